@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_BENCH_BENCH_HPP
+#define BOOST_CHANNELS_BENCH_BENCH_HPP
+
+// Minimal benchmark support shared by the programs in this directory.
+//
+// Each benchmark is a single translation unit, so this header also replaces
+// the global allocation functions in order to count heap allocations and the
+// blocks still live. For cache behaviour, run a benchmark under `perf stat -e cache-misses`.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+
+namespace bench {
+
+inline std::atomic< std::size_t >    allocations { 0 };
+inline std::atomic< std::ptrdiff_t > live_blocks { 0 };
+
+struct result
+{
+    double ns_per_op;
+    double allocs_per_op;
+};
+
+/// @brief Time f(), which is expected to perform ops operations.
+template < class F >
+result
+measure(std::size_t ops, F &&f)
+{
+    auto a0 = allocations.load();
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    auto a1 = allocations.load();
+    auto ns = std::chrono::duration< double, std::nano >(t1 - t0).count();
+    return { ns / double(ops), double(a1 - a0) / double(ops) };
+}
+
+inline void
+report(std::string_view name, result r)
+{
+    std::printf("%-48.*s %10.1f ns/op %8.2f allocs/op\n",
+                int(name.size()),
+                name.data(),
+                r.ns_per_op,
+                r.allocs_per_op);
+}
+
+/// @brief Report the number of heap blocks a benchmark left allocated.
+inline void
+report_retained(std::string_view name, std::ptrdiff_t blocks)
+{
+    std::printf("%-48.*s %10td blocks retained\n",
+                int(name.size()),
+                name.data(),
+                blocks);
+}
+
+}   // namespace bench
+
+void *
+operator new(std::size_t n)
+{
+    bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    bench::live_blocks.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void *p) noexcept
+{
+    if (p)
+        bench::live_blocks.fetch_sub(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+#endif   // BOOST_CHANNELS_BENCH_BENCH_HPP
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost per value of passing ints from one plain thread to another, with
+// async_send/async_consume waited on through asio::use_future versus the
+// blocking send and consume. Completions of the use_future operations run on
+// a thread of an io_context.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include <string>
+#include <thread>
+
+using namespace boost;
+
+namespace {
+
+template < class Send, class Consume >
+bench::result
+run(std::size_t capacity, std::size_t ops, Send send, Consume consume)
+{
+    auto ioc   = asio::io_context();
+    auto guard = asio::make_work_guard(ioc);
+    auto io    = std::thread([&] { ioc.run(); });
+    auto c     = channels::channel< int >(ioc.get_executor(), capacity);
+
+    long sum    = 0;
+    auto result = bench::measure(ops, [&] {
+        auto producer = std::thread([&] {
+            for (std::size_t i = 0; i < ops; ++i)
+                send(c, int(i));
+        });
+        for (std::size_t i = 0; i < ops; ++i)
+            sum += consume(c);
+        producer.join();
+    });
+
+    guard.reset();
+    io.join();
+    if (sum == 42)
+        std::printf("\n");
+    return result;
+}
+
+void
+send_future(channels::channel< int > &c, int v)
+{
+    c.async_send(v, asio::use_future).get();
+}
+
+int
+consume_future(channels::channel< int > &c)
+{
+    return c.async_consume(asio::use_future).get();
+}
+
+void
+send_blocking(channels::channel< int > &c, int v)
+{
+    channels::error_code ec;
+    c.send(v, ec);
+}
+
+int
+consume_blocking(channels::channel< int > &c)
+{
+    channels::error_code ec;
+    return c.consume(ec);
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = 100000;
+
+    for (std::size_t capacity : { 0, 64 })
+    {
+        auto suffix = capacity ? " buffered" : " unbuffered";
+        bench::report(std::string("use_future") + suffix,
+                      run(capacity, ops, send_future, consume_future));
+        bench::report(std::string("blocking send/consume") + suffix,
+                      run(capacity, ops, send_blocking, consume_blocking));
+    }
+}
@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost per value of fanning a string out to N subscribers, each of which
+// drains with consume_if after every batch. "channels" sends a copy into one
+// channel per subscriber. "broadcast" sends once into a broadcast_channel,
+// whose ring holds each value once.
+
+#include "bench.hpp"
+
+#include <boost/channels/broadcast_channel.hpp>
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+constexpr std::size_t batch = 64;
+
+bench::result
+channels_fanout(std::size_t subscribers, std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    std::vector< channels::channel< std::string > > cs;
+    for (std::size_t i = 0; i < subscribers; ++i)
+        cs.emplace_back(ioc.get_executor(), batch);
+
+    auto                 value = std::string(64, 'x');
+    std::size_t          bytes = 0;
+    channels::error_code ec;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            for (std::size_t i = 0; i < batch; ++i)
+                for (auto &c : cs)
+                    c.try_send(std::string(value), ec);
+            for (auto &c : cs)
+                while (auto v = c.consume_if(ec))
+                    bytes += v->size();
+        }
+    });
+}
+
+bench::result
+broadcast_fanout(std::size_t subscribers, std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::broadcast_channel< std::string >(ioc.get_executor(),
+                                                        batch);
+    std::vector< channels::broadcast_channel< std::string >::receiver_type >
+        rxs;
+    for (std::size_t i = 0; i < subscribers; ++i)
+        rxs.push_back(c.subscribe());
+
+    auto                 value = std::string(64, 'x');
+    std::size_t          bytes = 0;
+    channels::error_code ec;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            for (std::size_t i = 0; i < batch; ++i)
+                c.try_send(std::string(value), ec);
+            for (auto &rx : rxs)
+                while (auto v = rx.consume_if(ec))
+                    bytes += v->size();
+        }
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = batch * 4000;
+
+    for (std::size_t n : { 4, 32 })
+    {
+        auto suffix = " " + std::to_string(n) + " subscribers";
+        bench::report("channels" + suffix, channels_fanout(n, ops));
+        bench::report("broadcast" + suffix, broadcast_fanout(n, ops));
+    }
+}
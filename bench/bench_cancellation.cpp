@@ -0,0 +1,119 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost of an operation which is cancelled before a value arrives, as when it
+// loses a race in a parallel group, and the heap blocks still held once every
+// cancellation has completed. A cancelled op is withdrawn from its channel, so
+// the number retained should not grow with the number of ops. "abandoned"
+// starts the same ops without cancelling them, which is what every op used to
+// cost until the channel closed.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+#include <boost/channels/tie.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#ifdef BOOST_CHANNELS_HAS_CANCELLATION_SLOT
+#include <boost/asio/bind_cancellation_slot.hpp>
+#include <boost/asio/cancellation_signal.hpp>
+#endif
+
+#include <chrono>
+#include <optional>
+#include <string>
+
+using namespace boost;
+using namespace std::literals;
+
+#ifdef BOOST_CHANNELS_HAS_CANCELLATION_SLOT
+
+namespace {
+
+using string_channel = channels::channel< std::string >;
+
+/// @brief Run start(slot) ops times on one channel, cancelling each op through
+/// slot if cancel is true, and report the cost and the blocks retained.
+template < class Start >
+void
+run(std::string const &name, std::size_t ops, bool cancel, Start start)
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor());
+    auto sig = asio::cancellation_signal();
+
+    auto live0  = bench::live_blocks.load();
+    auto result = bench::measure(ops, [&] {
+        for (std::size_t i = 0; i < ops; ++i)
+        {
+            start(c, sig.slot());
+            if (cancel)
+                sig.emit(asio::cancellation_type::terminal);
+            ioc.poll();
+        }
+    });
+    auto retained = bench::live_blocks.load() - live0;
+
+    bench::report(name, result);
+    bench::report_retained(name, retained);
+    c.close();
+    ioc.poll();
+}
+
+void
+consume(string_channel &c, asio::cancellation_slot slot)
+{
+    c.async_consume(asio::bind_cancellation_slot(
+        slot, [](channels::error_code, std::string) {}));
+}
+
+void
+send_for(string_channel &c, asio::cancellation_slot slot)
+{
+    c.async_send_for(
+        std::string(64, 'x'),
+        1h,
+        asio::bind_cancellation_slot(
+            slot,
+            [](channels::error_code, std::optional< std::string >) {}));
+}
+
+void
+tie(string_channel &c, asio::cancellation_slot slot)
+{
+    static std::string s;
+    channels::tie(s << c).async_wait(
+        asio::bind_cancellation_slot(slot, [](channels::error_code, int) {}));
+}
+
+}   // namespace
+
+int
+main()
+{
+    for (std::size_t ops : { 1 << 12, 1 << 16 })
+    {
+        auto suffix = " x" + std::to_string(ops);
+        run("cancelled async_consume" + suffix, ops, true, consume);
+        run("abandoned async_consume" + suffix, ops, false, consume);
+        run("cancelled async_send_for" + suffix, ops, true, send_for);
+        run("cancelled tie" + suffix, ops, true, tie);
+    }
+}
+
+#else
+
+int
+main()
+{
+    std::puts("cancellation slots need asio from Boost 1.77 or later");
+}
+
+#endif
@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost per message of producing 1 KiB messages into a buffered channel, built
+// in a temporary and sent with async_send versus constructed in a claimed
+// slot with async_claim and published. The channel is drained with
+// consume_if between batches.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <array>
+#include <cstring>
+
+using namespace boost;
+
+namespace {
+
+struct message
+{
+    explicit message(std::size_t seq = 0)
+    : seq(seq)
+    {
+        std::memset(payload.data(), int(seq), payload.size());
+    }
+
+    std::size_t              seq;
+    std::array< char, 1024 > payload;
+};
+
+using message_channel = channels::channel< message >;
+
+constexpr std::size_t batch = 64;
+
+long
+drain(message_channel &c)
+{
+    long                 sum = 0;
+    channels::error_code ec;
+    while (auto m = c.consume_if(ec))
+        sum += m->payload[0];
+    return sum;
+}
+
+bench::result
+by_send(std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = message_channel(ioc.get_executor(), batch);
+
+    long sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            for (std::size_t i = 0; i < batch; ++i)
+                c.async_send(message(i), [](channels::error_code) {});
+            ioc.run();
+            ioc.restart();
+            sum += drain(c);
+        }
+    });
+}
+
+bench::result
+by_claim(std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = message_channel(ioc.get_executor(), batch);
+
+    long sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            for (std::size_t i = 0; i < batch; ++i)
+                c.async_claim([i](channels::error_code            ec,
+                                  message_channel::send_slot_type slot) {
+                    if (ec)
+                        return;
+                    slot.emplace(i);
+                    slot.publish(ec);
+                });
+            ioc.run();
+            ioc.restart();
+            sum += drain(c);
+        }
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = batch * 20000;
+
+    bench::report("async_send of a temporary", by_send(ops));
+    bench::report("async_claim, emplace, publish", by_claim(ops));
+}
@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Round trip latency of two loops on one io_context which pass a value back
+// and forth over a pair of unbuffered channels, as two coroutines playing
+// ping-pong would. Under completion_mode::post every hand-over goes through
+// the io_context's queue. Under completion_mode::dispatch the receiver runs
+// inline, up to BOOST_CHANNELS_INLINE_DEPTH deep.
+//
+// Also the cost per waiter of closing a channel on which many consumers wait.
+// Their handlers are posted to the io_context as one batch. Waiters spread
+// round robin over several strands or io_contexts are posted as one batch per
+// executor.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <cstdio>
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+using int_channel = channels::channel< int >;
+
+struct player
+{
+    // each received value is returned incremented, until the count is reached
+    void
+    next()
+    {
+        in.async_consume([this](channels::error_code ec, int v) {
+            if (ec)
+                return;
+            if (std::size_t(v) >= limit)
+            {
+                out.close();
+                return;
+            }
+            next();
+            out.async_send(v + 1, [](channels::error_code) {});
+        });
+    }
+
+    int_channel &in;
+    int_channel &out;
+    std::size_t  limit;
+};
+
+bench::result
+ping_pong(channels::completion_mode mode, std::size_t ops)
+{
+    auto ioc  = asio::io_context();
+    auto ping = int_channel(ioc.get_executor());
+    auto pong = int_channel(ioc.get_executor());
+    ping.set_completion_mode(mode);
+    pong.set_completion_mode(mode);
+
+    auto a = player { ping, pong, ops };
+    auto b = player { pong, ping, ops };
+    return bench::measure(ops, [&] {
+        a.next();
+        b.next();
+        asio::post(ioc, [&] {
+            ping.async_send(0, [](channels::error_code) {});
+        });
+        ioc.run();
+    });
+}
+
+bench::result
+close_waiters(std::size_t depth, std::size_t rounds, std::size_t strands = 0)
+{
+    auto ioc = asio::io_context();
+    auto s   = std::vector< asio::strand< asio::io_context::executor_type > >();
+    for (std::size_t i = 0; i < strands; ++i)
+        s.push_back(asio::make_strand(ioc));
+    return bench::measure(depth * rounds, [&] {
+        for (std::size_t r = 0; r < rounds; ++r)
+        {
+            auto c = int_channel(ioc.get_executor());
+            for (std::size_t i = 0; i < depth; ++i)
+                if (strands)
+                    c.async_consume(asio::bind_executor(
+                        s[i % strands], [](channels::error_code, int) {}));
+                else
+                    c.async_consume([](channels::error_code, int) {});
+            c.close();
+            ioc.run();
+            ioc.restart();
+        }
+    });
+}
+
+bench::result
+close_waiters_on_contexts(std::size_t depth,
+                          std::size_t rounds,
+                          std::size_t contexts)
+{
+    auto iocs = std::vector< asio::io_context >(contexts);
+    return bench::measure(depth * rounds, [&] {
+        for (std::size_t r = 0; r < rounds; ++r)
+        {
+            auto c = int_channel(iocs[0].get_executor());
+            for (std::size_t i = 0; i < depth; ++i)
+                c.async_consume(
+                    asio::bind_executor(iocs[i % contexts].get_executor(),
+                                        [](channels::error_code, int) {}));
+            c.close();
+            for (auto &ioc : iocs)
+            {
+                ioc.run();
+                ioc.restart();
+            }
+        }
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = 1000000;
+
+    // warm up asio's recycled handler memory
+    ping_pong(channels::completion_mode::post, 1024);
+
+    bench::report("ping-pong, completion_mode::post",
+                  ping_pong(channels::completion_mode::post, ops));
+    bench::report("ping-pong, completion_mode::dispatch",
+                  ping_pong(channels::completion_mode::dispatch, ops));
+
+    for (std::size_t depth : { 1, 16, 1024 })
+    {
+        char label[64];
+        std::snprintf(label, sizeof(label), "close, waiters=%zu", depth);
+        bench::report(label, close_waiters(depth, ops / depth));
+    }
+    bench::report("close, waiters=1024, strands=64",
+                  close_waiters(1024, ops / 1024, 64));
+    bench::report("close, waiters=1024, io_contexts=64",
+                  close_waiters_on_contexts(1024, ops / 1024, 64));
+}
@@ -0,0 +1,79 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost per value of consuming 4 KiB frames, moved out with async_consume
+// versus visited in place with async_consume_inplace. Frames are taken both
+// from a buffered channel and directly from waiting senders.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <array>
+
+using namespace boost;
+
+namespace {
+
+using frame = std::array< char, 4096 >;
+
+constexpr std::size_t batch = 64;
+
+template < class Consume >
+bench::result
+run(std::size_t capacity, std::size_t ops, Consume consume)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< frame >(ioc.get_executor(), capacity);
+
+    auto f   = frame {};
+    long sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            for (std::size_t i = 0; i < batch; ++i)
+            {
+                f[0] = char(i);
+                c.async_send(f, [](channels::error_code) {});
+            }
+            for (std::size_t i = 0; i < batch; ++i)
+                consume(c, sum);
+            ioc.run();
+            ioc.restart();
+        }
+    });
+}
+
+void
+by_move(channels::channel< frame > &c, long &sum)
+{
+    c.async_consume([&](channels::error_code, frame f) { sum += f[0]; });
+}
+
+void
+in_place(channels::channel< frame > &c, long &sum)
+{
+    c.async_consume_inplace([&](frame &f) { sum += f[0]; },
+                            [](channels::error_code) {});
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = batch * 5000;
+
+    bench::report("buffered async_consume", run(batch, ops, by_move));
+    bench::report("buffered async_consume_inplace", run(batch, ops, in_place));
+    bench::report("rendezvous async_consume", run(0, ops, by_move));
+    bench::report("rendezvous async_consume_inplace", run(0, ops, in_place));
+}
@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost per value of draining a full buffered channel, with one async_consume
+// per value versus one async_consume_some per batch. The channel is refilled
+// with async_send_range between batches.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+constexpr std::size_t batch = 64;
+
+void
+fill(channels::channel< int > &c, std::vector< int > &values)
+{
+    for (std::size_t i = 0; i < batch; ++i)
+        values[i] = int(i);
+    c.async_send_range(values.begin(),
+                       values.end(),
+                       [](channels::error_code, std::size_t) {});
+}
+
+bench::result
+one_by_one(std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), batch);
+
+    std::vector< int > values(batch);
+    long               sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            fill(c, values);
+            for (std::size_t i = 0; i < batch; ++i)
+                c.async_consume(
+                    [&](channels::error_code, int v) { sum += v; });
+            ioc.run();
+            ioc.restart();
+        }
+    });
+}
+
+bench::result
+as_batch(std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), batch);
+
+    std::vector< int > values(batch);
+    std::vector< int > out;
+    out.reserve(batch);
+    long sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            fill(c, values);
+            out.clear();
+            c.async_consume_some(
+                batch, out, [&](channels::error_code, std::size_t) {
+                    for (auto v : out)
+                        sum += v;
+                });
+            ioc.run();
+            ioc.restart();
+        }
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = batch * 20000;
+
+    bench::report("async_consume x64, per value", one_by_one(ops));
+    bench::report("async_consume_some of 64, per value", as_batch(ops));
+}
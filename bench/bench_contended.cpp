@@ -0,0 +1,158 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost of sending and consuming when producers and consumers run on
+// different threads, so that ops are matched and completed concurrently.
+// Each party chains its next op from the completion of the previous one on
+// its own io_context.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+#include <boost/channels/channel_consumer.hpp>
+#include <boost/channels/tie.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+using int_channel = channels::channel< int >;
+
+struct sender
+{
+    void
+    next()
+    {
+        if (remaining == 0)
+            return;
+        --remaining;
+        c.async_send(1, asio::bind_executor(ioc, [this](channels::error_code) {
+                         next();
+                     }));
+    }
+
+    int_channel      &c;
+    asio::io_context &ioc;
+    std::size_t       remaining;
+};
+
+struct receiver
+{
+    void
+    next()
+    {
+        if (remaining == 0)
+            return;
+        --remaining;
+        c.async_consume(
+            asio::bind_executor(ioc, [this](channels::error_code, int v) {
+                sum += v;
+                next();
+            }));
+    }
+
+    int_channel      &c;
+    asio::io_context &ioc;
+    std::size_t       remaining;
+    long              sum = 0;
+};
+
+struct selector
+{
+    void
+    next()
+    {
+        if (remaining == 0)
+            return;
+        --remaining;
+        channels::tie(v1 << c1, v2 << c2)
+            .async_wait(
+                asio::bind_executor(ioc, [this](channels::error_code, int) {
+                    next();
+                }));
+    }
+
+    int_channel      &c1;
+    int_channel      &c2;
+    asio::io_context &ioc;
+    std::size_t       remaining;
+    int               v1 = 0;
+    int               v2 = 0;
+};
+
+// run each io_context on its own thread until all of them run out of work
+void
+run_all(std::vector< asio::io_context * > const &iocs)
+{
+    std::vector< std::thread > threads;
+    for (auto ioc : iocs)
+        threads.emplace_back([ioc] { ioc->run(); });
+    for (auto &t : threads)
+        t.join();
+}
+
+bench::result
+send_consume(std::size_t capacity, std::size_t ops)
+{
+    auto chan_ioc = asio::io_context();
+    auto pioc     = asio::io_context();
+    auto cioc     = asio::io_context();
+    auto c        = int_channel(chan_ioc.get_executor(), capacity);
+
+    auto s = sender { c, pioc, ops };
+    auto r = receiver { c, cioc, ops };
+    return bench::measure(ops, [&] {
+        asio::post(pioc, [&] { s.next(); });
+        asio::post(cioc, [&] { r.next(); });
+        run_all({ &pioc, &cioc });
+    });
+}
+
+bench::result
+contended_select(std::size_t ops)
+{
+    auto chan_ioc = asio::io_context();
+    auto p1ioc    = asio::io_context();
+    auto p2ioc    = asio::io_context();
+    auto cioc     = asio::io_context();
+    auto c1       = int_channel(chan_ioc.get_executor());
+    auto c2       = int_channel(chan_ioc.get_executor());
+
+    // two producers race to complete each select
+    auto s1  = sender { c1, p1ioc, ops / 2 };
+    auto s2  = sender { c2, p2ioc, ops / 2 };
+    auto sel = selector { c1, c2, cioc, ops / 2 * 2 };
+    return bench::measure(ops, [&] {
+        asio::post(p1ioc, [&] { s1.next(); });
+        asio::post(p2ioc, [&] { s2.next(); });
+        asio::post(cioc, [&] { sel.next(); });
+        run_all({ &p1ioc, &p2ioc, &cioc });
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = 200000;
+
+    bench::report("send/consume across threads, capacity 0",
+                  send_consume(0, ops));
+    bench::report("send/consume across threads, capacity 16",
+                  send_consume(16, ops));
+    bench::report("tie() select, 2 producer threads", contended_select(ops));
+}
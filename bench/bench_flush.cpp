@@ -0,0 +1,158 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost of parking ops in a channel's wait queues and of matching them in
+// flush_not_closed. The std::deque based queue which the channel used to
+// have is measured alongside for comparison.
+
+#include "bench.hpp"
+
+#include <boost/channels/detail/implement_channel_queue.hpp>
+
+#include <deque>
+#include <memory>
+#include <queue>
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+struct bench_producer final : channels::detail::produce_op_interface< int >
+{
+    bench_producer()
+    : basic_produce_op_interface(this, &round_state_)
+    {
+    }
+
+    // make the op claimable again so that it can be reused by the next round
+    void
+    reset()
+    {
+        std::destroy_at(&round_state_);
+        std::construct_at(&round_state_);
+    }
+
+    int
+    consume()
+    {
+        return 1;
+    }
+
+    void
+    fail(channels::error_code)
+    {
+    }
+
+    channels::detail::completion_state round_state_;
+};
+
+struct bench_consumer final : channels::detail::consume_op_interface< int >
+{
+    bench_consumer()
+    : basic_consume_op_interface(this, &round_state_)
+    {
+    }
+
+    // make the op claimable again so that it can be reused by the next round
+    void
+    reset()
+    {
+        std::destroy_at(&round_state_);
+        std::construct_at(&round_state_);
+    }
+
+    void
+    commit(value_type &&v)
+    {
+        sum_ += std::get< 1 >(v);
+    }
+
+    long                               sum_ = 0;
+    channels::detail::completion_state round_state_;
+};
+
+template < class Op >
+using deque_queue = std::queue< boost::intrusive_ptr< Op >,
+                                std::deque< boost::intrusive_ptr< Op > > >;
+
+template < class Queue, class Op >
+void
+park_unpark(std::vector< boost::intrusive_ptr< Op > > const &ops,
+            std::size_t                                rounds)
+{
+    for (std::size_t r = 0; r < rounds; ++r)
+    {
+        // a fresh queue per round models an idle channel becoming busy
+        Queue q;
+        for (auto &op : ops)
+            q.push(op);
+        while (!q.empty())
+            q.pop();
+    }
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t rounds = 2000;
+
+    for (std::size_t depth : { 1, 16, 1024 })
+    {
+        std::vector< boost::intrusive_ptr< bench_producer > > producers;
+        std::vector< boost::intrusive_ptr< bench_consumer > > consumers;
+        for (std::size_t i = 0; i < depth; ++i)
+        {
+            producers.push_back(new bench_producer);
+            consumers.push_back(new bench_consumer);
+        }
+
+        auto ops   = rounds * depth;
+        auto label = [&](char const *what) {
+            static char buf[64];
+            std::snprintf(buf, sizeof(buf), "%s depth=%zu", what, depth);
+            return std::string_view(buf);
+        };
+
+        bench::report(
+            label("park/unpark std::deque"), bench::measure(ops, [&] {
+                park_unpark< deque_queue< channels::detail::produce_op_interface<
+                    int > > >(producers, rounds);
+            }));
+
+        bench::report(
+            label("park/unpark basic_op_queue"), bench::measure(ops, [&] {
+                park_unpark< channels::detail::producer_queue< int > >(
+                    producers, rounds);
+            }));
+
+        bench::report(
+            label("flush_not_closed handoff"), bench::measure(ops, [&] {
+                channels::detail::value_buffer_data data { 0 };
+                auto values = channels::detail::value_buffer_ref< int > {
+                    .pdata = &data, .storage = nullptr
+                };
+                for (std::size_t r = 0; r < rounds; ++r)
+                {
+                    channels::detail::consumer_queue< int > cq;
+                    channels::detail::producer_queue< int > pq;
+                    for (std::size_t i = 0; i < depth; ++i)
+                    {
+                        producers[i]->reset();
+                        consumers[i]->reset();
+                        pq.push(producers[i]);
+                        cq.push(consumers[i]);
+                    }
+                    channels::detail::flush_not_closed(values, cq, pq);
+                }
+            }));
+    }
+}
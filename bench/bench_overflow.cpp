@@ -0,0 +1,73 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost per value of async_sends into a channel whose consumer has fallen
+// behind: each batch is four times the buffer, and is drained once it has
+// been sent. With overflow_policy::block the senders beyond the buffer park
+// and are admitted as the consumer makes room. The lossy policies complete
+// every send at once without allocating an op.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+using namespace boost;
+
+namespace {
+
+constexpr std::size_t capacity = 64;
+constexpr std::size_t batch    = capacity * 4;
+
+bench::result
+overflowing(channels::overflow_policy policy, std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), capacity, policy);
+
+    long sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            for (std::size_t i = 0; i < batch; ++i)
+                c.async_send(int(i), [](channels::error_code) {});
+
+            // consume_if admits parked senders as it makes room
+            channels::error_code ec;
+            for (bool more = true; more;)
+            {
+                ioc.poll();
+                ioc.restart();
+                more = false;
+                while (auto v = c.consume_if(ec))
+                {
+                    sum += *v;
+                    more = true;
+                }
+            }
+        }
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = batch * 10000;
+
+    using channels::overflow_policy;
+    bench::report("block", overflowing(overflow_policy::block, ops));
+    bench::report("drop_newest",
+                  overflowing(overflow_policy::drop_newest, ops));
+    bench::report("drop_oldest",
+                  overflowing(overflow_policy::drop_oldest, ops));
+    bench::report("reject", overflowing(overflow_policy::reject, ops));
+}
@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost of receiving one control message sent behind a backlog of bulk
+// messages. With a single channel the consumer must first take the whole
+// backlog. With a two lane priority channel the control message is sent on
+// lane 0 and is taken first. Each operation is one round of topping up the
+// backlog, sending the control message and receiving it.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+#include <boost/channels/priority_channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <string>
+
+using namespace boost;
+
+namespace {
+
+constexpr int control = -1;
+
+bench::result
+single_channel(std::size_t backlog, std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), backlog + 1);
+
+    channels::error_code ec;
+    long                 sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t n = 0; n < ops; ++n)
+        {
+            for (std::size_t i = 0; i < backlog; ++i)
+                c.try_send(int(i), ec);
+            c.try_send(int(control), ec);
+
+            while (auto v = c.consume_if(ec))
+            {
+                if (*v == control)
+                    break;
+                sum += *v;
+            }
+        }
+    });
+}
+
+bench::result
+priority_channel(std::size_t backlog, std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::priority_channel< int, 2 >(
+        ioc.get_executor(), { 1, backlog });
+
+    channels::error_code ec;
+    long                 sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t n = 0; n < ops; ++n)
+        {
+            // only the control message is taken, so the backlog stays full
+            for (int i = 0; c.try_send(1, int(i), ec); ++i)
+                ;
+            c.try_send(0, int(control), ec);
+
+            sum += *c.consume_if(ec);
+        }
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = 1 << 14;
+
+    for (std::size_t backlog : { 16, 256, 4096 })
+    {
+        auto suffix = " backlog " + std::to_string(backlog);
+        bench::report("channel" + suffix, single_channel(backlog, ops));
+        bench::report("priority_channel" + suffix,
+                      priority_channel(backlog, ops));
+    }
+}
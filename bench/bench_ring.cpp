@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Push/pop throughput of each ring implementation, single threaded. The ring
+// is repeatedly filled to capacity and drained, so large capacities also
+// measure the cost of streaming values through memory. Capacities which are
+// not powers of two take the division path.
+
+#include "bench.hpp"
+
+#include <boost/channels/detail/concurrency_traits.hpp>
+
+#include <cstdlib>
+#include <string>
+
+using namespace boost;
+
+namespace {
+
+template < class Concurrency >
+bench::result
+fill_drain(std::size_t capacity, std::size_t ops)
+{
+    using traits_type = channels::detail::concurrency_traits< Concurrency >;
+    using ring_type   = typename traits_type::template ring_ref< long >;
+    using slot_type   = typename ring_type::slot_type;
+
+    auto data    = typename traits_type::ring_data(capacity);
+    auto storage = static_cast< slot_type * >(
+        std::calloc(capacity, sizeof(slot_type)));
+    auto ring = ring_type { &data, storage };
+    ring.init();
+
+    long sum    = 0;
+    auto result = bench::measure(ops, [&] {
+        std::size_t done = 0;
+        long        v    = 0;
+        while (done < ops)
+        {
+            while (ring.try_push_with([&] { return v++; }))
+                ;
+            while (ring.try_pop_with([&](long &&x) { sum += x; }))
+                ++done;
+        }
+    });
+
+    ring.destroy();
+    std::free(storage);
+    if (sum == 42)
+        std::printf("\n");
+    return result;
+}
+
+template < class Concurrency >
+void
+run(char const *model)
+{
+    constexpr std::size_t ops = 1 << 22;
+
+    for (std::size_t capacity :
+         { 1, 16, 1000, 1024, 65536, 1000000, 1 << 20 })
+    {
+        auto name = std::string(model) + " push/pop capacity " +
+                    std::to_string(capacity);
+        bench::report(name, fill_drain< Concurrency >(capacity, ops));
+    }
+}
+
+}   // namespace
+
+int
+main()
+{
+    run< channels::concurrency::locked >("locked");
+    run< channels::concurrency::spsc >("spsc");
+    run< channels::concurrency::mpmc >("mpmc");
+}
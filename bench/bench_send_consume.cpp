@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Steady state cost of an async_send matched with an async_consume on a
+// single threaded io_context, including the posting of both completions.
+// "concrete executor" names io_context::executor_type as the channel's
+// executor, so that no executor is type-erased on the way.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+
+using namespace boost;
+
+namespace {
+
+template < class Channel >
+struct pinger
+{
+    // each completed consume starts the next round, so that all ops are
+    // initiated from within the io_context as they would be in a program
+    void
+    next()
+    {
+        if (remaining == 0)
+            return;
+        --remaining;
+        c.async_consume([this](channels::error_code, int v) {
+            sum += v;
+            next();
+        });
+        c.async_send(1, [](channels::error_code) {});
+    }
+
+    Channel    &c;
+    std::size_t remaining;
+    long        sum = 0;
+};
+
+template < class Channel >
+bench::result
+ping(std::size_t capacity, std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = Channel(ioc.get_executor(), capacity);
+
+    // warm up asio's recycled handler memory
+    auto warm = pinger< Channel > { c, 16 };
+    asio::post(ioc, [&] { warm.next(); });
+    ioc.run();
+    ioc.restart();
+
+    auto p = pinger< Channel > { c, ops };
+    return bench::measure(ops, [&] {
+        asio::post(ioc, [&] { p.next(); });
+        ioc.run();
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = 1000000;
+
+    bench::report("consume then send, capacity 0",
+                  ping< channels::channel< int > >(0, ops));
+    bench::report("consume then send, capacity 16",
+                  ping< channels::channel< int > >(16, ops));
+
+    using concrete_channel =
+        channels::channel< int, asio::io_context::executor_type >;
+    bench::report("consume then send, capacity 0, concrete executor",
+                  ping< concrete_channel >(0, ops));
+}
@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost per value of sending a batch into a buffered channel, with one
+// async_send per value versus one async_send_range per batch. The channel is
+// drained with consume_if between batches.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+constexpr std::size_t batch = 64;
+
+long
+drain(channels::channel< int > &c)
+{
+    long                 sum = 0;
+    channels::error_code ec;
+    while (auto v = c.consume_if(ec))
+        sum += *v;
+    return sum;
+}
+
+bench::result
+one_by_one(std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), batch);
+
+    long sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            for (std::size_t i = 0; i < batch; ++i)
+                c.async_send(int(i), [](channels::error_code) {});
+            ioc.run();
+            ioc.restart();
+            sum += drain(c);
+        }
+    });
+}
+
+bench::result
+as_range(std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), batch);
+
+    std::vector< int > values(batch);
+    long               sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            for (std::size_t i = 0; i < batch; ++i)
+                values[i] = int(i);
+            c.async_send_range(values.begin(),
+                               values.end(),
+                               [](channels::error_code, std::size_t) {});
+            ioc.run();
+            ioc.restart();
+            sum += drain(c);
+        }
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = batch * 20000;
+
+    bench::report("async_send x64, per value", one_by_one(ops));
+    bench::report("async_send_range of 64, per value", as_range(ops));
+}
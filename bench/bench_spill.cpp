@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost per record of a burst of async_sends which overflows a buffer of 1024
+// records, drained with consume_if once the burst has been sent. Senders
+// beyond the locked channel's buffer park until it is drained. The spilling
+// channel appends them to memory-mapped files in the temporary directory.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <string>
+
+using namespace boost;
+
+namespace {
+
+struct record
+{
+    long   seq;
+    double values[7];
+};
+
+template < class Concurrency >
+using record_channel =
+    channels::channel< record, asio::any_io_executor, std::mutex, Concurrency >;
+
+template < class Channel >
+bench::result
+burst(Channel          &c,
+      asio::io_context &ioc,
+      std::size_t       burst_size,
+      std::size_t       ops)
+{
+    long sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += burst_size)
+        {
+            for (std::size_t i = 0; i < burst_size; ++i)
+                c.async_send(record { long(i), {} },
+                             [](channels::error_code) {});
+
+            // consume_if admits parked senders as it makes room
+            std::size_t          received = 0;
+            channels::error_code ec;
+            while (received < burst_size)
+            {
+                ioc.poll();
+                ioc.restart();
+                while (auto r = c.consume_if(ec))
+                {
+                    sum += r->seq;
+                    ++received;
+                }
+            }
+            ioc.poll();
+            ioc.restart();
+        }
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t capacity = 1024;
+    constexpr std::size_t ops      = 1 << 21;
+
+    for (std::size_t burst_size : { 1024, 16384, 262144 })
+    {
+        auto suffix = " burst " + std::to_string(burst_size);
+        {
+            auto ioc = asio::io_context();
+            auto c   = record_channel< channels::concurrency::locked >(
+                ioc.get_executor(), capacity);
+            bench::report("locked" + suffix, burst(c, ioc, burst_size, ops));
+        }
+        {
+            auto options           = channels::spill_options();
+            options.segment_size   = std::size_t(4) << 20;
+            options.max_spill_size = std::size_t(256) << 20;
+            auto ioc               = asio::io_context();
+            auto c = record_channel< channels::concurrency::spill >(
+                ioc.get_executor(), capacity, options);
+            bench::report("spill" + suffix, burst(c, ioc, burst_size, ops));
+        }
+    }
+}
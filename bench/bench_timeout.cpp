@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost of a consume with a timeout which a value beats, the common case, with
+// N such consumes outstanding on N channels. "steady_timer" pairs each
+// async_consume with a steady_timer of its own, which must be cancelled when
+// the value arrives. "consume_for" uses async_consume_for, whose deadline is
+// a node in the execution context's timer wheel.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+using namespace boost;
+using namespace std::literals;
+
+namespace {
+
+using int_channel = channels::channel< int >;
+
+bench::result
+steady_timer_consume(std::size_t n, std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    std::vector< std::unique_ptr< int_channel > >        cs;
+    std::vector< std::unique_ptr< asio::steady_timer > > timers;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        cs.push_back(std::make_unique< int_channel >(ioc.get_executor(), 1));
+        timers.push_back(
+            std::make_unique< asio::steady_timer >(ioc.get_executor()));
+    }
+
+    long                              sum = 0;
+    std::function< void(std::size_t) > start = [&](std::size_t i) {
+        timers[i]->expires_after(1h);
+        timers[i]->async_wait([](channels::error_code) {});
+        cs[i]->async_consume([&, i](channels::error_code ec, int v) {
+            timers[i]->cancel();
+            if (!ec)
+            {
+                sum += v;
+                start(i);
+            }
+        });
+    };
+    for (std::size_t i = 0; i < n; ++i)
+        start(i);
+    ioc.poll();
+
+    channels::error_code ec;
+    auto result = bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; ++done)
+        {
+            cs[done % n]->try_send(1, ec);
+            ioc.poll();
+        }
+    });
+    for (auto &c : cs)
+        c->close();
+    ioc.poll();
+    return result;
+}
+
+bench::result
+consume_for(std::size_t n, std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    std::vector< std::unique_ptr< int_channel > > cs;
+    for (std::size_t i = 0; i < n; ++i)
+        cs.push_back(std::make_unique< int_channel >(ioc.get_executor(), 1));
+
+    long                              sum = 0;
+    std::function< void(std::size_t) > start = [&](std::size_t i) {
+        cs[i]->async_consume_for(1h, [&, i](channels::error_code ec, int v) {
+            if (!ec)
+            {
+                sum += v;
+                start(i);
+            }
+        });
+    };
+    for (std::size_t i = 0; i < n; ++i)
+        start(i);
+    ioc.poll();
+
+    channels::error_code ec;
+    auto result = bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; ++done)
+        {
+            cs[done % n]->try_send(1, ec);
+            ioc.poll();
+        }
+    });
+    for (auto &c : cs)
+        c->close();
+    ioc.poll();
+    return result;
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = 1 << 19;
+
+    for (std::size_t n : { 1, 1024 })
+    {
+        auto suffix = " " + std::to_string(n) + " outstanding";
+        bench::report("steady_timer" + suffix, steady_timer_consume(n, ops));
+        bench::report("consume_for" + suffix, consume_for(n, ops));
+    }
+}
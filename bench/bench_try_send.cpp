@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost per value of sending into a busy channel with async_send versus
+// try_send. "buffered" fills a buffer which is drained with consume_if
+// between batches. "handoff" gives each value to a consumer which is already
+// waiting.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+using namespace boost;
+
+namespace {
+
+constexpr std::size_t batch = 64;
+
+long
+drain(channels::channel< int > &c)
+{
+    long                 sum = 0;
+    channels::error_code ec;
+    while (auto v = c.consume_if(ec))
+        sum += *v;
+    return sum;
+}
+
+template < class Send >
+bench::result
+buffered(std::size_t ops, Send send)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), batch);
+
+    long sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += batch)
+        {
+            for (std::size_t i = 0; i < batch; ++i)
+                send(c, int(i));
+            ioc.run();
+            ioc.restart();
+            sum += drain(c);
+        }
+    });
+}
+
+template < class Send >
+bench::result
+handoff(std::size_t ops, Send send)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor());
+
+    long sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t i = 0; i < ops; ++i)
+        {
+            c.async_consume([&](channels::error_code, int v) { sum += v; });
+            send(c, int(i));
+            ioc.run();
+            ioc.restart();
+        }
+    });
+}
+
+void
+by_async_send(channels::channel< int > &c, int v)
+{
+    c.async_send(v, [](channels::error_code) {});
+}
+
+void
+by_try_send(channels::channel< int > &c, int v)
+{
+    channels::error_code ec;
+    c.try_send(std::move(v), ec);
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = batch * 20000;
+
+    bench::report("buffered async_send", buffered(ops, by_async_send));
+    bench::report("buffered try_send", buffered(ops, by_try_send));
+    bench::report("handoff async_send", handoff(ops, by_async_send));
+    bench::report("handoff try_send", handoff(ops, by_try_send));
+}
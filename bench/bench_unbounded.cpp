@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost per value of a burst of async_sends which is larger than a bounded
+// channel's buffer, drained with consume_if once the burst has been sent.
+// Senders beyond the bounded buffer's capacity park until it is drained. The
+// unbounded channel stores the whole burst in its chunks.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <string>
+
+using namespace boost;
+
+namespace {
+
+template < class Concurrency >
+using int_channel =
+    channels::channel< int, asio::any_io_executor, std::mutex, Concurrency >;
+
+template < class Concurrency >
+bench::result
+burst(std::size_t capacity, std::size_t burst_size, std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = int_channel< Concurrency >(ioc.get_executor(), capacity);
+
+    long sum = 0;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += burst_size)
+        {
+            for (std::size_t i = 0; i < burst_size; ++i)
+                c.async_send(int(i), [](channels::error_code) {});
+
+            // consume_if admits parked senders as it makes room
+            std::size_t          received = 0;
+            channels::error_code ec;
+            while (received < burst_size)
+            {
+                ioc.poll();
+                ioc.restart();
+                while (auto v = c.consume_if(ec))
+                {
+                    sum += *v;
+                    ++received;
+                }
+            }
+            ioc.poll();
+            ioc.restart();
+        }
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t capacity = 64;
+    constexpr std::size_t ops      = 1 << 22;
+
+    for (std::size_t burst_size : { 64, 1024, 16384 })
+    {
+        auto suffix = " burst " + std::to_string(burst_size);
+        bench::report(
+            "locked capacity 64" + suffix,
+            burst< channels::concurrency::locked >(capacity, burst_size, ops));
+        bench::report(
+            "unbounded" + suffix,
+            burst< channels::concurrency::unbounded >(0, burst_size, ops));
+    }
+}
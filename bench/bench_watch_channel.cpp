@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// "read" is the cost of fetching the latest value while readers on other
+// threads poll the same channel, for a trivially copyable value (sequence
+// lock) and a string (shared snapshot). "burst" sends 100 updates between
+// each drain, which a buffered channel must deliver one by one and a watch
+// channel conflates into the last.
+
+#include "bench.hpp"
+
+#include <boost/channels/channel.hpp>
+#include <boost/channels/watch_channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+struct position
+{
+    double x, y, z;
+};
+
+template < class T >
+bench::result
+read(T initial, int pollers, std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::watch_channel< T >(ioc.get_executor(), initial);
+
+    std::atomic< bool >        done { false };
+    std::vector< std::thread > threads;
+    for (int i = 0; i < pollers; ++i)
+        threads.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed))
+                (void)c.get();
+        });
+
+    auto                 rx = c.subscribe();
+    channels::error_code ec;
+    std::size_t          seen = 0;
+    auto result = bench::measure(ops, [&] {
+        for (std::size_t i = 0; i < ops; ++i)
+        {
+            if (i % 64 == 0)
+                c.send(initial, ec);
+            seen += bool(rx.consume_if(ec));
+        }
+    });
+    done = true;
+    for (auto &t : threads)
+        t.join();
+    return result;
+}
+
+constexpr std::size_t burst_size = 100;
+
+bench::result
+burst_channel(std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), burst_size);
+
+    long                 sum = 0;
+    channels::error_code ec;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += burst_size)
+        {
+            for (std::size_t i = 0; i < burst_size; ++i)
+                c.try_send(int(i), ec);
+            while (auto v = c.consume_if(ec))
+                sum += *v;
+        }
+    });
+}
+
+bench::result
+burst_watch(std::size_t ops)
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::watch_channel< int >(ioc.get_executor());
+    auto rx  = c.subscribe();
+
+    long                 sum = 0;
+    channels::error_code ec;
+    return bench::measure(ops, [&] {
+        for (std::size_t done = 0; done < ops; done += burst_size)
+        {
+            for (std::size_t i = 0; i < burst_size; ++i)
+                c.send(int(i), ec);
+            while (auto v = rx.consume_if(ec))
+                sum += *v;
+        }
+    });
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = 1 << 22;
+
+    for (int pollers : { 0, 3 })
+    {
+        auto suffix = " with " + std::to_string(pollers) + " pollers";
+        bench::report("read position" + suffix,
+                      read(position { 1, 2, 3 }, pollers, ops));
+        bench::report("read string" + suffix,
+                      read(std::string(32, 'x'), pollers, ops));
+    }
+    bench::report("burst channel", burst_channel(ops));
+    bench::report("burst watch_channel", burst_watch(ops));
+}
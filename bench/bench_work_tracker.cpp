@@ -0,0 +1,151 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+// Cost of keeping a context running for the duration of one op: a share of a
+// channel's work_tracker against a tracked executor held by the op. "held"
+// keeps one op waiting throughout, as in a busy channel, so the counts never
+// fall to zero. Each is measured through any_io_executor and through the
+// io_context's own executor type.
+//
+// A lone op takes the context's work and gives it up again, which costs a
+// share more than a tracked executor on its own. "round trip" includes
+// posting the op's handler through the executor it keeps and running it,
+// where every copy the post makes of a tracked executor counts work again.
+
+#include "bench.hpp"
+
+#include <boost/channels/detail/work_tracker.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+using tracker_type = channels::detail::work_tracker< std::mutex >;
+
+template < class F >
+bench::result
+run_threads(std::size_t threads, std::size_t ops, F f)
+{
+    return bench::measure(ops * threads, [&] {
+        std::vector< std::thread > workers;
+        for (std::size_t t = 0; t < threads; ++t)
+            workers.emplace_back([&] {
+                for (std::size_t i = 0; i < ops; ++i)
+                    f();
+            });
+        for (auto &w : workers)
+            w.join();
+    });
+}
+
+template < class Executor >
+bench::result
+per_op(Executor const &exec, std::size_t threads, std::size_t ops)
+{
+    return run_threads(threads, ops, [&] {
+        auto work =
+            asio::prefer(exec, asio::execution::outstanding_work.tracked);
+        (void)work;
+    });
+}
+
+template < class Executor >
+bench::result
+tracked(Executor const &exec, std::size_t threads, std::size_t ops, bool held)
+{
+    auto tracker = tracker_type::create();
+    std::optional< channels::detail::counted_work< std::mutex > > keep;
+    if (held)
+        keep.emplace(tracker->acquire(exec));
+    auto r = run_threads(threads, ops, [&] {
+        auto work = tracker->acquire(exec);
+        (void)work;
+    });
+    keep.reset();
+    tracker->retire();
+    return r;
+}
+
+template < class Executor >
+bench::result
+per_op_round_trip(asio::io_context &ioc, Executor const &exec, std::size_t ops)
+{
+    return bench::measure(ops, [&] {
+        for (std::size_t i = 0; i < ops; ++i)
+        {
+            auto work =
+                asio::prefer(exec, asio::execution::outstanding_work.tracked);
+            asio::post(std::move(work), [] {});
+            ioc.poll_one();
+        }
+    });
+}
+
+template < class Executor >
+bench::result
+tracked_round_trip(asio::io_context &ioc, Executor const &exec, std::size_t ops)
+{
+    auto tracker = tracker_type::create();
+    auto r       = bench::measure(ops, [&] {
+        for (std::size_t i = 0; i < ops; ++i)
+        {
+            {
+                auto work = tracker->acquire(exec);
+                asio::post(exec, [] {});
+            }
+            ioc.poll_one();
+        }
+    });
+    tracker->retire();
+    return r;
+}
+
+}   // namespace
+
+int
+main()
+{
+    constexpr std::size_t ops = 2000000;
+
+    auto ioc  = asio::io_context();
+    auto exec = asio::any_io_executor(ioc.get_executor());
+    auto conc = ioc.get_executor();
+
+    bench::report("tracked executor per op", per_op(exec, 1, ops));
+    bench::report("work_tracker share", tracked(exec, 1, ops, false));
+    bench::report("work_tracker share, held", tracked(exec, 1, ops, true));
+    bench::report("tracked executor per op, round trip",
+                  per_op_round_trip(ioc, exec, ops));
+    bench::report("work_tracker share, round trip",
+                  tracked_round_trip(ioc, exec, ops));
+
+    bench::report("concrete, tracked executor per op", per_op(conc, 1, ops));
+    bench::report("concrete, work_tracker share",
+                  tracked(conc, 1, ops, false));
+    bench::report("concrete, work_tracker share, held",
+                  tracked(conc, 1, ops, true));
+    bench::report("concrete, tracked executor per op, round trip",
+                  per_op_round_trip(ioc, conc, ops));
+    bench::report("concrete, work_tracker share, round trip",
+                  tracked_round_trip(ioc, conc, ops));
+
+    bench::report("tracked executor per op, 4 threads",
+                  per_op(exec, 4, ops / 4));
+    bench::report("work_tracker share, held, 4 threads",
+                  tracked(exec, 4, ops / 4, true));
+}
@@ -57,16 +57,13 @@ thread_producer(std::string name, channels::channel< std::string > &chan)
     int count = 0;
     for (;;)
     {
-        try
-        {
-            chan.async_send("producer "s + name + " : message "s +
-                                std::to_string(++count),
-                            asio::use_future)
-                .get();
-        }
-        catch (std::exception &e)
+        channels::error_code ec;
+        chan.send("producer "s + name + " : message "s +
+                      std::to_string(++count),
+                  ec);
+        if (ec)
         {
-            println("producer", name, "stopping with error", e.what());
+            println("producer", name, "stopping with error", ec.message());
             break;
         }
     }
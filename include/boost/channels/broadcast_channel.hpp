@@ -0,0 +1,386 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_BROADCAST_CHANNEL_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_BROADCAST_CHANNEL_HPP
+
+#include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/detail/broadcast_channel_impl.hpp>
+#include <boost/channels/detail/cancellation.hpp>
+#include <boost/channels/detail/consumer_op_function.hpp>
+#include <boost/channels/detail/free_deleter.hpp>
+#include <boost/channels/detail/postit.hpp>
+#include <boost/channels/detail/producer_op_function.hpp>
+#include <boost/channels/error_code.hpp>
+#include <boost/channels/overflow_policy.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace boost::channels {
+
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+struct broadcast_receiver;
+
+/// @brief A channel which delivers every value to every subscriber.
+///
+/// Each value is held once, in a ring shared by all subscribers, and is
+/// destroyed once the slowest subscriber has received it. A subscriber
+/// receives a copy of each value sent after it subscribed.
+///
+/// When the slowest subscriber is a full ring behind, the overflow_policy
+/// decides what a send does. overflow_policy::block applies backpressure:
+/// senders wait until the slowest subscriber catches up.
+/// overflow_policy::drop_oldest never waits: the slowest subscribers lag,
+/// skipping the oldest value, and the number of values each has missed is
+/// recorded. drop_newest and reject refuse the new value, as they do for
+/// channel.
+/// @tparam ValueType is the type of value passed through the channel. It must
+/// be copyable.
+/// @tparam Executor is the type of executor associated with the channel.
+template < class ValueType,
+           class Executor           = asio::any_io_executor,
+           concepts::Lockable Mutex = std::mutex >
+struct broadcast_channel
+{
+    using executor_type = Executor;
+
+    /// @brief T type of value handled by this channel
+    using value_type = ValueType;
+
+    using receiver_type = broadcast_receiver< ValueType, Executor, Mutex >;
+
+    using impl_type = detail::broadcast_channel_impl< ValueType, Mutex >;
+    using impl_ptr  = std::shared_ptr< impl_type >;
+
+    /// @param exec
+    /// @param capacity is the number of values the ring holds, which must
+    /// be at least 1
+    /// @param policy decides what a send does while the ring is full
+    broadcast_channel(Executor        exec,
+                      std::size_t     capacity,
+                      overflow_policy policy = overflow_policy::block);
+
+    ~broadcast_channel()
+    {
+        close();
+    }
+
+    /// @brief Create a subscriber which receives every value sent from now
+    /// on.
+    receiver_type
+    subscribe() const
+    {
+        return receiver_type(exec_, impl_);
+    }
+
+    /// @brief Send a value if that can be done without waiting.
+    /// @param value is moved from only if the channel accepts it
+    /// @param ec is set to errors::channel_closed, or to the error of the
+    /// overflow policy, if the value was refused. Otherwise it is cleared.
+    /// @return true if the value was accepted.
+    bool
+    try_send(value_type &&value, error_code &ec);
+
+    /// @brief Initiate an asynchronous send of a value to every subscriber
+    ///
+    /// Under overflow_policy::block, the send waits while the ring is full.
+    /// Under every other policy it completes at once, and no op is
+    /// allocated. The completion handler will always be invoked as if by a
+    /// call to post(handler).
+    ///
+    /// As for channel::async_send, a cancellation emitted on the handler's
+    /// associated cancellation slot withdraws a waiting send and completes
+    /// it with asio::error::operation_aborted. The unsent value is
+    /// destroyed.
+    /// @param value is the value to send
+    /// @param token is the completion token
+    /// @return depends on CompletionToken
+    template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code)) SendHandler
+                   BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(executor_type) >
+    BOOST_ASIO_INITFN_RESULT_TYPE(SendHandler, void(error_code))
+    async_send(value_type value,
+               SendHandler &&token
+                   BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
+    /// @brief Cause the channel to be closed.
+    ///
+    /// Waiting sends fail with errors::channel_closed. Subscribers still
+    /// receive the values already sent, and then errors::channel_closed.
+    void
+    close() noexcept
+    {
+        if (impl_) [[likely]]
+            asio::dispatch(exec_, [impl = impl_] { impl->close(); });
+    }
+
+    /// @brief The number of values the channel has refused or dropped
+    /// because of its overflow_policy.
+    overflow_counters
+    counters() const
+    {
+        return impl_->counters();
+    }
+
+    executor_type const &
+    get_executor() const
+    {
+        return exec_;
+    }
+
+    impl_ptr const &
+    get_implementation() const
+    {
+        return impl_;
+    }
+
+  private:
+    static impl_ptr
+    create_impl(std::size_t capacity, overflow_policy policy);
+
+    Executor exec_;
+    impl_ptr impl_;
+};
+
+/// @brief A subscription to a broadcast_channel.
+///
+/// Unsubscribes when destroyed, which releases any values only this
+/// subscriber still needed. Any consume left waiting completes with
+/// errors::channel_closed.
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+struct broadcast_receiver
+{
+    using executor_type = Executor;
+    using value_type    = ValueType;
+    using impl_type     = detail::broadcast_channel_impl< ValueType, Mutex >;
+    using impl_ptr      = std::shared_ptr< impl_type >;
+
+    broadcast_receiver(Executor exec, impl_ptr impl)
+    : exec_(std::move(exec))
+    , impl_(std::move(impl))
+    , sub_(impl_->subscribe())
+    {
+    }
+
+    broadcast_receiver(broadcast_receiver &&other) noexcept
+    : exec_(other.exec_)
+    , impl_(std::move(other.impl_))
+    , sub_(std::exchange(other.sub_, nullptr))
+    {
+    }
+
+    broadcast_receiver &
+    operator=(broadcast_receiver &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            exec_ = other.exec_;
+            impl_ = std::move(other.impl_);
+            sub_  = std::exchange(other.sub_, nullptr);
+        }
+        return *this;
+    }
+
+    ~broadcast_receiver()
+    {
+        reset();
+    }
+
+    /// @brief The number of values sent which this subscriber has yet to
+    /// receive.
+    std::uint64_t
+    lag() const
+    {
+        return impl_->lag(*sub_);
+    }
+
+    /// @brief The number of values this subscriber has skipped because it
+    /// lagged under overflow_policy::drop_oldest.
+    std::uint64_t
+    missed() const
+    {
+        return impl_->missed(*sub_);
+    }
+
+    /// @brief Receive the next value if one is available immediately.
+    /// @param ec is set to errors::channel_closed if the channel is closed
+    /// and this subscriber has received every value, and otherwise cleared.
+    std::optional< value_type >
+    consume_if(error_code &ec)
+    {
+        ec.clear();
+        return impl_->consume_if(*sub_, ec);
+    }
+
+    /// @brief Initiate an asynchronous receive of the next value
+    ///
+    /// The completion handler will always be invoked as if by a call to
+    /// post(handler). A cancellation emitted on the handler's associated
+    /// cancellation slot withdraws a waiting receive, without moving the
+    /// subscriber's cursor, and completes it with
+    /// asio::error::operation_aborted.
+    /// @param token is the completion token
+    /// @return depends on CompletionToken
+    template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, ValueType))
+                   ConsumeHandler BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(
+                       executor_type) >
+    BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeHandler, void(error_code, ValueType))
+    async_consume(ConsumeHandler &&token
+                      BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
+    executor_type const &
+    get_executor() const
+    {
+        return exec_;
+    }
+
+  private:
+    void
+    reset() noexcept
+    {
+        if (auto sub = std::exchange(sub_, nullptr))
+            impl_->unsubscribe(sub);
+    }
+
+    Executor exec_;
+    impl_ptr impl_;
+
+    typename impl_type::subscriber *sub_;
+};
+
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+broadcast_channel< ValueType, Executor, Mutex >::broadcast_channel(
+    Executor        exec,
+    std::size_t     capacity,
+    overflow_policy policy)
+: exec_(std::move(exec))
+, impl_(create_impl(capacity, policy))
+{
+}
+
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+bool
+broadcast_channel< ValueType, Executor, Mutex >::try_send(value_type &&value,
+                                                          error_code  &ec)
+{
+    ec.clear();
+    return impl_->try_produce(value, ec);
+}
+
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code)) SendHandler >
+BOOST_ASIO_INITFN_RESULT_TYPE(SendHandler, void(error_code))
+broadcast_channel< ValueType, Executor, Mutex >::async_send(
+    value_type    value,
+    SendHandler &&token)
+{
+    return asio::async_initiate< SendHandler, void(error_code) >(
+        [value1 = std::move(value),
+         impl1  = impl_,
+         default_executor =
+             get_executor()]< class Handler1 >(Handler1 &&handler1) mutable {
+            // an op is only needed if the send has to wait
+            error_code ec;
+            if (impl1->try_produce(value1, ec) || ec)
+            {
+                auto completion = detail::postit(
+                    asio::get_associated_executor(handler1, default_executor),
+                    std::forward< Handler1 >(handler1));
+                completion(ec);
+                return;
+            }
+
+            auto slot           = detail::cancellation_slot_of(handler1);
+            auto [exec1, work1] = detail::track_work(
+                impl1->work(),
+                asio::get_associated_executor(handler1, default_executor));
+            auto op = detail::make_producer_op_function< Mutex >(
+                std::move(value1),
+                std::move(exec1),
+                std::forward< Handler1 >(handler1),
+                std::move(work1));
+            detail::connect_cancellation(slot, impl1, op);
+            impl1->submit_produce_op(std::move(op));
+        },
+        token);
+}
+
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+auto
+broadcast_channel< ValueType, Executor, Mutex >::create_impl(
+    std::size_t     capacity,
+    overflow_policy policy) -> impl_ptr
+{
+    if (capacity == 0)
+        BOOST_THROW_EXCEPTION(
+            std::invalid_argument("broadcast_channel needs a capacity"));
+
+    auto extra  = (sizeof(typename impl_type::slot_type) * capacity) +
+                 (sizeof(impl_type) - 1);
+    auto blocks = 1 + (extra / sizeof(impl_type));
+
+    auto pmem = std::calloc(blocks, sizeof(impl_type));
+    if (!pmem)
+        BOOST_THROW_EXCEPTION(std::bad_alloc());
+
+    impl_type *impl;
+    try
+    {
+        impl = new (pmem) impl_type(capacity, policy);
+    }
+    catch (...)
+    {
+        std::free(pmem);
+        throw;
+    }
+
+    // if the control block cannot be allocated, the deleter frees the impl
+    return impl_ptr(impl, detail::free_deleter());
+}
+
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, ValueType))
+               ConsumeHandler >
+BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeHandler, void(error_code, ValueType))
+broadcast_receiver< ValueType, Executor, Mutex >::async_consume(
+    ConsumeHandler &&token)
+{
+    return asio::async_initiate< ConsumeHandler, void(error_code, ValueType) >(
+        [impl1 = impl_, sub = sub_, default_executor = exec_]< class Handler1 >(
+            Handler1 &&handler1) {
+            auto slot           = detail::cancellation_slot_of(handler1);
+            auto [exec1, work1] = detail::track_work(
+                impl1->work(),
+                asio::get_associated_executor(handler1, default_executor));
+            auto op = detail::make_consumer_op_function< ValueType, Mutex >(
+                std::move(exec1),
+                std::forward< Handler1 >(handler1),
+                std::move(work1));
+            detail::connect_cancellation(slot, impl1, op);
+            impl1->submit_consume_op(*sub, std::move(op));
+        },
+        token);
+}
+
+}   // namespace boost::channels
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_BROADCAST_CHANNEL_HPP
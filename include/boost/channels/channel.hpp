@@ -10,10 +10,17 @@
 #ifndef BOOST_CHANNELS_CHANNEL_HPP
 #define BOOST_CHANNELS_CHANNEL_HPP
 
+#include <boost/channels/completion_mode.hpp>
 #include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/concurrency.hpp>
 #include <boost/channels/detail/free_deleter.hpp>
+#include <boost/channels/detail/postit.hpp>
 #include <boost/channels/detail/select_wait_op.hpp>
+#include <boost/channels/detail/slot_claim_op.hpp>
 #include <boost/channels/error_code.hpp>
+#include <boost/channels/overflow_policy.hpp>
+#include <boost/channels/send_slot.hpp>
+#include <boost/channels/spill_options.hpp>
 
 #include <boost/asio/any_io_executor.hpp>
 #include <boost/asio/dispatch.hpp>
@@ -21,14 +28,15 @@
 #include <boost/assert.hpp>
 #include <boost/variant2/variant.hpp>
 
-#include <deque>
+#include <chrono>
+#include <concepts>
+#include <iterator>
 #include <optional>
-#include <queue>
 
 namespace boost::channels {
 
 namespace detail {
-template < class ValueType, concepts::Lockable Mutex >
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
 struct channel_impl;
 };
 
@@ -46,9 +54,11 @@ requires(asio::system_executor se)
 /// Based on golang's channel idiom.
 /// @tparam ValueType is the type of value passed through the channel.
 /// @tparam Executor is the type of executor associated with the channel.
+/// @tparam Concurrency selects the implementation strategy. @see concurrency
 template < class ValueType,
            class Executor           = asio::any_io_executor,
-           concepts::Lockable Mutex = std::mutex >
+           concepts::Lockable Mutex = std::mutex,
+           class Concurrency        = concurrency::locked >
 struct channel
 {
     using executor_type = Executor;
@@ -56,23 +66,62 @@ struct channel
     /// @brief T type of value handled by this channel
     using value_type = ValueType;
 
+    /// @brief The type of slot granted by async_claim
+    using send_slot_type = send_slot< ValueType, Mutex >;
+
     /// @brief Construct a channel associated with the system_executor
-    /// @param capacity
+    /// @param capacity is the number of values the channel can buffer. A power
+    /// of two lets the buffer find its slots by masking rather than division.
+    /// Ignored by concurrency::unbounded.
     template < class T = Executor >
     requires constructible_with_system_executor< T >
     channel(std::size_t capacity = 0);
 
     /// @brief Construct an executor associated with the given executor
     /// @param exec
-    /// @param capacity
+    /// @param capacity is the number of values the channel can buffer. A power
+    /// of two lets the buffer find its slots by masking rather than division.
+    /// Ignored by concurrency::unbounded.
     channel(Executor exec, std::size_t capacity = 0);
 
+    /// @brief Construct a channel which spills values to files once its
+    /// buffer is full.
+    /// @param exec
+    /// @param capacity is the number of values the in-memory buffer can hold
+    /// @param options configures the spill files
+    channel(Executor exec, std::size_t capacity, spill_options options) requires
+        std::same_as< Concurrency, concurrency::spill >;
+
+    /// @brief Construct a channel which disposes of values sent while its
+    /// buffer is full, rather than making the sender wait.
+    ///
+    /// The policy is applied by every send, so no sender ever waits. No
+    /// operation is allocated for async_send, send, try_send or
+    /// async_send_range, and async_send_range applies the policy to each
+    /// value in turn. A send branch of a select, or a claim, which finds no
+    /// room completes at once: under drop_oldest, buffered values are
+    /// discarded until it is admitted, and otherwise it completes with
+    /// errors::value_dropped or errors::channel_full.
+    /// @param exec
+    /// @param capacity is the number of values the channel can buffer
+    /// @param policy selects what happens to a value which does not fit
+    channel(Executor        exec,
+            std::size_t     capacity,
+            overflow_policy policy) requires
+        std::same_as< Concurrency, concurrency::locked >;
+
     ~channel()
     {
         close();
     }
 
-    /// @brief Consume one value from the channel if there is one available.
+    /// @brief Consume one value from the channel, blocking the calling thread
+    /// until one is available.
+    ///
+    /// The thread polls briefly and then parks on an atomic wait until a
+    /// sender or close() completes the consume. No memory is allocated.
+    /// @note Must not be called from a thread on which the channel's senders
+    /// need to run, since they could then never complete it.
     /// @param ec is an out parameter referencing an error_code which will be
     /// overwritten by this function. If a value is available, ec will be
     /// cleared. Otherwise, ec will contain an error code.
@@ -81,6 +130,20 @@ struct channel
     ValueType
     consume(error_code &ec);
 
+    /// @brief Send a value to the channel, blocking the calling thread until
+    /// the value has been accepted.
+    ///
+    /// The thread polls briefly and then parks on an atomic wait until a
+    /// consumer or close() completes the send. No memory is allocated.
+    /// @note Must not be called from a thread on which the channel's consumers
+    /// need to run, since they could then never complete it.
+    /// @param value is the value to send into the channel
+    /// @param ec is an out parameter which will be cleared if the value was
+    /// accepted, or set to errors::channel_closed if the channel was closed
+    /// first.
+    void
+    send(value_type value, error_code &ec);
+
     /// @brief Consume one value if there is a value available to be consumed
     /// immediately.
     /// @param ec is a reference to an error_code. The value of this variable
@@ -93,11 +156,39 @@ struct channel
     std::optional< value_type >
     consume_if(error_code &ec);
 
+    /// @brief Send a value to the channel if that can be done without
+    /// waiting.
+    ///
+    /// The value is handed to a waiting consumer, or stored in the channel's
+    /// buffer if it has space, under the same ordering rules as async_send.
+    /// It is refused if other senders are already waiting. No memory is
+    /// allocated.
+    /// @param value is moved from only if the channel accepts it
+    /// @param ec is an out parameter which will be set to
+    /// errors::channel_closed if the channel is closed, and otherwise cleared.
+    /// @return true if the value was accepted.
+    bool
+    try_send(value_type &&value, error_code &ec);
+
     /// @brief Initiate an asynchronous send of a value to the channel
     ///
     /// If the channel is closed, the completion handler will be invoked with
     /// error_code errors::channel_closed. The completion handler will always be
-    /// invoked as if by a call to post(handler).
+    /// invoked as if by a call to post(handler), unless the channel's
+    /// completion_mode is dispatch.
+    ///
+    /// Where asio supports it (BOOST_CHANNELS_HAS_CANCELLATION_SLOT), a
+    /// terminal, partial or total cancellation emitted on the handler's
+    /// associated cancellation slot withdraws a waiting send from the channel
+    /// and completes it with asio::error::operation_aborted. The same holds
+    /// for async_consume and the timed variants. async_send_range,
+    /// async_claim, async_consume_some and async_consume_inplace are not
+    /// connected to a cancellation slot.
+    ///
+    /// A cancelled async_send destroys its unsent value, since its handler
+    /// has nowhere to return it. async_send_for hands the unsent value back
+    /// through its handler, whether the send was cancelled, timed out or
+    /// refused, and should be used where the value must not be lost.
     /// @tparam SendHandler is the type of completion token used to
     /// configure the initiation function
     /// @param value is the value to send into the channel
@@ -110,6 +201,98 @@ struct channel
                SendHandler &&token
                    BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
 
+    /// @brief Initiate an asynchronous send which gives up after a timeout
+    ///
+    /// Behaves as async_send, except that if the value has not been accepted
+    /// when the timeout expires, the send is withdrawn from the channel and
+    /// completes with errors::timed_out. Deadlines are kept by a timer wheel
+    /// shared by every timed operation on the handler's execution context,
+    /// with a resolution of BOOST_CHANNELS_TIMER_TICK_US. A send which waits
+    /// has its handler invoked as the channel's completion_mode directs.
+    /// @see set_completion_mode
+    /// @tparam SendForHandler is the type of completion token used to
+    /// configure the initiation function
+    /// @param value is the value to send into the channel
+    /// @param timeout is the longest time to wait for the value to be
+    /// accepted
+    /// @param token is the completion token. Its second argument holds the
+    /// value if it was not sent, whether because the timeout expired or
+    /// because the channel was closed or refused it.
+    /// @return depends on CompletionToken
+    template < BOOST_ASIO_COMPLETION_TOKEN_FOR(
+                   void(error_code, std::optional< ValueType >))
+                   SendForHandler BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(
+                       executor_type) >
+    BOOST_ASIO_INITFN_RESULT_TYPE(SendForHandler,
+                                  void(error_code, std::optional< ValueType >))
+    async_send_for(value_type                      value,
+                   std::chrono::steady_clock::duration timeout,
+                   SendForHandler &&token
+                       BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
+    /// @brief Initiate an asynchronous send of every value in a range
+    ///
+    /// Values are moved out of the range in order. As many as fit are handed
+    /// to waiting consumers or moved into the channel's buffer under a single
+    /// acquisition of the channel's mutex. The remainder waits as one
+    /// operation, which gives up values as consumers make room.
+    ///
+    /// The completion handler is invoked once, as the channel's
+    /// completion_mode directs, when the last value has been accepted or
+    /// when the channel is closed. Its second argument is the number of values which
+    /// were accepted by the channel. On a channel with an overflow_policy
+    /// other than block, the whole range is offered at once and values which
+    /// do not fit are disposed of one by one. The handler then receives the
+    /// error of the last value refused.
+    /// @tparam Iterator is an input iterator whose values are moved from. The
+    /// range must remain valid until the operation completes.
+    /// @tparam SendRangeHandler is the type of completion token used to
+    /// configure the initiation function
+    /// @param first is the beginning of the range of values to send
+    /// @param last is the end of the range of values to send
+    /// @param token is the completion token
+    /// @return depends on CompletionToken
+    template < std::input_iterator Iterator,
+               BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, std::size_t))
+                   SendRangeHandler BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(
+                       executor_type) >
+    requires std::constructible_from< ValueType,
+                                      std::iter_rvalue_reference_t< Iterator > >
+    BOOST_ASIO_INITFN_RESULT_TYPE(SendRangeHandler,
+                                  void(error_code, std::size_t))
+    async_send_range(Iterator            first,
+                     Iterator            last,
+                     SendRangeHandler &&token
+                         BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
+    /// @brief Initiate an asynchronous claim of a slot in the channel's buffer
+    ///
+    /// The claim waits behind any sends already waiting. When the buffer has
+    /// space, the slot at its back is reserved and granted to the handler. A
+    /// value is constructed directly in the slot with send_slot::emplace and
+    /// is only seen by consumers once send_slot::publish is called. While a
+    /// slot is reserved, later claims and sends wait behind it.
+    ///
+    /// The completion handler is invoked as the channel's completion_mode
+    /// directs. If the channel is closed first, the handler is invoked with
+    /// errors::channel_closed and an empty slot. A channel without a
+    /// buffer has no slots to claim, and the handler is invoked with
+    /// errors::channel_unbuffered.
+    /// @note Only available with concurrency::locked, since the lock-free
+    /// rings accept values without taking the channel's mutex.
+    /// @tparam ClaimHandler is the type of completion token used to configure
+    /// the initiation function
+    /// @param token is the completion token
+    /// @return depends on CompletionToken
+    template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, send_slot_type))
+                   ClaimHandler BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(
+                       executor_type) >
+    requires std::same_as< Concurrency, concurrency::locked >
+    BOOST_ASIO_INITFN_RESULT_TYPE(ClaimHandler,
+                                  void(error_code, send_slot_type))
+    async_claim(ClaimHandler &&token
+                    BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
     template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, ValueType))
                    ConsumeHandler BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(
                        executor_type) >
@@ -117,6 +300,150 @@ struct channel
     async_consume(ConsumeHandler &&token
                       BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
 
+    /// @brief Initiate an asynchronous consume which gives up after a timeout
+    ///
+    /// Behaves as async_consume, except that if no value has arrived when the
+    /// timeout expires, the consume is withdrawn from the channel and
+    /// completes with errors::timed_out and a default constructed value. A
+    /// consume which waits has its handler invoked as the channel's
+    /// completion_mode directs.
+    /// @see async_send_for for how deadlines are kept.
+    /// @see set_completion_mode
+    /// @tparam ConsumeForHandler is the type of completion token used to
+    /// configure the initiation function
+    /// @param timeout is the longest time to wait for a value
+    /// @param token is the completion token
+    /// @return depends on CompletionToken
+    template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, ValueType))
+                   ConsumeForHandler BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(
+                       executor_type) >
+    BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeForHandler,
+                                  void(error_code, ValueType))
+    async_consume_for(std::chrono::steady_clock::duration timeout,
+                      ConsumeForHandler &&token
+                          BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
+    /// @brief Initiate an asynchronous consume of up to max_n values
+    ///
+    /// The operation waits until at least one value is available. It then
+    /// appends to out every value which is available from the channel's
+    /// buffer or from waiting senders, up to max_n, in a single pass under the
+    /// channel's mutex, and completes once.
+    ///
+    /// The completion handler is invoked as the channel's completion_mode
+    /// directs. Its second argument is the number of values appended to
+    /// out. If the channel is closed and no values remain, the handler is
+    /// invoked with errors::channel_closed and 0.
+    /// @tparam Container is a container of value_type with push_back. It must
+    /// remain valid until the operation completes.
+    /// @tparam ConsumeSomeHandler is the type of completion token used to
+    /// configure the initiation function
+    /// @param max_n is the largest number of values to consume
+    /// @param out is the container to which values are appended
+    /// @param token is the completion token
+    /// @return depends on CompletionToken
+    template < class Container,
+               BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, std::size_t))
+                   ConsumeSomeHandler BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(
+                       executor_type) >
+    requires requires(Container &c, ValueType &&v)
+    {
+        c.push_back(std::move(v));
+    }
+    BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeSomeHandler,
+                                  void(error_code, std::size_t))
+    async_consume_some(std::size_t          max_n,
+                       Container           &out,
+                       ConsumeSomeHandler &&token
+                           BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
+    /// @brief Initiate an asynchronous consume which visits the value in
+    /// place
+    ///
+    /// When a value is available, visitor is invoked with a reference to it
+    /// while it still lies in the channel's buffer or in the sender's
+    /// storage. The value is destroyed when the visitor returns, so it is
+    /// never moved on its way to the consumer unless the visitor moves it.
+    ///
+    /// The visitor runs while the channel's mutex is held, on whichever thread
+    /// makes the value available. It must be brief and must not use the
+    /// channel.
+    ///
+    /// The completion handler is invoked as the channel's completion_mode
+    /// directs, after the visitor has returned. If the channel is closed
+    /// and no values remain, the visitor is not invoked and the handler is
+    /// invoked with errors::channel_closed.
+    /// @tparam Visitor is a function object with signature void(ValueType &)
+    /// @tparam ConsumeInplaceHandler is the type of completion token used to
+    /// configure the initiation function
+    /// @param visitor is the function object which visits the value
+    /// @param token is the completion token
+    /// @return depends on CompletionToken
+    template < std::invocable< ValueType & > Visitor,
+               BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code))
+                   ConsumeInplaceHandler
+                       BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(executor_type) >
+    BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeInplaceHandler, void(error_code))
+    async_consume_inplace(
+        Visitor               &&visitor,
+        ConsumeInplaceHandler &&token
+            BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
+    /// @brief Change the number of values the channel can buffer.
+    ///
+    /// Buffered values are moved, in order, into storage for the new
+    /// capacity, and senders waiting for space are admitted at once if the
+    /// channel grows. If the channel holds more values than the new capacity,
+    /// they are kept, and no more are accepted until consumers have taken
+    /// enough of them. Waiting senders and consumers are unaffected. While a
+    /// slot granted by async_claim is outstanding, the change is made when
+    /// the slot is published or released.
+    /// @note Only available with concurrency::locked, since the lock-free
+    /// rings are accessed without taking the channel's mutex.
+    /// @pre new_capacity != 0 if a claim may be waiting, since a channel
+    /// without a buffer has no slots to grant it.
+    /// @param new_capacity is the number of values the channel can buffer
+    void
+    resize(std::size_t new_capacity) requires
+        std::same_as< Concurrency, concurrency::locked >;
+
+    /// @brief The number of values the channel has refused because of its
+    /// overflow_policy.
+    overflow_counters
+    counters() const;
+
+    /// @brief The reason the channel last failed to create a spill file, or
+    /// error_code() if it has created one since.
+    ///
+    /// While no spill file can be created, senders wait as they would once
+    /// the spill limit is reached. Each later operation on the channel tries
+    /// again. Spill files are created outside the channel's mutex.
+    error_code
+    spill_error() const requires
+        std::same_as< Concurrency, concurrency::spill >;
+
+    /// @brief How the channel invokes the handlers of the operations it
+    /// completes.
+    completion_mode
+    get_completion_mode() const;
+
+    /// @brief Set how the channel invokes the handlers of the operations it
+    /// completes.
+    ///
+    /// The mode applies to every kind of operation the channel completes
+    /// once the operation has waited: sends, ranges, claims, consumes of
+    /// every kind and their timed variants. async_send and async_consume
+    /// also follow it when they complete during initiation. Any other
+    /// operation which completes during initiation, or which is completed by
+    /// its timeout, posts its handler.
+    ///
+    /// Under completion_mode::dispatch, a consumer which receives a value is
+    /// resumed before the send which provided it returns, if both run on the
+    /// same thread, rather than through the executor's queue. Operations
+    /// matched while the mode is being changed may complete under either mode.
+    void
+    set_completion_mode(completion_mode mode);
+
     /// @brief Cause the channel to be closed.
     ///
     /// All values already buffered will be delivered to consumers.
@@ -138,7 +465,7 @@ struct channel
         return exec_;
     }
 
-    using impl_type = detail::channel_impl< ValueType, Mutex >;
+    using impl_type = detail::channel_impl< ValueType, Mutex, Concurrency >;
     using impl_ptr  = std::shared_ptr< impl_type >;
 
     impl_ptr const &
@@ -148,8 +475,9 @@ struct channel
     }
 
   private:
+    template < class... RingArgs >
     impl_ptr
-    create_impl(std::size_t capacity);
+    create_impl(std::size_t capacity, RingArgs &&...ring_args);
 
   private:
     Executor exec_;
@@ -160,11 +488,17 @@ struct channel
 
 #include <boost/channels/concepts/equality_comparable.hpp>
 #include <boost/channels/concepts/executor.hpp>
+#include <boost/channels/detail/batch_consumer_op.hpp>
+#include <boost/channels/detail/blocking_op.hpp>
+#include <boost/channels/detail/cancellation.hpp>
 #include <boost/channels/detail/channel_impl.hpp>
 #include <boost/channels/detail/channel_send_op.hpp>
 #include <boost/channels/detail/consumer_op_function.hpp>
+#include <boost/channels/detail/inplace_consumer_op.hpp>
 #include <boost/channels/detail/postit.hpp>
 #include <boost/channels/detail/producer_op_function.hpp>
+#include <boost/channels/detail/range_producer_op.hpp>
+#include <boost/channels/detail/timed_op.hpp>
 
 #include <cstdlib>
 #include <new>
@@ -172,17 +506,53 @@ struct channel
 
 namespace boost::channels {
 
-template < class ValueType, class Executor, concepts::Lockable Mutex >
-channel< ValueType, Executor, Mutex >::channel(Executor    exec,
-                                               std::size_t capacity)
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+channel< ValueType, Executor, Mutex, Concurrency >::channel(
+    Executor    exec,
+    std::size_t capacity)
 : exec_(std::move(exec))
 , impl_(create_impl(capacity))
 {
 }
 
-template < class ValueType, class Executor, concepts::Lockable Mutex >
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+channel< ValueType, Executor, Mutex, Concurrency >::channel(
+    Executor      exec,
+    std::size_t   capacity,
+    spill_options options) requires
+    std::same_as< Concurrency, concurrency::spill >
+: exec_(std::move(exec))
+, impl_(create_impl(capacity, std::move(options)))
+{
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+channel< ValueType, Executor, Mutex, Concurrency >::channel(
+    Executor        exec,
+    std::size_t     capacity,
+    overflow_policy policy) requires
+    std::same_as< Concurrency, concurrency::locked >
+: exec_(std::move(exec))
+, impl_(create_impl(capacity))
+{
+    impl_->set_overflow(policy);
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
 auto
-channel< ValueType, Executor, Mutex >::consume_if(error_code &ec)
+channel< ValueType, Executor, Mutex, Concurrency >::consume_if(error_code &ec)
     -> std::optional< value_type >
 {
     ec.clear();
@@ -198,12 +568,171 @@ channel< ValueType, Executor, Mutex >::consume_if(error_code &ec)
     }
 }
 
-template < class ValueType, class Executor, concepts::Lockable Mutex >
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+bool
+channel< ValueType, Executor, Mutex, Concurrency >::try_send(value_type &&value,
+                                                             error_code &ec)
+{
+    ec.clear();
+
+    if (!impl_) [[unlikely]]
+    {
+        ec = errors::channel_null;
+        return false;
+    }
+
+    if constexpr (!impl_type::lock_free)
+    {
+        if (impl_->overflow() != overflow_policy::block)
+        {
+            ec = impl_->produce_or_overflow(value);
+            return !ec;
+        }
+    }
+
+    return impl_->try_produce(value, ec);
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+void
+channel< ValueType, Executor, Mutex, Concurrency >::resize(
+    std::size_t new_capacity) requires
+    std::same_as< Concurrency, concurrency::locked >
+{
+    if (impl_) [[likely]]
+        impl_->resize(new_capacity);
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+overflow_counters
+channel< ValueType, Executor, Mutex, Concurrency >::counters() const
+{
+    if (!impl_) [[unlikely]]
+        return overflow_counters();
+    return impl_->counters();
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+error_code
+channel< ValueType, Executor, Mutex, Concurrency >::spill_error() const
+    requires std::same_as< Concurrency, concurrency::spill >
+{
+    if (!impl_) [[unlikely]]
+        return errors::channel_null;
+    return impl_->spill_error();
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+completion_mode
+channel< ValueType, Executor, Mutex, Concurrency >::get_completion_mode() const
+{
+    if (!impl_) [[unlikely]]
+        return completion_mode::post;
+    return impl_->completion();
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+void
+channel< ValueType, Executor, Mutex, Concurrency >::set_completion_mode(
+    completion_mode mode)
+{
+    if (impl_) [[likely]]
+        impl_->set_completion(mode);
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+ValueType
+channel< ValueType, Executor, Mutex, Concurrency >::consume(error_code &ec)
+{
+    if (auto v = consume_if(ec))
+        return std::move(*v);
+    if (ec)
+        return ValueType();
+
+    std::optional< ValueType > result;
+    auto op = detail::blocking_consumer_op< ValueType, Mutex >(result);
+    impl_->submit_consume_op(
+        detail::basic_consumer_ptr< ValueType, Mutex >(&op));
+    ec = op.wait();
+    return result ? std::move(*result) : ValueType();
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+void
+channel< ValueType, Executor, Mutex, Concurrency >::send(value_type  value,
+                                                         error_code &ec)
+{
+    ec.clear();
+
+    if (!impl_) [[unlikely]]
+    {
+        ec = errors::channel_null;
+        return;
+    }
+
+    if constexpr (impl_type::lock_free)
+    {
+        if (impl_->try_produce_nolock(value))
+            return;
+    }
+    else
+    {
+        if (impl_->overflow() != overflow_policy::block)
+        {
+            ec = impl_->produce_or_overflow(value);
+            return;
+        }
+        if constexpr (impl_type::eager_send)
+        {
+            if (impl_->try_produce(value, ec) || ec)
+                return;
+        }
+    }
+
+    auto op = detail::blocking_producer_op< ValueType, Mutex >(value);
+    impl_->submit_produce_op(
+        detail::basic_producer_ptr< ValueType, Mutex >(&op));
+    ec = op.wait();
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+template < class... RingArgs >
 auto
-channel< ValueType, Executor, Mutex >::create_impl(std::size_t capacity)
-    -> impl_ptr
+channel< ValueType, Executor, Mutex, Concurrency >::create_impl(
+    std::size_t capacity,
+    RingArgs &&...ring_args) -> impl_ptr
 {
-    auto extra  = (sizeof(ValueType) * capacity) + (sizeof(impl_type) - 1);
+    // an unbounded buffer allocates its own chunks
+    auto slots  = impl_type::bounded ? capacity : 0;
+    auto extra  = (sizeof(typename impl_type::slot_type) * slots) +
+                 (sizeof(impl_type) - 1);
     auto blocks = 1 + (extra / sizeof(impl_type));
 
     auto pmem = std::calloc(blocks, sizeof(impl_type));
@@ -212,7 +741,9 @@ channel< ValueType, Executor, Mutex >::create_impl(std::size_t capacity)
 
     try
     {
-        return impl_ptr(new (pmem) impl_type(capacity), detail::free_deleter());
+        return impl_ptr(new (pmem) impl_type(
+                            capacity, std::forward< RingArgs >(ring_args)...),
+                        detail::free_deleter());
     }
     catch (...)
     {
@@ -244,27 +775,80 @@ rebind_and_call(Executor const &enew, Handler &&handler, F &&f)
         }));
 }
 
-template < class ValueType, class Executor, concepts::Lockable Mutex >
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
 template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code)) SendHandler >
 BOOST_ASIO_INITFN_RESULT_TYPE(SendHandler, void(error_code))
-channel< ValueType, Executor, Mutex >::async_send(value_type    value,
-                                                  SendHandler &&token)
+channel< ValueType, Executor, Mutex, Concurrency >::async_send(
+    value_type    value,
+    SendHandler &&token)
 {
     return asio::async_initiate< SendHandler, void(error_code) >(
         [value1 = std::move(value),
          impl1  = impl_,
          default_executor =
              get_executor()]< class Handler1 >(Handler1 &&handler1) mutable {
+            if constexpr (impl_type::lock_free)
+            {
+                // no op is allocated if the value fits into the ring
+                if (impl1 && impl1->try_produce_nolock(value1))
+                {
+                    auto completion = detail::postit(
+                        asio::get_associated_executor(handler1,
+                                                      default_executor),
+                        std::forward< Handler1 >(handler1),
+                        impl1->completion());
+                    completion(error_code());
+                    return;
+                }
+            }
+            else
+            {
+                // a lossy send never waits, so it never needs an op
+                if (impl1 && impl1->overflow() != overflow_policy::block)
+                {
+                    auto ec         = impl1->produce_or_overflow(value1);
+                    auto completion = detail::postit(
+                        asio::get_associated_executor(handler1,
+                                                      default_executor),
+                        std::forward< Handler1 >(handler1),
+                        impl1->completion());
+                    completion(ec);
+                    return;
+                }
+
+                if constexpr (impl_type::eager_send)
+                {
+                    // the buffer is rarely full, so try to complete at once
+                    error_code ec;
+                    if (impl1 && (impl1->try_produce(value1, ec) || ec))
+                    {
+                        auto completion = detail::postit(
+                            asio::get_associated_executor(handler1,
+                                                          default_executor),
+                            std::forward< Handler1 >(handler1),
+                            impl1->completion());
+                        completion(ec);
+                        return;
+                    }
+                }
+            }
+
             if (impl1) [[likely]]
             {
-                auto exec1 = asio::prefer(
-                    asio::get_associated_executor(handler1, default_executor),
-                    asio::execution::outstanding_work.tracked);
+                auto slot           = detail::cancellation_slot_of(handler1);
+                auto [exec1, work1] = detail::track_work(
+                    impl1->work(),
+                    asio::get_associated_executor(handler1, default_executor));
                 auto op = detail::make_producer_op_function< Mutex >(
                     std::move(value1),
-                    detail::postit(std::move(exec1),
-                                   std::forward< Handler1 >(handler1)));
-                impl1->submit_produce_op(op);
+                    std::move(exec1),
+                    std::forward< Handler1 >(handler1),
+                    std::move(work1));
+                detail::connect_cancellation(slot, impl1, op);
+                impl1->submit_produce_op(std::move(op));
             }
             else [[unlikely]]
             {
@@ -279,11 +863,198 @@ channel< ValueType, Executor, Mutex >::async_send(value_type    value,
         token);
 }
 
-template < class ValueType, class Executor, concepts::Lockable Mutex >
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+template < BOOST_ASIO_COMPLETION_TOKEN_FOR(
+    void(error_code, std::optional< ValueType >)) SendForHandler >
+BOOST_ASIO_INITFN_RESULT_TYPE(SendForHandler,
+                              void(error_code, std::optional< ValueType >))
+channel< ValueType, Executor, Mutex, Concurrency >::async_send_for(
+    value_type                          value,
+    std::chrono::steady_clock::duration timeout,
+    SendForHandler                    &&token)
+{
+    return asio::async_initiate< SendForHandler,
+                                 void(error_code, std::optional< ValueType >) >(
+        [value1 = std::move(value),
+         impl1  = impl_,
+         timeout,
+         default_executor =
+             get_executor()]< class Handler1 >(Handler1 &&handler1) mutable {
+            auto exec0 =
+                asio::get_associated_executor(handler1, default_executor);
+
+            // a send which completes at once needs neither an op nor a
+            // deadline, and hands the value back if it was refused
+            auto complete_now = [&](error_code ec) {
+                auto completion = detail::postit(
+                    std::move(exec0), std::forward< Handler1 >(handler1));
+                if (ec)
+                    completion(ec, std::optional< ValueType >(
+                                       std::move(value1)));
+                else
+                    completion(ec, std::optional< ValueType >());
+            };
+
+            if (!impl1) [[unlikely]]
+                return complete_now(errors::channel_null);
+
+            if constexpr (impl_type::lock_free)
+            {
+                if (impl1->try_produce_nolock(value1))
+                    return complete_now(error_code());
+            }
+            else
+            {
+                if (impl1->overflow() != overflow_policy::block)
+                    return complete_now(impl1->produce_or_overflow(value1));
+
+                if constexpr (impl_type::eager_send)
+                {
+                    error_code ec;
+                    if (impl1->try_produce(value1, ec) || ec)
+                        return complete_now(ec);
+                }
+            }
+
+            auto  slot    = detail::cancellation_slot_of(handler1);
+            auto &service = detail::timer_service::of(exec0);
+            auto [exec1, work1] = detail::track_work(impl1->work(), exec0);
+            auto op = detail::make_timed_producer_op< Mutex >(
+                std::move(value1),
+                std::weak_ptr< impl_type >(impl1),
+                service,
+                std::move(exec1),
+                std::forward< Handler1 >(handler1),
+                std::move(work1));
+            detail::arm_deadline(*op, service, timeout, exec0);
+            detail::connect_cancellation(slot, impl1, op);
+            impl1->submit_produce_op(std::move(op));
+        },
+        token);
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+template < std::input_iterator Iterator,
+           BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, std::size_t))
+               SendRangeHandler >
+requires std::constructible_from< ValueType,
+                                  std::iter_rvalue_reference_t< Iterator > >
+BOOST_ASIO_INITFN_RESULT_TYPE(SendRangeHandler, void(error_code, std::size_t))
+channel< ValueType, Executor, Mutex, Concurrency >::async_send_range(
+    Iterator            first,
+    Iterator            last,
+    SendRangeHandler &&token)
+{
+    return asio::async_initiate< SendRangeHandler,
+                                 void(error_code, std::size_t) >(
+        [first1 = std::move(first),
+         last1  = std::move(last),
+         impl1  = impl_,
+         default_executor =
+             get_executor()]< class Handler1 >(Handler1 &&handler1) mutable {
+            if constexpr (!impl_type::lock_free)
+            {
+                // a lossy send never waits, so it never needs an op
+                if (impl1 && impl1->overflow() != overflow_policy::block)
+                {
+                    auto accepted = std::size_t(0);
+                    auto ec       = impl1->produce_range_or_overflow(
+                        first1, last1, accepted);
+                    auto completion = detail::postit(
+                        asio::get_associated_executor(handler1,
+                                                      default_executor),
+                        std::forward< Handler1 >(handler1));
+                    completion(ec, accepted);
+                    return;
+                }
+            }
+
+            if (impl1 && first1 != last1) [[likely]]
+            {
+                auto [exec1, work1] = detail::track_work(
+                    impl1->work(),
+                    asio::get_associated_executor(handler1, default_executor));
+                impl1->submit_produce_op(
+                    detail::make_range_producer_op< ValueType, Mutex >(
+                        std::move(first1),
+                        std::move(last1),
+                        std::move(exec1),
+                        std::forward< Handler1 >(handler1),
+                        std::move(work1)));
+            }
+            else
+            {
+                // an empty range has nothing to wait for
+                auto ec =
+                    impl1 ? error_code() : error_code(errors::channel_null);
+                auto exec1 =
+                    asio::get_associated_executor(handler1, default_executor);
+                auto completion = detail::postit(
+                    std::move(exec1), std::forward< Handler1 >(handler1));
+                completion(ec, std::size_t(0));
+            }
+        },
+        token);
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+template < BOOST_ASIO_COMPLETION_TOKEN_FOR(
+    void(error_code, send_slot< ValueType, Mutex >)) ClaimHandler >
+requires std::same_as< Concurrency, concurrency::locked >
+BOOST_ASIO_INITFN_RESULT_TYPE(ClaimHandler,
+                              void(error_code, send_slot< ValueType, Mutex >))
+channel< ValueType, Executor, Mutex, Concurrency >::async_claim(
+    ClaimHandler &&token)
+{
+    return asio::async_initiate< ClaimHandler,
+                                 void(error_code, send_slot_type) >(
+        [impl1            = impl_,
+         default_executor = get_executor()]< class Handler1 >(
+            Handler1 &&handler1) {
+            if (impl1 && impl1->capacity()) [[likely]]
+            {
+                auto [exec1, work1] = detail::track_work(
+                    impl1->work(),
+                    asio::get_associated_executor(handler1, default_executor));
+                impl1->submit_produce_op(
+                    detail::make_slot_claim_op< ValueType, Mutex >(
+                        std::weak_ptr< impl_type >(impl1),
+                        std::move(exec1),
+                        std::forward< Handler1 >(handler1),
+                        std::move(work1)));
+            }
+            else
+            {
+                auto ec = impl1 ? error_code(errors::channel_unbuffered)
+                                : error_code(errors::channel_null);
+                auto exec1 =
+                    asio::get_associated_executor(handler1, default_executor);
+                auto completion = detail::postit(
+                    std::move(exec1), std::forward< Handler1 >(handler1));
+                completion(ec, send_slot_type());
+            }
+        },
+        token);
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
 template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, ValueType))
                ConsumeHandler >
 BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeHandler, void(error_code, ValueType))
-channel< ValueType, Executor, Mutex >::async_consume(ConsumeHandler &&token)
+channel< ValueType, Executor, Mutex, Concurrency >::async_consume(
+    ConsumeHandler &&token)
 {
     if (!impl_) [[unlikely]]
         BOOST_THROW_EXCEPTION(std::logic_error("channel is null"));
@@ -291,15 +1062,175 @@ channel< ValueType, Executor, Mutex >::async_consume(ConsumeHandler &&token)
     return asio::async_initiate< ConsumeHandler, void(error_code, ValueType) >(
         [impl1 = impl_, default_executor = get_executor()]< class Handler1 >(
             Handler1 &&handler1) {
+            if constexpr (impl_type::lock_free)
+            {
+                // no op is allocated if a value is waiting in the ring
+                if (auto value = impl1->try_consume_nolock())
+                {
+                    auto completion = detail::postit(
+                        asio::get_associated_executor(handler1,
+                                                      default_executor),
+                        std::forward< Handler1 >(handler1),
+                        impl1->completion());
+                    completion(error_code(), std::move(*value));
+                    return;
+                }
+            }
+
             if (impl1) [[likely]]
             {
-                auto exec1 = asio::prefer(
-                    asio::get_associated_executor(handler1, default_executor),
-                    asio::execution::outstanding_work.tracked);
+                auto slot           = detail::cancellation_slot_of(handler1);
+                auto [exec1, work1] = detail::track_work(
+                    impl1->work(),
+                    asio::get_associated_executor(handler1, default_executor));
+                auto op = detail::make_consumer_op_function< ValueType, Mutex >(
+                    std::move(exec1),
+                    std::forward< Handler1 >(handler1),
+                    std::move(work1));
+                detail::connect_cancellation(slot, impl1, op);
+                impl1->submit_consume_op(std::move(op));
+            }
+            else [[unlikely]]
+            {
+                auto exec1 =
+                    asio::get_associated_executor(handler1, default_executor);
                 auto handler2 = detail::postit(
                     std::move(exec1), std::forward< Handler1 >(handler1));
+                handler2(error_code(errors::channel_null), ValueType {});
+            }
+        },
+        token);
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, ValueType))
+               ConsumeForHandler >
+BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeForHandler, void(error_code, ValueType))
+channel< ValueType, Executor, Mutex, Concurrency >::async_consume_for(
+    std::chrono::steady_clock::duration timeout,
+    ConsumeForHandler                 &&token)
+{
+    if (!impl_) [[unlikely]]
+        BOOST_THROW_EXCEPTION(std::logic_error("channel is null"));
+
+    return asio::async_initiate< ConsumeForHandler,
+                                 void(error_code, ValueType) >(
+        [impl1            = impl_,
+         timeout,
+         default_executor = get_executor()]< class Handler1 >(
+            Handler1 &&handler1) {
+            auto exec0 =
+                asio::get_associated_executor(handler1, default_executor);
+            if constexpr (impl_type::lock_free)
+            {
+                // neither an op nor a deadline is needed if a value is waiting
+                if (auto value = impl1->try_consume_nolock())
+                {
+                    auto completion = detail::postit(
+                        std::move(exec0), std::forward< Handler1 >(handler1));
+                    completion(error_code(), std::move(*value));
+                    return;
+                }
+            }
+
+            auto  slot    = detail::cancellation_slot_of(handler1);
+            auto &service = detail::timer_service::of(exec0);
+            auto [exec1, work1] = detail::track_work(impl1->work(), exec0);
+            auto op = detail::make_timed_consumer_op< ValueType, Mutex >(
+                std::weak_ptr< impl_type >(impl1),
+                service,
+                std::move(exec1),
+                std::forward< Handler1 >(handler1),
+                std::move(work1));
+            detail::arm_deadline(*op, service, timeout, exec0);
+            detail::connect_cancellation(slot, impl1, op);
+            impl1->submit_consume_op(std::move(op));
+        },
+        token);
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+template < class Container,
+           BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, std::size_t))
+               ConsumeSomeHandler >
+requires requires(Container &c, ValueType &&v)
+{
+    c.push_back(std::move(v));
+}
+BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeSomeHandler, void(error_code, std::size_t))
+channel< ValueType, Executor, Mutex, Concurrency >::async_consume_some(
+    std::size_t          max_n,
+    Container           &out,
+    ConsumeSomeHandler &&token)
+{
+    return asio::async_initiate< ConsumeSomeHandler,
+                                 void(error_code, std::size_t) >(
+        [max_n,
+         &out,
+         impl1            = impl_,
+         default_executor = get_executor()]< class Handler1 >(
+            Handler1 &&handler1) {
+            if (impl1 && max_n) [[likely]]
+            {
+                auto [exec1, work1] = detail::track_work(
+                    impl1->work(),
+                    asio::get_associated_executor(handler1, default_executor));
+                impl1->submit_consume_op(
+                    detail::make_batch_consumer_op< ValueType, Mutex >(
+                        max_n,
+                        out,
+                        std::move(exec1),
+                        std::forward< Handler1 >(handler1),
+                        std::move(work1)));
+            }
+            else
+            {
+                // a request for nothing has nothing to wait for
+                auto ec =
+                    impl1 ? error_code() : error_code(errors::channel_null);
+                auto exec1 =
+                    asio::get_associated_executor(handler1, default_executor);
+                auto completion = detail::postit(
+                    std::move(exec1), std::forward< Handler1 >(handler1));
+                completion(ec, std::size_t(0));
+            }
+        },
+        token);
+}
+
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+template < std::invocable< ValueType & > Visitor,
+           BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code))
+               ConsumeInplaceHandler >
+BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeInplaceHandler, void(error_code))
+channel< ValueType, Executor, Mutex, Concurrency >::async_consume_inplace(
+    Visitor               &&visitor,
+    ConsumeInplaceHandler &&token)
+{
+    return asio::async_initiate< ConsumeInplaceHandler, void(error_code) >(
+        [impl1            = impl_,
+         default_executor = get_executor()]< class Visitor1, class Handler1 >(
+            Handler1 &&handler1, Visitor1 &&visitor1) {
+            if (impl1) [[likely]]
+            {
+                auto [exec1, work1] = detail::track_work(
+                    impl1->work(),
+                    asio::get_associated_executor(handler1, default_executor));
                 impl1->submit_consume_op(
-                    detail::make_consumer_op_function< ValueType, Mutex >(std::move(handler2)));
+                    detail::make_inplace_consumer_op< ValueType, Mutex >(
+                        std::forward< Visitor1 >(visitor1),
+                        std::move(exec1),
+                        std::forward< Handler1 >(handler1),
+                        std::move(work1)));
             }
             else [[unlikely]]
             {
@@ -307,15 +1238,19 @@ channel< ValueType, Executor, Mutex >::async_consume(ConsumeHandler &&token)
                     asio::get_associated_executor(handler1, default_executor);
                 auto handler2 = detail::postit(
                     std::move(exec1), std::forward< Handler1 >(handler1));
-                handler2(error_code(errors::channel_null), ValueType {});
+                handler2(error_code(errors::channel_null));
             }
         },
-        token);
+        token,
+        std::forward< Visitor >(visitor));
 }
 
-template < class ValueType, class Executor, concepts::Lockable Mutex >
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
 void
-channel< ValueType, Executor, Mutex >::close() noexcept
+channel< ValueType, Executor, Mutex, Concurrency >::close() noexcept
 {
     if (impl_) [[likely]]
     {
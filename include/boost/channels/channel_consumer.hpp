@@ -14,20 +14,23 @@
 #include <boost/channels/concepts/executor.hpp>
 #include <boost/channels/concepts/selectable_op.hpp>
 #include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/concurrency.hpp>
 #include <boost/channels/detail/select_state_base.hpp>
 #include <boost/channels/detail/shared_consume_op.hpp>
 
 namespace boost::channels {
 template < class ValueType,
            concepts::executor_model Executor,
-           concepts::Lockable       Mutex >
+           concepts::Lockable       Mutex,
+           class Concurrency = concurrency::locked >
 struct basic_channel_consumer
 {
     using executor_type = Executor;
     using mutex_type    = Mutex;
+    using channel_type  = channel< ValueType, Executor, Mutex, Concurrency >;
+    using impl_type     = typename channel_type::impl_type;
 
-    basic_channel_consumer(channel< ValueType, Executor, Mutex > &chan,
-                           ValueType &                            sink)
+    basic_channel_consumer(channel_type &chan, ValueType &sink)
     : impl_(chan.get_implementation())
     , exec_(chan.get_executor())
     , sink_(sink)
@@ -40,7 +43,7 @@ struct basic_channel_consumer
         return exec_;
     }
 
-    std::shared_ptr< detail::channel_impl< ValueType, Mutex > > const &
+    std::shared_ptr< impl_type > const &
     get_implementation() const
     {
         return impl_;
@@ -52,14 +55,20 @@ struct basic_channel_consumer
         int                                                   which) const
     {
         BOOST_CHANNELS_ASSERT(impl_);
-        impl_->submit_consume_op(
-            detail::make_shared_consume_op(shared_op, sink_, which));
+        auto op = detail::make_shared_consume_op(shared_op, impl_, sink_, which);
+
+        impl_->submit_consume_op(op);
+
+        // the select unlinks the branches it knows of once it completes. A
+        // branch which is linked too late to be among them unlinks itself.
+        if (!op->link_to_select())
+            impl_->cancel_consume_op(*op);
     }
 
   private:
-    std::shared_ptr< detail::channel_impl< ValueType, Mutex > > impl_;
-    Executor                                                    exec_;
-    std::reference_wrapper< ValueType >                         sink_;
+    std::shared_ptr< impl_type >        impl_;
+    Executor                            exec_;
+    std::reference_wrapper< ValueType > sink_;
 };
 
 static_assert(
@@ -67,11 +76,16 @@ static_assert(
                                                      asio::any_io_executor,
                                                      std::mutex > >);
 
-template < class ValueType, class Executor, concepts::Lockable Mutex >
-basic_channel_consumer< ValueType, Executor, Mutex >
-operator<<(ValueType &target, channel< ValueType, Executor, Mutex > &chan)
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+basic_channel_consumer< ValueType, Executor, Mutex, Concurrency >
+operator<<(ValueType                                          &target,
+           channel< ValueType, Executor, Mutex, Concurrency > &chan)
 {
-    return basic_channel_consumer< ValueType, Executor, Mutex >(chan, target);
+    return basic_channel_consumer< ValueType, Executor, Mutex, Concurrency >(
+        chan, target);
 }
 
 }   // namespace boost::channels
@@ -14,6 +14,7 @@
 #include <boost/channels/concepts/executor.hpp>
 #include <boost/channels/concepts/selectable_op.hpp>
 #include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/concurrency.hpp>
 #include <boost/channels/detail/select_state_base.hpp>
 #include <boost/channels/detail/shared_produce_op.hpp>
 
@@ -26,14 +27,16 @@ namespace boost::channels {
 /// asynchronous completion handlers.
 template < class ValueType,
            concepts::executor_model Executor,
-           concepts::Lockable       Mutex >
+           concepts::Lockable       Mutex,
+           class Concurrency = concurrency::locked >
 struct basic_channel_producer
 {
     using executor_type = Executor;
     using mutex_type    = Mutex;
+    using channel_type  = channel< ValueType, Executor, Mutex, Concurrency >;
+    using impl_type     = typename channel_type::impl_type;
 
-    basic_channel_producer(channel< ValueType, Executor, Mutex > &chan,
-                           ValueType &                            source)
+    basic_channel_producer(channel_type &chan, ValueType &source)
     : impl_(chan.get_implementation())
     , exec_(chan.get_executor())
     , source_(source)
@@ -48,7 +51,7 @@ struct basic_channel_producer
 
     auto
     get_implementation() const
-        -> std::shared_ptr< detail::channel_impl< ValueType, Mutex > > const &
+        -> std::shared_ptr< impl_type > const &
     {
         return impl_;
     }
@@ -66,17 +69,17 @@ struct basic_channel_producer
                 //
                 if (impl1) [[likely]]
                 {
-                    auto e1 =
-                        asio::prefer(asio::get_associated_executor(
-                                         handler1, default_executor),
-                                     asio::execution::outstanding_work.tracked);
+                    auto [e1, work1] = detail::track_work(
+                        impl1->work(),
+                        asio::get_associated_executor(handler1,
+                                                      default_executor));
 
-                    auto handler2 = detail::postit(
-                        std::move(e1), std::forward< Handler1 >(handler1));
-                    auto op = detail::make_producer_op_function< Mutex >(
-                        source1, std::move(handler2));
-
-                    impl1->submit_produce_op(op);
+                    impl1->submit_produce_op(
+                        detail::make_producer_op_function< Mutex >(
+                            source1,
+                            std::move(e1),
+                            std::forward< Handler1 >(handler1),
+                            std::move(work1)));
                 }
                 else
                 {
@@ -97,14 +100,20 @@ struct basic_channel_producer
         int                                                   which) const
     {
         BOOST_CHANNELS_ASSERT(impl_);
-        impl_->submit_produce_op(
-            detail::make_shared_produce_op(shared_op, source_, which));
+        auto op = detail::make_shared_produce_op(shared_op, impl_, source_, which);
+
+        impl_->submit_produce_op(op);
+
+        // the select unlinks the branches it knows of once it completes. A
+        // branch which is linked too late to be among them unlinks itself.
+        if (!op->link_to_select())
+            impl_->cancel_produce_op(*op);
     }
 
   private:
-    std::shared_ptr< detail::channel_impl< ValueType, Mutex > > impl_;
-    Executor                                                    exec_;
-    std::reference_wrapper< ValueType >                         source_;
+    std::shared_ptr< impl_type >        impl_;
+    Executor                            exec_;
+    std::reference_wrapper< ValueType > source_;
 };
 
 namespace detail {
@@ -131,11 +140,16 @@ static_assert(concepts::selectable_op<
 /// not be destroyed before any outstanding async_wait operations have
 /// completed.
 /// @return a basic_channel_producer
-template < class ValueType, class Executor, concepts::Lockable Mutex >
-basic_channel_producer< ValueType, Executor, Mutex >
-operator>>(ValueType &source, channel< ValueType, Executor, Mutex > &chan)
+template < class ValueType,
+           class Executor,
+           concepts::Lockable Mutex,
+           class Concurrency >
+basic_channel_producer< ValueType, Executor, Mutex, Concurrency >
+operator>>(ValueType                                          &source,
+           channel< ValueType, Executor, Mutex, Concurrency > &chan)
 {
-    return basic_channel_producer< ValueType, Executor, Mutex >(chan, source);
+    return basic_channel_producer< ValueType, Executor, Mutex, Concurrency >(
+        chan, source);
 }
 
 }   // namespace boost::channels
@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_COMPLETION_MODE_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_COMPLETION_MODE_HPP
+
+namespace boost::channels {
+
+/// @brief How a channel invokes the completion handlers of the async_send
+/// and async_consume operations it matches.
+enum class completion_mode
+{
+    /// @brief Handlers are invoked as if by a call to post(handler). This is
+    /// the default.
+    ///
+    /// Handlers completed by the same call on the channel, such as the
+    /// waiters failed by close(), which share an executor are posted to it
+    /// together as a single function which invokes them in the order they
+    /// completed.
+    post,
+
+    /// @brief Handlers are invoked as if by a call to dispatch(handler), once
+    /// the channel's mutex has been released. A handler whose executor is
+    /// running in the current thread is therefore invoked before the
+    /// operation which completed it returns.
+    ///
+    /// Each thread nests at most BOOST_CHANNELS_INLINE_DEPTH such calls, and
+    /// beyond that handlers are posted, so that two coroutines which feed each
+    /// other cannot exhaust the stack.
+    ///
+    /// Handlers completed by the channel's noexcept members, close() and the
+    /// release of an unpublished send_slot, are posted regardless, so that a
+    /// handler which throws cannot terminate the program.
+    dispatch,
+};
+
+}   // namespace boost::channels
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_COMPLETION_MODE_HPP
@@ -13,6 +13,7 @@
 #include <boost/channels/concepts/convertible_to.hpp>
 
 #include <type_traits>
+#include <utility>
 
 namespace boost::channels::concepts {
 namespace detail {
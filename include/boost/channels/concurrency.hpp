@@ -0,0 +1,73 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_CONCURRENCY_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_CONCURRENCY_HPP
+
+namespace boost::channels::concurrency {
+
+/// @brief Every producer and consumer is serialised by the channel's mutex.
+///
+/// This is the default, and the only model which places no restriction on
+/// the number of producers and consumers.
+struct locked
+{
+};
+
+/// @brief Single producer, single consumer.
+///
+/// The channel's buffer is a wait-free ring. consume_if and any send which
+/// finds space in the ring never take the channel's mutex. The mutex and the
+/// wait queues are only used when one side has to park.
+/// @note At most one thread of execution may produce into the channel and at
+/// most one may consume from it. Operations on each side must be sequenced
+/// with respect to each other. Unbuffered channels always take the slow path.
+struct spsc
+{
+};
+
+/// @brief Any number of producers and consumers, lock-free when buffered.
+///
+/// The channel's buffer is a bounded ring in which every slot carries a
+/// sequence number, so producers and consumers only contend on the ring's
+/// positions rather than on the channel's mutex. The mutex and the wait
+/// queues are only used when the ring is full or empty.
+/// @note Values are moved while a ring slot is claimed. ValueType's move
+/// constructor must not throw.
+struct mpmc
+{
+};
+
+/// @brief Serialised by the channel's mutex, with a buffer of unlimited size.
+///
+/// Values are stored in a linked list of cache-aligned chunks which are
+/// recycled through a small free list, so the memory held grows and shrinks
+/// with the backlog. Sends never wait and no op is allocated for them. The
+/// capacity given to the channel is ignored.
+/// @see BOOST_CHANNELS_CHUNK_SIZE, BOOST_CHANNELS_CHUNK_FREELIST
+struct unbounded
+{
+};
+
+/// @brief Serialised by the channel's mutex, with a buffer which overflows
+/// into memory-mapped files.
+///
+/// The channel's capacity is the size of an in-memory ring. Once it is full,
+/// values are appended to spill files, which are read back in order as the
+/// ring drains. Senders only wait once the spill files reach their limit,
+/// or if no spill file can be created. @see channel::spill_error
+/// Only ValueTypes which are trivially copyable may be spilled.
+/// @note Requires POSIX. @see spill_options, BOOST_CHANNELS_HAS_SPILL
+struct spill
+{
+};
+
+}   // namespace boost::channels::concurrency
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_CONCURRENCY_HPP
@@ -13,9 +13,63 @@
 #include <boost/config.hpp>
 #include <boost/assert.hpp>
 
-#define BOOST_CHANNELS_BUSY_WAIT()
+#include <thread>
+
+/// Called while waiting for another thread to settle the completion state of
+/// an op. Such waits are only ever for the duration of a value transfer.
+#ifndef BOOST_CHANNELS_BUSY_WAIT
+#define BOOST_CHANNELS_BUSY_WAIT() std::this_thread::yield()
+#endif
 #define BOOST_CHANNELS_ASSERT(x) BOOST_ASSERT(x)
 
+/// The number of times a thread blocked in channel::send or channel::consume
+/// polls for completion before it parks. Set to 0 to park at once.
+#ifndef BOOST_CHANNELS_BLOCKING_SPIN
+#define BOOST_CHANNELS_BLOCKING_SPIN 100
+#endif
+
+#ifndef BOOST_CHANNELS_CACHELINE_SIZE
+#define BOOST_CHANNELS_CACHELINE_SIZE 64
+#endif
+
+/// The size in bytes of each chunk of an unbounded channel's buffer.
+#ifndef BOOST_CHANNELS_CHUNK_SIZE
+#define BOOST_CHANNELS_CHUNK_SIZE 4096
+#endif
+
+/// The number of emptied chunks an unbounded channel keeps for reuse. Any
+/// more are released.
+#ifndef BOOST_CHANNELS_CHUNK_FREELIST
+#define BOOST_CHANNELS_CHUNK_FREELIST 4
+#endif
+
+/// The resolution, in microseconds, of the timer wheel which expires
+/// async_send_for and async_consume_for. Deadlines are rounded up to a tick.
+#ifndef BOOST_CHANNELS_TIMER_TICK_US
+#define BOOST_CHANNELS_TIMER_TICK_US 1000
+#endif
+
+/// The number of completion handlers a thread may be running inline, one
+/// within another, under completion_mode::dispatch. Further completions are
+/// posted.
+#ifndef BOOST_CHANNELS_INLINE_DEPTH
+#define BOOST_CHANNELS_INLINE_DEPTH 16
+#endif
+
+/// Defined if channels may spill values to memory-mapped files, which needs
+/// POSIX.
+#if !defined(BOOST_CHANNELS_HAS_SPILL) && __has_include(<sys/mman.h>) && \
+    __has_include(<unistd.h>)
+#define BOOST_CHANNELS_HAS_SPILL
+#endif
+
+/// Defined if asio provides per-operation cancellation slots (Boost 1.77 and
+/// later), to which channel operations then connect.
+#if !defined(BOOST_CHANNELS_HAS_CANCELLATION_SLOT) && \
+    __has_include(<boost/asio/cancellation_signal.hpp>)
+#define BOOST_CHANNELS_HAS_CANCELLATION_SLOT
+#endif
+
 namespace boost::channels {
 
 
@@ -0,0 +1,60 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_ALLOCATE_OP_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_ALLOCATE_OP_HPP
+
+#include <memory>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief Allocate and construct an op with a copy of the given allocator,
+/// which is normally the one associated with the op's completion handler.
+/// @return a raw pointer to the op. Ownership is normally taken by a
+/// boost::intrusive_ptr.
+template < class Op, class Allocator, class... Args >
+Op *
+allocate_op(Allocator const &a, Args &&...args)
+{
+    using traits =
+        typename std::allocator_traits< Allocator >::template rebind_traits<
+            Op >;
+    auto alloc = typename traits::allocator_type(a);
+    auto p     = traits::allocate(alloc, 1);
+    try
+    {
+        traits::construct(
+            alloc, std::to_address(p), std::forward< Args >(args)...);
+    }
+    catch (...)
+    {
+        traits::deallocate(alloc, p, 1);
+        throw;
+    }
+    return std::to_address(p);
+}
+
+/// @brief Destroy and deallocate an op allocated by allocate_op.
+/// @param a must not refer to storage within the op.
+template < class Op, class Allocator >
+void
+deallocate_op(Allocator const &a, Op *op) noexcept
+{
+    using traits =
+        typename std::allocator_traits< Allocator >::template rebind_traits<
+            Op >;
+    auto alloc = typename traits::allocator_type(a);
+    traits::destroy(alloc, op);
+    traits::deallocate(alloc, op, 1);
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_ALLOCATE_OP_HPP
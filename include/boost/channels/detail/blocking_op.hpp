@@ -0,0 +1,170 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_BLOCKING_OP_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_BLOCKING_OP_HPP
+
+#include <boost/channels/config.hpp>
+#include <boost/channels/detail/consume_op_interface.hpp>
+#include <boost/channels/detail/produce_op_interface.hpp>
+#include <boost/channels/error_code.hpp>
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief Parks a thread until the channel has released an op which lives
+/// on that thread's stack.
+///
+/// The waker marks the parker as waking, notifies, and only then marks it
+/// woken. The parked thread does not return until it sees woken, so the
+/// parker is never destroyed while the waker is still using it.
+struct op_parker
+{
+    /// @brief Wait for wake(), polling up to BOOST_CHANNELS_BLOCKING_SPIN
+    /// times before parking.
+    void
+    wait() noexcept
+    {
+        for (int i = 0; i < BOOST_CHANNELS_BLOCKING_SPIN; ++i)
+            if (word_.load(std::memory_order_acquire) != parked)
+                break;
+
+        word_.wait(parked, std::memory_order_acquire);
+        while (word_.load(std::memory_order_acquire) != woken)
+            BOOST_CHANNELS_BUSY_WAIT();
+    }
+
+    void
+    wake() noexcept
+    {
+        word_.store(waking, std::memory_order_release);
+        word_.notify_one();
+        word_.store(woken, std::memory_order_release);
+    }
+
+  private:
+    enum : unsigned
+    {
+        parked,
+        waking,
+        woken
+    };
+
+    std::atomic< unsigned > word_ { parked };
+};
+
+/// @brief A producer op on the stack of a thread blocked in channel::send
+///
+/// The op is never deallocated. When the channel releases its last reference,
+/// the sending thread is woken.
+template < class ValueType, concepts::Lockable Mutex >
+struct blocking_producer_op final
+: detail::basic_produce_op_interface< ValueType, Mutex >
+{
+    using interface_type = detail::basic_produce_op_interface< ValueType, Mutex >;
+
+    explicit blocking_producer_op(ValueType &source)
+    : interface_type(this)
+    , source_(source)
+    {
+    }
+
+    ValueType
+    consume()
+    {
+        return std::move(source_);
+    }
+
+    template < class F >
+    void
+    lend(F &&f)
+    {
+        f(source_);
+    }
+
+    void
+    fail(error_code ec)
+    {
+        ec_ = ec;
+    }
+
+    static void
+    destroy(blocking_producer_op *self) noexcept
+    {
+        self->parker_.wake();
+    }
+
+    /// @brief Wait until the channel has released the op.
+    /// @return the outcome of the send.
+    error_code
+    wait() noexcept
+    {
+        parker_.wait();
+        return ec_;
+    }
+
+  private:
+    ValueType &source_;
+    error_code ec_;
+    op_parker  parker_;
+};
+
+/// @brief A consumer op on the stack of a thread blocked in channel::consume
+///
+/// The op is never deallocated. When the channel releases its last reference,
+/// the consuming thread is woken.
+template < class ValueType, concepts::Lockable Mutex >
+struct blocking_consumer_op final
+: detail::basic_consume_op_interface< ValueType, Mutex >
+{
+    using interface_type = detail::basic_consume_op_interface< ValueType, Mutex >;
+    using value_type     = typename interface_type::value_type;
+
+    explicit blocking_consumer_op(std::optional< ValueType > &target)
+    : interface_type(this)
+    , target_(target)
+    {
+    }
+
+    void
+    commit(value_type &&val)
+    {
+        auto &[ec, value] = val;
+        ec_               = ec;
+        if (!ec)
+            target_.emplace(std::move(value));
+    }
+
+    static void
+    destroy(blocking_consumer_op *self) noexcept
+    {
+        self->parker_.wake();
+    }
+
+    /// @brief Wait until the channel has released the op.
+    /// @return the outcome of the consume.
+    error_code
+    wait() noexcept
+    {
+        parker_.wait();
+        return ec_;
+    }
+
+  private:
+    std::optional< ValueType > &target_;
+    error_code                  ec_;
+    op_parker                   parker_;
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_BLOCKING_OP_HPP
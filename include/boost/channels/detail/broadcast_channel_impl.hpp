@@ -0,0 +1,582 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_BROADCAST_CHANNEL_IMPL_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_BROADCAST_CHANNEL_IMPL_HPP
+
+#include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/detail/implement_channel_queue.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+#include <boost/channels/error_code.hpp>
+#include <boost/channels/overflow_policy.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace boost::channels::detail {
+
+/// @brief The shared state of a broadcast_channel.
+///
+/// Values are held once, in a ring indexed by sequence number. Every
+/// subscriber has its own cursor, which is the sequence number of the next
+/// value it will receive. head_ is the oldest value any cursor still needs
+/// and tail_ is the next value to be sent. A value is destroyed as soon as
+/// the slowest cursor passes it.
+///
+/// The ring is full when tail_ - head_ == capacity. What a send then does is
+/// chosen by an overflow_policy. Under overflow_policy::drop_oldest the
+/// value at head_ is destroyed, and every subscriber whose cursor was on it
+/// lags: its cursor moves to the new head and the values it skipped are
+/// counted.
+///
+/// The ring's slots are allocated after the implementation.
+template < class ValueType, concepts::Lockable Mutex >
+struct alignas(std::max_align_t) broadcast_channel_impl final
+{
+    using value_type   = ValueType;
+    using slot_type    = std::aligned_storage_t< sizeof(ValueType) >;
+    using consumer_ptr = basic_consumer_ptr< ValueType, Mutex >;
+    using producer_ptr = basic_producer_ptr< ValueType, Mutex >;
+
+    struct subscriber
+    {
+        explicit subscriber(std::uint64_t cursor)
+        : cursor(cursor)
+        {
+        }
+
+        /// The sequence number of the next value to be received.
+        std::uint64_t cursor;
+
+        /// The number of values skipped because the subscriber lagged.
+        std::uint64_t missed = 0;
+
+        basic_consumer_queue< ValueType, Mutex > consumers;
+    };
+
+    /// @pre capacity > 0
+    broadcast_channel_impl(std::size_t capacity, overflow_policy policy);
+
+    broadcast_channel_impl(broadcast_channel_impl const &) = delete;
+
+    broadcast_channel_impl &
+    operator=(broadcast_channel_impl const &) = delete;
+
+    ~broadcast_channel_impl();
+
+    /// @brief Add a subscriber which receives values sent from now on.
+    subscriber *
+    subscribe();
+
+    /// @brief Remove a subscriber, failing any consumer it left waiting.
+    void
+    unsubscribe(subscriber *sub);
+
+    void
+    close();
+
+    /// @brief Append a value if there is room, or apply the overflow policy.
+    /// @param value is moved from only if it is taken
+    /// @param ec is set to errors::channel_closed, errors::value_dropped or
+    /// errors::channel_full if the value was refused for good
+    /// @return true if the value was taken. false with ec clear means the
+    /// sender must wait.
+    bool
+    try_produce(value_type &value, error_code &ec);
+
+    /// @brief Park a sender until the ring has room.
+    void
+    submit_produce_op(producer_ptr produce_op);
+
+    void
+    submit_consume_op(subscriber &sub, consumer_ptr consume_op);
+
+    /// @brief Claim a consumer which has not completed and remove it from its
+    /// subscriber's wait queue.
+    /// @return true if the op was claimed. The caller completes it and commits
+    /// its state.
+    bool
+    claim_consume_op(basic_consume_op_interface< ValueType, Mutex > &op);
+
+    /// @brief Claim a producer which has not completed and remove it from the
+    /// wait queue.
+    /// @see claim_consume_op
+    bool
+    claim_produce_op(basic_produce_op_interface< ValueType, Mutex > &op);
+
+    /// @brief Copy the subscriber's next value, if it has one.
+    std::optional< value_type >
+    consume_if(subscriber &sub, error_code &ec);
+
+    /// @brief The number of values sent which the subscriber has yet to
+    /// receive.
+    std::uint64_t
+    lag(subscriber const &sub)
+    {
+        auto lck = std::lock_guard(mutex_);
+        return tail_ - sub.cursor;
+    }
+
+    std::uint64_t
+    missed(subscriber const &sub)
+    {
+        auto lck = std::lock_guard(mutex_);
+        return sub.missed;
+    }
+
+    std::size_t
+    capacity() const
+    {
+        return capacity_;
+    }
+
+    /// @brief The number of values held in the ring.
+    std::size_t
+    size()
+    {
+        auto lck = std::lock_guard(mutex_);
+        return std::size_t(tail_ - head_);
+    }
+
+    std::size_t
+    subscribers()
+    {
+        auto lck = std::lock_guard(mutex_);
+        return subscribers_.size();
+    }
+
+    std::size_t
+    producers_waiting()
+    {
+        auto lck = std::lock_guard(mutex_);
+        return producers_.size();
+    }
+
+    overflow_counters
+    counters()
+    {
+        auto lck = std::lock_guard(mutex_);
+        return counters_;
+    }
+
+    /// @brief Counts the outstanding work of the channel's waiting ops.
+    work_tracker< Mutex > &
+    work()
+    {
+        return *work_;
+    }
+
+  private:
+    value_type &
+    at(std::uint64_t seq)
+    {
+        auto slots = reinterpret_cast< slot_type * >(this + 1);
+        return *std::launder(
+            reinterpret_cast< value_type * >(slots + seq % capacity_));
+    }
+
+    bool
+    full() const
+    {
+        return tail_ - head_ == capacity_;
+    }
+
+    /// @brief Append a value and hand it to every subscriber waiting for it.
+    /// @pre !full()
+    void
+    append(value_type &&value);
+
+    /// @brief Destroy the value at head_, moving any subscriber on it past.
+    void
+    evict_head();
+
+    /// @brief Complete the subscriber's waiting consumers from its cursor.
+    void
+    serve(subscriber &sub);
+
+    /// @brief Move a cursor forward, keeping at_head_ current.
+    void
+    advance(subscriber &sub)
+    {
+        if (sub.cursor++ == head_)
+            --at_head_;
+    }
+
+    /// @brief Destroy the values which every cursor has passed.
+    void
+    release();
+
+    /// @brief Release passed values and admit waiting senders into the room
+    /// made.
+    void
+    settle();
+
+    std::size_t const     capacity_;
+    overflow_policy const policy_;
+
+    Mutex mutex_;
+
+    std::uint64_t head_ = 0;
+    std::uint64_t tail_ = 0;
+
+    /// The number of subscribers whose cursor is head_. While it is non-zero
+    /// the value at head_ is still needed.
+    std::size_t at_head_ = 0;
+
+    std::vector< std::unique_ptr< subscriber > > subscribers_;
+
+    basic_producer_queue< ValueType, Mutex > producers_;
+
+    overflow_counters counters_;
+
+    bool closed_ = false;
+
+    /// Shared with the ops it counts, which may outlive the channel
+    work_tracker< Mutex > *work_ = work_tracker< Mutex >::create();
+};
+
+//
+//
+//
+
+template < class ValueType, concepts::Lockable Mutex >
+broadcast_channel_impl< ValueType, Mutex >::broadcast_channel_impl(
+    std::size_t     capacity,
+    overflow_policy policy)
+: capacity_(capacity)
+, policy_(policy)
+{
+    BOOST_CHANNELS_ASSERT(capacity_ > 0);
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+broadcast_channel_impl< ValueType, Mutex >::~broadcast_channel_impl()
+{
+    close();
+    for (; head_ != tail_; ++head_)
+        at(head_).~value_type();
+    work_->retire();
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+auto
+broadcast_channel_impl< ValueType, Mutex >::subscribe() -> subscriber *
+{
+    auto lck = std::lock_guard(mutex_);
+    subscribers_.push_back(std::make_unique< subscriber >(tail_));
+    if (tail_ == head_)
+        ++at_head_;
+    return subscribers_.back().get();
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+broadcast_channel_impl< ValueType, Mutex >::unsubscribe(subscriber *sub)
+{
+    // the subscriber and its ops are released after the mutex
+    std::unique_ptr< subscriber > removed;
+
+    auto lck = std::lock_guard(mutex_);
+    auto it  = std::find_if(subscribers_.begin(),
+                           subscribers_.end(),
+                           [sub](auto &p) { return p.get() == sub; });
+    BOOST_CHANNELS_ASSERT(it != subscribers_.end());
+    removed = std::move(*it);
+    subscribers_.erase(it);
+
+    auto &consumers = removed->consumers;
+    while (!consumers.empty())
+    {
+        auto &consumer = *consumers.front();
+        if (consumer.state().claim())
+        {
+            consumer.commit(std::make_tuple(
+                error_code(errors::channel_closed), value_type()));
+            consumer.state().commit();
+        }
+        consumers.pop();
+    }
+
+    if (removed->cursor == head_)
+        --at_head_;
+    settle();
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+broadcast_channel_impl< ValueType, Mutex >::close()
+{
+    auto lck = std::lock_guard(mutex_);
+    if (closed_)
+        return;
+    closed_ = true;
+
+    while (!producers_.empty())
+    {
+        auto &producer = *producers_.front();
+        if (producer.state().claim())
+        {
+            producer.fail(errors::channel_closed);
+            producer.state().commit();
+        }
+        producers_.pop();
+    }
+
+    // subscribers still receive the values already sent
+    for (auto &sub : subscribers_)
+        serve(*sub);
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+bool
+broadcast_channel_impl< ValueType, Mutex >::try_produce(value_type &value,
+                                                        error_code &ec)
+{
+    auto lck = std::lock_guard(mutex_);
+    if (closed_)
+    {
+        ec = errors::channel_closed;
+        return false;
+    }
+
+    if (!full() && producers_.empty())
+    {
+        append(std::move(value));
+        settle();
+        return true;
+    }
+
+    switch (policy_)
+    {
+    case overflow_policy::block:
+        break;
+    case overflow_policy::drop_newest:
+        ++counters_.dropped_newest;
+        ec = errors::value_dropped;
+        break;
+    case overflow_policy::reject:
+        ++counters_.rejected;
+        ec = errors::channel_full;
+        break;
+    case overflow_policy::drop_oldest:
+        evict_head();
+        append(std::move(value));
+        settle();
+        return true;
+    }
+    return false;
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+broadcast_channel_impl< ValueType, Mutex >::submit_produce_op(
+    producer_ptr produce_op)
+{
+    auto lck = std::lock_guard(mutex_);
+    producers_.push(std::move(produce_op));
+    if (closed_)
+    {
+        auto &producer = *producers_.front();
+        if (producer.state().claim())
+        {
+            producer.fail(errors::channel_closed);
+            producer.state().commit();
+        }
+        producers_.pop();
+        return;
+    }
+    settle();
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+broadcast_channel_impl< ValueType, Mutex >::submit_consume_op(
+    subscriber  &sub,
+    consumer_ptr consume_op)
+{
+    auto lck = std::lock_guard(mutex_);
+    sub.consumers.push(std::move(consume_op));
+    serve(sub);
+    settle();
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+auto
+broadcast_channel_impl< ValueType, Mutex >::consume_if(subscriber &sub,
+                                                       error_code &ec)
+    -> std::optional< value_type >
+{
+    auto lck = std::lock_guard(mutex_);
+
+    std::optional< value_type > result;
+    if (sub.cursor != tail_ && sub.consumers.empty())
+    {
+        result.emplace(at(sub.cursor));
+        advance(sub);
+        settle();
+    }
+    else if (closed_ && sub.cursor == tail_)
+        ec = errors::channel_closed;
+    return result;
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+bool
+broadcast_channel_impl< ValueType, Mutex >::claim_consume_op(
+    basic_consume_op_interface< ValueType, Mutex > &op)
+{
+    // the op is released after the mutex
+    consumer_ptr removed;
+
+    auto lck = std::lock_guard(mutex_);
+    if (!op.state().claim())
+        return false;
+
+    // the op does not know its subscriber, so each one's queue is asked
+    for (auto &sub : subscribers_)
+        if (sub->consumers.holds(op))
+        {
+            removed = sub->consumers.erase(&op);
+            break;
+        }
+    return true;
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+bool
+broadcast_channel_impl< ValueType, Mutex >::claim_produce_op(
+    basic_produce_op_interface< ValueType, Mutex > &op)
+{
+    // the op is released after the mutex
+    producer_ptr removed;
+
+    auto lck = std::lock_guard(mutex_);
+    if (!op.state().claim())
+        return false;
+    if (producers_.linked(op))
+        removed = producers_.erase(&op);
+    return true;
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+broadcast_channel_impl< ValueType, Mutex >::append(value_type &&value)
+{
+    BOOST_CHANNELS_ASSERT(!full());
+    new (&at(tail_)) value_type(std::move(value));
+    ++tail_;
+
+    for (auto &sub : subscribers_)
+        if (!sub->consumers.empty())
+            serve(*sub);
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+broadcast_channel_impl< ValueType, Mutex >::evict_head()
+{
+    BOOST_CHANNELS_ASSERT(head_ != tail_);
+    at(head_).~value_type();
+    ++head_;
+
+    // those on the evicted value lag to the new head, alongside any
+    // subscriber already there
+    at_head_ = 0;
+    for (auto &sub : subscribers_)
+    {
+        if (sub->cursor < head_)
+        {
+            sub->missed += head_ - sub->cursor;
+            sub->cursor = head_;
+        }
+        if (sub->cursor == head_)
+            ++at_head_;
+    }
+    counters_.dropped_oldest += 1;
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+broadcast_channel_impl< ValueType, Mutex >::serve(subscriber &sub)
+{
+    auto &consumers = sub.consumers;
+    while (!consumers.empty())
+    {
+        auto &consumer = *consumers.front();
+        if (sub.cursor == tail_ && !closed_)
+            break;
+        if (consumer.state().claim())
+        {
+            if (sub.cursor == tail_)
+                consumer.commit(std::make_tuple(
+                    error_code(errors::channel_closed), value_type()));
+            else
+            {
+                consumer.commit(
+                    std::make_tuple(error_code(), value_type(at(sub.cursor))));
+                advance(sub);
+            }
+            consumer.state().commit();
+        }
+        consumers.pop();
+    }
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+broadcast_channel_impl< ValueType, Mutex >::release()
+{
+    if (at_head_ != 0 || head_ == tail_)
+        return;
+
+    auto next = tail_;
+    for (auto &sub : subscribers_)
+        next = std::min(next, sub->cursor);
+
+    for (; head_ != next; ++head_)
+        at(head_).~value_type();
+
+    at_head_ = 0;
+    for (auto &sub : subscribers_)
+        if (sub->cursor == head_)
+            ++at_head_;
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+broadcast_channel_impl< ValueType, Mutex >::settle()
+{
+    release();
+    while (!full() && !producers_.empty())
+    {
+        auto &producer = *producers_.front();
+        if (producer.state().claim())
+        {
+            auto v = producer.consume();
+            settle_front_producer(producers_);
+            append(std::move(v));
+            release();
+        }
+        else
+            producers_.pop();
+    }
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_BROADCAST_CHANNEL_IMPL_HPP
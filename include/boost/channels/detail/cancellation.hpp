@@ -0,0 +1,258 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CANCELLATION_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CANCELLATION_HPP
+
+#include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/config.hpp>
+#include <boost/channels/detail/consume_op_interface.hpp>
+#include <boost/channels/detail/produce_op_interface.hpp>
+#include <boost/channels/detail/select_state_base.hpp>
+#include <boost/channels/error_code.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+
+#ifdef BOOST_CHANNELS_HAS_CANCELLATION_SLOT
+#include <boost/asio/associated_cancellation_slot.hpp>
+#include <boost/asio/cancellation_type.hpp>
+#endif
+
+#include <memory>
+#include <tuple>
+
+namespace boost::channels::detail {
+
+/// @brief Claim a consumer op parked in a channel and remove it from the
+/// channel's queue.
+///
+/// The channel claims the op under its mutex, as a flush does, so the claim
+/// is never held by a thread which is waiting for the mutex.
+/// @param impl is the channel, or nullptr if it no longer exists
+/// @return true if the op was claimed. The caller completes it and commits
+/// its state.
+template < class Impl, class ValueType, concepts::Lockable Mutex >
+bool
+claim_parked(Impl *impl, basic_consume_op_interface< ValueType, Mutex > &op)
+{
+    return impl ? impl->claim_consume_op(op) : op.state().claim();
+}
+
+/// @brief Claim a producer op parked in a channel and remove it from the
+/// channel's queue.
+/// @see claim_parked
+template < class Impl, class ValueType, concepts::Lockable Mutex >
+bool
+claim_parked(Impl *impl, basic_produce_op_interface< ValueType, Mutex > &op)
+{
+    return impl ? impl->claim_produce_op(op) : op.state().claim();
+}
+
+/// @brief Complete a withdrawn consumer op with
+/// asio::error::operation_aborted.
+/// @pre op.state().claimed() == true
+template < class ValueType, concepts::Lockable Mutex >
+void
+withdraw(basic_consume_op_interface< ValueType, Mutex > &op)
+{
+    op.commit(std::make_tuple(error_code(asio::error::operation_aborted),
+                              ValueType()));
+}
+
+/// @brief Fail a withdrawn producer op with asio::error::operation_aborted.
+/// Ops which can hand their value back, such as those of async_send_for, do
+/// so.
+/// @pre op.state().claimed() == true
+template < class ValueType, concepts::Lockable Mutex >
+void
+withdraw(basic_produce_op_interface< ValueType, Mutex > &op)
+{
+    op.fail(asio::error::operation_aborted);
+}
+
+/// @brief Cancel an op parked in a channel, unless it has already completed.
+///
+/// An op which has not yet been matched has had no effect on its channel, so
+/// withdrawing it satisfies terminal, partial and total cancellation alike.
+/// The op is completed outside the channel's mutex.
+/// @return true if the op was cancelled.
+template < class Impl, class Op >
+bool
+cancel_parked_op(Impl *impl, Op &op)
+{
+    if (!claim_parked(impl, op))
+        return false;
+    withdraw(op);
+    op.state().commit();
+    return true;
+}
+
+/// @brief Cancel a select, unless it has already completed.
+///
+/// The select completes with asio::error::operation_aborted. Its branches
+/// are unlinked from their channels by the posted completion, after the
+/// claim has been committed, so no channel's mutex is taken while the claim
+/// is held. Values offered by producing branches stay in the caller's
+/// storage.
+/// @return true if the select was cancelled.
+template < concepts::Lockable Mutex >
+bool
+cancel_select(select_state_base< Mutex > &sstate)
+{
+    if (!sstate.state().claim())
+        return false;
+    sstate.complete(
+        std::make_tuple(error_code(asio::error::operation_aborted), -1));
+    sstate.state().commit();
+    return true;
+}
+
+#ifdef BOOST_CHANNELS_HAS_CANCELLATION_SLOT
+
+using cancellation_slot_type = asio::cancellation_slot;
+
+/// @brief The cancellation slot associated with a handler. It must be taken
+/// before the handler is moved into its op.
+template < class Handler >
+cancellation_slot_type
+cancellation_slot_of(Handler const &handler)
+{
+    return asio::get_associated_cancellation_slot(handler);
+}
+
+/// @brief Remove whatever canceller an op installed in its handler's slot.
+///
+/// Called on the handler's executor as the handler is invoked, which is
+/// where the slot's signal is emitted, so the two cannot race.
+template < class Handler >
+void
+clear_cancellation_slot(Handler const &handler)
+{
+    auto slot = asio::get_associated_cancellation_slot(handler);
+    if (slot.is_connected())
+        slot.clear();
+}
+
+inline bool
+honours(asio::cancellation_type type)
+{
+    using asio::cancellation_type;
+    return (type & (cancellation_type::terminal | cancellation_type::partial |
+                    cancellation_type::total)) != cancellation_type::none;
+}
+
+/// @brief The cancellation handler installed in the slot of a parked op's
+/// completion handler.
+///
+/// Holds a reference to the op, so that a signal emitted after the op has
+/// completed finds its state done and does nothing. The slot is cleared, and
+/// the reference dropped, when the op's handler is invoked. Ops hand their
+/// executor, and with it any outstanding work, to the completion they post,
+/// so only the op's memory is kept until then.
+template < class Impl, class Op >
+struct op_canceller
+{
+    void
+    operator()(asio::cancellation_type type)
+    {
+        if (!honours(type))
+            return;
+        auto impl = impl_.lock();
+        cancel_parked_op(impl.get(), *op_);
+    }
+
+    std::weak_ptr< Impl >       impl_;
+    boost::intrusive_ptr< Op > op_;
+};
+
+/// @brief The cancellation handler installed in the slot of a select's
+/// completion handler.
+template < concepts::Lockable Mutex >
+struct select_canceller
+{
+    void
+    operator()(asio::cancellation_type type)
+    {
+        if (!honours(type))
+            return;
+        if (auto sstate = sstate_.lock())
+            cancel_select(*sstate);
+    }
+
+    std::weak_ptr< select_state_base< Mutex > > sstate_;
+};
+
+/// @brief Withdraw an op from its channel when the cancellation slot of its
+/// handler is signalled.
+template < class Impl, class Op >
+void
+connect_cancellation(cancellation_slot_type         slot,
+                     std::shared_ptr< Impl > const &impl,
+                     boost::intrusive_ptr< Op >     op)
+{
+    if (slot.is_connected())
+        slot.template emplace< op_canceller< Impl, Op > >(
+            std::weak_ptr< Impl >(impl), std::move(op));
+}
+
+/// @brief Cancel a select when the cancellation slot of its handler is
+/// signalled.
+template < class SelectState >
+void
+connect_cancellation(cancellation_slot_type                slot,
+                     std::shared_ptr< SelectState > const &sstate)
+{
+    using mutex_type = typename SelectState::mutex_type;
+    if (slot.is_connected())
+        slot.template emplace< select_canceller< mutex_type > >(
+            std::weak_ptr< select_state_base< mutex_type > >(sstate));
+}
+
+#else
+
+/// @brief Stands in for the cancellation slot of a handler where asio has
+/// none. Nothing is connected to it.
+struct cancellation_slot_type
+{
+};
+
+template < class Handler >
+cancellation_slot_type
+cancellation_slot_of(Handler const &)
+{
+    return {};
+}
+
+template < class Handler >
+void
+clear_cancellation_slot(Handler const &)
+{
+}
+
+template < class Impl, class Op >
+void
+connect_cancellation(cancellation_slot_type,
+                     std::shared_ptr< Impl > const &,
+                     boost::intrusive_ptr< Op > const &)
+{
+}
+
+template < class SelectState >
+void
+connect_cancellation(cancellation_slot_type,
+                     std::shared_ptr< SelectState > const &)
+{
+}
+
+#endif
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CANCELLATION_HPP
@@ -11,25 +11,59 @@
 #define BOOST_CHANNELS_DETAIL_CHANNEL_IMPL_HPP
 
 #include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/completion_mode.hpp>
+#include <boost/channels/concurrency.hpp>
 #include <boost/channels/detail/channel_consume_op.hpp>
 #include <boost/channels/detail/channel_send_op.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
+#include <boost/channels/detail/concurrency_traits.hpp>
 #include <boost/channels/detail/implement_channel_queue.hpp>
 #include <boost/channels/detail/value_buffer.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+#include <boost/channels/overflow_policy.hpp>
 
 #include <boost/assert.hpp>
+#include <boost/throw_exception.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
-#include <deque>
-#include <queue>
+#include <cstdlib>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <utility>
 
 namespace boost::channels::detail {
 
-template < class ValueType, concepts::Lockable Mutex >
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Concurrency = concurrency::locked >
 struct alignas(std::max_align_t) channel_impl final
 {
-    using value_type = ValueType;
+    using value_type  = ValueType;
+    using traits_type = concurrency_traits< Concurrency >;
+    using ring_type = typename traits_type::template ring_ref< ValueType >;
+    using slot_type = typename ring_type::slot_type;
 
-    channel_impl(std::size_t capacity);
+    /// @brief true if the ring buffer can be accessed without the mutex
+    static constexpr bool lock_free = traits_type::lock_free;
+
+    /// @brief true if the buffer's slots trail the implementation. Otherwise
+    /// the buffer allocates its own storage and is never full.
+    static constexpr bool bounded = traits_type::bounded;
+
+    /// @brief true if sends should try try_produce before parking an op.
+    static constexpr bool eager_send = traits_type::eager_send;
+
+    /// @brief true if the buffer spills into segments mapped by grow_spill.
+    static constexpr bool spills = traits_type::spills;
+
+    /// @param capacity is the number of values the buffer holds
+    /// @param ring_args are further arguments to the buffer's control block
+    template < class... RingArgs >
+    explicit channel_impl(std::size_t capacity, RingArgs &&...ring_args);
 
     channel_impl(channel_impl const &) = delete;
 
@@ -52,26 +86,250 @@ struct alignas(std::max_align_t) channel_impl final
     void
     submit_produce_op(basic_producer_ptr< ValueType, Mutex > produce_op);
 
+    /// @brief Remove a consumer from the wait queue, if it is still there.
+    ///
+    /// Used to unlink the losing branches of a select once it has completed.
+    void
+    cancel_consume_op(basic_consume_op_interface< ValueType, Mutex > &op);
+
+    /// @brief Remove a producer from the wait queue, if it is still there.
+    ///
+    /// Used to unlink the losing branches of a select once it has completed.
+    void
+    cancel_produce_op(basic_produce_op_interface< ValueType, Mutex > &op);
+
+    /// @brief Claim a consumer which has not completed and remove it from the
+    /// wait queue.
+    ///
+    /// Used by deadlines and cancellations. The op is claimed with the mutex
+    /// held, as a flush claims it, so no thread ever waits for the mutex
+    /// while holding the op's claim.
+    /// @return true if the op was claimed. The caller completes it outside
+    /// the mutex and commits its state.
+    bool
+    claim_consume_op(basic_consume_op_interface< ValueType, Mutex > &op);
+
+    /// @brief Claim a producer which has not completed and remove it from the
+    /// wait queue.
+    /// @see claim_consume_op
+    bool
+    claim_produce_op(basic_produce_op_interface< ValueType, Mutex > &op);
+
+    /// @brief The number of values the buffer accepts.
+    std::size_t
+    capacity()
+    {
+        return buffer().capacity();
+    }
+
+    /// @brief Move the buffered values into storage for new_capacity values
+    /// and admit any producers for which there is now space.
+    ///
+    /// If more than new_capacity values are buffered, they are kept, and no
+    /// more are accepted until enough have been consumed. While a slot is
+    /// reserved, the resize is deferred until it is published or cancelled.
+    void
+    resize(std::size_t new_capacity) requires(!lock_free && bounded);
+
+    /// @brief The number of consumers in the wait queue.
+    std::size_t
+    consumers_waiting();
+
+    /// @brief The number of producers in the wait queue.
+    std::size_t
+    producers_waiting();
+
     std::optional< value_type >
     consume_if(error_code &ec);
 
+    /// @brief Give a value to a waiting consumer or to the ring buffer, if
+    /// that can be done without waiting.
+    /// @param value is moved from only if it is taken
+    /// @param ec is set to errors::channel_closed if the channel is closed
+    /// @return true if the value was taken.
+    bool
+    try_produce(value_type &value, error_code &ec);
+
+    /// @brief The channel's overflow policy.
+    overflow_policy
+    overflow() const
+    {
+        return overflow_;
+    }
+
+    /// @brief Set the channel's overflow policy.
+    /// @pre No operation has been started on the channel, since sends read
+    /// the policy without taking the mutex.
+    void
+    set_overflow(overflow_policy policy) requires(!lock_free)
+    {
+        overflow_ = policy;
+    }
+
+    /// @brief Give a value to a waiting consumer or to the ring buffer, and
+    /// if neither has room, dispose of it according to the overflow policy.
+    ///
+    /// Never waits.
+    /// @param value is moved from only if it is taken
+    /// @return errors::channel_closed, errors::value_dropped or
+    /// errors::channel_full if the value was not taken.
+    error_code
+    produce_or_overflow(value_type &value) requires(!lock_free);
+
+    /// @brief Apply produce_or_overflow to each value of a range, under a
+    /// single acquisition of the mutex.
+    ///
+    /// Every value is moved from. Those which do not fit are disposed of
+    /// and counted one by one, as for separate sends.
+    /// @param accepted is set to the number of values taken
+    /// @return errors::channel_closed if nothing was taken because the
+    /// channel is closed, otherwise the error of the last value refused.
+    template < class Iterator >
+    error_code
+    produce_range_or_overflow(Iterator         &first,
+                              Iterator const   &last,
+                              std::size_t      &accepted) requires(!lock_free);
+
+    /// @brief How the handlers of matched ops are invoked.
+    completion_mode
+    completion() const
+    {
+        return completion_.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Set how the handlers of matched ops are invoked. Ops matched
+    /// while the mode is changed may complete under either mode.
+    void
+    set_completion(completion_mode mode)
+    {
+        completion_.store(mode, std::memory_order_relaxed);
+    }
+
+    /// @brief Counts the outstanding work of the channel's waiting ops.
+    work_tracker< Mutex > &
+    work()
+    {
+        return *work_;
+    }
+
+    /// @brief The number of values refused because of the overflow policy.
+    overflow_counters
+    counters();
+
+    /// @brief The reason the last spill segment could not be created, or
+    /// error_code() if the last attempt succeeded.
+    error_code
+    spill_error() requires spills;
+
+    /// @brief Make the value constructed in the reserved slot visible to
+    /// consumers.
+    ///
+    /// If the channel has been closed since the slot was granted, the value
+    /// is destroyed instead.
+    /// @param value is the value in the reserved slot
+    /// @return errors::channel_closed if the value was not published.
+    error_code
+    publish_reserved(value_type *value) requires(!lock_free);
+
+    /// @brief Give up the reserved slot, which must hold no value.
+    void
+    cancel_reserved() requires(!lock_free);
+
+    /// @brief Attempt to move a value into the ring buffer without taking the
+    /// mutex.
+    ///
+    /// Fails if the channel is closed, if the ring is full or if there are
+    /// producers already parked (which preserves ordering). The mutex is
+    /// only taken if a parked consumer needs to be woken.
+    /// @return true if the value was taken, otherwise value is untouched.
+    bool
+    try_produce_nolock(value_type &value) requires lock_free;
+
+    /// @brief Attempt to take a value from the ring buffer without taking
+    /// the mutex.
+    ///
+    /// Fails if the ring is empty or if there are consumers already parked.
+    /// The mutex is only taken if a parked producer can now be admitted.
+    std::optional< value_type >
+    try_consume_nolock() requires lock_free;
+
   private:
-    std::aligned_storage_t< sizeof(ValueType) > *
+    slot_type *
+    trailing_storage()
+    {
+        return reinterpret_cast< slot_type * >(this + 1);
+    }
+
+    slot_type *
     storage()
     {
-        return reinterpret_cast<
-            std::aligned_storage_t< sizeof(ValueType) > * >(this + 1);
+        return storage_;
     }
 
-    value_buffer_ref< ValueType >
+    ring_type
     buffer()
     {
-        return value_buffer_ref< ValueType > { &buffer_data_, storage() };
+        return ring_type { &buffer_data_, storage() };
     }
 
+    /// @brief Match waiters against the buffer and against each other.
+    /// @pre mutex_ is locked
+    void
+    flush();
+
+    /// @brief Relocate the buffer into storage for new_capacity values.
+    /// @pre mutex_ is locked and no slot is reserved
+    void
+    relocate(std::size_t new_capacity) requires(!lock_free && bounded);
+
+    /// @brief Map the spill segment the buffer has asked for, if any, and
+    /// admit the producers waiting for it.
+    /// @pre mutex_ is not locked, since mapping takes system calls
+    void
+    grow_spill();
+
+    /// @brief Offer a value to a running channel, and dispose of it
+    /// according to the overflow policy if there is no room.
+    /// @pre mutex_ is locked and the channel is running
+    error_code
+    offer_or_overflow(value_type &value) requires(!lock_free);
+
+    /// @brief Apply the overflow policy to a producer which a flush has
+    /// left waiting, so that no producer waits on a lossy channel.
+    ///
+    /// Under drop_oldest, buffered values are discarded until the producer
+    /// is admitted. Otherwise the producer completes with
+    /// errors::value_dropped or errors::channel_full.
+    /// @pre mutex_ is locked
+    void
+    overflow_parked(basic_produce_op_interface< ValueType, Mutex > &op)
+        requires(!lock_free);
+
+    /// @brief Apply a resize which was deferred by a reserved slot.
+    /// @pre mutex_ is locked and no slot is reserved
+    void
+    apply_pending_resize() requires(!lock_free && bounded);
+
     Mutex mutex_;
 
-    value_buffer_data buffer_data_;
+    typename traits_type::ring_data buffer_data_;
+
+    /// The ring's slots. Initially those allocated after the implementation,
+    /// and separately allocated once the channel has been resized.
+    slot_type *storage_ = trailing_storage();
+
+    /// A capacity to be applied once the reserved slot is settled.
+    std::optional< std::size_t > pending_capacity_;
+
+    overflow_policy overflow_ = overflow_policy::block;
+
+    /// Read before the mutex is taken, by the scope which outlives the lock
+    std::atomic< completion_mode > completion_ { completion_mode::post };
+
+    /// Shared with the ops it counts, which may outlive the channel
+    work_tracker< Mutex > *work_ = work_tracker< Mutex >::create();
+
+    overflow_counters counters_;
 
     /// A list of receivers waiting to receive a value
     basic_consumer_queue< ValueType, Mutex > consumers_;
@@ -79,27 +337,39 @@ struct alignas(std::max_align_t) channel_impl final
     /// A list of senders waiting to send a value
     basic_producer_queue< ValueType, Mutex > producers_;
 
+    /// Lock-free models only: the lengths of the wait queues as last
+    /// published under the mutex. While either is non-zero, the lock-free
+    /// paths on that side are disabled so that parked ops keep their order.
+    std::atomic< std::size_t > parked_consumers_ { 0 };
+    std::atomic< std::size_t > parked_producers_ { 0 };
+
     // current state of the implementation
 
     enum state_code
     {
         state_running,
         state_closed,
-    } state_ = state_running;
+    };
+
+    std::atomic< state_code > state_ { state_running };
 };
 
 //
 //
 //
 
-template < class ValueType, concepts::Lockable Mutex >
-channel_impl< ValueType, Mutex >::channel_impl(std::size_t capacity)
-: buffer_data_ { .capacity = capacity }
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+template < class... RingArgs >
+channel_impl< ValueType, Mutex, Concurrency >::channel_impl(
+    std::size_t capacity,
+    RingArgs &&...ring_args)
+: buffer_data_(capacity, std::forward< RingArgs >(ring_args)...)
 {
+    buffer().init();
 }
 
-template < class ValueType, concepts::Lockable Mutex >
-channel_impl< ValueType, Mutex >::~channel_impl()
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+channel_impl< ValueType, Mutex, Concurrency >::~channel_impl()
 {
     auto ring_buffer = buffer();
     switch (state_)
@@ -112,32 +382,45 @@ channel_impl< ValueType, Mutex >::~channel_impl()
         break;
     }
     ring_buffer.destroy();
+    if (storage_ != trailing_storage())
+        std::free(storage_);
+    work_->retire();
 }
 
-template < class ValueType, concepts::Lockable Mutex >
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
 void
-channel_impl< ValueType, Mutex >::close()
+channel_impl< ValueType, Mutex, Concurrency >::close()
 {
-    auto lock = std::unique_lock(mutex_);
+    // handlers deferred while the mutex is held are posted when the scope
+    // ends. close() is noexcept, so they are never invoked inline, where a
+    // handler which throws would terminate the program
+    auto scope = completion_scope(completion_mode::post);
+    auto lock  = std::unique_lock(mutex_);
     switch (state_)
     {
     case state_running:
         state_ = state_closed;
-        flush_closed(buffer(), consumers_, producers_);
+        flush();
         break;
     case state_closed:
         break;
     }
 }
 
-template < class ValueType, concepts::Lockable Mutex >
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
 void
-channel_impl< ValueType, Mutex >::submit_consume_op(
-    basic_consumer_ptr< ValueType, Mutex > consume_op)
+channel_impl< ValueType, Mutex, Concurrency >::flush()
 {
-    auto lck = std::lock_guard(mutex_);
-
-    consumers_.push(std::move(consume_op));
+    if constexpr (lock_free)
+    {
+        // Publish the waiters before examining the ring. Paired with the
+        // fences in the nolock functions, either the flush below sees a
+        // value that was concurrently pushed/popped, or the nolock side sees
+        // the waiter and comes back here to flush.
+        parked_consumers_.store(consumers_.size(), std::memory_order_relaxed);
+        parked_producers_.store(producers_.size(), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
 
     switch (state_)
     {
@@ -148,41 +431,259 @@ channel_impl< ValueType, Mutex >::submit_consume_op(
         flush_not_closed(buffer(), consumers_, producers_);
         break;
     }
+
+    if constexpr (lock_free)
+    {
+        parked_consumers_.store(consumers_.size(), std::memory_order_release);
+        parked_producers_.store(producers_.size(), std::memory_order_release);
+    }
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+void
+channel_impl< ValueType, Mutex, Concurrency >::submit_consume_op(
+    basic_consumer_ptr< ValueType, Mutex > consume_op)
+{
+    auto scope = completion_scope(completion());
+    {
+        auto lck = std::lock_guard(mutex_);
+        consumers_.push(std::move(consume_op));
+        flush();
+    }
+    grow_spill();
 }
 
-template < class ValueType, concepts::Lockable Mutex >
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
 void
-channel_impl< ValueType, Mutex >::submit_produce_op(
+channel_impl< ValueType, Mutex, Concurrency >::submit_produce_op(
     basic_producer_ptr< ValueType, Mutex > produce_op)
 {
+    auto scope = completion_scope(completion());
+
+    // an op which may be parked by the overflow policy, kept because the
+    // queue's reference may be dropped by the flush, and released after the
+    // mutex
+    basic_producer_ptr< ValueType, Mutex > parked;
+    {
+        auto lck = std::lock_guard(mutex_);
+        if constexpr (!lock_free)
+            if (overflow_ != overflow_policy::block) [[unlikely]]
+                parked = produce_op;
+        producers_.push(std::move(produce_op));
+        flush();
+        if constexpr (!lock_free)
+            if (parked) [[unlikely]]
+                overflow_parked(*parked);
+    }
+    grow_spill();
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+void
+channel_impl< ValueType, Mutex, Concurrency >::cancel_consume_op(
+    basic_consume_op_interface< ValueType, Mutex > &op)
+{
+    // the op is released after the mutex
+    basic_consumer_ptr< ValueType, Mutex > removed;
+
     auto lck = std::lock_guard(mutex_);
+    if (consumers_.linked(op))
+    {
+        removed = consumers_.erase(&op);
+        if constexpr (lock_free)
+            parked_consumers_.store(consumers_.size(),
+                                    std::memory_order_release);
+    }
+}
 
-    producers_.push(std::move(produce_op));
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+void
+channel_impl< ValueType, Mutex, Concurrency >::cancel_produce_op(
+    basic_produce_op_interface< ValueType, Mutex > &op)
+{
+    // the op is released after the mutex
+    basic_producer_ptr< ValueType, Mutex > removed;
 
+    auto lck = std::lock_guard(mutex_);
+    if (producers_.linked(op))
+    {
+        removed = producers_.erase(&op);
+        if constexpr (lock_free)
+            parked_producers_.store(producers_.size(),
+                                    std::memory_order_release);
+    }
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+bool
+channel_impl< ValueType, Mutex, Concurrency >::claim_consume_op(
+    basic_consume_op_interface< ValueType, Mutex > &op)
+{
+    // the op is released after the mutex
+    basic_consumer_ptr< ValueType, Mutex > removed;
+
+    auto lck = std::lock_guard(mutex_);
+    if (!op.state().claim())
+        return false;
+    if (consumers_.linked(op))
+    {
+        removed = consumers_.erase(&op);
+        if constexpr (lock_free)
+            parked_consumers_.store(consumers_.size(),
+                                    std::memory_order_release);
+    }
+    return true;
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+bool
+channel_impl< ValueType, Mutex, Concurrency >::claim_produce_op(
+    basic_produce_op_interface< ValueType, Mutex > &op)
+{
+    // the op is released after the mutex
+    basic_producer_ptr< ValueType, Mutex > removed;
+
+    auto lck = std::lock_guard(mutex_);
+    if (!op.state().claim())
+        return false;
+    if (producers_.linked(op))
+    {
+        removed = producers_.erase(&op);
+        if constexpr (lock_free)
+            parked_producers_.store(producers_.size(),
+                                    std::memory_order_release);
+    }
+    return true;
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+std::size_t
+channel_impl< ValueType, Mutex, Concurrency >::consumers_waiting()
+{
+    auto lck = std::lock_guard(mutex_);
+    return consumers_.size();
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+std::size_t
+channel_impl< ValueType, Mutex, Concurrency >::producers_waiting()
+{
+    auto lck = std::lock_guard(mutex_);
+    return producers_.size();
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+error_code
+channel_impl< ValueType, Mutex, Concurrency >::publish_reserved(
+    value_type *value) requires(!lock_free)
+{
+    auto scope = completion_scope(completion());
+    auto lck   = std::lock_guard(mutex_);
+    auto ring = buffer();
     switch (state_)
     {
-    case state_closed:
-        flush_closed(buffer(), consumers_, producers_);
-        break;
     case state_running:
-        flush_not_closed(buffer(), consumers_, producers_);
+        ring.publish();
+        apply_pending_resize();
+        flush();
         break;
+    case state_closed:
+        value->~value_type();
+        ring.unreserve();
+        apply_pending_resize();
+        return errors::channel_closed;
+    }
+    return error_code();
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+void
+channel_impl< ValueType, Mutex, Concurrency >::cancel_reserved() requires(
+    !lock_free)
+{
+    // called from the noexcept send_slot::reset(), so as with close() the
+    // handlers of ops admitted here are posted rather than invoked inline
+    auto scope = completion_scope(completion_mode::post);
+    auto lck   = std::lock_guard(mutex_);
+    buffer().unreserve();
+    apply_pending_resize();
+    flush();
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+void
+channel_impl< ValueType, Mutex, Concurrency >::resize(
+    std::size_t new_capacity) requires(!lock_free && bounded)
+{
+    auto scope = completion_scope(completion());
+    auto lck   = std::lock_guard(mutex_);
+    if (buffer().reserved())
+    {
+        // the reserved slot must stay where it is until it is settled
+        pending_capacity_ = new_capacity;
+        return;
+    }
+    pending_capacity_.reset();
+    relocate(new_capacity);
+    flush();
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+void
+channel_impl< ValueType, Mutex, Concurrency >::relocate(
+    std::size_t new_capacity) requires(!lock_free && bounded)
+{
+    auto ring  = buffer();
+    auto slots = std::max(new_capacity, ring.size());
+
+    slot_type *mem = nullptr;
+    if (slots)
+    {
+        mem = static_cast< slot_type * >(std::calloc(slots, sizeof(slot_type)));
+        if (!mem)
+            BOOST_THROW_EXCEPTION(std::bad_alloc());
     }
+
+    ring.relocate(mem, slots, new_capacity);
+    if (storage_ != trailing_storage())
+        std::free(storage_);
+    storage_ = mem;
 }
 
-template < class ValueType, concepts::Lockable Mutex >
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+void
+channel_impl< ValueType, Mutex, Concurrency >::apply_pending_resize() requires(
+    !lock_free && bounded)
+{
+    if (pending_capacity_) [[unlikely]]
+    {
+        relocate(*pending_capacity_);
+        pending_capacity_.reset();
+    }
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
 auto
-channel_impl< ValueType, Mutex >::consume_if(error_code &ec)
+channel_impl< ValueType, Mutex, Concurrency >::consume_if(error_code &ec)
     -> std::optional< value_type >
 {
-    auto lock = std::unique_lock(mutex_);
+    if constexpr (lock_free)
+    {
+        if (auto result = try_consume_nolock())
+            return result;
+    }
+
+    auto scope = completion_scope(completion());
+    auto lock  = std::unique_lock(mutex_);
 
     std::optional< value_type > result;
 
-    if (auto ring_buffer = buffer(); ring_buffer.size())
+    if (buffer().try_pop_with(
+            [&](value_type &&v) { result.emplace(std::move(v)); }))
     {
-        result.emplace(std::move(ring_buffer.front()));
-        ring_buffer.pop();
+        // the space may be taken by a waiting producer
+        if (!producers_.empty())
+            flush();
     }
     else
     {
@@ -192,12 +693,265 @@ channel_impl< ValueType, Mutex >::consume_if(error_code &ec)
             ec = errors::channel_closed;
             break;
         case state_running:
-            if (!producers_.empty())
+            take_from_producer(buffer(), producers_, result);
+            if constexpr (lock_free)
+                parked_producers_.store(producers_.size(),
+                                        std::memory_order_release);
+            break;
+        }
+    }
+
+    lock.unlock();
+    grow_spill();
+    return result;
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+bool
+channel_impl< ValueType, Mutex, Concurrency >::try_produce(value_type &value,
+                                                           error_code &ec)
+{
+    if constexpr (lock_free)
+    {
+        if (try_produce_nolock(value))
+            return true;
+    }
+
+    auto scope = completion_scope(completion());
+    auto lock  = std::unique_lock(mutex_);
+    switch (state_)
+    {
+    case state_closed:
+        ec = errors::channel_closed;
+        return false;
+    case state_running:
+        break;
+    }
+
+    if (!try_produce_not_closed(buffer(), consumers_, producers_, value))
+    {
+        lock.unlock();
+        grow_spill();
+        return false;
+    }
+
+    // a value pushed while consumers were parked is passed on to them, and
+    // the lock-free side learns how many remain parked
+    if (lock_free || !consumers_.empty())
+        flush();
+    lock.unlock();
+    grow_spill();
+    return true;
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+error_code
+channel_impl< ValueType, Mutex, Concurrency >::produce_or_overflow(
+    value_type &value) requires(!lock_free)
+{
+    auto scope = completion_scope(completion());
+    auto lock  = std::unique_lock(mutex_);
+    switch (state_)
+    {
+    case state_closed:
+        return errors::channel_closed;
+    case state_running:
+        break;
+    }
+    return offer_or_overflow(value);
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+template < class Iterator >
+error_code
+channel_impl< ValueType, Mutex, Concurrency >::produce_range_or_overflow(
+    Iterator       &first,
+    Iterator const &last,
+    std::size_t    &accepted) requires(!lock_free)
+{
+    accepted = 0;
+
+    auto scope = completion_scope(completion());
+    auto lock  = std::unique_lock(mutex_);
+    switch (state_)
+    {
+    case state_closed:
+        return errors::channel_closed;
+    case state_running:
+        break;
+    }
+
+    error_code result;
+    for (; first != last; ++first)
+    {
+        auto value = value_type(std::ranges::iter_move(first));
+        if (auto ec = offer_or_overflow(value))
+            result = ec;
+        else
+            ++accepted;
+    }
+    return result;
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+error_code
+channel_impl< ValueType, Mutex, Concurrency >::offer_or_overflow(
+    value_type &value) requires(!lock_free)
+{
+    if (try_produce_not_closed(buffer(), consumers_, producers_, value))
+    {
+        if (!consumers_.empty())
+            flush();
+        return error_code();
+    }
+
+    switch (overflow_)
+    {
+    case overflow_policy::block:
+        BOOST_ASSERT(!"produce_or_overflow called on a blocking channel");
+        [[fallthrough]];
+    case overflow_policy::reject:
+        ++counters_.rejected;
+        return errors::channel_full;
+    case overflow_policy::drop_oldest:
+    {
+        // a reserved slot holds the next value, so it must not be overtaken
+        auto ring = buffer();
+        if (!ring.reserved() && ring.try_pop_with([](value_type &&) {}))
+        {
+            ++counters_.dropped_oldest;
+            if (ring.try_push_with(
+                    [&]() -> value_type && { return std::move(value); }))
+                return error_code();
+        }
+        [[fallthrough]];
+    }
+    case overflow_policy::drop_newest:
+        ++counters_.dropped_newest;
+        return errors::value_dropped;
+    }
+    return error_code();
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+void
+channel_impl< ValueType, Mutex, Concurrency >::overflow_parked(
+    basic_produce_op_interface< ValueType, Mutex > &op) requires(!lock_free)
+{
+    while (producers_.linked(op) && !op.state().completed())
+    {
+        if (overflow_ == overflow_policy::drop_oldest)
+        {
+            // a reserved slot holds the next value, so it must not be
+            // overtaken
+            auto ring = buffer();
+            if (!ring.reserved() && ring.try_pop_with([](value_type &&) {}))
             {
-                result.emplace(producers_.front()->consume());
-                producers_.pop();
+                ++counters_.dropped_oldest;
+                flush();
+                continue;
             }
+        }
+
+        if (!op.state().claim())
             break;
+        if (overflow_ == overflow_policy::reject)
+        {
+            ++counters_.rejected;
+            op.fail(errors::channel_full);
+        }
+        else
+        {
+            ++counters_.dropped_newest;
+            op.fail(errors::value_dropped);
+        }
+        op.state().commit();
+        producers_.erase(&op);
+    }
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+overflow_counters
+channel_impl< ValueType, Mutex, Concurrency >::counters()
+{
+    auto lck = std::lock_guard(mutex_);
+    return counters_;
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+error_code
+channel_impl< ValueType, Mutex, Concurrency >::spill_error() requires spills
+{
+    auto lck = std::lock_guard(mutex_);
+    return buffer_data_.error;
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+void
+channel_impl< ValueType, Mutex, Concurrency >::grow_spill()
+{
+    if constexpr (spills)
+    {
+        // only the thread which asked for a segment needs to see the request
+        if (!buffer_data_.wanted.load(std::memory_order_relaxed))
+            return;
+
+        auto lck = std::unique_lock(mutex_);
+        while (buffer_data_.start_mapping())
+        {
+            lck.unlock();
+            error_code ec;
+            auto       segment = buffer_data_.map_segment(ec);
+            lck.lock();
+            if (!buffer_data_.finish_mapping(segment, ec))
+                break;
+            flush();
+        }
+    }
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+bool
+channel_impl< ValueType, Mutex, Concurrency >::try_produce_nolock(
+    value_type &value) requires lock_free
+{
+    if (state_.load(std::memory_order_acquire) != state_running ||
+        parked_producers_.load(std::memory_order_acquire))
+        return false;
+
+    if (!buffer().try_push(value))
+        return false;
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_consumers_.load(std::memory_order_relaxed)) [[unlikely]]
+    {
+        auto scope = completion_scope(completion());
+        auto lck   = std::lock_guard(mutex_);
+        flush();
+    }
+
+    return true;
+}
+
+template < class ValueType, concepts::Lockable Mutex, class Concurrency >
+auto
+channel_impl< ValueType, Mutex, Concurrency >::try_consume_nolock()
+    -> std::optional< value_type > requires lock_free
+{
+    std::optional< value_type > result;
+
+    if (parked_consumers_.load(std::memory_order_acquire))
+        return result;
+
+    result = buffer().try_pop();
+    if (result)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_producers_.load(std::memory_order_relaxed)) [[unlikely]]
+        {
+            auto scope = completion_scope(completion());
+            auto lck   = std::lock_guard(mutex_);
+            flush();
         }
     }
 
@@ -0,0 +1,258 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CHUNK_BUFFER_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CHUNK_BUFFER_HPP
+
+#include <boost/channels/config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief The link at the start of every chunk of a chunk buffer.
+struct chunk_link
+{
+    chunk_link *next = nullptr;
+};
+
+/// @brief Control block of the unbounded buffer used by
+/// concurrency::unbounded.
+///
+/// Values are stored in a singly linked list of fixed-size chunks. Values
+/// are pushed at tail in the tail chunk and popped from head in the head
+/// chunk. Chunks which have been emptied are kept on a short free list for
+/// reuse, and any beyond BOOST_CHANNELS_CHUNK_FREELIST are released, so the
+/// memory held follows the backlog.
+struct chunk_buffer_data
+{
+    /// @param capacity is ignored. The buffer has no bound.
+    explicit chunk_buffer_data(std::size_t) noexcept
+    {
+    }
+
+    static constexpr std::size_t capacity =
+        std::numeric_limits< std::size_t >::max();
+
+    /// The chunk holding the next value to be consumed.
+    chunk_link *head_chunk = nullptr;
+
+    /// The chunk into which the next value will be produced.
+    chunk_link *tail_chunk = nullptr;
+
+    /// Index of the next value to be consumed in head_chunk.
+    std::size_t head = 0;
+
+    /// Index of the next slot to be produced in tail_chunk.
+    std::size_t tail = 0;
+
+    /// The number of values in the buffer.
+    std::size_t size = 0;
+
+    /// Emptied chunks kept for reuse.
+    chunk_link *spare       = nullptr;
+    std::size_t spare_count = 0;
+};
+
+template < class ValueType >
+struct chunk_buffer_ref
+{
+    /// Channels using this buffer have no trailing storage. The slot type
+    /// only keeps the shape of the other rings.
+    using slot_type = std::aligned_storage_t< sizeof(ValueType),
+                                              alignof(ValueType) >;
+
+    /// The number of values held by each chunk.
+    static constexpr std::size_t chunk_values = std::max< std::size_t >(
+        1,
+        (BOOST_CHANNELS_CHUNK_SIZE - sizeof(chunk_link)) / sizeof(ValueType));
+
+    struct alignas(std::max< std::size_t >(BOOST_CHANNELS_CACHELINE_SIZE,
+                                           alignof(ValueType))) chunk
+    : chunk_link
+    {
+        slot_type slots[chunk_values];
+    };
+
+    chunk_buffer_data *pdata;
+    slot_type         *storage;
+
+    std::size_t
+    size() const
+    {
+        return pdata->size;
+    }
+
+    std::size_t
+    capacity() const
+    {
+        return pdata->capacity;
+    }
+
+    bool
+    empty() const
+    {
+        return pdata->size == 0;
+    }
+
+    void
+    init()
+    {
+    }
+
+    /// @brief The buffer never reserves slots.
+    bool
+    reserved() const
+    {
+        return false;
+    }
+
+    void *
+    try_reserve()
+    {
+        return nullptr;
+    }
+
+    /// @brief Construct a value at the back of the buffer from make().
+    ///
+    /// A chunk is taken from the free list, or allocated, before make is
+    /// called, so if allocation throws no value has been taken from make.
+    /// @return true
+    template < class F >
+    bool
+    try_push_with(F &&make)
+    {
+        if (pdata->tail_chunk && pdata->tail != chunk_values)
+        {
+            new (slot(pdata->tail_chunk, pdata->tail)) ValueType(make());
+            ++pdata->tail;
+        }
+        else
+        {
+            auto c = acquire_chunk();
+            try
+            {
+                new (slot(c, 0)) ValueType(make());
+            }
+            catch (...)
+            {
+                recycle_chunk(c);
+                throw;
+            }
+            if (pdata->tail_chunk)
+                pdata->tail_chunk->next = c;
+            else
+                pdata->head_chunk = c;
+            pdata->tail_chunk = c;
+            pdata->tail       = 1;
+        }
+        ++pdata->size;
+        return true;
+    }
+
+    /// @brief Pass the value at the front of the buffer to sink as an rvalue
+    /// and pop it, if there is one.
+    /// @return false if the buffer was empty, in which case sink is not called.
+    template < class F >
+    bool
+    try_pop_with(F &&sink)
+    {
+        if (empty())
+            return false;
+        auto p = slot(pdata->head_chunk, pdata->head);
+        sink(std::move(*p));
+        p->~ValueType();
+        pop_slot();
+        return true;
+    }
+
+    void
+    destroy()
+    {
+        while (!empty())
+        {
+            slot(pdata->head_chunk, pdata->head)->~ValueType();
+            pop_slot();
+        }
+        if (auto c = std::exchange(pdata->head_chunk, nullptr))
+            delete static_cast< chunk * >(c);
+        pdata->tail_chunk = nullptr;
+        while (auto c = pdata->spare)
+        {
+            pdata->spare = c->next;
+            delete static_cast< chunk * >(c);
+        }
+        pdata->spare_count = 0;
+    }
+
+  private:
+    static ValueType *
+    slot(chunk_link *c, std::size_t i)
+    {
+        auto slots = static_cast< chunk * >(c)->slots;
+        return reinterpret_cast< ValueType * >(slots + i);
+    }
+
+    /// @brief Advance head past the value just destroyed.
+    ///
+    /// When the buffer empties, its last chunk is reused from the start.
+    /// Otherwise an exhausted head chunk is recycled.
+    void
+    pop_slot()
+    {
+        ++pdata->head;
+        if (--pdata->size == 0)
+        {
+            pdata->head = 0;
+            pdata->tail = 0;
+        }
+        else if (pdata->head == chunk_values)
+        {
+            auto c            = pdata->head_chunk;
+            pdata->head_chunk = c->next;
+            pdata->head       = 0;
+            recycle_chunk(c);
+        }
+    }
+
+    chunk_link *
+    acquire_chunk()
+    {
+        if (auto c = pdata->spare)
+        {
+            pdata->spare = c->next;
+            --pdata->spare_count;
+            c->next = nullptr;
+            return c;
+        }
+        return new chunk;
+    }
+
+    void
+    recycle_chunk(chunk_link *c) noexcept
+    {
+        if (pdata->spare_count == BOOST_CHANNELS_CHUNK_FREELIST)
+        {
+            delete static_cast< chunk * >(c);
+            return;
+        }
+        c->next      = pdata->spare;
+        pdata->spare = c;
+        ++pdata->spare_count;
+    }
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CHUNK_BUFFER_HPP
@@ -0,0 +1,387 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_COMPLETION_SCOPE_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_COMPLETION_SCOPE_HPP
+
+#include <boost/channels/completion_mode.hpp>
+#include <boost/channels/config.hpp>
+#include <boost/channels/scope_exit.hpp>
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+
+#include <array>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace boost::channels::detail {
+
+/// @brief The number of completion handlers the calling thread is running
+/// inline, one within another.
+inline std::size_t &
+inline_depth() noexcept
+{
+    static thread_local std::size_t depth = 0;
+    return depth;
+}
+
+/// @brief Invoke f as if by dispatch(exec, f) while the calling thread's
+/// inline budget lasts, and otherwise as if by post(exec, f).
+template < class Executor, class Function >
+void
+dispatch_or_post(Executor const &exec, Function &&f)
+{
+    auto &depth = inline_depth();
+    if (depth < BOOST_CHANNELS_INLINE_DEPTH)
+    {
+        ++depth;
+        auto restore = scope_exit([&depth]() noexcept { --depth; });
+        asio::dispatch(exec, std::forward< Function >(f));
+    }
+    else
+        asio::post(exec, std::forward< Function >(f));
+}
+
+/// @brief How a deferred op is to complete its handler.
+enum class fire_mode
+{
+    /// as if by post(exec, handler)
+    post,
+    /// as if by dispatch_or_post(exec, handler)
+    dispatch,
+    /// by calling the handler, from a function already running on exec
+    invoke,
+    /// by destroying the handler uninvoked, when its executor has been shut
+    /// down
+    discard
+};
+
+/// @brief Defers the completions made while a channel's mutex is held until
+/// the mutex has been released.
+///
+/// A channel declares a scope before taking its mutex, so that the scope ends
+/// after the mutex is unlocked, and ops which complete within it defer()
+/// themselves rather than completing their handlers. When the scope ends, the
+/// deferred ops are fired in the order they completed.
+///
+/// Under completion_mode::dispatch each op dispatches its handler while the
+/// thread's inline budget lasts. Under completion_mode::post the ops are
+/// grouped by executor, and each group of more than one is posted to its
+/// executor as one function which invokes their handlers in the order they
+/// completed. Closing a channel with a thousand waiters on one executor then
+/// costs one post rather than a thousand, however their ops interleave with
+/// those of other executors.
+///
+/// Executors can only be compared for equality, so grouping compares each op
+/// with the groups open so far. At most max_groups are open at once; a new
+/// executor beyond that posts the oldest group first. Groups on one executor
+/// are posted in the order they were opened, so each executor still sees its
+/// handlers in the order they completed, and the cost of grouping stays
+/// linear in the number of ops. Once max_groups groups have been posted with
+/// a single op, the ops are taken to be spread over too many executors to
+/// gather, and the rest are grouped only with neighbours on the same
+/// executor.
+///
+/// Deferred ops are kept in a vector owned by the thread, which is reused by
+/// every scope, so deferring allocates nothing once the vector has grown.
+struct completion_scope
+{
+    /// @brief The function which completes a deferred op.
+    /// @param self is the op, which holds a reference to itself
+    /// @param mode is how the handler is to be completed
+    using fire_fn = void (*)(void *self, fire_mode mode);
+
+    explicit completion_scope(completion_mode mode) noexcept
+    : prev_(current_ref())
+    , begin_(pending().size())
+    , exceptions_(std::uncaught_exceptions())
+    , mode_(mode)
+    {
+        current_ref() = this;
+    }
+
+    completion_scope(completion_scope const &) = delete;
+
+    completion_scope &
+    operator=(completion_scope const &) = delete;
+
+    /// @brief Fire the ops deferred to this scope. If a handler invoked inline
+    /// throws, the remaining ops are posted and the exception propagates.
+    ~completion_scope() noexcept(false)
+    {
+        current_ref() = prev_;
+        auto &q = pending();
+
+        // scopes opened by handlers run here add to, and then trim back to,
+        // the end of the vector, so entries are copied out before firing
+        auto end     = q.size();
+        auto release = scope_exit([&]() noexcept { q.resize(begin_); });
+        if (mode_ == completion_mode::post ||
+            std::uncaught_exceptions() != exceptions_)
+        {
+            post_runs(begin_, end);
+            return;
+        }
+
+        auto i = begin_;
+        try
+        {
+            for (; i < end; ++i)
+            {
+                auto e = q[i];
+                e.fire(e.self, fire_mode::dispatch);
+            }
+        }
+        catch (...)
+        {
+            post_runs(i + 1, end);
+            throw;
+        }
+    }
+
+    /// @brief The scope to which ops completing on this thread defer, if any.
+    static completion_scope *
+    current() noexcept
+    {
+        return current_ref();
+    }
+
+    /// @brief Call fire(self, mode) once the scope ends.
+    /// @param exec is the executor of the op's handler, which must remain
+    /// valid until the op is fired
+    template < class Executor >
+    void
+    defer(void *self, fire_fn fire, Executor const &exec)
+    {
+        pending().push_back(
+            { self, fire, std::addressof(exec), &executor_ops_for< Executor > });
+    }
+
+  private:
+    struct batch;
+
+    struct executor_ops
+    {
+        bool (*equal)(void const *a, void const *b);
+        void (*post)(void const *exec, batch &&b);
+    };
+
+    struct entry
+    {
+        void               *self;
+        fire_fn             fire;
+        void const         *exec;
+        executor_ops const *ops;
+    };
+
+    /// A run of ops deferred to one executor, invoked in order by a single
+    /// function posted to it
+    struct batch
+    {
+        explicit batch(std::vector< entry > entries) noexcept
+        : entries_(std::move(entries))
+        {
+        }
+
+        batch(batch &&other) noexcept
+        : entries_(std::move(other.entries_))
+        , next_(std::exchange(other.next_, 0))
+        {
+            other.entries_.clear();
+        }
+
+        batch &
+        operator=(batch &&) = delete;
+
+        ~batch()
+        {
+            for (; next_ < entries_.size(); ++next_)
+                entries_[next_].fire(entries_[next_].self, fire_mode::discard);
+            if (entries_.capacity() > spare().capacity())
+            {
+                entries_.clear();
+                spare() = std::move(entries_);
+            }
+        }
+
+        void
+        operator()()
+        {
+            while (next_ < entries_.size())
+            {
+                auto e = entries_[next_++];
+                try
+                {
+                    e.fire(e.self, fire_mode::invoke);
+                }
+                catch (...)
+                {
+                    for (; next_ < entries_.size(); ++next_)
+                        entries_[next_].fire(entries_[next_].self,
+                                             fire_mode::post);
+                    throw;
+                }
+            }
+        }
+
+      private:
+        std::vector< entry > entries_;
+        std::size_t          next_ = 0;
+    };
+
+    /// The most executors whose groups are gathered at once
+    static constexpr std::size_t max_groups = 64;
+
+    /// The ops deferred to one executor, chained through links() from head
+    /// to tail
+    struct group
+    {
+        std::size_t head;
+        std::size_t tail;
+        std::size_t size;
+    };
+
+    template < class Executor >
+    static constexpr executor_ops executor_ops_for = {
+        [](void const *a, void const *b) -> bool {
+            return *static_cast< Executor const * >(a) ==
+                   *static_cast< Executor const * >(b);
+        },
+        [](void const *exec, batch &&b) {
+            asio::post(*static_cast< Executor const * >(exec), std::move(b));
+        }
+    };
+
+    /// Fire the entries in [first, last), one post per group of entries on
+    /// the same executor.
+    static void
+    post_runs(std::size_t first, std::size_t last)
+    {
+        auto &q    = pending();
+        auto &link = links();
+        link.resize(q.size());
+
+        std::array< group, max_groups > open;
+        std::size_t                     n      = 0;
+        std::size_t                     wasted = 0;
+
+        auto i = first;
+        for (; i != last && wasted != max_groups; ++i)
+        {
+            auto const &e = q[i];
+            auto        g = std::size_t(0);
+            while (g != n && !(q[open[g].head].ops == e.ops &&
+                               e.ops->equal(q[open[g].head].exec, e.exec)))
+                ++g;
+
+            if (g != n)
+            {
+                link[open[g].tail] = i;
+                open[g].tail       = i;
+                ++open[g].size;
+                continue;
+            }
+
+            if (n == max_groups)
+            {
+                if (open[0].size == 1)
+                    ++wasted;
+                post_group(open[0]);
+                std::move(open.begin() + 1, open.end(), open.begin());
+                --n;
+            }
+            open[n++] = group { i, i, 1 };
+        }
+
+        for (std::size_t g = 0; g != n; ++g)
+            post_group(open[g]);
+
+        // groups which keep being posted alone mean the ops are spread over
+        // more executors than can be gathered, so the rest are only grouped
+        // with their neighbours
+        while (i != last)
+        {
+            auto const &e   = q[i];
+            auto        end = i + 1;
+            while (end != last && q[end].ops == e.ops &&
+                   e.ops->equal(e.exec, q[end].exec))
+            {
+                link[end - 1] = end;
+                ++end;
+            }
+            post_group(group { i, end - 1, end - i });
+            i = end;
+        }
+    }
+
+    static void
+    post_group(group const &g)
+    {
+        auto &q = pending();
+        auto  e = q[g.head];
+        if (g.size == 1)
+            return e.fire(e.self, fire_mode::post);
+
+        auto &link    = links();
+        auto  entries = std::move(spare());
+        entries.clear();
+        entries.reserve(g.size);
+        for (auto i = g.head;; i = link[i])
+        {
+            entries.push_back(q[i]);
+            if (i == g.tail)
+                break;
+        }
+        e.ops->post(e.exec, batch(std::move(entries)));
+    }
+
+    static completion_scope *&
+    current_ref() noexcept
+    {
+        static thread_local completion_scope *current = nullptr;
+        return current;
+    }
+
+    static std::vector< entry > &
+    pending() noexcept
+    {
+        static thread_local std::vector< entry > q;
+        return q;
+    }
+
+    /// The next entry of the same group, by index into pending()
+    static std::vector< std::size_t > &
+    links() noexcept
+    {
+        static thread_local std::vector< std::size_t > link;
+        return link;
+    }
+
+    /// A batch's vector, kept by the thread which ran the batch for the next
+    /// one, so that batching allocates nothing once the vector has grown
+    static std::vector< entry > &
+    spare() noexcept
+    {
+        static thread_local std::vector< entry > entries;
+        return entries;
+    }
+
+    completion_scope *prev_;
+    std::size_t       begin_;
+    int               exceptions_;
+    completion_mode   mode_;
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_COMPLETION_SCOPE_HPP
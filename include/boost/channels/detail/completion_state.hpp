@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_COMPLETION_STATE_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_COMPLETION_STATE_HPP
+
+#include <boost/channels/config.hpp>
+
+#include <atomic>
+#include <functional>
+
+namespace boost::channels::detail {
+
+/// @brief The completion state of an op, or of a set of ops only one of which
+/// may complete, such as the branches of a select.
+///
+/// A channel which wants to complete an op first claims its state, moving it
+/// from waiting to busy. It then either commits (busy to done) once the op
+/// has been completed, or releases the claim (busy to waiting) if it turns
+/// out that the op cannot be completed after all. Claims are only ever held
+/// for the duration of a transfer, so a thread which finds a state busy
+/// simply waits for it to settle.
+struct completion_state
+{
+    /// @brief Claim the right to complete the op.
+    ///
+    /// Waits while another thread holds a claim.
+    /// @return true if the claim was taken, false if the op has already
+    /// completed.
+    bool
+    claim() noexcept
+    {
+        for (;;)
+        {
+            auto expected = waiting;
+            if (word_.compare_exchange_weak(expected,
+                                            busy,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+                return true;
+            if (expected == done)
+                return false;
+            BOOST_CHANNELS_BUSY_WAIT();
+        }
+    }
+
+    /// @brief Mark a claimed op as completed.
+    /// @pre claimed() == true
+    void
+    commit() noexcept
+    {
+        BOOST_CHANNELS_ASSERT(claimed());
+        word_.store(done, std::memory_order_release);
+    }
+
+    /// @brief Give up a claim without completing the op.
+    /// @pre claimed() == true
+    void
+    release() noexcept
+    {
+        BOOST_CHANNELS_ASSERT(claimed());
+        word_.store(waiting, std::memory_order_release);
+    }
+
+    bool
+    claimed() const noexcept
+    {
+        return word_.load(std::memory_order_relaxed) == busy;
+    }
+
+    bool
+    completed() const noexcept
+    {
+        return word_.load(std::memory_order_acquire) == done;
+    }
+
+  private:
+    enum state_code : unsigned char
+    {
+        waiting,
+        busy,
+        done
+    };
+
+    std::atomic< state_code > word_ { waiting };
+};
+
+/// @brief The outcome of claim_pair
+enum class claim_pair_result
+{
+    /// both states are now claimed
+    claimed,
+
+    /// the first state had already completed. No claim is held.
+    first_completed,
+
+    /// the second state had already completed. No claim is held.
+    second_completed,
+
+    /// both arguments refer to the same state, which is now claimed.
+    same_state
+};
+
+/// @brief Claim two states, for instance those of a consumer and a producer
+/// which are to be matched with each other.
+///
+/// States are always claimed in address order, so two threads which are
+/// claiming overlapping pairs can never wait on each other in a cycle.
+inline claim_pair_result
+claim_pair(completion_state &first, completion_state &second) noexcept
+{
+    if (&first == &second)
+        return first.claim() ? claim_pair_result::same_state
+                             : claim_pair_result::first_completed;
+
+    auto swapped = std::less<>()(&second, &first);
+    auto &lo     = swapped ? second : first;
+    auto &hi     = swapped ? first : second;
+
+    auto const lo_completed = swapped ? claim_pair_result::second_completed
+                                      : claim_pair_result::first_completed;
+    auto const hi_completed = swapped ? claim_pair_result::first_completed
+                                      : claim_pair_result::second_completed;
+
+    if (!lo.claim())
+        return lo_completed;
+    if (!hi.claim())
+    {
+        lo.release();
+        return hi_completed;
+    }
+    return claim_pair_result::claimed;
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_COMPLETION_STATE_HPP
@@ -0,0 +1,113 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CONCURRENCY_TRAITS_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CONCURRENCY_TRAITS_HPP
+
+#include <boost/channels/concurrency.hpp>
+#include <boost/channels/detail/chunk_buffer.hpp>
+#include <boost/channels/detail/mpmc_ring.hpp>
+#include <boost/channels/detail/spill_buffer.hpp>
+#include <boost/channels/detail/spsc_ring.hpp>
+#include <boost/channels/detail/value_buffer.hpp>
+
+namespace boost::channels::detail {
+
+/// @brief Maps a concurrency model onto the ring buffer implementation used
+/// by channel_impl.
+/// @tparam Concurrency one of the tag types in boost::channels::concurrency
+template < class Concurrency >
+struct concurrency_traits;
+
+template <>
+struct concurrency_traits< concurrency::locked >
+{
+    using ring_data = value_buffer_data;
+
+    template < class ValueType >
+    using ring_ref = value_buffer_ref< ValueType >;
+
+    /// true if the ring may be accessed without holding the channel mutex
+    static constexpr bool lock_free = false;
+
+    /// true if the ring's slots are allocated with the channel
+    static constexpr bool bounded = true;
+
+    /// true if a send normally finds space, so it first tries to complete
+    /// without allocating an op
+    static constexpr bool eager_send = false;
+
+    /// true if the buffer spills into segments, which the channel maps
+    /// outside its mutex
+    static constexpr bool spills = false;
+};
+
+template <>
+struct concurrency_traits< concurrency::spsc >
+{
+    using ring_data = spsc_ring_data;
+
+    template < class ValueType >
+    using ring_ref = spsc_ring_ref< ValueType >;
+
+    static constexpr bool lock_free  = true;
+    static constexpr bool bounded    = true;
+    static constexpr bool eager_send = false;
+    static constexpr bool spills     = false;
+};
+
+template <>
+struct concurrency_traits< concurrency::mpmc >
+{
+    using ring_data = mpmc_ring_data;
+
+    template < class ValueType >
+    using ring_ref = mpmc_ring_ref< ValueType >;
+
+    static constexpr bool lock_free  = true;
+    static constexpr bool bounded    = true;
+    static constexpr bool eager_send = false;
+    static constexpr bool spills     = false;
+};
+
+template <>
+struct concurrency_traits< concurrency::unbounded >
+{
+    using ring_data = chunk_buffer_data;
+
+    template < class ValueType >
+    using ring_ref = chunk_buffer_ref< ValueType >;
+
+    static constexpr bool lock_free  = false;
+    static constexpr bool bounded    = false;
+    static constexpr bool eager_send = true;
+    static constexpr bool spills     = false;
+};
+
+#ifdef BOOST_CHANNELS_HAS_SPILL
+
+template <>
+struct concurrency_traits< concurrency::spill >
+{
+    using ring_data = spill_buffer_data;
+
+    template < class ValueType >
+    using ring_ref = spill_buffer_ref< ValueType >;
+
+    static constexpr bool lock_free  = false;
+    static constexpr bool bounded    = true;
+    static constexpr bool eager_send = true;
+    static constexpr bool spills     = true;
+};
+
+#endif
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CONCURRENCY_TRAITS_HPP
@@ -13,29 +13,165 @@
 #include <boost/channels/detail/io_op_interface_base.hpp>
 #include <boost/channels/error_code.hpp>
 
+#include <tuple>
+
 namespace boost::channels::detail {
 template < class ValueType, concepts::Lockable Mutex = std::mutex >
 struct basic_consume_op_interface : basic_io_op_interface_base< Mutex >
 {
+    using base_type  = basic_io_op_interface_base< Mutex >;
+    using mutex_type = typename base_type::mutex_type;
     using value_type = std::tuple< error_code, ValueType >;
 
-    virtual ~basic_consume_op_interface() = default;
+    struct vtable_type : base_type::vtable_type
+    {
+        void (*commit)(basic_consume_op_interface &, value_type &&);
+        bool (*more)(basic_consume_op_interface const &);
+        bool (*partial)(basic_consume_op_interface const &);
+        void (*finish)(basic_consume_op_interface &);
+        void (*visit)(basic_consume_op_interface &, ValueType &);
+    };
 
     /// @brief Commit a value to a prepared consumer.
-    /// @pre completed() == false
-    /// @post completed() == true
+    /// @pre state().claimed() == true
+    /// @post the caller commits or releases state()
     /// @param source An r-value reference to the object that will be committed.
-    virtual void
-    commit(value_type &&source) = 0;
+    void
+    commit(value_type &&source)
+    {
+        vtable().commit(*this, std::move(source));
+    }
+
+    /// @brief Test whether the op would take another value after the one
+    /// just committed.
+    ///
+    /// Most ops take a single value. An op which takes a batch stays at the
+    /// front of the queue while it has room, and the caller releases its
+    /// state rather than committing it.
+    bool
+    more() const
+    {
+        return vtable().more && vtable().more(*this);
+    }
+
+    /// @brief Test whether a batch op holds values but has room for more.
+    ///
+    /// Such an op is finished once no further values are available, rather
+    /// than left waiting for the rest of its batch.
+    bool
+    partial() const
+    {
+        return vtable().partial && vtable().partial(*this);
+    }
+
+    /// @brief Complete a partial batch op with the values it holds.
+    /// @pre partial() == true
+    /// @pre state().claimed() == true
+    void
+    finish()
+    {
+        BOOST_CHANNELS_ASSERT(vtable().finish);
+        vtable().finish(*this);
+    }
+
+    /// @brief Test whether the op takes values in place.
+    ///
+    /// Such an op is given a reference to each value where it lies, through
+    /// visit(), rather than having the value moved into commit(). Errors are
+    /// still delivered through commit().
+    bool
+    in_place() const
+    {
+        return vtable().visit != nullptr;
+    }
+
+    /// @brief Give the op a value without moving it from its storage.
+    ///
+    /// The storage is released once visit() returns.
+    /// @pre in_place() == true
+    /// @pre state().claimed() == true
+    void
+    visit(ValueType &v)
+    {
+        BOOST_CHANNELS_ASSERT(in_place());
+        vtable().visit(*this, v);
+    }
+
+  protected:
+    /// @brief Bind the op's function table to the most derived type.
+    /// @param self is the most derived op. Only its type is used.
+    /// @param shared is the completion state shared with other ops, if any.
+    template < class Op >
+    explicit basic_consume_op_interface(Op *self, completion_state *shared = nullptr)
+    : base_type(&vtable_for< Op >, shared)
+    {
+        static_assert(
+            !std::is_same_v< decltype(&Op::commit),
+                             decltype(&basic_consume_op_interface::commit) >,
+            "Op must implement commit()");
+        (void)self;
+    }
+
+  private:
+    // only ops which take a batch provide more(), partial() and finish()
+    template < class Op >
+    static constexpr bool is_batch_op =
+        !std::is_same_v< decltype(&Op::more),
+                         decltype(&basic_consume_op_interface::more) >;
+
+    // only ops which take values in place provide visit()
+    template < class Op >
+    static constexpr bool is_in_place_op =
+        !std::is_same_v< decltype(&Op::visit),
+                         decltype(&basic_consume_op_interface::visit) >;
+
+    template < class Op >
+    static constexpr vtable_type
+    make_vtable_for()
+    {
+        vtable_type vt {};
+        static_cast< typename base_type::vtable_type & >(vt) =
+            base_type::template make_vtable< Op >();
+        vt.commit = [](basic_consume_op_interface &self, value_type &&source) {
+            static_cast< Op & >(self).commit(std::move(source));
+        };
+        if constexpr (is_batch_op< Op >)
+        {
+            vt.more = [](basic_consume_op_interface const &self) {
+                return static_cast< Op const & >(self).more();
+            };
+            vt.partial = [](basic_consume_op_interface const &self) {
+                return static_cast< Op const & >(self).partial();
+            };
+            vt.finish = [](basic_consume_op_interface &self) {
+                static_cast< Op & >(self).finish();
+            };
+        }
+        if constexpr (is_in_place_op< Op >)
+            vt.visit = [](basic_consume_op_interface &self, ValueType &v) {
+                static_cast< Op & >(self).visit(v);
+            };
+        return vt;
+    }
+
+    template < class Op >
+    static constexpr vtable_type vtable_for = make_vtable_for< Op >();
+
+    vtable_type const &
+    vtable() const
+    {
+        return static_cast< vtable_type const & >(*this->vtable_);
+    }
 };
 
-template < class ValueType , concepts::Lockable Mutex>
-using basic_consumer_ptr = std::shared_ptr< basic_consume_op_interface< ValueType, Mutex > >;
+template < class ValueType, concepts::Lockable Mutex >
+using basic_consumer_ptr =
+    boost::intrusive_ptr< basic_consume_op_interface< ValueType, Mutex > >;
 
-template<class ValueType>
-using consume_op_interface = basic_consume_op_interface<ValueType>;
+template < class ValueType >
+using consume_op_interface = basic_consume_op_interface< ValueType >;
 
 template < class ValueType >
-using consumer_ptr = std::shared_ptr< consume_op_interface< ValueType > >;
+using consumer_ptr = boost::intrusive_ptr< consume_op_interface< ValueType > >;
 }   // namespace boost::channels::detail
 #endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CONSUME_OP_INTERFACE_HPP
@@ -11,76 +11,141 @@
 #define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_CONSUMER_OP_FUNCTION_HPP
 
 #include <boost/channels/config.hpp>
+#include <boost/channels/detail/allocate_op.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
 #include <boost/channels/detail/consume_op_interface.hpp>
+#include <boost/channels/detail/postit.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/post.hpp>
+
+#include <optional>
+#include <type_traits>
+#include <utility>
 
 namespace boost::channels::detail {
-/// @brief A consumer op specialisation which calls a function when done
+/// @brief A consumer op which posts a completion handler when done
+///
+/// The handler and its executor live in the op, which is the only allocation
+/// made by the channel for an async_consume. The op is allocated with the
+/// handler's associated allocator. On completion the handler and the value are
+/// moved directly into the function posted to the handler's executor. Within
+/// a completion_scope the value is held in the op until the scope ends.
+///
+/// The op keeps its executor's context running either through a share of its
+/// channel's work_tracker, given up once the handler is posted, or through an
+/// executor which tracks outstanding work itself.
 /// @tparam ValueType
 /// @tparam Mutex
-/// @tparam CompletionFunction A function object with signature void(error_code,
+/// @tparam Executor is the executor on which the handler will be invoked
+/// @tparam Handler A function object with signature void(error_code,
 /// ValueType)
 ///
-template < class ValueType, concepts::Lockable Mutex, class CompletionFunction >
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Executor,
+           class Handler >
 struct consumer_op_function final
 : detail::basic_consume_op_interface< ValueType, Mutex >
 {
-    using value_type =
-        typename detail::basic_consume_op_interface< ValueType,
-                                                     Mutex >::value_type;
-
-    using mutex_type =
-        typename detail::basic_consume_op_interface< ValueType,
-                                                     Mutex >::mutex_type;
+    using interface_type =
+        detail::basic_consume_op_interface< ValueType, Mutex >;
+    using value_type     = typename interface_type::value_type;
+    using mutex_type     = typename interface_type::mutex_type;
+    using allocator_type = asio::associated_allocator_t< Handler >;
 
-    template <
-        class CompletionArg,
-        std::enable_if_t< !std::is_base_of_v< consumer_op_function,
-                                              std::decay_t< CompletionArg > > >
-            * = nullptr >
-    consumer_op_function(CompletionArg &&completion)
-    : completion_(std::forward< CompletionArg >(completion))
+    template < class HandlerArg >
+    consumer_op_function(Executor              exec,
+                         HandlerArg          &&handler,
+                         counted_work< Mutex > work = {})
+    : interface_type(this)
+    , exec_(std::move(exec))
+    , handler_(std::forward< HandlerArg >(handler))
+    , work_(std::move(work))
+    , alloc_(asio::get_associated_allocator(handler_))
     {
     }
 
-    virtual bool
-    completed() const override
+    void
+    commit(value_type &&val)
     {
-        return completed_;
-    };
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        if (auto scope = completion_scope::current())
+        {
+            result_.emplace(std::move(val));
+            intrusive_ptr_add_ref(this);
+            scope->defer(this, &fire, exec_);
+        }
+        else
+            complete(std::move(val), fire_mode::post);
+    }
 
-    virtual mutex_type &
-    get_mutex() override
+    static void
+    destroy(consumer_op_function *self) noexcept
     {
-        return mutex_;
+        auto alloc = self->alloc_;
+        deallocate_op(alloc, self);
     }
 
-    virtual void
-    commit(value_type &&val) override
+  private:
+    static void
+    fire(void *p, fire_mode mode)
     {
-        BOOST_CHANNELS_ASSERT(!completed_);
+        auto self = boost::intrusive_ptr< consumer_op_function >(
+            static_cast< consumer_op_function * >(p), false);
+        if (mode != fire_mode::discard)
+            self->complete(std::move(*self->result_), mode);
+    }
 
-        auto completion = std::move(completion_);
+    void
+    complete(value_type &&val, fire_mode mode)
+    {
+        auto &[ec, value] = val;
+        // the op may outlive its completion in a cancellation slot, so the
+        // executor's outstanding work leaves with the handler, and the op's
+        // share of its tracker's work once the handler has been posted or run
+        auto work = std::move(work_);
+        auto exec = std::move(exec_);
+        auto f =
+            handler_bound_to_args(std::move(handler_), ec, std::move(value));
+        if (mode == fire_mode::invoke)
+            f();
+        else if (mode == fire_mode::dispatch)
+            dispatch_or_post(exec, std::move(f));
+        else
+            asio::post(exec, std::move(f));
+    }
 
-        // destroy here
-        completed_ = true;
+    Executor              exec_;
+    Handler               handler_;
+    counted_work< Mutex > work_;
 
-        std::apply(completion, std::move(val));
-    }
+    /// The value committed within a completion_scope
+    std::optional< value_type > result_;
 
-    CompletionFunction completion_;
-    Mutex              mutex_;
-    bool               completed_ = false;
+    [[no_unique_address]] allocator_type alloc_;
 };
 
-template < class ValueType, concepts::Lockable Mutex, class CompletionFunction >
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Executor,
+           class Handler >
 auto
-make_consumer_op_function(CompletionFunction &&completion)
+make_consumer_op_function(Executor            &&exec,
+                          Handler             &&handler,
+                          counted_work< Mutex > work = {})
 {
     using type = consumer_op_function< ValueType,
                                        Mutex,
-                                       std::decay_t< CompletionFunction > >;
-    return std::make_shared< type >(
-        std::forward< CompletionFunction >(completion));
+                                       std::decay_t< Executor >,
+                                       std::decay_t< Handler > >;
+    auto alloc = asio::get_associated_allocator(handler);
+    return boost::intrusive_ptr< type >(
+        allocate_op< type >(alloc,
+                            std::forward< Executor >(exec),
+                            std::forward< Handler >(handler),
+                            std::move(work)));
 }
 
 }   // namespace boost::channels::detail
@@ -7,12 +7,14 @@
 // Official repository: https://github.com/madmongo1/boost_channels
 //
 
+#include <boost/channels/detail/completion_state.hpp>
 #include <boost/channels/detail/consume_op_interface.hpp>
+#include <boost/channels/detail/op_queue.hpp>
 #include <boost/channels/detail/produce_op_interface.hpp>
 #include <boost/channels/detail/value_buffer.hpp>
 
-#include <deque>
-#include <queue>
+#include <optional>
+#include <tuple>
 
 #ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_IMPLEMENT_CHANNEL_QUEUE_HPP
 #define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_IMPLEMENT_CHANNEL_QUEUE_HPP
@@ -20,17 +22,119 @@
 namespace boost::channels::detail {
 template < class ValueType, concepts::Lockable Mutex = std::mutex >
 using basic_producer_queue =
-    std::queue< basic_producer_ptr< ValueType, Mutex >,
-                std::deque< basic_producer_ptr< ValueType, Mutex > > >;
+    basic_op_queue< basic_produce_op_interface< ValueType, Mutex > >;
 
 template < class ValueType, concepts::Lockable Mutex = std::mutex >
 using basic_consumer_queue =
-    std::queue< basic_consumer_ptr< ValueType, Mutex >,
-                std::deque< basic_consumer_ptr< ValueType, Mutex > > >;
+    basic_op_queue< basic_consume_op_interface< ValueType, Mutex > >;
 
+/// @brief Settle a claimed producer after a value has been taken from it.
+///
+/// A producer with more values to give stays where it is in the queue, ready
+/// to be claimed again. Otherwise it is complete.
 template < class ValueType, concepts::Lockable Mutex >
 void
-flush_closed(value_buffer_ref< ValueType >             values,
+settle_producer(basic_producer_queue< ValueType, Mutex >       &producers,
+                basic_produce_op_interface< ValueType, Mutex > &producer)
+{
+    if (producer.more())
+        producer.state().release();
+    else
+    {
+        producer.state().commit();
+        producers.erase(&producer);
+    }
+}
+
+/// @brief Settle the claimed producer at the front of the queue after a
+/// value has been taken from it.
+template < class ValueType, concepts::Lockable Mutex >
+void
+settle_front_producer(basic_producer_queue< ValueType, Mutex > &producers)
+{
+    settle_producer(producers, *producers.front());
+}
+
+/// @brief Settle a claimed consumer after a value has been committed to it.
+///
+/// A consumer with room for more values stays where it is in the queue,
+/// ready to be claimed again. Otherwise it is complete.
+template < class ValueType, concepts::Lockable Mutex >
+void
+settle_consumer(basic_consumer_queue< ValueType, Mutex >       &consumers,
+                basic_consume_op_interface< ValueType, Mutex > &consumer)
+{
+    if (consumer.more())
+        consumer.state().release();
+    else
+    {
+        consumer.state().commit();
+        consumers.erase(&consumer);
+    }
+}
+
+/// @brief Settle the claimed consumer at the front of the queue after a
+/// value has been committed to it.
+template < class ValueType, concepts::Lockable Mutex >
+void
+settle_front_consumer(basic_consumer_queue< ValueType, Mutex > &consumers)
+{
+    settle_consumer(consumers, *consumers.front());
+}
+
+/// @brief Complete the consumer at the front of the queue if it has taken
+/// part of a batch.
+///
+/// Called once no further values are available, so that the consumer is not
+/// left waiting for the rest of its batch.
+template < class ValueType, concepts::Lockable Mutex >
+void
+finish_partial_consumer(basic_consumer_queue< ValueType, Mutex > &consumers)
+{
+    if (consumers.size() && consumers.front()->partial())
+    {
+        auto &consumer = *consumers.front();
+        if (consumer.state().claim())
+        {
+            consumer.finish();
+            consumer.state().commit();
+        }
+        consumers.pop();
+    }
+}
+
+/// @brief Give a value taken from the ring buffer to a claimed consumer.
+///
+/// A consumer which takes values in place sees the value in its slot.
+template < class ValueType, concepts::Lockable Mutex >
+void
+deliver_value(basic_consume_op_interface< ValueType, Mutex > &consumer,
+              ValueType                                      &v)
+{
+    if (consumer.in_place())
+        consumer.visit(v);
+    else
+        consumer.commit(std::make_tuple(error_code(), std::move(v)));
+}
+
+/// @brief Pass a value from a claimed producer directly to a claimed
+/// consumer.
+///
+/// A consumer which takes values in place sees the value in the producer.
+template < class ValueType, concepts::Lockable Mutex >
+void
+transfer_value(basic_consume_op_interface< ValueType, Mutex > &consumer,
+               basic_produce_op_interface< ValueType, Mutex > &producer)
+{
+    if (consumer.in_place())
+        producer.lend_to([&](ValueType &v) { consumer.visit(v); });
+    else
+        consumer.commit(std::make_tuple(error_code(), producer.consume()));
+}
+
+template < class Ring, class ValueType, concepts::Lockable Mutex >
+void
+flush_closed(Ring                                      values,
              basic_consumer_queue< ValueType, Mutex > &consumers_pending,
              basic_producer_queue< ValueType, Mutex > &producers_pending)
 {
@@ -40,10 +144,12 @@ flush_closed(value_buffer_ref< ValueType >             values,
     //
     while (!producers_pending.empty())
     {
-        auto lck = channels::detail::lock(*producers_pending.front());
-        if (!producers_pending.front()->completed())
-            producers_pending.front()->fail(channels::errors::channel_closed);
-        lck.unlock();
+        auto &producer = *producers_pending.front();
+        if (producer.state().claim())
+        {
+            producer.fail(channels::errors::channel_closed);
+            producer.state().commit();
+        }
         producers_pending.pop();
     }
 
@@ -54,118 +160,262 @@ flush_closed(value_buffer_ref< ValueType >             values,
     while (!consumers_pending.empty())
     {
         auto &consumer = *consumers_pending.front();
-        auto  lck      = channels::detail::lock(consumer);
-        if (!consumer.completed())
+        if (consumer.state().claim())
         {
-            if (values.empty())
+            auto taken = false;
+            while (values.try_pop_with(
+                [&](ValueType &&v) { deliver_value(consumer, v); }))
             {
+                taken = true;
+                if (!consumer.more())
+                    break;
+            }
+
+            if (!taken)
                 consumer.commit(std::make_tuple(
                     error_code(channels::errors::channel_closed), ValueType()));
-            }
-            else
-            {
-                consumer.commit(
-                    std::make_tuple(error_code(), std::move(values.front())));
-                values.pop();
-            }
+            else if (consumer.more())
+                consumer.finish();
+            consumer.state().commit();
         }
-        lck.unlock();
         consumers_pending.pop();
     }
 }
 
+/// @brief Directly match the front consumer with a later producer, or a
+/// later consumer with the front producer.
+///
+/// Used when the front consumer and the front producer are branches of one
+/// select, which may not be matched against itself. The select keeps its
+/// place at the front of both queues, and the oldest other party which can
+/// be matched with it is found instead. Ops found to have completed are
+/// unlinked on the way.
+/// @pre The ring buffer is empty and no slot is reserved.
+/// @return true if either queue changed, so that matching may continue.
 template < class ValueType, concepts::Lockable Mutex >
+bool
+match_past_select(basic_consumer_queue< ValueType, Mutex > &consumers,
+                  basic_producer_queue< ValueType, Mutex > &producers)
+{
+    auto &consumer = *consumers.front();
+    for (auto p = producers.next(producers.front()); p;)
+    {
+        // a producer which claims a slot has no value to give
+        if (p->claims_slot())
+            break;
+        auto next = producers.next(p);
+        switch (claim_pair(consumer.state(), p->state()))
+        {
+        case claim_pair_result::claimed:
+            transfer_value(consumer, *p);
+            settle_front_consumer(consumers);
+            settle_producer(producers, *p);
+            return true;
+        case claim_pair_result::first_completed:
+            consumers.pop();
+            return true;
+        case claim_pair_result::second_completed:
+            producers.erase(p);
+            break;
+        case claim_pair_result::same_state:
+            consumer.state().release();
+            break;
+        }
+        p = next;
+    }
+
+    auto &producer = *producers.front();
+    for (auto c = consumers.next(consumers.front()); c;)
+    {
+        auto next = consumers.next(c);
+        switch (claim_pair(c->state(), producer.state()))
+        {
+        case claim_pair_result::claimed:
+            transfer_value(*c, producer);
+            settle_consumer(consumers, *c);
+            settle_front_producer(producers);
+            return true;
+        case claim_pair_result::first_completed:
+            consumers.erase(c);
+            break;
+        case claim_pair_result::second_completed:
+            producers.pop();
+            return true;
+        case claim_pair_result::same_state:
+            c->state().release();
+            break;
+        }
+        c = next;
+    }
+
+    return false;
+}
+
+/// @brief Match waiting producers and consumers against the ring buffer and
+/// against each other.
+///
+/// The ring is only accessed through its try_ functions, so that this
+/// algorithm remains correct for rings which are concurrently accessed by
+/// lock-free producers and consumers.
+template < class Ring, class ValueType, concepts::Lockable Mutex >
 void
-flush_not_closed(value_buffer_ref< ValueType >             values,
+flush_not_closed(Ring                                      values,
                  basic_consumer_queue< ValueType, Mutex > &consumers_pending,
                  basic_producer_queue< ValueType, Mutex > &producers_pending)
 {
     for (;;)
     {
         // try to consume into ring buffer
-        if (values.size() < values.capacity() && producers_pending.size())
+        if (producers_pending.size() && values.size() < values.capacity())
         {
             auto &producer = *producers_pending.front();
-            auto  lck      = lock(producer);
-            if (!producer.completed())
-                values.push(producer.consume());
-            lck.unlock();
-            producers_pending.pop();
-            continue;
+            auto &state    = producer.state();
+            if (!state.claim())
+            {
+                producers_pending.pop();
+                continue;
+            }
+            if (producer.claims_slot())
+            {
+                if (auto slot = values.try_reserve())
+                {
+                    producer.grant(slot);
+                    state.commit();
+                    producers_pending.pop();
+                    continue;
+                }
+            }
+            else if (values.try_push_with([&] { return producer.consume(); }))
+            {
+                settle_front_producer(producers_pending);
+                continue;
+            }
+            state.release();
         }
 
         // try to transfer from ring buffer to consumers
-        if (values.size() && consumers_pending.size())
+        if (consumers_pending.size() && values.size())
         {
             auto &consumer = *consumers_pending.front();
-            auto  lck      = lock(consumer);
-            if (!consumer.completed())
+            auto &state    = consumer.state();
+            if (!state.claim())
+            {
+                consumers_pending.pop();
+                continue;
+            }
+            if (values.try_pop_with(
+                    [&](ValueType &&v) { deliver_value(consumer, v); }))
             {
-                consumer.commit(std::make_tuple(channels::error_code(),
-                                                std::move(values.front())));
-                values.pop();
+                settle_front_consumer(consumers_pending);
+                continue;
             }
-            lck.unlock();
-            consumers_pending.pop();
-            continue;
+            state.release();
         }
 
         // if the ring buffer is empty and there is a matched consumer and
-        // producer, perform a direct transfer
-        while (values.empty() && consumers_pending.size() &&
-               producers_pending.size())
+        // producer, perform a direct transfer. A reserved slot holds the next
+        // value, so nothing may overtake it, and a producer which claims a
+        // slot only ever waits for space.
+        auto matchable = true;
+        while (matchable && values.empty() && !values.reserved() &&
+               consumers_pending.size() && producers_pending.size())
         {
             auto &consumer = *consumers_pending.front();
             auto &producer = *producers_pending.front();
-            auto  locks    = channels::detail::lock(consumer, producer);
-            auto  pc       = producer.completed();
-            auto  cc       = consumer.completed();
-            if (!pc && !cc)
+            if (producer.claims_slot())
+                break;
+            switch (claim_pair(consumer.state(), producer.state()))
             {
-                consumer.commit(std::make_tuple(channels::error_code(),
-                                                producer.consume()));
-                pc = cc = true;
-            }
-            locks.unlock();
-            if (cc)
+            case claim_pair_result::claimed:
+                transfer_value(consumer, producer);
+                settle_front_consumer(consumers_pending);
+                settle_front_producer(producers_pending);
+                break;
+            case claim_pair_result::first_completed:
                 consumers_pending.pop();
-            if (pc)
+                break;
+            case claim_pair_result::second_completed:
                 producers_pending.pop();
-            BOOST_CHANNELS_ASSERT(pc || cc);
+                break;
+            case claim_pair_result::same_state:
+                // a select may not be matched against itself. Match
+                // another party past it, leaving both branches in place.
+                consumer.state().release();
+                matchable = match_past_select(consumers_pending,
+                                              producers_pending);
+                break;
+            }
         }
 
         break;
     }
+
+    finish_partial_consumer(consumers_pending);
 }
 
-template < class ValueType, concepts::Lockable Mutex >
-void
-process_producer(basic_producer_ptr< ValueType, Mutex >    producer_op,
-                 value_buffer_ref< ValueType >             values,
-                 basic_consumer_queue< ValueType, Mutex > &consumers_pending,
-                 basic_producer_queue< ValueType, Mutex > &producers_pending,
-                 bool                                      closed)
+/// @brief Offer a value to a running channel without waiting.
+///
+/// The value is handed directly to the first waiting consumer, or pushed
+/// into the ring buffer if no consumer is waiting, under the same ordering
+/// rules as flush_not_closed. It is refused if producers are already
+/// waiting, so that it does not overtake them.
+/// @return true if the value was taken, otherwise value is untouched.
+template < class Ring, class ValueType, concepts::Lockable Mutex >
+bool
+try_produce_not_closed(Ring                                      values,
+                       basic_consumer_queue< ValueType, Mutex > &consumers,
+                       basic_producer_queue< ValueType, Mutex > &producers,
+                       ValueType                                &value)
 {
-    producers_pending.push(std::move(producer_op));
-    if (closed) [[unlikely]]
-        flush_closed(values, consumers_pending, producers_pending);
-    else
-        flush_not_closed(values, consumers_pending, producers_pending);
+    if (!producers.empty() || values.reserved())
+        return false;
+
+    while (values.empty() && !consumers.empty())
+    {
+        auto &consumer = *consumers.front();
+        if (!consumer.state().claim())
+        {
+            consumers.pop();
+            continue;
+        }
+        deliver_value(consumer, value);
+        settle_front_consumer(consumers);
+        finish_partial_consumer(consumers);
+        return true;
+    }
+
+    return values.try_push_with([&]() -> ValueType && {
+        return std::move(value);
+    });
 }
 
-template < class ValueType, concepts::Lockable Mutex >
-void
-process_consumer(basic_consumer_ptr< ValueType, Mutex >    consumer_op,
-                 value_buffer_ref< ValueType >             values,
-                 basic_consumer_queue< ValueType, Mutex > &consumers_pending,
-                 basic_producer_queue< ValueType, Mutex > &producers_pending,
-                 bool                                      closed)
+/// @brief Take a value directly from the first waiting producer which can
+/// give one.
+///
+/// Used when the ring buffer is empty. A reserved slot holds the next value,
+/// and a producer which claims a slot has no value to give, so neither may
+/// be overtaken.
+/// @return true if result was assigned a value.
+template < class Ring, class ValueType, concepts::Lockable Mutex >
+bool
+take_from_producer(Ring                                      values,
+                   basic_producer_queue< ValueType, Mutex > &producers,
+                   std::optional< ValueType >                &result)
 {
-    consumers_pending.push(std::move(consumer_op));
-    if (closed) [[unlikely]]
-        flush_closed(values, consumers_pending, producers_pending);
-    else
-        flush_not_closed(values, consumers_pending, producers_pending);
+    while (!producers.empty() && !values.reserved())
+    {
+        auto &producer = *producers.front();
+        if (producer.claims_slot())
+            break;
+        if (producer.state().claim())
+        {
+            result.emplace(producer.consume());
+            settle_front_producer(producers);
+            return true;
+        }
+        producers.pop();
+    }
+    return false;
 }
 
 template < class ValueType >
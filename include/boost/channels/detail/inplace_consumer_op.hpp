@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_INPLACE_CONSUMER_OP_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_INPLACE_CONSUMER_OP_HPP
+
+#include <boost/channels/config.hpp>
+#include <boost/channels/detail/allocate_op.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
+#include <boost/channels/detail/consume_op_interface.hpp>
+#include <boost/channels/detail/postit.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/post.hpp>
+
+#include <type_traits>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief A consumer op which visits a value where it lies
+///
+/// The visitor is invoked with a reference to the value in the ring buffer
+/// slot or in the sending op, while the channel's mutex is held. The slot or
+/// sender is released when the visitor returns. The handler is then completed
+/// with the outcome. Within a completion_scope the handler stays in the op
+/// until the scope ends.
+///
+/// The op keeps its executor's context running as consumer_op_function does.
+/// @tparam ValueType
+/// @tparam Visitor A function object with signature void(ValueType &)
+/// @tparam Mutex
+/// @tparam Executor is the executor on which the handler will be invoked
+/// @tparam Handler A function object with signature void(error_code)
+///
+template < class ValueType,
+           class Visitor,
+           concepts::Lockable Mutex,
+           class Executor,
+           class Handler >
+struct inplace_consumer_op final
+: detail::basic_consume_op_interface< ValueType, Mutex >
+{
+    using interface_type = detail::basic_consume_op_interface< ValueType, Mutex >;
+    using value_type     = typename interface_type::value_type;
+    using allocator_type = asio::associated_allocator_t< Handler >;
+
+    template < class VisitorArg, class HandlerArg >
+    inplace_consumer_op(VisitorArg          &&visitor,
+                        Executor              exec,
+                        HandlerArg          &&handler,
+                        counted_work< Mutex > work = {})
+    : interface_type(this)
+    , visitor_(std::forward< VisitorArg >(visitor))
+    , exec_(std::move(exec))
+    , handler_(std::forward< HandlerArg >(handler))
+    , work_(std::move(work))
+    , alloc_(asio::get_associated_allocator(handler_))
+    {
+    }
+
+    void
+    visit(ValueType &v)
+    {
+        visitor_(v);
+        complete(error_code());
+    }
+
+    /// @brief Values are only ever visited, so this delivers an error.
+    void
+    commit(value_type &&val)
+    {
+        BOOST_CHANNELS_ASSERT(std::get< 0 >(val));
+        complete(std::get< 0 >(val));
+    }
+
+    static void
+    destroy(inplace_consumer_op *self) noexcept
+    {
+        auto alloc = self->alloc_;
+        deallocate_op(alloc, self);
+    }
+
+  private:
+    void
+    complete(error_code ec)
+    {
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        if (auto scope = completion_scope::current())
+        {
+            result_ = ec;
+            intrusive_ptr_add_ref(this);
+            scope->defer(this, &fire, exec_);
+        }
+        else
+            invoke(ec, fire_mode::post);
+    }
+
+    static void
+    fire(void *p, fire_mode mode)
+    {
+        auto self = boost::intrusive_ptr< inplace_consumer_op >(
+            static_cast< inplace_consumer_op * >(p), false);
+        if (mode != fire_mode::discard)
+            self->invoke(self->result_, mode);
+    }
+
+    void
+    invoke(error_code ec, fire_mode mode)
+    {
+        auto work = std::move(work_);
+        auto exec = std::move(exec_);
+        auto f    = handler_bound_to_args(std::move(handler_), ec);
+        if (mode == fire_mode::invoke)
+            f();
+        else if (mode == fire_mode::dispatch)
+            dispatch_or_post(exec, std::move(f));
+        else
+            asio::post(exec, std::move(f));
+    }
+
+    Visitor               visitor_;
+    Executor              exec_;
+    Handler               handler_;
+    counted_work< Mutex > work_;
+
+    /// The error completed with within a completion_scope
+    error_code result_;
+
+    [[no_unique_address]] allocator_type alloc_;
+};
+
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Visitor,
+           class Executor,
+           class Handler >
+auto
+make_inplace_consumer_op(Visitor            &&visitor,
+                         Executor           &&exec,
+                         Handler            &&handler,
+                         counted_work< Mutex > work = {})
+{
+    using type = inplace_consumer_op< ValueType,
+                                      std::decay_t< Visitor >,
+                                      Mutex,
+                                      std::decay_t< Executor >,
+                                      std::decay_t< Handler > >;
+    auto alloc = asio::get_associated_allocator(handler);
+    return boost::intrusive_ptr< type >(
+        allocate_op< type >(alloc,
+                            std::forward< Visitor >(visitor),
+                            std::forward< Executor >(exec),
+                            std::forward< Handler >(handler),
+                            std::move(work)));
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_INPLACE_CONSUMER_OP_HPP
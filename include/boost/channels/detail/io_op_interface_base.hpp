@@ -10,44 +10,126 @@
 #ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_IO_OP_INTERFACE_BASE_HPP
 #define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_IO_OP_INTERFACE_BASE_HPP
 
-#include "lock.hpp"
+#include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/detail/completion_state.hpp>
 
-#include <boost/channels/detail/lock.hpp>
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
 
 namespace boost::channels::detail {
 
 template < concepts::Lockable Mutex = std::mutex >
 struct basic_io_op_interface_base;
 
+template < class Op >
+struct basic_op_queue;
+
+/// @brief The common base of all producer and consumer ops.
+///
+/// Ops are not polymorphic in the C++ sense. Each op carries a pointer to a
+/// static table of function pointers which is built from the most derived
+/// type's non-virtual member functions, and a reference count which is
+/// managed through boost::intrusive_ptr. An op therefore costs a single
+/// allocation and each call through the interface is a single indirect call.
+///
+/// Whether an op may still be completed is decided by its completion_state.
+/// An op normally uses its own, but the branches of a select share the state
+/// of the select.
+/// @tparam Mutex is the mutex type of the channel the op is submitted to. It
+/// forms part of the op's type only; ops do not lock it.
 template < concepts::Lockable Mutex >
 struct basic_io_op_interface_base
 {
+    using mutex_type = Mutex;
+
+    /// @brief The function table common to all ops. Derived interfaces extend
+    /// it with their own entries.
+    struct vtable_type
+    {
+        void (*destroy)(basic_io_op_interface_base *) noexcept;
+    };
+
+    /// @brief The state which must be claimed before completing the op.
+    completion_state &
+    state() const
+    {
+        return *pstate_;
+    }
+
     /// @brief Test whether the op has already been completed
     /// @return true if the op has already been completed, otherwise false
-    virtual bool
-    completed() const = 0;
+    bool
+    completed() const
+    {
+        return pstate_->completed();
+    }
 
-    using mutex_type = Mutex;
+    friend void
+    intrusive_ptr_add_ref(basic_io_op_interface_base *op) noexcept
+    {
+        op->refs_.fetch_add(1, std::memory_order_relaxed);
+    }
 
-    virtual mutex_type &
-    get_mutex() = 0;
+    friend void
+    intrusive_ptr_release(basic_io_op_interface_base *op) noexcept
+    {
+        if (op->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            op->vtable_->destroy(op);
+    }
 
-};
+  protected:
+    /// @param vtable is the function table of the most derived type.
+    /// @param shared is the completion state shared with other ops, if any.
+    basic_io_op_interface_base(vtable_type const *vtable,
+                               completion_state  *shared)
+    : vtable_(vtable)
+    , pstate_(shared ? shared : &own_state_)
+    {
+    }
 
-template < concepts::Lockable Mutex >
-basic_dual_lock< Mutex >
-lock(basic_io_op_interface_base< Mutex > &consumer,
-     basic_io_op_interface_base< Mutex > &producer)
-{
-    return basic_dual_lock< Mutex >(consumer.get_mutex(), producer.get_mutex());
-}
+    basic_io_op_interface_base(basic_io_op_interface_base const &) = delete;
 
-template < concepts::Lockable Mutex >
-std::unique_lock< Mutex >
-lock(basic_io_op_interface_base< Mutex > &c_or_p)
-{
-    return std::unique_lock< Mutex >(c_or_p.get_mutex());
-}
+    basic_io_op_interface_base &
+    operator=(basic_io_op_interface_base const &) = delete;
+
+    ~basic_io_op_interface_base() = default;
+
+    /// @brief Build the common part of the function table for Op.
+    ///
+    /// If Op provides a static destroy(Op*) it is used to release the op's
+    /// memory, otherwise the op is deleted.
+    template < class Op >
+    static constexpr vtable_type
+    make_vtable()
+    {
+        return vtable_type { .destroy =
+                                 [](basic_io_op_interface_base *self) noexcept {
+                                     auto op = static_cast< Op * >(self);
+                                     if constexpr (requires { Op::destroy(op); })
+                                         Op::destroy(op);
+                                     else
+                                         delete op;
+                                 } };
+    }
+
+    vtable_type const *vtable_;
+
+  private:
+    template < class Op >
+    friend struct basic_op_queue;
+
+    std::atomic< std::size_t > refs_ { 0 };
+    completion_state           own_state_;
+    completion_state          *pstate_;
+
+    // links used while the op is parked in a channel's basic_op_queue
+    basic_io_op_interface_base *next_   = nullptr;
+    basic_io_op_interface_base *prev_   = nullptr;
+    bool                        linked_ = false;
+};
 
 using io_op_interface_base = basic_io_op_interface_base<>;
 
@@ -0,0 +1,231 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_MPMC_RING_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_MPMC_RING_HPP
+
+#include <boost/channels/config.hpp>
+#include <boost/channels/detail/ring_index.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief Control block of a bounded multi producer, multi consumer ring.
+///
+/// This is Dmitry Vyukov's bounded queue. Each slot carries a sequence number
+/// which tells producers and consumers whether the slot is ready for them at a
+/// given position. Sequence numbers are kept at twice the scale of positions
+/// so that a capacity of 1 is not ambiguous:
+/// - 2 * pos      : slot is empty and may be written at position pos
+/// - 2 * pos + 1  : slot has been written at position pos and may be read
+struct mpmc_ring_data : ring_index
+{
+    explicit mpmc_ring_data(std::size_t capacity) noexcept
+    : ring_index(capacity)
+    {
+    }
+
+    char pad0_[BOOST_CHANNELS_CACHELINE_SIZE];
+
+    /// Next position to be claimed by a producer.
+    std::atomic< std::size_t > enqueue_pos { 0 };
+
+    char pad1_[BOOST_CHANNELS_CACHELINE_SIZE];
+
+    /// Next position to be claimed by a consumer.
+    std::atomic< std::size_t > dequeue_pos { 0 };
+
+    char pad2_[BOOST_CHANNELS_CACHELINE_SIZE];
+};
+
+template < class ValueType >
+struct mpmc_ring_slot
+{
+    std::atomic< std::size_t >                                   sequence;
+    std::aligned_storage_t< sizeof(ValueType), alignof(ValueType) > value;
+
+    ValueType *
+    get()
+    {
+        return reinterpret_cast< ValueType * >(&value);
+    }
+};
+
+/// @brief A view of an mpmc_ring_data and its slots.
+///
+/// All try_ functions are safe to call concurrently from any number of
+/// threads. The remaining functions model value_buffer_ref for the benefit of
+/// code which only needs an approximate answer.
+/// @note Values are constructed and moved while a slot is claimed. ValueType's
+/// move constructor must not throw.
+template < class ValueType >
+struct mpmc_ring_ref
+{
+    using slot_type = mpmc_ring_slot< ValueType >;
+
+    mpmc_ring_data *pdata;
+    slot_type      *storage;
+
+    slot_type &
+    slot(std::size_t pos) const
+    {
+        BOOST_CHANNELS_ASSERT(storage);
+        // sequence numbers are derived from positions, so this ring needs
+        // positions which always count up and cannot use ring_index's
+        // wrapping scheme for other capacities
+        if (pdata->power_of_two)
+            return storage[pos & pdata->mask];
+        return storage[pos % pdata->capacity];
+    }
+
+    /// @brief Prepare the slots of a newly allocated ring.
+    void
+    init()
+    {
+        for (std::size_t i = 0; i < pdata->capacity; ++i)
+            new (&storage[i].sequence) std::atomic< std::size_t >(2 * i);
+    }
+
+    /// @return The number of values in the ring. Only exact in quiescence.
+    std::size_t
+    size() const
+    {
+        auto d = pdata->dequeue_pos.load(std::memory_order_acquire);
+        auto e = pdata->enqueue_pos.load(std::memory_order_acquire);
+        auto n = e - d;
+        return n > pdata->capacity ? pdata->capacity : n;
+    }
+
+    std::size_t
+    capacity() const
+    {
+        return pdata->capacity;
+    }
+
+    bool
+    empty() const
+    {
+        return size() == 0;
+    }
+
+    /// @brief Slots are never reserved in a lock-free ring, because values
+    /// are pushed without the channel's mutex.
+    bool
+    reserved() const
+    {
+        return false;
+    }
+
+    void *
+    try_reserve()
+    {
+        return nullptr;
+    }
+
+    /// @brief Claim a slot, construct a value in it from make() and publish
+    /// it.
+    /// @return false if the ring was full, in which case make is not called.
+    template < class F >
+    bool
+    try_push_with(F &&make)
+    {
+        if (pdata->capacity == 0)
+            return false;
+
+        auto pos = pdata->enqueue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto &s    = slot(pos);
+            auto  seq  = s.sequence.load(std::memory_order_acquire);
+            auto  diff = static_cast< std::ptrdiff_t >(seq - 2 * pos);
+            if (diff == 0)
+            {
+                if (pdata->enqueue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed))
+                {
+                    new (s.get()) ValueType(make());
+                    s.sequence.store(2 * pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = pdata->enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Claim the value at the head of the ring, pass it to sink as an
+    /// rvalue and release the slot.
+    /// @return false if the ring was empty, in which case sink is not called.
+    template < class F >
+    bool
+    try_pop_with(F &&sink)
+    {
+        if (pdata->capacity == 0)
+            return false;
+
+        auto pos = pdata->dequeue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto &s    = slot(pos);
+            auto  seq  = s.sequence.load(std::memory_order_acquire);
+            auto  diff = static_cast< std::ptrdiff_t >(seq - (2 * pos + 1));
+            if (diff == 0)
+            {
+                if (pdata->dequeue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed))
+                {
+                    auto p = s.get();
+                    sink(std::move(*p));
+                    p->~ValueType();
+                    s.sequence.store(2 * (pos + pdata->capacity),
+                                     std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = pdata->dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool
+    try_push(ValueType &v)
+    {
+        return try_push_with([&]() -> ValueType && { return std::move(v); });
+    }
+
+    std::optional< ValueType >
+    try_pop()
+    {
+        std::optional< ValueType > result;
+        try_pop_with([&](ValueType &&v) { result.emplace(std::move(v)); });
+        return result;
+    }
+
+    void
+    destroy()
+    {
+        if (storage)
+            while (try_pop_with([](ValueType &&) {}))
+                ;
+    }
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_MPMC_RING_HPP
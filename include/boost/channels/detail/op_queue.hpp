@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_OP_QUEUE_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_OP_QUEUE_HPP
+
+#include <boost/channels/config.hpp>
+
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+
+#include <cstddef>
+
+namespace boost::channels::detail {
+
+/// @brief An intrusive FIFO of parked operations.
+///
+/// The links live in the op itself (@see basic_io_op_interface_base), so
+/// push, pop and erase are O(1) and never allocate. While an op is linked,
+/// the queue owns one reference to it, which is adopted from the pointer
+/// passed to push and handed back by pop, so no reference count is touched.
+/// @tparam Op is the interface type held in the queue. It must derive from
+/// basic_io_op_interface_base.
+template < class Op >
+struct basic_op_queue
+{
+    using pointer = boost::intrusive_ptr< Op >;
+
+    basic_op_queue() = default;
+
+    basic_op_queue(basic_op_queue const &) = delete;
+
+    basic_op_queue &
+    operator=(basic_op_queue const &) = delete;
+
+    ~basic_op_queue()
+    {
+        while (!empty())
+            pop();
+    }
+
+    bool
+    empty() const
+    {
+        return head_ == nullptr;
+    }
+
+    std::size_t
+    size() const
+    {
+        return size_;
+    }
+
+    Op *
+    front() const
+    {
+        BOOST_CHANNELS_ASSERT(head_);
+        return head_;
+    }
+
+    /// @brief The op after op in the queue, or nullptr if op is the last.
+    /// @pre op is linked into this queue.
+    Op *
+    next(Op const *op) const
+    {
+        BOOST_CHANNELS_ASSERT(op && linked(*op));
+        return static_cast< Op * >(op->next_);
+    }
+
+    /// @brief Test whether an op is linked into a queue.
+    static bool
+    linked(Op const &op)
+    {
+        return op.linked_;
+    }
+
+    /// @brief Test whether an op is linked into this queue rather than
+    /// another. Walks back from the op to the front of its queue.
+    bool
+    holds(Op const &op) const
+    {
+        if (!linked(op))
+            return false;
+        auto p = static_cast< Op const * >(&op);
+        while (p->prev_)
+            p = static_cast< Op const * >(p->prev_);
+        return p == head_;
+    }
+
+    void
+    push(pointer op)
+    {
+        auto p = op.get();
+        BOOST_CHANNELS_ASSERT(p && !linked(*p));
+        p->prev_ = tail_;
+        p->next_ = nullptr;
+        if (tail_)
+            tail_->next_ = p;
+        else
+            head_ = p;
+        tail_      = p;
+        p->linked_ = true;
+        op.detach();
+        ++size_;
+    }
+
+    /// @brief Unlink the op at the front of the queue.
+    /// @return the queue's reference to the op.
+    pointer
+    pop()
+    {
+        return erase(front());
+    }
+
+    /// @brief Unlink an op from anywhere in the queue.
+    /// @pre op is linked into this queue.
+    /// @return the queue's reference to the op.
+    pointer
+    erase(Op *op)
+    {
+        BOOST_CHANNELS_ASSERT(op && linked(*op));
+        auto prev = static_cast< Op * >(op->prev_);
+        auto next = static_cast< Op * >(op->next_);
+        if (prev)
+            prev->next_ = next;
+        else
+            head_ = next;
+        if (next)
+            next->prev_ = prev;
+        else
+            tail_ = prev;
+        op->prev_   = nullptr;
+        op->next_   = nullptr;
+        op->linked_ = false;
+        --size_;
+        return pointer(op, false);
+    }
+
+  private:
+    Op         *head_ = nullptr;
+    Op         *tail_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_OP_QUEUE_HPP
@@ -10,6 +10,10 @@
 #ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_POSTIT_HPP
 #define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_POSTIT_HPP
 
+#include <boost/channels/completion_mode.hpp>
+#include <boost/channels/detail/cancellation.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
+
 #include <boost/asio/post.hpp>
 
 #include <tuple>
@@ -33,6 +37,8 @@ struct handler_bound_to_args
     void
     operator()()
     {
+        // an op's canceller must not keep the op alive after completion
+        clear_cancellation_slot(handler_);
         std::apply(handler_, std::move(args_));
     }
 
@@ -60,13 +66,20 @@ handler_bound_to_args(Handler &&, Args &&...)
 
 //
 
+/// @brief Completes a handler with the arguments it is called with, as if by
+/// post(handler), or under completion_mode::dispatch as if by
+/// dispatch(handler) while the thread's inline budget lasts.
+/// @pre No channel mutex is held when a dispatching postit is called.
 template < class Executor, class Handler >
 struct postit
 {
     template < class ExecutorArg, class HandlerArg >
-    postit(ExecutorArg &&e, HandlerArg &&h)
+    postit(ExecutorArg    &&e,
+           HandlerArg     &&h,
+           completion_mode mode = completion_mode::post)
     : exec_(std::forward< ExecutorArg >(e))
     , handler_(std::forward< HandlerArg >(h))
+    , mode_(mode)
     {
     }
 
@@ -74,13 +87,17 @@ struct postit
     void
     operator()(Args &&...args)
     {
-        asio::post(exec_,
-                   handler_bound_to_args(std::move(handler_),
-                                         std::forward< Args >(args)...));
+        auto f = handler_bound_to_args(std::move(handler_),
+                                       std::forward< Args >(args)...);
+        if (mode_ == completion_mode::dispatch)
+            dispatch_or_post(exec_, std::move(f));
+        else
+            asio::post(exec_, std::move(f));
     }
 
-    Executor exec_;
-    Handler  handler_;
+    Executor        exec_;
+    Handler         handler_;
+    completion_mode mode_;
 };
 
 template < class Executor, class Handler >
@@ -88,6 +105,10 @@ postit(Executor &&, Handler &&)
     -> postit< std::decay_t< Executor >,
                               std::decay_t< Handler > >;
 
+template < class Executor, class Handler >
+postit(Executor &&, Handler &&, completion_mode)
+    -> postit< std::decay_t< Executor >, std::decay_t< Handler > >;
+
 }   // namespace boost::channels::detail
 
 #endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_POSTIT_HPP
@@ -0,0 +1,419 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_PRIORITY_CHANNEL_IMPL_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_PRIORITY_CHANNEL_IMPL_HPP
+
+#include <boost/channels/completion_mode.hpp>
+#include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
+#include <boost/channels/detail/implement_channel_queue.hpp>
+#include <boost/channels/detail/value_buffer.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+#include <boost/channels/error_code.hpp>
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief The shared state of a priority_channel.
+///
+/// Each lane has its own ring buffer and its own queue of waiting producers,
+/// and all lanes share one queue of consumers. Lane 0 has the highest
+/// priority. A bitmap records which lanes hold values or have producers
+/// waiting, so the highest such lane is found with a single bit scan.
+///
+/// The ring buffers' slots are allocated after the implementation, lane by
+/// lane.
+///
+/// As in channel_impl, every member which may complete ops declares a
+/// completion_scope before taking the mutex, so handlers are posted once the
+/// mutex is released, and those on the same executor together.
+/// Lanes are checked by priority_channel, so members only assert them.
+/// @tparam Lanes is the number of lanes, at most 64
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+struct alignas(std::max_align_t) priority_channel_impl final
+{
+    static_assert(Lanes >= 1 && Lanes <= 64,
+                  "A priority channel has between 1 and 64 lanes");
+
+    using value_type = ValueType;
+    using ring_type  = value_buffer_ref< ValueType >;
+    using slot_type  = typename ring_type::slot_type;
+
+    /// @brief The total number of slots needed by lanes with the given
+    /// capacities.
+    static std::size_t
+    total_slots(std::array< std::size_t, Lanes > const &capacities);
+
+    explicit priority_channel_impl(
+        std::array< std::size_t, Lanes > const &capacities);
+
+    priority_channel_impl(priority_channel_impl const &) = delete;
+
+    priority_channel_impl &
+    operator=(priority_channel_impl const &) = delete;
+
+    ~priority_channel_impl();
+
+    void
+    close();
+
+    void
+    submit_consume_op(basic_consumer_ptr< ValueType, Mutex > consume_op);
+
+    void
+    submit_produce_op(std::size_t                            lane,
+                      basic_producer_ptr< ValueType, Mutex > produce_op);
+
+    /// @brief Take a value from the highest lane which has one, if that can
+    /// be done without waiting.
+    std::optional< value_type >
+    consume_if(error_code &ec);
+
+    /// @brief Give a value to a waiting consumer or to a lane's ring buffer,
+    /// if that can be done without waiting.
+    /// @param value is moved from only if it is taken
+    /// @return true if the value was taken.
+    bool
+    try_produce(std::size_t lane, value_type &value, error_code &ec);
+
+    /// @brief Claim a consumer which has not completed and remove it from the
+    /// wait queue.
+    /// @return true if the op was claimed. The caller completes it and commits
+    /// its state.
+    bool
+    claim_consume_op(basic_consume_op_interface< ValueType, Mutex > &op);
+
+    /// @brief Claim a producer which has not completed and remove it from
+    /// its lane's wait queue.
+    /// @see claim_consume_op
+    bool
+    claim_produce_op(basic_produce_op_interface< ValueType, Mutex > &op);
+
+    /// @brief The number of values a lane's buffer can hold.
+    std::size_t
+    capacity(std::size_t lane) const
+    {
+        return lanes_[lane].data.capacity;
+    }
+
+    std::size_t
+    consumers_waiting();
+
+    std::size_t
+    producers_waiting(std::size_t lane);
+
+    /// @brief Counts the outstanding work of the channel's waiting ops.
+    work_tracker< Mutex > &
+    work()
+    {
+        return *work_;
+    }
+
+  private:
+    struct lane_state
+    {
+        explicit lane_state(std::size_t capacity)
+        : data(capacity)
+        {
+        }
+
+        value_buffer_data                        data;
+        slot_type                               *storage = nullptr;
+        basic_producer_queue< ValueType, Mutex > producers;
+    };
+
+    ring_type
+    buffer(std::size_t lane)
+    {
+        return ring_type { &lanes_[lane].data, lanes_[lane].storage };
+    }
+
+    /// @brief Record whether a lane holds values or has producers waiting.
+    void
+    update(std::size_t lane)
+    {
+        auto bit = std::uint64_t(1) << lane;
+        if (!buffer(lane).empty() || !lanes_[lane].producers.empty())
+            busy_ |= bit;
+        else
+            busy_ &= ~bit;
+    }
+
+    /// @brief Match one lane's producers and ring against the consumers.
+    void
+    flush_lane(std::size_t lane)
+    {
+        flush_not_closed(buffer(lane), consumers_, lanes_[lane].producers);
+        update(lane);
+    }
+
+    /// @brief Serve the waiting consumers from the busy lanes in order of
+    /// priority.
+    /// @pre mutex_ is locked
+    void
+    flush();
+
+    template < std::size_t... Is >
+    static std::array< lane_state, Lanes >
+    make_lanes(std::array< std::size_t, Lanes > const &capacities,
+               std::index_sequence< Is... >)
+    {
+        return { lane_state(capacities[Is])... };
+    }
+
+    Mutex mutex_;
+
+    std::array< lane_state, Lanes > lanes_;
+
+    /// Bit n is set if lane n holds values or has producers waiting.
+    std::uint64_t busy_ = 0;
+
+    basic_consumer_queue< ValueType, Mutex > consumers_;
+
+    bool closed_ = false;
+
+    /// Shared with the ops it counts, which may outlive the channel
+    work_tracker< Mutex > *work_ = work_tracker< Mutex >::create();
+};
+
+//
+//
+//
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+std::size_t
+priority_channel_impl< ValueType, Lanes, Mutex >::total_slots(
+    std::array< std::size_t, Lanes > const &capacities)
+{
+    std::size_t n = 0;
+    for (auto c : capacities)
+        n += c;
+    return n;
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+priority_channel_impl< ValueType, Lanes, Mutex >::priority_channel_impl(
+    std::array< std::size_t, Lanes > const &capacities)
+: lanes_(make_lanes(capacities, std::make_index_sequence< Lanes >()))
+{
+    auto slots = reinterpret_cast< slot_type * >(this + 1);
+    for (auto &lane : lanes_)
+    {
+        if (lane.data.capacity)
+            lane.storage = slots;
+        slots += lane.data.capacity;
+    }
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+priority_channel_impl< ValueType, Lanes, Mutex >::~priority_channel_impl()
+{
+    auto scope = completion_scope(completion_mode::post);
+    if (!closed_)
+    {
+        closed_ = true;
+        flush();
+    }
+    for (std::size_t i = 0; i < Lanes; ++i)
+        buffer(i).destroy();
+    work_->retire();
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+void
+priority_channel_impl< ValueType, Lanes, Mutex >::close()
+{
+    auto scope = completion_scope(completion_mode::post);
+    auto lck   = std::lock_guard(mutex_);
+    if (!closed_)
+    {
+        closed_ = true;
+        flush();
+    }
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+void
+priority_channel_impl< ValueType, Lanes, Mutex >::flush()
+{
+    if (closed_) [[unlikely]]
+    {
+        // waiting producers fail, but buffered values are still delivered
+        basic_consumer_queue< ValueType, Mutex > none;
+        for (std::size_t i = 0; i < Lanes; ++i)
+        {
+            flush_closed(buffer(i), none, lanes_[i].producers);
+            update(i);
+        }
+    }
+
+    // every lane other than those touched since the last flush is already
+    // settled, so once the consumers are satisfied there is nothing to do
+    for (auto busy = busy_; busy && !consumers_.empty(); busy &= busy - 1)
+        flush_lane(std::countr_zero(busy));
+
+    // any consumer left over when closed has nothing more to wait for
+    if (closed_)
+        flush_closed(buffer(0), consumers_, lanes_[0].producers);
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+void
+priority_channel_impl< ValueType, Lanes, Mutex >::submit_consume_op(
+    basic_consumer_ptr< ValueType, Mutex > consume_op)
+{
+    auto scope = completion_scope(completion_mode::post);
+    auto lck   = std::lock_guard(mutex_);
+
+    consumers_.push(std::move(consume_op));
+    flush();
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+void
+priority_channel_impl< ValueType, Lanes, Mutex >::submit_produce_op(
+    std::size_t                            lane,
+    basic_producer_ptr< ValueType, Mutex > produce_op)
+{
+    BOOST_CHANNELS_ASSERT(lane < Lanes);
+    auto scope = completion_scope(completion_mode::post);
+    auto lck   = std::lock_guard(mutex_);
+
+    lanes_[lane].producers.push(std::move(produce_op));
+    if (closed_) [[unlikely]]
+        flush();
+    else
+        // a consumer only waits while every lane is empty, so no other lane
+        // can have changed
+        flush_lane(lane);
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+auto
+priority_channel_impl< ValueType, Lanes, Mutex >::consume_if(error_code &ec)
+    -> std::optional< value_type >
+{
+    auto scope = completion_scope(completion_mode::post);
+    auto lck   = std::lock_guard(mutex_);
+
+    std::optional< value_type > result;
+    for (auto busy = busy_; busy && !result; busy &= busy - 1)
+    {
+        auto  i    = std::size_t(std::countr_zero(busy));
+        auto &lane = lanes_[i];
+        auto  ring = buffer(i);
+        if (ring.try_pop_with(
+                [&](value_type &&v) { result.emplace(std::move(v)); }))
+        {
+            // the space may be taken by a waiting producer
+            if (!lane.producers.empty())
+                flush_lane(i);
+        }
+        else
+            take_from_producer(ring, lane.producers, result);
+        update(i);
+    }
+
+    if (!result && closed_)
+        ec = errors::channel_closed;
+    return result;
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+bool
+priority_channel_impl< ValueType, Lanes, Mutex >::try_produce(
+    std::size_t lane,
+    value_type &value,
+    error_code &ec)
+{
+    BOOST_CHANNELS_ASSERT(lane < Lanes);
+    auto scope = completion_scope(completion_mode::post);
+    auto lck   = std::lock_guard(mutex_);
+    if (closed_)
+    {
+        ec = errors::channel_closed;
+        return false;
+    }
+
+    // a waiting consumer means that every lane is empty, so the value may be
+    // handed over directly
+    if (!try_produce_not_closed(
+            buffer(lane), consumers_, lanes_[lane].producers, value))
+        return false;
+    update(lane);
+    return true;
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+bool
+priority_channel_impl< ValueType, Lanes, Mutex >::claim_consume_op(
+    basic_consume_op_interface< ValueType, Mutex > &op)
+{
+    // the op is released after the mutex
+    basic_consumer_ptr< ValueType, Mutex > removed;
+
+    auto lck = std::lock_guard(mutex_);
+    if (!op.state().claim())
+        return false;
+    if (consumers_.linked(op))
+        removed = consumers_.erase(&op);
+    return true;
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+bool
+priority_channel_impl< ValueType, Lanes, Mutex >::claim_produce_op(
+    basic_produce_op_interface< ValueType, Mutex > &op)
+{
+    // the op is released after the mutex
+    basic_producer_ptr< ValueType, Mutex > removed;
+
+    auto lck = std::lock_guard(mutex_);
+    if (!op.state().claim())
+        return false;
+
+    // the op does not know its lane, so each lane's queue is asked
+    for (std::size_t i = 0; i < Lanes; ++i)
+        if (lanes_[i].producers.holds(op))
+        {
+            removed = lanes_[i].producers.erase(&op);
+            update(i);
+            break;
+        }
+    return true;
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+std::size_t
+priority_channel_impl< ValueType, Lanes, Mutex >::consumers_waiting()
+{
+    auto lck = std::lock_guard(mutex_);
+    return consumers_.size();
+}
+
+template < class ValueType, std::size_t Lanes, concepts::Lockable Mutex >
+std::size_t
+priority_channel_impl< ValueType, Lanes, Mutex >::producers_waiting(
+    std::size_t lane)
+{
+    auto lck = std::lock_guard(mutex_);
+    return lanes_[lane].producers.size();
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_PRIORITY_CHANNEL_IMPL_HPP
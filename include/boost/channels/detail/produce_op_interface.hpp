@@ -13,32 +13,219 @@
 #include <boost/channels/detail/io_op_interface_base.hpp>
 #include <boost/channels/error_code.hpp>
 
+#include <memory>
+
 namespace boost::channels::detail {
 template < class ValueType, concepts::Lockable Mutex = std::mutex >
 struct basic_produce_op_interface : basic_io_op_interface_base< Mutex >
 {
-    virtual ~basic_produce_op_interface() = default;
+    using base_type  = basic_io_op_interface_base< Mutex >;
+    using mutex_type = typename base_type::mutex_type;
+
+    struct vtable_type : base_type::vtable_type
+    {
+        ValueType (*consume)(basic_produce_op_interface &);
+        void (*fail)(basic_produce_op_interface &, error_code);
+        bool (*more)(basic_produce_op_interface const &);
+        void (*lend)(basic_produce_op_interface &,
+                     void (*)(void *, ValueType &),
+                     void *);
+        void (*grant)(basic_produce_op_interface &, void *);
+    };
 
     /// @brief Consume the value from the produce_op_interface.
-    /// @pre completed() == false
-    /// @post completed() == true
+    /// @pre claims_slot() == false
+    /// @pre state().claimed() == true
+    /// @post the caller commits or releases state()
     /// @return the object held within the produce_op_interface, having been
     /// moved out of its temporary storeag
-    virtual ValueType
-    consume() = 0;
+    ValueType
+    consume()
+    {
+        return vtable().consume(*this);
+    }
+
+    /// @brief Test whether the op claims a slot in the channel's buffer
+    /// rather than giving a value.
+    ///
+    /// Such an op waits in the queue like any other producer. When it reaches
+    /// the front and the buffer has space, the slot at the back of the buffer
+    /// is reserved and granted to it. The value is constructed there later
+    /// and published by the owner of the slot.
+    bool
+    claims_slot() const
+    {
+        return vtable().grant != nullptr;
+    }
+
+    /// @brief Give the op the reserved slot it claimed.
+    /// @param slot is uninitialised storage for one value
+    /// @pre claims_slot() == true
+    /// @pre state().claimed() == true
+    /// @post the caller commits state()
+    void
+    grant(void *slot)
+    {
+        BOOST_CHANNELS_ASSERT(claims_slot());
+        vtable().grant(*this, slot);
+    }
+
+    /// @brief Give the value to a visitor without moving it out of the op.
+    ///
+    /// This has the same effect on the op as consume(), except that the value
+    /// is seen by reference where it lies and is discarded after f returns.
+    /// Ops which cannot lend their value in place are consumed into a local
+    /// and f sees that.
+    /// @pre claims_slot() == false
+    /// @pre state().claimed() == true
+    /// @post the caller commits or releases state()
+    template < class F >
+    void
+    lend_to(F &&f)
+    {
+        vtable().lend(
+            *this,
+            [](void *pf, ValueType &v) { (*static_cast< F * >(pf))(v); },
+            std::addressof(f));
+    }
+
+    /// @brief Test whether the op has further values to give after the one
+    /// just consumed.
+    ///
+    /// Most ops produce a single value. An op which produces a batch gives
+    /// one value per call to consume() and only completes when it gives the
+    /// last one. While it has more to give, the caller releases the op's
+    /// state rather than committing it and leaves the op in the queue.
+    bool
+    more() const
+    {
+        return vtable().more && vtable().more(*this);
+    }
 
     /// @brief Complete the operation with an error code.
     ///
     /// Does not take the value from the producer.
-    /// @pre completed() == false
-    /// @post completed() == true
-    virtual void
-    fail(error_code ec) = 0;
+    /// @pre state().claimed() == true
+    /// @post the caller commits or releases state()
+    void
+    fail(error_code ec)
+    {
+        vtable().fail(*this, ec);
+    }
+
+  protected:
+    /// @brief Bind the op's function table to the most derived type.
+    /// @param self is the most derived op. Only its type is used.
+    /// @param shared is the completion state shared with other ops, if any.
+    template < class Op >
+    explicit basic_produce_op_interface(Op *self, completion_state *shared = nullptr)
+    : base_type(&vtable_for< Op >, shared)
+    {
+        static_assert(is_slot_claim< Op > ||
+                          !std::is_same_v<
+                              decltype(&Op::consume),
+                              decltype(&basic_produce_op_interface::consume) >,
+                      "Op must implement consume() or grant()");
+        static_assert(
+            !std::is_same_v< decltype(&Op::fail),
+                             decltype(&basic_produce_op_interface::fail) >,
+            "Op must implement fail()");
+        (void)self;
+    }
+
+  private:
+    // ops which claim a slot provide grant() instead of consume()
+    template < class Op >
+    static constexpr bool is_slot_claim =
+        !std::is_same_v< decltype(&Op::grant),
+                         decltype(&basic_produce_op_interface::grant) >;
+
+    template < class Op >
+    static constexpr auto
+    consume_for() -> ValueType (*)(basic_produce_op_interface &)
+    {
+        if constexpr (is_slot_claim< Op >)
+            return nullptr;
+        else
+            return [](basic_produce_op_interface &self) -> ValueType {
+                return static_cast< Op & >(self).consume();
+            };
+    }
+
+    template < class Op >
+    static constexpr auto
+    grant_for() -> void (*)(basic_produce_op_interface &, void *)
+    {
+        if constexpr (is_slot_claim< Op >)
+            return [](basic_produce_op_interface &self, void *slot) {
+                static_cast< Op & >(self).grant(slot);
+            };
+        else
+            return nullptr;
+    }
+
+    // only ops which produce a batch provide more()
+    template < class Op >
+    static constexpr auto
+    more_for() -> bool (*)(basic_produce_op_interface const &)
+    {
+        if constexpr (!std::is_same_v<
+                          decltype(&Op::more),
+                          decltype(&basic_produce_op_interface::more) >)
+            return [](basic_produce_op_interface const &self) {
+                return static_cast< Op const & >(self).more();
+            };
+        else
+            return nullptr;
+    }
+
+    // ops which hold their value provide lend()
+    template < class Op >
+    static constexpr auto
+    lend_for()
+        -> void (*)(basic_produce_op_interface &,
+                    void (*)(void *, ValueType &),
+                    void *)
+    {
+        if constexpr (is_slot_claim< Op >)
+            return nullptr;
+        else
+            return [](basic_produce_op_interface &self,
+                      void (*visit)(void *, ValueType &),
+                      void *context) {
+                auto &op = static_cast< Op & >(self);
+                if constexpr (requires { op.lend([](ValueType &) {}); })
+                    op.lend([&](ValueType &v) { visit(context, v); });
+                else
+                {
+                    ValueType v = op.consume();
+                    visit(context, v);
+                }
+            };
+    }
+
+    template < class Op >
+    static constexpr vtable_type vtable_for = {
+        base_type::template make_vtable< Op >(),
+        consume_for< Op >(),
+        [](basic_produce_op_interface &self, error_code ec) {
+            static_cast< Op & >(self).fail(ec);
+        },
+        more_for< Op >(),
+        lend_for< Op >(),
+        grant_for< Op >()
+    };
+
+    vtable_type const &
+    vtable() const
+    {
+        return static_cast< vtable_type const & >(*this->vtable_);
+    }
 };
 
 template < class ValueType, concepts::Lockable Mutex >
 using basic_producer_ptr =
-    std::shared_ptr< basic_produce_op_interface< ValueType, Mutex > >;
+    boost::intrusive_ptr< basic_produce_op_interface< ValueType, Mutex > >;
 
 // common specialisations
 
@@ -46,7 +233,7 @@ template < class ValueType >
 using produce_op_interface = basic_produce_op_interface< ValueType >;
 
 template < class ValueType >
-using producer_ptr = std::shared_ptr< produce_op_interface< ValueType > >;
+using producer_ptr = boost::intrusive_ptr< produce_op_interface< ValueType > >;
 }   // namespace boost::channels::detail
 
 #endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_PRODUCE_OP_INTERFACE_HPP
@@ -11,143 +11,175 @@
 #define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_PRODUCER_OP_FUNCTION_HPP
 
 #include <boost/channels/config.hpp>
+#include <boost/channels/detail/allocate_op.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
+#include <boost/channels/detail/postit.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
 #include <boost/channels/detail/produce_op_interface.hpp>
 
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/post.hpp>
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+
 namespace boost::channels::detail {
 
-/// @brief A producer op specialisation which calls a function when done
-/// @tparam ValueType
+/// @brief The value type sent by a producer op whose source is a value or a
+/// std::reference_wrapper to one.
+template < class Source >
+using unwrap_source_t =
+    std::remove_reference_t< std::unwrap_reference_t< Source > >;
+
+/// @brief A producer op which posts a completion handler when done
+///
+/// The value, the handler and its executor live in the op, which is the only
+/// allocation made by the channel for an async_send. The op is allocated with
+/// the handler's associated allocator. On completion the handler is moved
+/// directly into the function posted to its executor. Within a
+/// completion_scope the handler stays in the op until the scope ends.
+///
+/// As with consumer_op_function, the op holds either a share of its
+/// channel's work_tracker or an executor which tracks outstanding work.
+/// @tparam Source is the type of value to send, or a std::reference_wrapper
+/// to it if the value is to be moved from the caller's storage at the time
+/// of sending
 /// @tparam Mutex
-/// @tparam CompletionFunction A function object with signature void(error_code)
+/// @tparam Executor is the executor on which the handler will be invoked
+/// @tparam Handler A function object with signature void(error_code)
 ///
-template < class ValueType, concepts::Lockable Mutex, class CompletionFunction >
+template < class Source,
+           concepts::Lockable Mutex,
+           class Executor,
+           class Handler >
 struct producer_op_function final
-: detail::basic_produce_op_interface< ValueType, Mutex >
+: detail::basic_produce_op_interface< unwrap_source_t< Source >, Mutex >
 {
-    template < class ValueArg, class CompletionArg >
-    producer_op_function(ValueArg &&source, CompletionArg &&completion)
-    : source_(std::forward< ValueArg >(source))
-    , completion_(std::forward< CompletionArg >(completion))
-    {
-    }
-
-    virtual bool
-    completed() const override
-    {
-        return completed_;
-    };
-
-    virtual typename detail::basic_produce_op_interface< ValueType,
-                                                         Mutex >::mutex_type &
-    get_mutex() override
+    using interface_type =
+        detail::basic_produce_op_interface< unwrap_source_t< Source >, Mutex >;
+    using value_type     = unwrap_source_t< Source >;
+    using mutex_type     = typename interface_type::mutex_type;
+    using allocator_type = asio::associated_allocator_t< Handler >;
+
+    template < class SourceArg, class HandlerArg >
+    producer_op_function(SourceArg           &&source,
+                         Executor              exec,
+                         HandlerArg          &&handler,
+                         counted_work< Mutex > work = {})
+    : interface_type(this)
+    , source_(std::forward< SourceArg >(source))
+    , exec_(std::move(exec))
+    , handler_(std::forward< HandlerArg >(handler))
+    , work_(std::move(work))
+    , alloc_(asio::get_associated_allocator(handler_))
     {
-        return mutex_;
     }
 
-    virtual ValueType
-    consume() override
+    value_type
+    consume()
     {
-        auto result     = std::move(source_);
-        auto completion = std::move(completion_);
-
-        // a normal comepletion handler would destroy itself here
-        completed_ = true;
-
-        completion(error_code());
+        value_type result = std::move(static_cast< value_type & >(source_));
+        complete(error_code());
         return result;
     }
 
-    virtual void
-    fail(error_code ec) override
+    template < class F >
+    void
+    lend(F &&f)
     {
-        BOOST_CHANNELS_ASSERT(!completed_);
-
-        auto completion = std::move(completion_);
-
-        // a normal completion handler would destroy itself here
-        completed_ = true;
-
-        completion(ec);
+        f(static_cast< value_type & >(source_));
+        complete(error_code());
     }
 
-    ValueType          source_;
-    CompletionFunction completion_;
-    Mutex              mutex_;
-    bool               completed_ = false;
-};
-
-template < concepts::Lockable Mutex, class ValueType, class CompletionFunction >
-auto
-make_producer_op_function(ValueType &&value, CompletionFunction &&completion)
-{
-    using type = producer_op_function< std::decay_t< ValueType >,
-                                       Mutex,
-                                       std::decay_t< CompletionFunction > >;
-    return std::make_shared< type >(
-        std::forward< ValueType >(value),
-        std::forward< CompletionFunction >(completion));
-}
-
-//
-// Specialisation to deliver through a reference
-template < class ValueType, concepts::Lockable Mutex, class CompletionFunction >
-struct producer_op_function< std::reference_wrapper< ValueType >,
-                             Mutex,
-                             CompletionFunction >
-    final : detail::basic_produce_op_interface< ValueType, Mutex >
-{
-    template < class ValueArg, class CompletionArg >
-    producer_op_function(ValueArg &&source, CompletionArg &&completion)
-    : source_(std::forward< ValueArg >(source))
-    , completion_(std::forward< CompletionArg >(completion))
+    void
+    fail(error_code ec)
     {
+        complete(ec);
     }
 
-    virtual bool
-    completed() const override
+    static void
+    destroy(producer_op_function *self) noexcept
     {
-        return completed_;
-    };
+        auto alloc = self->alloc_;
+        deallocate_op(alloc, self);
+    }
 
-    virtual typename detail::basic_produce_op_interface< ValueType,
-                                                         Mutex >::mutex_type &
-    get_mutex() override
+  private:
+    void
+    complete(error_code ec)
     {
-        return mutex_;
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        if (auto scope = completion_scope::current())
+        {
+            result_ = ec;
+            intrusive_ptr_add_ref(this);
+            scope->defer(this, &fire, exec_);
+        }
+        else
+            invoke(ec, fire_mode::post);
     }
 
-    virtual ValueType
-    consume() override
+    static void
+    fire(void *p, fire_mode mode)
     {
-        auto result     = std::move(source_.get());
-        auto completion = std::move(completion_);
-
-        // a normal comepletion handler would destroy itself here
-        completed_ = true;
-
-        completion(error_code());
-        return result;
+        auto self = boost::intrusive_ptr< producer_op_function >(
+            static_cast< producer_op_function * >(p), false);
+        if (mode != fire_mode::discard)
+            self->invoke(self->result_, mode);
     }
 
-    virtual void
-    fail(error_code ec) override
+    void
+    invoke(error_code ec, fire_mode mode)
     {
-        BOOST_CHANNELS_ASSERT(!completed_);
-
-        auto completion = std::move(completion_);
+        // the op may outlive its completion in a cancellation slot, so the
+        // executor's outstanding work leaves with the handler, and the op's
+        // share of its tracker's work once the handler has been posted or run
+        auto work = std::move(work_);
+        auto exec = std::move(exec_);
+        auto f    = handler_bound_to_args(std::move(handler_), ec);
+        if (mode == fire_mode::invoke)
+            f();
+        else if (mode == fire_mode::dispatch)
+            dispatch_or_post(exec, std::move(f));
+        else
+            asio::post(exec, std::move(f));
+    }
 
-        // a normal completion handler would destroy itself here
-        completed_ = true;
+    Source                source_;
+    Executor              exec_;
+    Handler               handler_;
+    counted_work< Mutex > work_;
 
-        completion(ec);
-    }
+    /// The error completed with within a completion_scope
+    error_code result_;
 
-    std::reference_wrapper< ValueType > source_;
-    CompletionFunction                  completion_;
-    Mutex                               mutex_;
-    bool                                completed_ = false;
+    [[no_unique_address]] allocator_type alloc_;
 };
 
+template < concepts::Lockable Mutex,
+           class ValueType,
+           class Executor,
+           class Handler >
+auto
+make_producer_op_function(ValueType           &&value,
+                          Executor            &&exec,
+                          Handler             &&handler,
+                          counted_work< Mutex > work = {})
+{
+    using type = producer_op_function< std::decay_t< ValueType >,
+                                       Mutex,
+                                       std::decay_t< Executor >,
+                                       std::decay_t< Handler > >;
+    auto alloc = asio::get_associated_allocator(handler);
+    return boost::intrusive_ptr< type >(
+        allocate_op< type >(alloc,
+                            std::forward< ValueType >(value),
+                            std::forward< Executor >(exec),
+                            std::forward< Handler >(handler),
+                            std::move(work)));
+}
+
 }   // namespace boost::channels::detail
 
 #endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_PRODUCER_OP_FUNCTION_HPP
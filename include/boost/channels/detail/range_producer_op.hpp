@@ -0,0 +1,186 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_RANGE_PRODUCER_OP_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_RANGE_PRODUCER_OP_HPP
+
+#include <boost/channels/config.hpp>
+#include <boost/channels/detail/allocate_op.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
+#include <boost/channels/detail/postit.hpp>
+#include <boost/channels/detail/produce_op_interface.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/post.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief A producer op which sends every value in a range of iterators
+///
+/// The op gives one value each time it is consumed and stays in the
+/// channel's queue until the range is exhausted, so a whole batch is moved
+/// under as few acquisitions of the channel's mutex as space allows. The
+/// handler is invoked once, with the number of values accepted by the
+/// channel. Within a completion_scope the handler stays in the op until the
+/// scope ends.
+///
+/// The op keeps its executor's context running as consumer_op_function does.
+/// @tparam ValueType is the channel's value type
+/// @tparam Iterator is an input iterator whose values are moved from
+/// @tparam Mutex
+/// @tparam Executor is the executor on which the handler will be invoked
+/// @tparam Handler A function object with signature void(error_code,
+/// std::size_t)
+///
+template < class ValueType,
+           std::input_iterator Iterator,
+           concepts::Lockable  Mutex,
+           class Executor,
+           class Handler >
+struct range_producer_op final
+: detail::basic_produce_op_interface< ValueType, Mutex >
+{
+    using interface_type = detail::basic_produce_op_interface< ValueType, Mutex >;
+    using value_type     = ValueType;
+    using allocator_type = asio::associated_allocator_t< Handler >;
+
+    template < class HandlerArg >
+    range_producer_op(Iterator              first,
+                      Iterator              last,
+                      Executor              exec,
+                      HandlerArg          &&handler,
+                      counted_work< Mutex > work = {})
+    : interface_type(this)
+    , first_(std::move(first))
+    , last_(std::move(last))
+    , exec_(std::move(exec))
+    , handler_(std::forward< HandlerArg >(handler))
+    , work_(std::move(work))
+    , alloc_(asio::get_associated_allocator(handler_))
+    {
+    }
+
+    value_type
+    consume()
+    {
+        BOOST_CHANNELS_ASSERT(first_ != last_);
+        value_type result = std::move(*first_);
+        ++first_;
+        ++accepted_;
+        if (first_ == last_)
+            complete(error_code());
+        return result;
+    }
+
+    bool
+    more() const
+    {
+        return first_ != last_;
+    }
+
+    void
+    fail(error_code ec)
+    {
+        complete(ec);
+    }
+
+    static void
+    destroy(range_producer_op *self) noexcept
+    {
+        auto alloc = self->alloc_;
+        deallocate_op(alloc, self);
+    }
+
+  private:
+    void
+    complete(error_code ec)
+    {
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        if (auto scope = completion_scope::current())
+        {
+            result_ = ec;
+            intrusive_ptr_add_ref(this);
+            scope->defer(this, &fire, exec_);
+        }
+        else
+            invoke(ec, fire_mode::post);
+    }
+
+    static void
+    fire(void *p, fire_mode mode)
+    {
+        auto self = boost::intrusive_ptr< range_producer_op >(
+            static_cast< range_producer_op * >(p), false);
+        if (mode != fire_mode::discard)
+            self->invoke(self->result_, mode);
+    }
+
+    void
+    invoke(error_code ec, fire_mode mode)
+    {
+        auto work = std::move(work_);
+        auto exec = std::move(exec_);
+        auto f    = handler_bound_to_args(std::move(handler_), ec, accepted_);
+        if (mode == fire_mode::invoke)
+            f();
+        else if (mode == fire_mode::dispatch)
+            dispatch_or_post(exec, std::move(f));
+        else
+            asio::post(exec, std::move(f));
+    }
+
+    Iterator              first_;
+    Iterator              last_;
+    Executor              exec_;
+    Handler               handler_;
+    counted_work< Mutex > work_;
+    std::size_t           accepted_ = 0;
+
+    /// The error completed with within a completion_scope
+    error_code result_;
+
+    [[no_unique_address]] allocator_type alloc_;
+};
+
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Iterator,
+           class Executor,
+           class Handler >
+auto
+make_range_producer_op(Iterator              first,
+                       Iterator              last,
+                       Executor            &&exec,
+                       Handler             &&handler,
+                       counted_work< Mutex > work = {})
+{
+    using type = range_producer_op< ValueType,
+                                    Iterator,
+                                    Mutex,
+                                    std::decay_t< Executor >,
+                                    std::decay_t< Handler > >;
+    auto alloc = asio::get_associated_allocator(handler);
+    return boost::intrusive_ptr< type >(
+        allocate_op< type >(alloc,
+                            std::move(first),
+                            std::move(last),
+                            std::forward< Executor >(exec),
+                            std::forward< Handler >(handler),
+                            std::move(work)));
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_RANGE_PRODUCER_OP_HPP
@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_RING_INDEX_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_RING_INDEX_HPP
+
+#include <boost/channels/config.hpp>
+
+#include <cstddef>
+
+namespace boost::channels::detail {
+
+/// @brief Test whether n is a non-zero power of two.
+constexpr bool
+is_power_of_two(std::size_t n) noexcept
+{
+    return n && !(n & (n - 1));
+}
+
+/// @brief The geometry of a ring buffer.
+///
+/// Rings address their values by position. The number of values in a ring is
+/// the distance from its head position to its tail position, so no separate
+/// count is kept.
+///
+/// If the capacity is a power of two, positions simply count up, and a slot
+/// is found by masking. Otherwise positions wrap at twice the capacity, which
+/// still tells a full ring from an empty one, and a slot is found with one
+/// comparison. In neither case is a division needed.
+struct ring_index
+{
+    explicit ring_index(std::size_t capacity) noexcept
+    : capacity(capacity)
+    , mask(capacity - 1)
+    , power_of_two(is_power_of_two(capacity))
+    {
+    }
+
+    /// @brief The position following pos.
+    std::size_t
+    advance(std::size_t pos) const noexcept
+    {
+        ++pos;
+        if (!power_of_two && pos == 2 * capacity)
+            pos = 0;
+        return pos;
+    }
+
+    /// @brief The number of positions from head up to tail.
+    std::size_t
+    distance(std::size_t head, std::size_t tail) const noexcept
+    {
+        if (power_of_two || tail >= head)
+            return tail - head;
+        return tail + 2 * capacity - head;
+    }
+
+    /// @brief The slot addressed by a position.
+    /// @pre capacity != 0
+    std::size_t
+    slot_of(std::size_t pos) const noexcept
+    {
+        BOOST_CHANNELS_ASSERT(capacity);
+        if (power_of_two)
+            return pos & mask;
+        return pos >= capacity ? pos - capacity : pos;
+    }
+
+    std::size_t capacity;
+    std::size_t mask;
+    bool        power_of_two;
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_RING_INDEX_HPP
@@ -0,0 +1,138 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SELECT_BRANCH_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SELECT_BRANCH_HPP
+
+#include <atomic>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief The part of a select branch's op which allows the select to find
+/// it again once the select has completed.
+///
+/// While the select is waiting, it holds a reference to each of its branches.
+/// When it completes, the branches which lost are removed from the wait
+/// queues of their channels, so that an idle channel does not keep dead ops,
+/// and through them the select, alive.
+struct select_branch
+{
+    /// @brief Remove the branch from its channel's wait queue, if it is still
+    /// there.
+    void (*unlink)(select_branch *) noexcept;
+
+    /// @brief Drop the reference to the branch's op held by the select.
+    void (*release)(select_branch *) noexcept;
+
+    select_branch *next_branch = nullptr;
+};
+
+/// @brief The branches taken from a completed select.
+///
+/// Owns a reference to each branch. Branches which have not been unlinked
+/// are released without being unlinked when the list is destroyed.
+struct select_branch_list
+{
+    explicit select_branch_list(select_branch *head = nullptr)
+    : head_(head)
+    {
+    }
+
+    select_branch_list(select_branch_list &&other) noexcept
+    : head_(std::exchange(other.head_, nullptr))
+    {
+    }
+
+    select_branch_list &
+    operator=(select_branch_list &&other) noexcept
+    {
+        auto tmp = std::move(other);
+        std::swap(head_, tmp.head_);
+        return *this;
+    }
+
+    ~select_branch_list()
+    {
+        while (auto b = pop())
+            b->release(b);
+    }
+
+    /// @brief Remove every branch from its channel and release it.
+    /// @note Must not be called while any channel's mutex is held.
+    void
+    unlink_all() noexcept
+    {
+        while (auto b = pop())
+        {
+            b->unlink(b);
+            b->release(b);
+        }
+    }
+
+  private:
+    select_branch *
+    pop() noexcept
+    {
+        auto b = head_;
+        if (b)
+            head_ = b->next_branch;
+        return b;
+    }
+
+    select_branch *head_;
+};
+
+/// @brief The set of branches registered with a select.
+///
+/// Branches may be registered by one thread while another completes the
+/// select, so the set is a lock-free stack which is closed when it is taken.
+struct select_branch_set
+{
+    /// @brief Register a branch with the select.
+    /// @return false if the select has already completed, in which case the
+    /// branch is not registered.
+    bool
+    add(select_branch &b) noexcept
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        do
+        {
+            if (head == closed())
+                return false;
+            b.next_branch = head;
+        } while (!head_.compare_exchange_weak(head,
+                                              &b,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+        return true;
+    }
+
+    /// @brief Take all registered branches and refuse any more.
+    select_branch_list
+    take() noexcept
+    {
+        auto head = head_.exchange(closed(), std::memory_order_acquire);
+        return select_branch_list(head == closed() ? nullptr : head);
+    }
+
+  private:
+    static select_branch *
+    closed() noexcept
+    {
+        static select_branch marker { nullptr, nullptr };
+        return &marker;
+    }
+
+    std::atomic< select_branch * > head_ { nullptr };
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SELECT_BRANCH_HPP
@@ -11,40 +11,170 @@
 #define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SELECT_STATE_HPP
 
 #include <boost/channels/concepts/select_handler.hpp>
+#include <boost/channels/detail/cancellation.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
 #include <boost/channels/detail/select_state_base.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/post.hpp>
+
+#include <memory>
+#include <optional>
+#include <tuple>
 
 namespace boost::channels::detail {
-template < concepts::Lockable Mutex, concepts::select_handler Handler >
-struct select_state final : select_state_base< Mutex >
+
+/// @brief The function posted to a select's executor when the select
+/// completes.
+///
+/// Removes the losing branches from their channels before invoking the
+/// handler. This runs outside of every channel's mutex, so a channel is
+/// never locked while another is held.
+template < class Handler >
+struct select_completion
+{
+    using executor_type  = asio::associated_executor_t< Handler >;
+    using allocator_type = asio::associated_allocator_t< Handler >;
+
+    select_completion(Handler                      handler,
+                      select_branch_list           branches,
+                      std::tuple< error_code, int > args)
+    : handler_(std::move(handler))
+    , branches_(std::move(branches))
+    , args_(args)
+    {
+    }
+
+    void
+    operator()()
+    {
+        branches_.unlink_all();
+        clear_cancellation_slot(handler_);
+        std::apply(handler_, args_);
+    }
+
+    executor_type
+    get_executor() const
+    {
+        return asio::get_associated_executor(handler_);
+    }
+
+    allocator_type
+    get_allocator() const
+    {
+        return asio::get_associated_allocator(handler_);
+    }
+
+  private:
+    Handler                       handler_;
+    select_branch_list            branches_;
+    std::tuple< error_code, int > args_;
+};
+
+/// @brief The shared state of a select whose handler will be invoked on
+/// Executor.
+///
+/// Within a completion_scope the state keeps itself alive, with the handler
+/// and the branches to unlink, until the scope ends. The state keeps its
+/// executor's context running as consumer_op_function does, through the
+/// work_tracker of the first of the select's channels.
+template < concepts::Lockable       Mutex,
+           class                    Executor,
+           concepts::select_handler Handler >
+struct select_state final
+: select_state_base< Mutex >
+, std::enable_shared_from_this< select_state< Mutex, Executor, Handler > >
 {
     using value_type =
         typename detail::select_state_base< Mutex >::value_type;
 
-    template < concepts::select_handler HandlerArg >
-    select_state(HandlerArg &&arg)
-    : handler_(std::forward< HandlerArg >(arg))
+    template < class ExecutorArg, concepts::select_handler HandlerArg >
+    select_state(ExecutorArg          &&exec,
+                 HandlerArg           &&arg,
+                 counted_work< Mutex > work = {})
+    : exec_(std::forward< ExecutorArg >(exec))
+    , handler_(std::forward< HandlerArg >(arg))
+    , work_(std::move(work))
     {
     }
 
     void
     complete(value_type value) override
     {
-        auto handler = std::move(handler_);
-        this->set_completed();
-        std::apply(handler, std::move(value));
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        auto branches = this->branches().take();
+        if (auto scope = completion_scope::current())
+        {
+            deferred_.emplace(
+                std::move(branches), value, this->shared_from_this());
+            scope->defer(this, &fire, exec_);
+        }
+        else
+            invoke(std::move(branches), value, fire_mode::post);
     }
 
   private:
-    Handler handler_;
+    /// The outcome completed with within a completion_scope, and the
+    /// reference which keeps the state alive until the scope ends
+    struct deferred
+    {
+        select_branch_list              branches;
+        value_type                      value;
+        std::shared_ptr< select_state > self;
+    };
+
+    static void
+    fire(void *p, fire_mode mode)
+    {
+        auto &d    = *static_cast< select_state * >(p)->deferred_;
+        auto  self = std::move(d.self);
+        if (mode != fire_mode::discard)
+            self->invoke(std::move(d.branches), d.value, mode);
+        self->deferred_.reset();
+    }
+
+    void
+    invoke(select_branch_list branches, value_type value, fire_mode mode)
+    {
+        auto work = std::move(work_);
+        auto exec = std::move(exec_);
+        auto f    = select_completion< Handler >(
+            std::move(handler_), std::move(branches), value);
+        if (mode == fire_mode::invoke)
+            f();
+        else if (mode == fire_mode::dispatch)
+            dispatch_or_post(exec, std::move(f));
+        else
+            asio::post(exec, std::move(f));
+    }
+
+    Executor                  exec_;
+    Handler                   handler_;
+    counted_work< Mutex >     work_;
+    std::optional< deferred > deferred_;
 };
 
-template < concepts::Lockable Mutex, concepts::select_handler Handler >
+/// @brief Create the shared state of a select whose handler will be invoked
+/// on the given executor.
+template < concepts::Lockable       Mutex,
+           class                    Executor,
+           concepts::select_handler Handler >
 auto
-make_select_state(Handler &&handler)
-    -> std::shared_ptr< select_state< Mutex, std ::decay_t< Handler > > >
+make_select_state(Executor            &&exec,
+                  Handler             &&handler,
+                  counted_work< Mutex > work = {})
+    -> std::shared_ptr< select_state< Mutex,
+                                      std::decay_t< Executor >,
+                                      std::decay_t< Handler > > >
 {
-    return std::make_shared< select_state< Mutex, std ::decay_t< Handler > > >(
-        std::forward< Handler >(handler));
+    return std::make_shared< select_state< Mutex,
+                                           std::decay_t< Executor >,
+                                           std::decay_t< Handler > > >(
+        std::forward< Executor >(exec),
+        std::forward< Handler >(handler),
+        std::move(work));
 }
 
 }   // namespace boost::channels::detail
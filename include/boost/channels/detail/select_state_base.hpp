@@ -12,6 +12,8 @@
 
 #include <boost/channels/concepts/std_lockable.hpp>
 #include <boost/channels/config.hpp>
+#include <boost/channels/detail/completion_state.hpp>
+#include <boost/channels/detail/select_branch.hpp>
 #include <boost/channels/error_code.hpp>
 
 #include <tuple>
@@ -20,68 +22,65 @@ namespace boost::channels::detail {
 
 /// @brief The base class of any shared_select_handler_state.
 ///
-/// The shared_select_handler_state holds the mutex, completion state and
-/// completion handler for any select_like operation. That is, any set of
-/// asynchronous operations only one of which is allowed to complete.
-/// @tparam Mutex is the type of mutex used internally to prevent concurrent
-/// completion by more than one simultaneous operation.
+/// The shared_select_handler_state holds the completion state and completion
+/// handler for any select_like operation. That is, any set of asynchronous
+/// operations only one of which is allowed to complete. Every branch of the
+/// select shares the completion state, so claiming any one branch claims them
+/// all. Each branch also registers itself with the select, so that the
+/// branches which lose can be removed from their channels once the select
+/// has completed.
+/// @tparam Mutex is the mutex type of the channels taking part in the select.
+/// It forms part of the type only; the shared state is not locked.
 /// @note In any set of simultaneous operations, all operations must use the
 /// same mutex type. This is enforced at compile time.
 template < concepts::Lockable Mutex >
 struct select_state_base
 {
-    /// @brief The type of mutex managing this shared state
+    /// @brief The type of mutex of the channels taking part in the select
     using mutex_type = Mutex;
 
     /// @brief The value type of the shared select state. This matches the
     /// concept @see concepts::select_handler
     using value_type = std::tuple< error_code, int >;
 
-    /// @brief Get a mutable reference to the mutex guarding this shared state
-    /// @return a reference to the mutex
-    mutex_type &
-    get_mutex()
+    /// @brief The completion state shared by all branches of the select.
+    completion_state &
+    state()
     {
-        return mutex_;
+        return state_;
     }
 
-    /// @brief Return the completd flag for the shared state.
+    /// @brief The branches of the select which are parked in channels.
+    select_branch_set &
+    branches()
+    {
+        return branches_;
+    }
+
+    /// @brief Return the completed flag for the shared state.
     ///
-    /// @note This function must only be called while the mutex is locked.
     /// @return true if the operation has completed, false if it is yet to
     /// complete.
     bool
     completed() const
     {
-        return completed_;
+        return state_.completed();
     }
 
     /// @brief Cause the shared state to complete.
     ///
-    /// @note This function must only be called while the lock is held.
-    /// @note The intention is that the derived class will:
-    /// - Move the protected member handler_ into a local variable
-    /// - call @see set_complete in order to inform this object that it has
-    /// completed, and finally:
-    /// - invoke the moved handler passig the supplied value argument.
+    /// @note This function must only be called while the state is claimed.
+    /// The caller commits the state afterwards. The derived class takes the
+    /// registered branches and unlinks them from their channels before
+    /// invoking the handler, which must happen outside of any channel's
+    /// mutex.
     /// @param value The value with which to invoke the handler.
     virtual void
     complete(value_type value) = 0;
 
-  protected:
-    /// @brief Called by the derived class prior to invoking the moved handler.
-    ///
-    /// @see complete
-    void
-    set_completed()
-    {
-        BOOST_CHANNELS_ASSERT(!completed_);
-        completed_ = true;
-    }
-
   private:
-    Mutex mutex_;
-    bool  completed_ = false;
+    completion_state  state_;
+    select_branch_set branches_;
 };
 
 }   // namespace boost::channels::detail
@@ -12,66 +12,97 @@
 
 #include <boost/channels/concepts/std_lockable.hpp>
 #include <boost/channels/detail/consume_op_interface.hpp>
+#include <boost/channels/detail/select_branch.hpp>
 #include <boost/channels/detail/select_state_base.hpp>
 
+#include <memory>
+
 namespace boost::channels::detail {
-template < class ValueType, concepts::Lockable Mutex >
+/// @brief Models the state of an asynchronous consume operation occuring in a
+/// first-past-the-post operation on a set of channels, such as during @see
+/// select.
+/// @tparam ValueType is the type of value being consumed from the associated
+/// channel
+/// @tparam Channel is the channel implementation the op is submitted to
+template < class ValueType, concepts::Lockable Mutex, class Channel >
 struct shared_consume_op final
 : detail::basic_consume_op_interface< ValueType, Mutex >
+, select_branch
 {
-    using value_type =
-        typename detail::basic_consume_op_interface< ValueType,
-                                                     Mutex >::value_type;
-
-    using mutex_type =
-        typename detail::basic_consume_op_interface< ValueType,
-                                                     Mutex >::mutex_type;
+    using interface_type =
+        detail::basic_consume_op_interface< ValueType, Mutex >;
+    using value_type = typename interface_type::value_type;
+    using mutex_type = typename interface_type::mutex_type;
 
     shared_consume_op(
         std::shared_ptr< detail::select_state_base< Mutex > > sbase,
+        std::weak_ptr< Channel >                              channel,
         std::reference_wrapper< ValueType >                   sink,
         int                                                   which)
-    : sbase_(std::move(sbase))
+    : interface_type(this, &sbase->state())
+    , select_branch { &unlink_branch, &release_branch }
+    , sbase_(std::move(sbase))
+    , channel_(std::move(channel))
     , sink_(sink)
     , which_(which)
     {
     }
 
+    void
+    commit(value_type &&value)
+    {
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        sink_.get() = std::move(get< 1 >(std::move(value)));
+        sbase_->complete(std::make_tuple(get< 0 >(value), which_));
+    }
+
+    /// @brief Register the op with its select, which then holds a reference
+    /// to it until the select completes.
+    /// @return false if the select has already completed.
     bool
-    completed() const override
+    link_to_select()
     {
-        return sbase_->completed();
+        intrusive_ptr_add_ref(this);
+        if (sbase_->branches().add(*this))
+            return true;
+        intrusive_ptr_release(this);
+        return false;
     }
 
-    void
-    commit(value_type &&value) override
+  private:
+    static void
+    unlink_branch(select_branch *b) noexcept
     {
-        BOOST_CHANNELS_ASSERT(!sbase_->completed());
-        sink_.get() = std::move(get< 1 >(std::move(value)));
-        sbase_->complete(std::make_tuple(get< 0 >(value), which_));
-        BOOST_CHANNELS_ASSERT(sbase_->completed());
+        auto self = static_cast< shared_consume_op * >(b);
+        if (auto channel = self->channel_.lock())
+            channel->cancel_consume_op(*self);
     }
 
-    mutex_type &
-    get_mutex() override
+    static void
+    release_branch(select_branch *b) noexcept
     {
-        return sbase_->get_mutex();
+        intrusive_ptr_release(static_cast< shared_consume_op * >(b));
     }
 
     std::shared_ptr< detail::select_state_base< Mutex > > sbase_;
+    std::weak_ptr< Channel >                              channel_;
     std::reference_wrapper< ValueType >                   sink_;
     int                                                   which_;
 };
 
-template < class ValueType, concepts::Lockable Mutex >
+template < class ValueType, concepts::Lockable Mutex, class Channel >
 auto
 make_shared_consume_op(
     std::shared_ptr< detail::select_state_base< Mutex > > sbase,
+    std::shared_ptr< Channel > const                     &channel,
     std::reference_wrapper< ValueType >                   sink,
-    int which) -> std::shared_ptr< shared_consume_op< ValueType, Mutex > >
+    int                                                   which)
+    -> boost::intrusive_ptr< shared_consume_op< ValueType, Mutex, Channel > >
 {
-    return std::make_shared< shared_consume_op< ValueType, Mutex > >(
-        std::move(sbase), sink, which);
+    return boost::intrusive_ptr<
+        shared_consume_op< ValueType, Mutex, Channel > >(
+        new shared_consume_op< ValueType, Mutex, Channel >(
+            std::move(sbase), channel, sink, which));
 }
 
 }   // namespace boost::channels::detail
@@ -12,74 +12,113 @@
 
 #include <boost/channels/concepts/std_lockable.hpp>
 #include <boost/channels/detail/produce_op_interface.hpp>
+#include <boost/channels/detail/select_branch.hpp>
 #include <boost/channels/detail/select_state_base.hpp>
 
+#include <memory>
+
 namespace boost::channels::detail {
 /// @brief Models the state of an asynchronous produce operation occuring in a
 /// first-past-the-post operation on a set of channels, such as during @see
 /// select.
 /// @tparam ValueType is the type of value being produced to the associated
 /// channel
-template < class ValueType, concepts::Lockable Mutex >
-struct shared_produce_op
+/// @tparam Channel is the channel implementation the op is submitted to
+template < class ValueType, concepts::Lockable Mutex, class Channel >
+struct shared_produce_op final
 : detail::basic_produce_op_interface< ValueType, Mutex >
+, select_branch
 {
-    using mutex_type =
-        typename detail::basic_produce_op_interface< ValueType,
-                                                     Mutex >::mutex_type;
+    using interface_type =
+        detail::basic_produce_op_interface< ValueType, Mutex >;
+    using mutex_type = typename interface_type::mutex_type;
 
     shared_produce_op(
         std::shared_ptr< detail::select_state_base< Mutex > > sbase,
-        std::reference_wrapper< ValueType >                          source,
-        int                                                          which)
-    : sbase_(std::move(sbase))
+        std::weak_ptr< Channel >                              channel,
+        std::reference_wrapper< ValueType >                   source,
+        int                                                   which)
+    : interface_type(this, &sbase->state())
+    , select_branch { &unlink_branch, &release_branch }
+    , sbase_(std::move(sbase))
+    , channel_(std::move(channel))
     , source_(source)
     , which_(which)
     {
     }
 
-    bool
-    completed() const override
-    {
-        return sbase_->completed();
-    }
-    mutex_type &
-    get_mutex() override
-    {
-        return sbase_->get_mutex();
-    }
     ValueType
-    consume() override
+    consume()
     {
-        BOOST_CHANNELS_ASSERT(!sbase_->completed());
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
         auto v = std::move(source_.get());
         sbase_->complete(std::make_tuple(error_code(), which_));
-        BOOST_CHANNELS_ASSERT(sbase_->completed());
         return v;
     }
 
+    template < class F >
+    void
+    lend(F &&f)
+    {
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        f(source_.get());
+        sbase_->complete(std::make_tuple(error_code(), which_));
+    }
+
     void
-    fail(error_code ec) override
+    fail(error_code ec)
     {
-        BOOST_CHANNELS_ASSERT(!sbase_->completed());
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
         sbase_->complete(std::make_tuple(ec, which_));
-        BOOST_CHANNELS_ASSERT(sbase_->completed());
+    }
+
+    /// @brief Register the op with its select, which then holds a reference
+    /// to it until the select completes.
+    /// @return false if the select has already completed.
+    bool
+    link_to_select()
+    {
+        intrusive_ptr_add_ref(this);
+        if (sbase_->branches().add(*this))
+            return true;
+        intrusive_ptr_release(this);
+        return false;
+    }
+
+  private:
+    static void
+    unlink_branch(select_branch *b) noexcept
+    {
+        auto self = static_cast< shared_produce_op * >(b);
+        if (auto channel = self->channel_.lock())
+            channel->cancel_produce_op(*self);
+    }
+
+    static void
+    release_branch(select_branch *b) noexcept
+    {
+        intrusive_ptr_release(static_cast< shared_produce_op * >(b));
     }
 
     std::shared_ptr< detail::select_state_base< Mutex > > sbase_;
-    std::reference_wrapper< ValueType >                          source_;
-    int                                                          which_;
+    std::weak_ptr< Channel >                              channel_;
+    std::reference_wrapper< ValueType >                   source_;
+    int                                                   which_;
 };
 
-template < class ValueType, concepts::Lockable Mutex >
+template < class ValueType, concepts::Lockable Mutex, class Channel >
 auto
 make_shared_produce_op(
     std::shared_ptr< detail::select_state_base< Mutex > > sbase,
-    std::reference_wrapper< ValueType >                          source,
-    int which) -> std::shared_ptr< shared_produce_op< ValueType, Mutex > >
+    std::shared_ptr< Channel > const                     &channel,
+    std::reference_wrapper< ValueType >                   source,
+    int                                                   which)
+    -> boost::intrusive_ptr< shared_produce_op< ValueType, Mutex, Channel > >
 {
-    return std::make_shared< shared_produce_op< ValueType, Mutex > >(
-        std::move(sbase), source, which);
+    return boost::intrusive_ptr<
+        shared_produce_op< ValueType, Mutex, Channel > >(
+        new shared_produce_op< ValueType, Mutex, Channel >(
+            std::move(sbase), channel, source, which));
 }
 
 }   // namespace boost::channels::detail
@@ -0,0 +1,171 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SLOT_CLAIM_OP_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SLOT_CLAIM_OP_HPP
+
+#include <boost/channels/config.hpp>
+#include <boost/channels/detail/allocate_op.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
+#include <boost/channels/detail/postit.hpp>
+#include <boost/channels/detail/produce_op_interface.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+#include <boost/channels/send_slot.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/post.hpp>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief A producer op which claims a slot in the channel's buffer
+///
+/// The op waits in the producer queue, so a claim is ordered with respect to
+/// sends. When it reaches the front and the buffer has space, the slot is
+/// reserved and the handler is completed with a send_slot which owns it.
+/// Within a completion_scope the handler and the slot stay in the op until the
+/// scope ends.
+///
+/// The op keeps its executor's context running as consumer_op_function does.
+/// @tparam ValueType
+/// @tparam Mutex
+/// @tparam Executor is the executor on which the handler will be invoked
+/// @tparam Handler A function object with signature void(error_code,
+/// send_slot< ValueType, Mutex >)
+///
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Executor,
+           class Handler >
+struct slot_claim_op final
+: detail::basic_produce_op_interface< ValueType, Mutex >
+{
+    using interface_type = detail::basic_produce_op_interface< ValueType, Mutex >;
+    using slot_type      = send_slot< ValueType, Mutex >;
+    using impl_type      = typename slot_type::impl_type;
+    using allocator_type = asio::associated_allocator_t< Handler >;
+
+    template < class HandlerArg >
+    slot_claim_op(std::weak_ptr< impl_type > impl,
+                  Executor                   exec,
+                  HandlerArg               &&handler,
+                  counted_work< Mutex >      work = {})
+    : interface_type(this)
+    , impl_(std::move(impl))
+    , exec_(std::move(exec))
+    , handler_(std::forward< HandlerArg >(handler))
+    , work_(std::move(work))
+    , alloc_(asio::get_associated_allocator(handler_))
+    {
+    }
+
+    void
+    grant(void *slot)
+    {
+        // the channel is flushing its queues, so it is alive
+        auto impl = impl_.lock();
+        BOOST_CHANNELS_ASSERT(impl);
+        complete(error_code(), slot_type(std::move(impl), slot));
+    }
+
+    void
+    fail(error_code ec)
+    {
+        complete(ec, slot_type());
+    }
+
+    static void
+    destroy(slot_claim_op *self) noexcept
+    {
+        auto alloc = self->alloc_;
+        deallocate_op(alloc, self);
+    }
+
+  private:
+    void
+    complete(error_code ec, slot_type slot)
+    {
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        if (auto scope = completion_scope::current())
+        {
+            result_ = ec;
+            slot_   = std::move(slot);
+            intrusive_ptr_add_ref(this);
+            scope->defer(this, &fire, exec_);
+        }
+        else
+            invoke(ec, std::move(slot), fire_mode::post);
+    }
+
+    static void
+    fire(void *p, fire_mode mode)
+    {
+        auto self = boost::intrusive_ptr< slot_claim_op >(
+            static_cast< slot_claim_op * >(p), false);
+        if (mode != fire_mode::discard)
+            self->invoke(self->result_, std::move(self->slot_), mode);
+    }
+
+    void
+    invoke(error_code ec, slot_type slot, fire_mode mode)
+    {
+        auto work = std::move(work_);
+        auto exec = std::move(exec_);
+        auto f =
+            handler_bound_to_args(std::move(handler_), ec, std::move(slot));
+        if (mode == fire_mode::invoke)
+            f();
+        else if (mode == fire_mode::dispatch)
+            dispatch_or_post(exec, std::move(f));
+        else
+            asio::post(exec, std::move(f));
+    }
+
+    std::weak_ptr< impl_type > impl_;
+    Executor                   exec_;
+    Handler                    handler_;
+    counted_work< Mutex >      work_;
+
+    /// The outcome completed with within a completion_scope
+    error_code result_;
+    slot_type  slot_;
+
+    [[no_unique_address]] allocator_type alloc_;
+};
+
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Impl,
+           class Executor,
+           class Handler >
+auto
+make_slot_claim_op(std::weak_ptr< Impl > impl,
+                   Executor            &&exec,
+                   Handler             &&handler,
+                   counted_work< Mutex > work = {})
+{
+    using type = slot_claim_op< ValueType,
+                                Mutex,
+                                std::decay_t< Executor >,
+                                std::decay_t< Handler > >;
+    auto alloc = asio::get_associated_allocator(handler);
+    return boost::intrusive_ptr< type >(
+        allocate_op< type >(alloc,
+                            std::move(impl),
+                            std::forward< Executor >(exec),
+                            std::forward< Handler >(handler),
+                            std::move(work)));
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SLOT_CLAIM_OP_HPP
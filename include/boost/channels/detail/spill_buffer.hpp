@@ -0,0 +1,405 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SPILL_BUFFER_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SPILL_BUFFER_HPP
+
+#include <boost/channels/config.hpp>
+
+#ifdef BOOST_CHANNELS_HAS_SPILL
+
+#include <boost/channels/detail/value_buffer.hpp>
+#include <boost/channels/error_code.hpp>
+#include <boost/channels/spill_options.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace boost::channels::detail {
+
+/// @brief A memory-mapped spill file.
+///
+/// The file is unlinked as soon as it is created, so it never outlives the
+/// mapping, even if the process does not exit cleanly.
+struct spill_segment
+{
+    spill_segment *next = nullptr;
+    char          *base = nullptr;
+};
+
+/// @brief Control block of the buffer used by concurrency::spill.
+///
+/// The in-memory ring is used while nothing has been spilled. Once it is
+/// full, values are appended to a list of spill segments and are read back
+/// once the ring has drained. While any value is spilled, new values are
+/// also spilled, so the ring only ever holds values older than those in the
+/// segments.
+///
+/// Creating a segment takes several system calls, so it is never done under
+/// the channel's mutex. Values are only spilled into a spare segment, which
+/// was mapped ahead of time. Taking the spare, or finding none, asks for the
+/// next one. The channel then maps it after unlocking, through
+/// start_mapping(), map_segment() and finish_mapping().
+///
+/// Segments which have been consumed are released, apart from one which is
+/// kept as the spare. Live and spare segments together never exceed
+/// max_spill_size.
+struct spill_buffer_data : value_buffer_data
+{
+    explicit spill_buffer_data(std::size_t   capacity,
+                               spill_options options = {})
+    : value_buffer_data(capacity)
+    , options(std::move(options))
+    {
+        if (this->options.directory.empty())
+            this->options.directory = std::filesystem::temp_directory_path();
+    }
+
+    spill_buffer_data(spill_buffer_data const &) = delete;
+
+    spill_buffer_data &
+    operator=(spill_buffer_data const &) = delete;
+
+    ~spill_buffer_data()
+    {
+        release_segments();
+    }
+
+    /// @brief The number of segments which may exist at once.
+    std::size_t
+    max_segments() const
+    {
+        if (!options.segment_size)
+            return 0;
+        return options.max_spill_size / options.segment_size;
+    }
+
+    /// @brief Take the spare segment, and ask for the next one to be mapped
+    /// if the limit allows.
+    /// @return nullptr if there is no spare segment.
+    spill_segment *
+    acquire_segment()
+    {
+        wanted.store(segments < max_segments(), std::memory_order_relaxed);
+        if (auto s = std::exchange(spare, nullptr))
+        {
+            s->next = nullptr;
+            return s;
+        }
+        return nullptr;
+    }
+
+    /// @brief Take the right to map the segment which has been asked for.
+    ///
+    /// Only one segment is mapped at a time.
+    /// @return true if the caller is to call map_segment() without the lock
+    /// and then finish_mapping() with it.
+    bool
+    start_mapping()
+    {
+        if (!wanted.load(std::memory_order_relaxed) || mapping || spare ||
+            segments == max_segments())
+            return false;
+        wanted.store(false, std::memory_order_relaxed);
+        mapping = true;
+        return true;
+    }
+
+    /// @brief Create a segment. Only reads the options, which do not change,
+    /// so it is called without the lock.
+    /// @param ec is set to the reason if no segment could be created
+    /// @return nullptr on failure
+    spill_segment *
+    map_segment(error_code &ec) const
+    {
+        auto name = "boost_channels_spill_XXXXXX";
+        auto path = (options.directory / name).string();
+        auto fd   = ::mkstemp(path.data());
+        if (fd < 0)
+        {
+            ec = error_code(errno, system::system_category());
+            return nullptr;
+        }
+        ::unlink(path.c_str());
+
+        void *base = MAP_FAILED;
+        if (::ftruncate(fd, off_t(options.segment_size)) == 0)
+            base = ::mmap(nullptr,
+                          options.segment_size,
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED,
+                          fd,
+                          0);
+        if (base == MAP_FAILED)
+            ec = error_code(errno, system::system_category());
+        ::close(fd);
+        if (base == MAP_FAILED)
+            return nullptr;
+
+        auto s = new (std::nothrow) spill_segment;
+        if (!s)
+        {
+            ::munmap(base, options.segment_size);
+            ec = error_code(ENOMEM, system::system_category());
+            return nullptr;
+        }
+        s->base = static_cast< char * >(base);
+        return s;
+    }
+
+    /// @brief Keep the segment created by map_segment() as the spare, or
+    /// record why none was created.
+    /// @return true if there is now a spare segment.
+    bool
+    finish_mapping(spill_segment *s, error_code const &ec)
+    {
+        mapping = false;
+        if (!s)
+        {
+            error = ec;
+            return false;
+        }
+        error.clear();
+        ++segments;
+        spare = s;
+        return true;
+    }
+
+    /// @brief Keep a consumed segment as the spare, or release it.
+    void
+    recycle_segment(spill_segment *s) noexcept
+    {
+        if (spare)
+        {
+            unmap_segment(s);
+            --segments;
+        }
+        else
+            spare = s;
+    }
+
+    void
+    release_segments() noexcept
+    {
+        while (auto s = head_segment)
+        {
+            head_segment = s->next;
+            unmap_segment(s);
+        }
+        tail_segment = nullptr;
+        if (auto s = std::exchange(spare, nullptr))
+            unmap_segment(s);
+        segments = 0;
+    }
+
+    spill_options options;
+
+    /// The segment holding the oldest spilled value.
+    spill_segment *head_segment = nullptr;
+
+    /// The segment into which values are being spilled.
+    spill_segment *tail_segment = nullptr;
+
+    /// Index of the next value to be read back in head_segment.
+    std::size_t spill_head = 0;
+
+    /// Index of the next value to be spilled in tail_segment.
+    std::size_t spill_tail = 0;
+
+    /// The number of values spilled and not yet read back.
+    std::size_t spilled = 0;
+
+    /// A segment ready to be spilled into.
+    spill_segment *spare = nullptr;
+
+    /// The number of segments mapped, including the spare.
+    std::size_t segments = 0;
+
+    /// A spare segment has been asked for. Written under the channel's
+    /// mutex, and read without it to skip grow_spill when nothing is needed.
+    std::atomic< bool > wanted { false };
+
+    /// A thread is mapping the spare segment.
+    bool mapping = false;
+
+    /// The reason the last attempt to create a segment failed. Cleared once
+    /// a segment is created.
+    error_code error;
+
+  private:
+    void
+    unmap_segment(spill_segment *s) noexcept
+    {
+        ::munmap(s->base, options.segment_size);
+        delete s;
+    }
+};
+
+template < class ValueType >
+struct spill_buffer_ref
+{
+    static_assert(std::is_trivially_copyable_v< ValueType >,
+                  "Only trivially copyable values may be spilled to disk");
+
+    using ring_type = value_buffer_ref< ValueType >;
+    using slot_type = typename ring_type::slot_type;
+
+    spill_buffer_data *pdata;
+    slot_type         *storage;
+
+    /// @brief The number of values held by each segment.
+    std::size_t
+    segment_values() const
+    {
+        return pdata->options.segment_size / sizeof(ValueType);
+    }
+
+    std::size_t
+    size() const
+    {
+        return ring().size() + pdata->spilled;
+    }
+
+    /// @brief The number of values the ring and the spill files can hold.
+    std::size_t
+    capacity() const
+    {
+        return ring().capacity() + pdata->max_segments() * segment_values();
+    }
+
+    bool
+    empty() const
+    {
+        return size() == 0;
+    }
+
+    void
+    init()
+    {
+        ring().init();
+    }
+
+    /// @brief The buffer never reserves slots.
+    bool
+    reserved() const
+    {
+        return false;
+    }
+
+    void *
+    try_reserve()
+    {
+        return nullptr;
+    }
+
+    /// @brief Construct a value at the back of the buffer from make(), in
+    /// the ring if nothing is spilled, otherwise in a spill segment.
+    /// @return false if the ring is full and no spill segment is ready, in
+    /// which case make is not called.
+    template < class F >
+    bool
+    try_push_with(F &&make)
+    {
+        if (!pdata->spilled && ring().try_push_with(make))
+            return true;
+
+        auto n = segment_values();
+        if (pdata->tail_segment && pdata->spill_tail != n)
+        {
+            new (slot(pdata->tail_segment, pdata->spill_tail))
+                ValueType(make());
+            ++pdata->spill_tail;
+        }
+        else
+        {
+            if (!n)
+                return false;
+            auto s = pdata->acquire_segment();
+            if (!s)
+                return false;
+            new (slot(s, 0)) ValueType(make());
+            if (pdata->tail_segment)
+                pdata->tail_segment->next = s;
+            else
+                pdata->head_segment = s;
+            pdata->tail_segment = s;
+            pdata->spill_tail   = 1;
+        }
+        ++pdata->spilled;
+        return true;
+    }
+
+    /// @brief Pass the oldest value to sink as an rvalue and pop it, if there
+    /// is one.
+    /// @return false if the buffer was empty, in which case sink is not called.
+    template < class F >
+    bool
+    try_pop_with(F &&sink)
+    {
+        if (ring().try_pop_with(sink))
+            return true;
+        if (!pdata->spilled)
+            return false;
+
+        sink(std::move(*slot(pdata->head_segment, pdata->spill_head)));
+        ++pdata->spill_head;
+        if (--pdata->spilled == 0)
+        {
+            // the last segment is reused from its start
+            pdata->spill_head = 0;
+            pdata->spill_tail = 0;
+        }
+        else if (pdata->spill_head == segment_values())
+        {
+            auto s              = pdata->head_segment;
+            pdata->head_segment = s->next;
+            pdata->spill_head   = 0;
+            pdata->recycle_segment(s);
+        }
+        return true;
+    }
+
+    void
+    destroy()
+    {
+        ring().destroy();
+        pdata->spilled    = 0;
+        pdata->spill_head = 0;
+        pdata->spill_tail = 0;
+        pdata->release_segments();
+    }
+
+  private:
+    ring_type
+    ring() const
+    {
+        return ring_type { pdata, storage };
+    }
+
+    static ValueType *
+    slot(spill_segment *s, std::size_t i)
+    {
+        return reinterpret_cast< ValueType * >(s->base) + i;
+    }
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_HAS_SPILL
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SPILL_BUFFER_HPP
@@ -0,0 +1,207 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SPSC_RING_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SPSC_RING_HPP
+
+#include <boost/channels/config.hpp>
+#include <boost/channels/detail/ring_index.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief Control block of a wait-free single producer, single consumer ring.
+///
+/// head and tail are positions as described by ring_index. Each is written by
+/// only one side and they are kept on separate cache lines.
+struct spsc_ring_data : ring_index
+{
+    explicit spsc_ring_data(std::size_t capacity) noexcept
+    : ring_index(capacity)
+    {
+    }
+
+    char pad0_[BOOST_CHANNELS_CACHELINE_SIZE];
+
+    /// Position of the next value to be consumed. Written by the consumer.
+    std::atomic< std::size_t > head { 0 };
+
+    char pad1_[BOOST_CHANNELS_CACHELINE_SIZE];
+
+    /// Position of the next slot to be produced. Written by the producer.
+    std::atomic< std::size_t > tail { 0 };
+
+    char pad2_[BOOST_CHANNELS_CACHELINE_SIZE];
+};
+
+/// @brief A view of an spsc_ring_data and its value storage.
+///
+/// Models the same interface as value_buffer_ref so that it can be driven by
+/// the flush algorithms while the channel mutex is held. The try_ functions
+/// may be called without the mutex, provided that at most one thread is
+/// acting on each side of the ring.
+template < class ValueType >
+struct spsc_ring_ref
+{
+    using slot_type = std::aligned_storage_t< sizeof(ValueType) >;
+
+    spsc_ring_data *pdata;
+    slot_type      *storage;
+
+    ValueType *
+    mem() const
+    {
+        return reinterpret_cast< ValueType * >(storage);
+    }
+
+    ValueType *
+    slot(std::size_t pos) const
+    {
+        BOOST_CHANNELS_ASSERT(mem());
+        return mem() + pdata->slot_of(pos);
+    }
+
+    std::size_t
+    size() const
+    {
+        // head must be read first so that the result can never be negative
+        auto h = pdata->head.load(std::memory_order_acquire);
+        auto t = pdata->tail.load(std::memory_order_acquire);
+        return pdata->distance(h, t);
+    }
+
+    std::size_t
+    capacity() const
+    {
+        return pdata->capacity;
+    }
+
+    bool
+    empty() const
+    {
+        return size() == 0;
+    }
+
+    /// @pre called from the consumer side
+    ValueType &
+    front()
+    {
+        BOOST_CHANNELS_ASSERT(!empty());
+        return *slot(pdata->head.load(std::memory_order_relaxed));
+    }
+
+    /// @pre called from the consumer side
+    void
+    pop()
+    {
+        BOOST_CHANNELS_ASSERT(!empty());
+        auto h = pdata->head.load(std::memory_order_relaxed);
+        slot(h)->~ValueType();
+        pdata->head.store(pdata->advance(h), std::memory_order_release);
+    }
+
+    /// @pre called from the producer side
+    void
+    push(ValueType &&v)
+    {
+        BOOST_CHANNELS_ASSERT(size() < capacity());
+        auto t = pdata->tail.load(std::memory_order_relaxed);
+        new (slot(t)) ValueType(std::move(v));
+        pdata->tail.store(pdata->advance(t), std::memory_order_release);
+    }
+
+    void
+    init()
+    {
+    }
+
+    /// @brief Construct a value at the tail of the ring from make(), if there
+    /// is space.
+    /// @pre called from the producer side
+    /// @return false if the ring was full, in which case make is not called.
+    template < class F >
+    bool
+    try_push_with(F &&make)
+    {
+        auto t = pdata->tail.load(std::memory_order_relaxed);
+        auto h = pdata->head.load(std::memory_order_acquire);
+        if (pdata->distance(h, t) == pdata->capacity)
+            return false;
+        new (slot(t)) ValueType(make());
+        pdata->tail.store(pdata->advance(t), std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Pass the value at the head of the ring to sink as an rvalue and
+    /// release its slot, if there is one.
+    /// @pre called from the consumer side
+    /// @return false if the ring was empty, in which case sink is not called.
+    template < class F >
+    bool
+    try_pop_with(F &&sink)
+    {
+        auto h = pdata->head.load(std::memory_order_relaxed);
+        if (pdata->tail.load(std::memory_order_acquire) == h)
+            return false;
+        auto p = slot(h);
+        sink(std::move(*p));
+        p->~ValueType();
+        pdata->head.store(pdata->advance(h), std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Slots are never reserved in a lock-free ring, because values
+    /// are pushed without the channel's mutex.
+    bool
+    reserved() const
+    {
+        return false;
+    }
+
+    void *
+    try_reserve()
+    {
+        return nullptr;
+    }
+
+    /// @brief Move v into the ring if there is space.
+    /// @return true if v was moved into the ring, otherwise v is untouched.
+    bool
+    try_push(ValueType &v)
+    {
+        return try_push_with([&]() -> ValueType && { return std::move(v); });
+    }
+
+    /// @brief Take the value at the head of the ring, if there is one.
+    std::optional< ValueType >
+    try_pop()
+    {
+        std::optional< ValueType > result;
+        try_pop_with([&](ValueType &&v) { result.emplace(std::move(v)); });
+        return result;
+    }
+
+    void
+    destroy()
+    {
+        if (mem())
+            while (!empty())
+                pop();
+    }
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_SPSC_RING_HPP
@@ -0,0 +1,413 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_TIMED_OP_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_TIMED_OP_HPP
+
+#include <boost/channels/config.hpp>
+#include <boost/channels/detail/allocate_op.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
+#include <boost/channels/detail/consume_op_interface.hpp>
+#include <boost/channels/detail/postit.hpp>
+#include <boost/channels/detail/produce_op_interface.hpp>
+#include <boost/channels/detail/timer_service.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+#include <boost/channels/error_code.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/post.hpp>
+
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief Arm the deadline of a timed op, which holds a reference to itself
+/// while it is armed.
+/// @return false if the deadline could not be armed because the execution
+/// context is shutting down.
+template < class Op >
+bool
+arm_deadline(Op                                &op,
+             timer_service                     &service,
+             timer_service::clock_type::duration timeout,
+             asio::any_io_executor const       &exec)
+{
+    intrusive_ptr_add_ref(&op);
+    if (service.schedule(op, timeout, exec))
+        return true;
+    intrusive_ptr_release(&op);
+    return false;
+}
+
+/// @brief Disarm the deadline of a timed op which is being completed, and
+/// drop the reference held on its behalf.
+template < class Op >
+void
+disarm_deadline(Op &op, timer_service &service)
+{
+    // the caller holds a reference of its own
+    if (service.cancel(op))
+        intrusive_ptr_release(&op);
+}
+
+/// @brief A consumer op which completes with errors::timed_out if no value
+/// arrives before its deadline.
+///
+/// The op is a timer_node in the timer_service of its handler's execution
+/// context. Whichever of a value, a close or the deadline claims the op first
+/// completes it. A value or a close disarms the deadline. An expired deadline
+/// has the channel claim the op under its mutex and unlink it from the queue.
+/// Within a completion_scope the value is held in the op until the scope
+/// ends.
+///
+/// The op keeps its executor's context running as consumer_op_function does,
+/// and gives up its share on completion even though the timer_service may
+/// hold it a while longer.
+/// @tparam Impl is the channel implementation, which provides
+/// claim_consume_op()
+/// @tparam Executor is the executor on which the handler will be invoked
+/// @tparam Handler A function object with signature void(error_code,
+/// ValueType)
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Impl,
+           class Executor,
+           class Handler >
+struct timed_consumer_op final
+: detail::basic_consume_op_interface< ValueType, Mutex >
+, timer_node
+{
+    using interface_type =
+        detail::basic_consume_op_interface< ValueType, Mutex >;
+    using value_type     = typename interface_type::value_type;
+    using allocator_type = asio::associated_allocator_t< Handler >;
+
+    template < class HandlerArg >
+    timed_consumer_op(std::weak_ptr< Impl > impl,
+                      timer_service        &service,
+                      Executor              exec,
+                      HandlerArg          &&handler,
+                      counted_work< Mutex > work = {})
+    : interface_type(this)
+    , timer_node { .fire = &expire }
+    , impl_(std::move(impl))
+    , service_(service)
+    , exec_(std::move(exec))
+    , handler_(std::forward< HandlerArg >(handler))
+    , work_(std::move(work))
+    , alloc_(asio::get_associated_allocator(handler_))
+    {
+    }
+
+    void
+    commit(value_type &&val)
+    {
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        disarm_deadline(*this, service_);
+        auto &[ec, value] = val;
+        complete(ec, std::move(value));
+    }
+
+    static void
+    destroy(timed_consumer_op *self) noexcept
+    {
+        auto alloc = self->alloc_;
+        deallocate_op(alloc, self);
+    }
+
+  private:
+    static void
+    expire(timer_node *node, bool expired)
+    {
+        auto self = static_cast< timed_consumer_op * >(node);
+        if (expired && self->claim())
+        {
+            self->complete(errors::timed_out, ValueType());
+            self->state().commit();
+        }
+        intrusive_ptr_release(self);
+    }
+
+    // the channel, while it exists, claims the op under its mutex
+    bool
+    claim()
+    {
+        if (auto impl = impl_.lock())
+            return impl->claim_consume_op(*this);
+        return this->state().claim();
+    }
+
+    void
+    complete(error_code ec, ValueType &&value)
+    {
+        if (auto scope = completion_scope::current())
+        {
+            result_.emplace(ec, std::move(value));
+            intrusive_ptr_add_ref(this);
+            scope->defer(this, &fire, exec_);
+        }
+        else
+            invoke(ec, std::move(value), fire_mode::post);
+    }
+
+    static void
+    fire(void *p, fire_mode mode)
+    {
+        auto self = boost::intrusive_ptr< timed_consumer_op >(
+            static_cast< timed_consumer_op * >(p), false);
+        if (mode == fire_mode::discard)
+            return;
+        auto &[ec, value] = *self->result_;
+        self->invoke(ec, std::move(value), mode);
+    }
+
+    void
+    invoke(error_code ec, ValueType &&value, fire_mode mode)
+    {
+        auto work = std::move(work_);
+        auto exec = std::move(exec_);
+        auto f =
+            handler_bound_to_args(std::move(handler_), ec, std::move(value));
+        if (mode == fire_mode::invoke)
+            f();
+        else if (mode == fire_mode::dispatch)
+            dispatch_or_post(exec, std::move(f));
+        else
+            asio::post(exec, std::move(f));
+    }
+
+    std::weak_ptr< Impl > impl_;
+    timer_service        &service_;
+    Executor              exec_;
+    Handler               handler_;
+    counted_work< Mutex > work_;
+
+    /// The value committed within a completion_scope
+    std::optional< value_type > result_;
+
+    [[no_unique_address]] allocator_type alloc_;
+};
+
+/// @brief A producer op which completes with errors::timed_out if its value
+/// is not taken before its deadline.
+///
+/// The handler receives the value back if it was not sent, whether because
+/// the deadline passed or because the channel was closed. Within a
+/// completion_scope the value stays in the op until the scope ends. The op
+/// keeps its executor's context running as timed_consumer_op does.
+/// @tparam Impl is the channel implementation, which provides
+/// claim_produce_op()
+/// @tparam Executor is the executor on which the handler will be invoked
+/// @tparam Handler A function object with signature void(error_code,
+/// std::optional<ValueType>)
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Impl,
+           class Executor,
+           class Handler >
+struct timed_producer_op final
+: detail::basic_produce_op_interface< ValueType, Mutex >
+, timer_node
+{
+    using interface_type =
+        detail::basic_produce_op_interface< ValueType, Mutex >;
+    using value_type     = ValueType;
+    using allocator_type = asio::associated_allocator_t< Handler >;
+
+    template < class ValueArg, class HandlerArg >
+    timed_producer_op(ValueArg            &&value,
+                      std::weak_ptr< Impl > impl,
+                      timer_service        &service,
+                      Executor              exec,
+                      HandlerArg          &&handler,
+                      counted_work< Mutex > work = {})
+    : interface_type(this)
+    , timer_node { .fire = &expire }
+    , value_(std::forward< ValueArg >(value))
+    , impl_(std::move(impl))
+    , service_(service)
+    , exec_(std::move(exec))
+    , handler_(std::forward< HandlerArg >(handler))
+    , work_(std::move(work))
+    , alloc_(asio::get_associated_allocator(handler_))
+    {
+    }
+
+    value_type
+    consume()
+    {
+        disarm_deadline(*this, service_);
+        value_type result = std::move(value_);
+        complete(error_code(), false);
+        return result;
+    }
+
+    template < class F >
+    void
+    lend(F &&f)
+    {
+        disarm_deadline(*this, service_);
+        f(value_);
+        complete(error_code(), false);
+    }
+
+    void
+    fail(error_code ec)
+    {
+        disarm_deadline(*this, service_);
+        complete(ec, true);
+    }
+
+    static void
+    destroy(timed_producer_op *self) noexcept
+    {
+        auto alloc = self->alloc_;
+        deallocate_op(alloc, self);
+    }
+
+  private:
+    static void
+    expire(timer_node *node, bool expired)
+    {
+        auto self = static_cast< timed_producer_op * >(node);
+        if (expired && self->claim())
+        {
+            self->complete(errors::timed_out, true);
+            self->state().commit();
+        }
+        intrusive_ptr_release(self);
+    }
+
+    // the channel, while it exists, claims the op under its mutex
+    bool
+    claim()
+    {
+        if (auto impl = impl_.lock())
+            return impl->claim_produce_op(*this);
+        return this->state().claim();
+    }
+
+    /// @param unsent is true if the value is to be handed back
+    void
+    complete(error_code ec, bool unsent)
+    {
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        if (auto scope = completion_scope::current())
+        {
+            result_ = ec;
+            unsent_ = unsent;
+            intrusive_ptr_add_ref(this);
+            scope->defer(this, &fire, exec_);
+        }
+        else
+            invoke(ec, unsent, fire_mode::post);
+    }
+
+    static void
+    fire(void *p, fire_mode mode)
+    {
+        auto self = boost::intrusive_ptr< timed_producer_op >(
+            static_cast< timed_producer_op * >(p), false);
+        if (mode != fire_mode::discard)
+            self->invoke(self->result_, self->unsent_, mode);
+    }
+
+    void
+    invoke(error_code ec, bool unsent, fire_mode mode)
+    {
+        auto value = unsent ? std::optional< value_type >(std::move(value_))
+                            : std::nullopt;
+        auto work  = std::move(work_);
+        auto exec  = std::move(exec_);
+        auto f =
+            handler_bound_to_args(std::move(handler_), ec, std::move(value));
+        if (mode == fire_mode::invoke)
+            f();
+        else if (mode == fire_mode::dispatch)
+            dispatch_or_post(exec, std::move(f));
+        else
+            asio::post(exec, std::move(f));
+    }
+
+    value_type            value_;
+    std::weak_ptr< Impl > impl_;
+    timer_service        &service_;
+    Executor              exec_;
+    Handler               handler_;
+    counted_work< Mutex > work_;
+
+    /// The outcome completed with within a completion_scope
+    error_code result_;
+    bool       unsent_ = false;
+
+    [[no_unique_address]] allocator_type alloc_;
+};
+
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Impl,
+           class Executor,
+           class Handler >
+auto
+make_timed_consumer_op(std::weak_ptr< Impl > impl,
+                       timer_service        &service,
+                       Executor            &&exec,
+                       Handler             &&handler,
+                       counted_work< Mutex > work = {})
+{
+    using type = timed_consumer_op< ValueType,
+                                    Mutex,
+                                    Impl,
+                                    std::decay_t< Executor >,
+                                    std::decay_t< Handler > >;
+    auto alloc = asio::get_associated_allocator(handler);
+    return boost::intrusive_ptr< type >(
+        allocate_op< type >(alloc,
+                            std::move(impl),
+                            service,
+                            std::forward< Executor >(exec),
+                            std::forward< Handler >(handler),
+                            std::move(work)));
+}
+
+template < concepts::Lockable Mutex,
+           class ValueType,
+           class Impl,
+           class Executor,
+           class Handler >
+auto
+make_timed_producer_op(ValueType           &&value,
+                       std::weak_ptr< Impl > impl,
+                       timer_service        &service,
+                       Executor            &&exec,
+                       Handler             &&handler,
+                       counted_work< Mutex > work = {})
+{
+    using type = timed_producer_op< std::decay_t< ValueType >,
+                                    Mutex,
+                                    Impl,
+                                    std::decay_t< Executor >,
+                                    std::decay_t< Handler > >;
+    auto alloc = asio::get_associated_allocator(handler);
+    return boost::intrusive_ptr< type >(
+        allocate_op< type >(alloc,
+                            std::forward< ValueType >(value),
+                            std::move(impl),
+                            service,
+                            std::forward< Executor >(exec),
+                            std::forward< Handler >(handler),
+                            std::move(work)));
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_TIMED_OP_HPP
@@ -0,0 +1,210 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_TIMER_SERVICE_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_TIMER_SERVICE_HPP
+
+#include <boost/channels/config.hpp>
+#include <boost/channels/detail/timer_wheel.hpp>
+#include <boost/channels/error_code.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/execution/context.hpp>
+#include <boost/asio/execution_context.hpp>
+#include <boost/asio/query.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+namespace boost::channels::detail {
+
+/// @brief The deadlines of timed channel operations on one execution
+/// context.
+///
+/// Every deadline is a timer_node in a single timer_wheel, and the service
+/// keeps one steady_timer waiting for the earliest tick at which the wheel
+/// has work to do. Arming and cancelling a deadline therefore costs a list
+/// insertion or removal rather than a timer of its own. The steady_timer is
+/// cancelled whenever the wheel empties, so that a context with no pending
+/// deadlines has no outstanding work on their account.
+///
+/// Fire functions are called without the service's mutex held, on the
+/// executor of the first timed operation, or from shutdown().
+class timer_service : public asio::execution_context::service
+{
+  public:
+    using clock_type = std::chrono::steady_clock;
+    using key_type   = timer_service;
+
+    static inline asio::execution_context::id id;
+
+    /// @brief The service of the execution context of an executor.
+    template < class Executor >
+    static timer_service &
+    of(Executor const &exec)
+    {
+        return asio::use_service< timer_service >(
+            asio::query(exec, asio::execution::context));
+    }
+
+    explicit timer_service(asio::execution_context &ctx)
+    : asio::execution_context::service(ctx)
+    , origin_(clock_type::now())
+    {
+    }
+
+    /// @brief Arm a deadline.
+    /// @param node will have its fire function called once the deadline has
+    /// passed, unless it is cancelled first
+    /// @param timeout is rounded up to a whole number of ticks
+    /// @param exec is used for the steady_timer if there is none yet
+    /// @return false if the service has been shut down, in which case the
+    /// node is not armed.
+    /// @pre node is not armed
+    bool
+    schedule(timer_node                  &node,
+             clock_type::duration         timeout,
+             asio::any_io_executor const &exec)
+    {
+        auto lck = std::lock_guard(mutex_);
+        if (shut_down_)
+            return false;
+        if (!timer_)
+            timer_.emplace(exec);
+
+        auto now = clock_type::now();
+        // an idle wheel catches up at once, rather than tick by tick later
+        if (wheel_.empty())
+            wheel_.advance(ticks_by(now));
+        wheel_.insert(node, tick_at(now + timeout));
+        arm();
+        return true;
+    }
+
+    /// @brief Disarm a deadline.
+    /// @return true if the node was armed, in which case its fire function
+    /// will not be called.
+    bool
+    cancel(timer_node &node)
+    {
+        auto lck = std::lock_guard(mutex_);
+        if (!wheel_.remove(node))
+            return false;
+        arm();
+        return true;
+    }
+
+    void
+    shutdown() override
+    {
+        timer_node *all;
+        {
+            auto lck   = std::lock_guard(mutex_);
+            shut_down_ = true;
+            all        = wheel_.clear();
+            ++generation_;
+            timer_.reset();
+        }
+        fire_all(all, false);
+    }
+
+  private:
+    static constexpr auto tick_length =
+        std::chrono::microseconds(BOOST_CHANNELS_TIMER_TICK_US);
+
+    // the first tick which begins no earlier than t
+    std::uint64_t
+    tick_at(clock_type::time_point t) const
+    {
+        if (t <= origin_)
+            return 0;
+        auto ticks = (t - origin_ + tick_length - clock_type::duration(1)) /
+                     tick_length;
+        return static_cast< std::uint64_t >(ticks);
+    }
+
+    // the last tick which has begun by t
+    std::uint64_t
+    ticks_by(clock_type::time_point t) const
+    {
+        return static_cast< std::uint64_t >((t - origin_) / tick_length);
+    }
+
+    // wait for the next tick with work, if it is not already awaited
+    // pre: mutex_ is held
+    void
+    arm()
+    {
+        auto next = wheel_.next_tick();
+        if (!next)
+        {
+            if (armed_)
+            {
+                armed_ = false;
+                ++generation_;
+                timer_->cancel();
+            }
+            return;
+        }
+        if (armed_ && armed_tick_ <= *next)
+            return;
+
+        armed_      = true;
+        armed_tick_ = *next;
+        timer_->expires_at(origin_ +
+                           tick_length * static_cast< clock_type::rep >(*next));
+        timer_->async_wait(
+            [this, generation = ++generation_](error_code ec) {
+                on_timer(ec, generation);
+            });
+    }
+
+    void
+    on_timer(error_code ec, std::uint64_t generation)
+    {
+        timer_node *expired;
+        {
+            auto lck = std::lock_guard(mutex_);
+            if (ec || generation != generation_ || shut_down_)
+                return;
+            armed_  = false;
+            expired = wheel_.advance(ticks_by(clock_type::now()));
+            arm();
+        }
+        fire_all(expired, true);
+    }
+
+    static void
+    fire_all(timer_node *node, bool expired)
+    {
+        while (node)
+        {
+            auto next  = node->next;
+            node->next = nullptr;
+            node->fire(node, expired);
+            node = next;
+        }
+    }
+
+    std::mutex                          mutex_;
+    clock_type::time_point const        origin_;
+    timer_wheel                         wheel_;
+    std::optional< asio::steady_timer > timer_;
+    std::uint64_t                       armed_tick_ = 0;
+    std::uint64_t                       generation_ = 0;
+    bool                                armed_      = false;
+    bool                                shut_down_  = false;
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_TIMER_SERVICE_HPP
@@ -0,0 +1,249 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_TIMER_WHEEL_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_TIMER_WHEEL_HPP
+
+#include <boost/channels/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace boost::channels::detail {
+
+/// @brief A deadline which can be linked into a timer_wheel.
+///
+/// The node is embedded in the object which owns the deadline, so arming
+/// and cancelling a timer never allocates.
+struct timer_node
+{
+    /// @brief Called once the node has left the wheel without being
+    /// cancelled.
+    /// @param expired is true if the deadline passed, and false if the wheel
+    /// was shut down first.
+    void (*fire)(timer_node *, bool expired) = nullptr;
+
+    /// the tick at which the node expires
+    std::uint64_t when = 0;
+
+    timer_node  *next  = nullptr;
+    timer_node  *prev  = nullptr;
+    timer_node **owner = nullptr;
+};
+
+/// @brief A hierarchical timing wheel counted in ticks.
+///
+/// Level 0 has one slot per tick for the next 64 ticks, and each level above
+/// it has slots 64 times as wide. Inserting and removing a node is O(1). As
+/// time passes, the slot of a higher level whose span has been reached is
+/// cascaded: its nodes are redistributed into the levels below. Deadlines
+/// beyond the span of the top level wait in its furthest slot and are
+/// redistributed from there.
+///
+/// The wheel is not thread safe.
+class timer_wheel
+{
+  public:
+    static constexpr unsigned    level_bits = 6;
+    static constexpr std::size_t slots      = std::size_t(1) << level_bits;
+    static constexpr std::size_t levels     = 4;
+
+    explicit timer_wheel(std::uint64_t now = 0)
+    : now_(now)
+    {
+    }
+
+    timer_wheel(timer_wheel const &) = delete;
+
+    timer_wheel &
+    operator=(timer_wheel const &) = delete;
+
+    /// @brief The tick up to which the wheel has been advanced.
+    std::uint64_t
+    now() const
+    {
+        return now_;
+    }
+
+    bool
+    empty() const
+    {
+        return size_ == 0;
+    }
+
+    std::size_t
+    size() const
+    {
+        return size_;
+    }
+
+    /// @brief Link a node which is to expire at the given tick.
+    ///
+    /// A deadline which is not after now() expires at the next tick.
+    /// @pre the node is not linked
+    void
+    insert(timer_node &node, std::uint64_t when)
+    {
+        BOOST_CHANNELS_ASSERT(!node.owner);
+        node.when = when > now_ ? when : now_ + 1;
+        place(node);
+        ++size_;
+    }
+
+    /// @brief Unlink a node before it expires.
+    /// @return true if the node was linked.
+    bool
+    remove(timer_node &node)
+    {
+        if (!node.owner)
+            return false;
+        unlink(node);
+        --size_;
+        return true;
+    }
+
+    /// @brief Advance the wheel to the given tick.
+    /// @return the nodes which have expired, unlinked and chained through
+    /// their next pointers in order of expiry.
+    timer_node *
+    advance(std::uint64_t to)
+    {
+        timer_node  *expired = nullptr;
+        timer_node **tail    = &expired;
+
+        while (now_ < to)
+        {
+            if (size_ == 0)
+            {
+                now_ = to;
+                break;
+            }
+
+            ++now_;
+
+            // cascade each level whose span begins at this tick
+            auto t = now_;
+            for (std::size_t level = 1;
+                 level < levels && (t & (slots - 1)) == 0;
+                 ++level)
+            {
+                t >>= level_bits;
+                cascade(level, t & (slots - 1));
+            }
+
+            auto &slot = slots_[0][now_ & (slots - 1)];
+            while (auto node = slot)
+            {
+                unlink(*node);
+                --size_;
+                *tail = node;
+                tail  = &node->next;
+            }
+        }
+        return expired;
+    }
+
+    /// @brief The first tick at which advance() has work to do.
+    /// @return std::nullopt if the wheel is empty
+    std::optional< std::uint64_t >
+    next_tick() const
+    {
+        if (size_ == 0)
+            return std::nullopt;
+
+        bool const above = size_ != level_size_[0];
+        for (std::uint64_t t = now_ + 1;; ++t)
+        {
+            if (slots_[0][t & (slots - 1)] ||
+                (above && (t & (slots - 1)) == 0))
+                return t;
+        }
+    }
+
+    /// @brief Unlink every node.
+    /// @return the nodes, chained through their next pointers.
+    timer_node *
+    clear()
+    {
+        timer_node *all = nullptr;
+        for (auto &level : slots_)
+            for (auto &slot : level)
+                while (auto node = slot)
+                {
+                    unlink(*node);
+                    node->next = all;
+                    all        = node;
+                }
+        size_ = 0;
+        return all;
+    }
+
+  private:
+    void
+    place(timer_node &node)
+    {
+        auto delta = node.when - now_;
+
+        std::size_t level = 0;
+        while (level + 1 < levels &&
+               delta >= (std::uint64_t(1) << (level_bits * (level + 1))))
+            ++level;
+
+        // deadlines beyond the wheel wait in the top level's furthest slot
+        auto const span = std::uint64_t(1) << (level_bits * levels);
+        auto       at   = delta < span ? node.when : now_ + span - 1;
+
+        auto &head = slots_[level][(at >> (level_bits * level)) & (slots - 1)];
+        node.prev  = nullptr;
+        node.next  = head;
+        if (head)
+            head->prev = &node;
+        head       = &node;
+        node.owner = &head;
+        ++level_size_[level];
+    }
+
+    void
+    unlink(timer_node &node)
+    {
+        if (node.prev)
+            node.prev->next = node.next;
+        else
+            *node.owner = node.next;
+        if (node.next)
+            node.next->prev = node.prev;
+
+        auto pos   = std::size_t(node.owner - &slots_[0][0]);
+        --level_size_[pos / slots];
+        node.next  = nullptr;
+        node.prev  = nullptr;
+        node.owner = nullptr;
+    }
+
+    void
+    cascade(std::size_t level, std::size_t index)
+    {
+        auto &slot = slots_[level][index];
+        while (auto node = slot)
+        {
+            unlink(*node);
+            place(*node);
+        }
+    }
+
+    std::uint64_t now_;
+    std::size_t   size_ = 0;
+    std::size_t   level_size_[levels] {};
+    timer_node   *slots_[levels][slots] {};
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_TIMER_WHEEL_HPP
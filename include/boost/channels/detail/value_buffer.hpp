@@ -11,43 +11,56 @@
 #define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_VALUE_BUFFER_HPP
 
 #include <boost/channels/config.hpp>
+#include <boost/channels/detail/ring_index.hpp>
 
 #include <cstddef>
-
+#include <new>
 #include <type_traits>
+#include <utility>
 
 namespace boost::channels::detail {
-struct value_buffer_data
-{
-    std::size_t capacity = 0;
-    std::size_t begin    = 0;
-    std::size_t end      = 0;
-    std::size_t size     = 0;
 
-    void
-    reduce()
+/// @brief Control block of the ring used by channels which are serialised
+/// by their mutex.
+///
+/// head and tail are positions as described by ring_index. The consumer side
+/// and the producer side are kept on separate cache lines.
+struct value_buffer_data : ring_index
+{
+    explicit value_buffer_data(std::size_t capacity) noexcept
+    : ring_index(capacity)
+    , limit(capacity)
     {
-        BOOST_CHANNELS_ASSERT(size);
-        if (++begin == capacity)
-            begin = 0;
-        --size;
     }
 
-    void
-    increase()
-    {
-        BOOST_CHANNELS_ASSERT(size < capacity);
-        if (++end == capacity)
-            end = 0;
-        ++size;
-    }
+    char pad0_[BOOST_CHANNELS_CACHELINE_SIZE];
+
+    /// Position of the next value to be consumed.
+    std::size_t head = 0;
+
+    char pad1_[BOOST_CHANNELS_CACHELINE_SIZE];
+
+    /// Position of the next slot to be produced.
+    std::size_t tail = 0;
+
+    /// The number of values the ring accepts. Less than its capacity while
+    /// values beyond a reduced limit drain.
+    std::size_t limit;
+
+    /// Set while the slot at tail is reserved for a value which has not yet
+    /// been published.
+    bool reserved = false;
+
+    char pad2_[BOOST_CHANNELS_CACHELINE_SIZE];
 };
 
 template < class ValueType >
 struct value_buffer_ref
 {
-    value_buffer_data *                          pdata;
-    std::aligned_storage_t< sizeof(ValueType) > *storage;
+    using slot_type = std::aligned_storage_t< sizeof(ValueType) >;
+
+    value_buffer_data *pdata;
+    slot_type         *storage;
 
     ValueType *
     mem() const
@@ -55,61 +68,166 @@ struct value_buffer_ref
         return reinterpret_cast< ValueType * >(storage);
     }
 
+    ValueType *
+    slot(std::size_t pos) const
+    {
+        BOOST_CHANNELS_ASSERT(mem());
+        return mem() + pdata->slot_of(pos);
+    }
+
     std::size_t
     size() const
     {
-        return pdata->size;
+        return pdata->distance(pdata->head, pdata->tail);
     }
 
+    /// @brief The number of values the buffer accepts.
     std::size_t
     capacity() const
     {
-        return pdata->capacity;
+        return pdata->limit;
     }
 
     ValueType &
     front()
     {
-        BOOST_CHANNELS_ASSERT(mem());
-        return *(mem() + pdata->begin);
+        BOOST_CHANNELS_ASSERT(!empty());
+        return *slot(pdata->head);
     }
 
     bool
     empty() const
     {
-        return pdata->size == 0;
+        return pdata->tail == pdata->head;
     }
 
     void
     pop()
     {
-        BOOST_CHANNELS_ASSERT(mem());
-        BOOST_CHANNELS_ASSERT(pdata->size);
-        (mem() + pdata->begin)->~ValueType();
-        pdata->reduce();
+        BOOST_CHANNELS_ASSERT(!empty());
+        slot(pdata->head)->~ValueType();
+        pdata->head = pdata->advance(pdata->head);
     }
 
     void
     push(ValueType &&v)
     {
-        BOOST_CHANNELS_ASSERT(mem());
-        BOOST_CHANNELS_ASSERT(pdata->size < pdata->capacity);
-        auto pback = mem() + pdata->end;
-        new (pback) ValueType(std::move(v));
-        pdata->increase();
+        BOOST_CHANNELS_ASSERT(size() < capacity());
+        new (slot(pdata->tail)) ValueType(std::move(v));
+        pdata->tail = pdata->advance(pdata->tail);
     }
 
     void
-    destroy()
+    init()
     {
-        if (auto pmem = mem())
+    }
+
+    /// @brief Test whether the slot at the back of the buffer is reserved.
+    bool
+    reserved() const
+    {
+        return pdata->reserved;
+    }
+
+    /// @brief Reserve the slot at the back of the buffer, if there is space
+    /// and it is not already reserved.
+    ///
+    /// The slot is not part of the buffer's contents until it is published.
+    /// Until then, nothing more can be pushed.
+    /// @return the uninitialised slot, or nullptr.
+    void *
+    try_reserve()
+    {
+        if (pdata->reserved || size() >= pdata->limit)
+            return nullptr;
+        pdata->reserved = true;
+        return slot(pdata->tail);
+    }
+
+    /// @brief Make the value constructed in the reserved slot the last value
+    /// in the buffer.
+    /// @pre reserved() == true
+    void
+    publish()
+    {
+        BOOST_CHANNELS_ASSERT(pdata->reserved);
+        pdata->reserved = false;
+        pdata->tail     = pdata->advance(pdata->tail);
+    }
+
+    /// @brief Give up the reserved slot.
+    /// @pre reserved() == true
+    /// @pre the slot holds no value
+    void
+    unreserve()
+    {
+        BOOST_CHANNELS_ASSERT(pdata->reserved);
+        pdata->reserved = false;
+    }
+
+    /// @brief Construct a value at the back of the buffer from make(), if
+    /// there is space.
+    /// @return false if the buffer was full or its back slot is reserved, in
+    /// which case make is not called.
+    template < class F >
+    bool
+    try_push_with(F &&make)
+    {
+        if (pdata->reserved || size() >= pdata->limit)
+            return false;
+        new (slot(pdata->tail)) ValueType(make());
+        pdata->tail = pdata->advance(pdata->tail);
+        return true;
+    }
+
+    /// @brief Pass the value at the front of the buffer to sink as an rvalue
+    /// and pop it, if there is one.
+    /// @return false if the buffer was empty, in which case sink is not called.
+    template < class F >
+    bool
+    try_pop_with(F &&sink)
+    {
+        if (empty())
+            return false;
+        auto p = slot(pdata->head);
+        sink(std::move(*p));
+        p->~ValueType();
+        pdata->head = pdata->advance(pdata->head);
+        return true;
+    }
+
+    /// @brief Move the values, in order, into new storage and set the number
+    /// of values the buffer accepts.
+    ///
+    /// The old storage is no longer used and may be freed by the caller.
+    /// @pre reserved() == false
+    /// @pre slots >= size() && slots >= limit
+    /// @param to is storage for slots values, or nullptr if slots is 0
+    void
+    relocate(slot_type *to, std::size_t slots, std::size_t limit)
+    {
+        BOOST_CHANNELS_ASSERT(!pdata->reserved);
+        BOOST_CHANNELS_ASSERT(slots >= size() && slots >= limit);
+        auto        out = reinterpret_cast< ValueType * >(to);
+        std::size_t n   = 0;
+        while (!empty())
         {
-            while (pdata->size)
-            {
-                (pmem + pdata->begin)->~ValueType();
-                pdata->reduce();
-            }
+            new (out + n++) ValueType(std::move(front()));
+            pop();
         }
+        static_cast< ring_index & >(*pdata) = ring_index(slots);
+        pdata->head                         = 0;
+        pdata->tail                         = n;
+        pdata->limit                        = limit;
+        storage                             = to;
+    }
+
+    void
+    destroy()
+    {
+        if (mem())
+            while (!empty())
+                pop();
     }
 };
 
@@ -0,0 +1,226 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WATCH_CHANNEL_IMPL_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WATCH_CHANNEL_IMPL_HPP
+
+#include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/detail/implement_channel_queue.hpp>
+#include <boost/channels/detail/watch_storage.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+#include <boost/channels/error_code.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief The shared state of a watch_channel.
+///
+/// The latest value is read without the mutex. The mutex serialises stores
+/// and guards the queue of consumers waiting for a newer version. Every
+/// waiting consumer is waiting for the version after the current one, so a
+/// store wakes the whole queue.
+///
+/// Waiting consumers are completed with one shared snapshot of the new
+/// value, so a store costs each of them a reference count rather than a copy
+/// of the value under the mutex. Each consumer copies the value out of the
+/// snapshot when its handler runs.
+template < class ValueType, concepts::Lockable Mutex >
+struct watch_channel_impl
+{
+    using value_type    = ValueType;
+    using snapshot_type = watch_snapshot_ptr< ValueType >;
+    using consumer_ptr  = basic_consumer_ptr< snapshot_type, Mutex >;
+
+    explicit watch_channel_impl(ValueType const &initial)
+    : storage_(initial)
+    {
+    }
+
+    watch_channel_impl(watch_channel_impl const &) = delete;
+
+    watch_channel_impl &
+    operator=(watch_channel_impl const &) = delete;
+
+    ~watch_channel_impl()
+    {
+        close();
+        work_->retire();
+    }
+
+    /// @brief The version of the latest value. Does not take the mutex.
+    std::uint64_t
+    version() const
+    {
+        return storage_.version();
+    }
+
+    /// @brief A copy of the latest value, with its version. Does not take
+    /// the mutex.
+    watch_snapshot< ValueType >
+    load() const
+    {
+        return storage_.load();
+    }
+
+    bool
+    closed() const
+    {
+        return closed_.load(std::memory_order_acquire);
+    }
+
+    /// @brief Replace the value and wake every waiting consumer with it.
+    /// @return errors::channel_closed if the channel is closed.
+    error_code
+    store(ValueType const &value);
+
+    /// @brief Complete consume_op with the latest value once its version is
+    /// greater than seen.
+    void
+    submit_consume_op(std::uint64_t seen, consumer_ptr consume_op);
+
+    /// @brief Fail every waiting consumer with errors::channel_closed.
+    void
+    close();
+
+    /// @brief Claim a consumer which has not completed and remove it from the
+    /// wait queue.
+    /// @return true if the op was claimed. The caller completes it and commits
+    /// its state.
+    bool
+    claim_consume_op(basic_consume_op_interface< snapshot_type, Mutex > &op);
+
+    std::size_t
+    consumers_waiting()
+    {
+        auto lck = std::lock_guard(mutex_);
+        return consumers_.size();
+    }
+
+    /// @brief Counts the outstanding work of the channel's waiting ops.
+    work_tracker< Mutex > &
+    work()
+    {
+        return *work_;
+    }
+
+  private:
+    /// @pre the op's state is claimed
+    static void
+    complete(basic_consume_op_interface< snapshot_type, Mutex > &op,
+             error_code                                        ec,
+             snapshot_type                                     snapshot)
+    {
+        op.commit(std::make_tuple(ec, std::move(snapshot)));
+        op.state().commit();
+    }
+
+    Mutex mutex_;
+
+    watch_storage< ValueType > storage_;
+
+    basic_consumer_queue< snapshot_type, Mutex > consumers_;
+
+    std::atomic< bool > closed_ { false };
+
+    /// Shared with the ops it counts, which may outlive the channel
+    work_tracker< Mutex > *work_ = work_tracker< Mutex >::create();
+};
+
+//
+//
+//
+
+template < class ValueType, concepts::Lockable Mutex >
+error_code
+watch_channel_impl< ValueType, Mutex >::store(ValueType const &value)
+{
+    auto lck = std::lock_guard(mutex_);
+    if (closed_.load(std::memory_order_relaxed))
+        return errors::channel_closed;
+
+    storage_.store(value);
+    if (consumers_.empty())
+        return error_code();
+
+    auto snapshot = storage_.snapshot();
+    while (!consumers_.empty())
+    {
+        auto &consumer = *consumers_.front();
+        if (consumer.state().claim())
+            complete(consumer, error_code(), snapshot);
+        consumers_.pop();
+    }
+    return error_code();
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+watch_channel_impl< ValueType, Mutex >::submit_consume_op(
+    std::uint64_t seen,
+    consumer_ptr  consume_op)
+{
+    auto lck = std::lock_guard(mutex_);
+
+    // the version cannot move while the mutex is held
+    if (storage_.version() > seen)
+    {
+        if (consume_op->state().claim())
+            complete(*consume_op, error_code(), storage_.snapshot());
+    }
+    else if (closed_.load(std::memory_order_relaxed))
+    {
+        if (consume_op->state().claim())
+            complete(*consume_op, errors::channel_closed, snapshot_type());
+    }
+    else
+        consumers_.push(std::move(consume_op));
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+watch_channel_impl< ValueType, Mutex >::close()
+{
+    auto lck = std::lock_guard(mutex_);
+    if (closed_.exchange(true, std::memory_order_release))
+        return;
+
+    while (!consumers_.empty())
+    {
+        auto &consumer = *consumers_.front();
+        if (consumer.state().claim())
+            complete(consumer, errors::channel_closed, snapshot_type());
+        consumers_.pop();
+    }
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+bool
+watch_channel_impl< ValueType, Mutex >::claim_consume_op(
+    basic_consume_op_interface< snapshot_type, Mutex > &op)
+{
+    // the op is released after the mutex
+    consumer_ptr removed;
+
+    auto lck = std::lock_guard(mutex_);
+    if (!op.state().claim())
+        return false;
+    if (consumers_.linked(op))
+        removed = consumers_.erase(&op);
+    return true;
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WATCH_CHANNEL_IMPL_HPP
@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WATCH_CONSUMER_OP_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WATCH_CONSUMER_OP_HPP
+
+#include <boost/channels/config.hpp>
+#include <boost/channels/detail/allocate_op.hpp>
+#include <boost/channels/detail/cancellation.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
+#include <boost/channels/detail/consume_op_interface.hpp>
+#include <boost/channels/detail/postit.hpp>
+#include <boost/channels/detail/watch_storage.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/post.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief The function which completes a watch consumer's handler.
+///
+/// The value is copied out of the shared snapshot here, on the handler's
+/// executor, and the snapshot's version recorded in the receiver's cursor
+/// just before the handler is invoked. An error carries a default-constructed
+/// value.
+template < class ValueType, class Handler >
+struct watch_completion
+{
+    using executor_type  = asio::associated_executor_t< Handler >;
+    using allocator_type = asio::associated_allocator_t< Handler >;
+
+    void
+    operator()()
+    {
+        clear_cancellation_slot(handler_);
+        if (ec_)
+            return std::move(handler_)(ec_, ValueType());
+        *seen_ = snapshot_->version;
+        std::move(handler_)(ec_, ValueType(snapshot_->value));
+    }
+
+    executor_type
+    get_executor() const
+    {
+        return asio::get_associated_executor(handler_);
+    }
+
+    allocator_type
+    get_allocator() const
+    {
+        return asio::get_associated_allocator(handler_);
+    }
+
+    Handler                          handler_;
+    error_code                       ec_;
+    watch_snapshot_ptr< ValueType >  snapshot_;
+    std::shared_ptr< std::uint64_t > seen_;
+};
+
+/// @brief A consumer op waiting on a watch_channel for a newer version.
+///
+/// Like consumer_op_function, the op is the only allocation made for an
+/// async_consume, is allocated with the handler's associated allocator, and
+/// hands the handler, with its associated executor, allocator and
+/// cancellation slot, to the function posted on completion.
+///
+/// The op holds the receiver's cursor, the version it has seen, rather than
+/// the receiver, so the receiver may be moved or destroyed while the op
+/// waits.
+/// @tparam Handler A function object with signature void(error_code,
+/// ValueType)
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Executor,
+           class Handler >
+struct watch_consumer_op final
+: basic_consume_op_interface< watch_snapshot_ptr< ValueType >, Mutex >
+{
+    using interface_type =
+        basic_consume_op_interface< watch_snapshot_ptr< ValueType >, Mutex >;
+    using value_type     = typename interface_type::value_type;
+    using allocator_type = asio::associated_allocator_t< Handler >;
+
+    template < class HandlerArg >
+    watch_consumer_op(Executor                         exec,
+                      HandlerArg                     &&handler,
+                      std::shared_ptr< std::uint64_t > seen,
+                      counted_work< Mutex >            work = {})
+    : interface_type(this)
+    , exec_(std::move(exec))
+    , handler_(std::forward< HandlerArg >(handler))
+    , seen_(std::move(seen))
+    , work_(std::move(work))
+    , alloc_(asio::get_associated_allocator(handler_))
+    {
+    }
+
+    void
+    commit(value_type &&val)
+    {
+        BOOST_CHANNELS_ASSERT(this->state().claimed());
+        if (auto scope = completion_scope::current())
+        {
+            result_.emplace(std::move(val));
+            intrusive_ptr_add_ref(this);
+            scope->defer(this, &fire, exec_);
+        }
+        else
+            complete(std::move(val), fire_mode::post);
+    }
+
+    static void
+    destroy(watch_consumer_op *self) noexcept
+    {
+        auto alloc = self->alloc_;
+        deallocate_op(alloc, self);
+    }
+
+  private:
+    static void
+    fire(void *p, fire_mode mode)
+    {
+        auto self = boost::intrusive_ptr< watch_consumer_op >(
+            static_cast< watch_consumer_op * >(p), false);
+        if (mode != fire_mode::discard)
+            self->complete(std::move(*self->result_), mode);
+    }
+
+    void
+    complete(value_type &&val, fire_mode mode)
+    {
+        auto &[ec, snapshot] = val;
+        auto work            = std::move(work_);
+        auto exec            = std::move(exec_);
+        auto f               = watch_completion< ValueType, Handler > {
+            std::move(handler_), ec, std::move(snapshot), std::move(seen_)
+        };
+        if (mode == fire_mode::invoke)
+            f();
+        else if (mode == fire_mode::dispatch)
+            dispatch_or_post(exec, std::move(f));
+        else
+            asio::post(exec, std::move(f));
+    }
+
+    Executor                         exec_;
+    Handler                          handler_;
+    std::shared_ptr< std::uint64_t > seen_;
+    counted_work< Mutex >            work_;
+
+    /// The snapshot committed within a completion_scope
+    std::optional< value_type > result_;
+
+    [[no_unique_address]] allocator_type alloc_;
+};
+
+template < class ValueType,
+           concepts::Lockable Mutex,
+           class Executor,
+           class Handler >
+auto
+make_watch_consumer_op(Executor                       &&exec,
+                       Handler                        &&handler,
+                       std::shared_ptr< std::uint64_t > seen,
+                       counted_work< Mutex >            work = {})
+{
+    using type = watch_consumer_op< ValueType,
+                                    Mutex,
+                                    std::decay_t< Executor >,
+                                    std::decay_t< Handler > >;
+    auto alloc = asio::get_associated_allocator(handler);
+    return boost::intrusive_ptr< type >(
+        allocate_op< type >(alloc,
+                            std::forward< Executor >(exec),
+                            std::forward< Handler >(handler),
+                            std::move(seen),
+                            std::move(work)));
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WATCH_CONSUMER_OP_HPP
@@ -0,0 +1,212 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WATCH_STORAGE_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WATCH_STORAGE_HPP
+
+#include <boost/channels/config.hpp>
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace boost::channels::detail {
+
+/// @brief An immutable value of a watch_channel together with its version.
+template < class ValueType >
+struct watch_snapshot
+{
+    watch_snapshot(ValueType const &value, std::uint64_t version)
+    : value(value)
+    , version(version)
+    {
+    }
+
+    watch_snapshot(ValueType &&value, std::uint64_t version)
+    : value(std::move(value))
+    , version(version)
+    {
+    }
+
+    ValueType     value;
+    std::uint64_t version;
+};
+
+template < class ValueType >
+using watch_snapshot_ptr = std::shared_ptr< watch_snapshot< ValueType > const >;
+
+/// @brief The latest value of a watch_channel, which is read without locks.
+///
+/// Every store increments the version. Stores must be serialised by the
+/// caller, while any number of threads may load concurrently with them.
+///
+/// A trivially copyable value is held in a sequence lock: the value is kept
+/// as an array of atomic words, and a reader retries if a store overlapped
+/// its copy. Any other value is held in an immutable snapshot which is
+/// replaced by swapping a shared pointer, so that a reader copies from a
+/// snapshot which can no longer change.
+///
+/// The shared pointer is a std::atomic< std::shared_ptr >, which is not lock
+/// free: libstdc++ guards it with a lock bit in the pointer, held while a
+/// reader takes its reference. Readers of a non-trivially copyable value
+/// therefore serialise on that lock, and with stores, for the time it takes
+/// to bump a reference count. The copy of the value itself is made outside it, so readers of an
+/// expensive value still copy in parallel, but many readers of a cheap one
+/// contend as they would on a mutex.
+///
+/// Values are copy-constructed from the stored one, so ValueType need not be
+/// default constructible.
+///
+/// snapshot() shares the latest value with any number of waiting consumers,
+/// each of which copies it later, outside the channel's mutex.
+template < class ValueType, bool = std::is_trivially_copyable_v< ValueType > >
+struct watch_storage;
+
+template < class ValueType >
+struct watch_storage< ValueType, true >
+{
+    explicit watch_storage(ValueType const &initial)
+    {
+        put(initial);
+    }
+
+    /// @brief The version of the value most recently stored.
+    std::uint64_t
+    version() const
+    {
+        return seq_.load(std::memory_order_acquire) / 2;
+    }
+
+    /// @brief A copy of the latest value, with its version.
+    watch_snapshot< ValueType >
+    load() const
+    {
+        std::array< std::uint64_t, words > buf;
+        for (;;)
+        {
+            auto s1 = seq_.load(std::memory_order_acquire);
+            if (s1 & 1)
+            {
+                BOOST_CHANNELS_BUSY_WAIT();
+                continue;
+            }
+            for (std::size_t i = 0; i < words; ++i)
+                buf[i] = data_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == s1)
+            {
+                // the value is made from its bytes rather than copied over a
+                // default-constructed one
+                std::array< unsigned char, sizeof(ValueType) > bytes;
+                std::memcpy(bytes.data(), buf.data(), sizeof(ValueType));
+                return watch_snapshot< ValueType >(
+                    std::bit_cast< ValueType >(bytes), s1 / 2);
+            }
+        }
+    }
+
+    /// @brief The latest value, in a snapshot which can be shared.
+    watch_snapshot_ptr< ValueType >
+    snapshot() const
+    {
+        return std::make_shared< watch_snapshot< ValueType > const >(load());
+    }
+
+    /// @brief Replace the value.
+    /// @return the new version.
+    std::uint64_t
+    store(ValueType const &value)
+    {
+        auto s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        put(value);
+        seq_.store(s + 2, std::memory_order_release);
+        return (s + 2) / 2;
+    }
+
+  private:
+    static constexpr std::size_t words =
+        (sizeof(ValueType) + sizeof(std::uint64_t) - 1) /
+        sizeof(std::uint64_t);
+
+    void
+    put(ValueType const &value)
+    {
+        std::array< std::uint64_t, words > buf {};
+        std::memcpy(buf.data(),
+                    static_cast< void const * >(std::addressof(value)),
+                    sizeof(ValueType));
+        for (std::size_t i = 0; i < words; ++i)
+            data_[i].store(buf[i], std::memory_order_relaxed);
+    }
+
+    /// Odd while a store is in progress. Half of it is the version.
+    std::atomic< std::uint64_t > seq_ { 0 };
+
+    std::array< std::atomic< std::uint64_t >, words > data_;
+};
+
+template < class ValueType >
+struct watch_storage< ValueType, false >
+{
+    explicit watch_storage(ValueType const &initial)
+    : current_(std::make_shared< watch_snapshot< ValueType > const >(initial,
+                                                                     0))
+    {
+    }
+
+    std::uint64_t
+    version() const
+    {
+        return version_.load(std::memory_order_acquire);
+    }
+
+    /// @brief A copy of the latest value, with its version. Only taking the
+    /// reference to the snapshot holds the atomic's lock; the copy does not.
+    watch_snapshot< ValueType >
+    load() const
+    {
+        return *current_.load(std::memory_order_acquire);
+    }
+
+    /// @brief The snapshot holding the latest value.
+    watch_snapshot_ptr< ValueType >
+    snapshot() const
+    {
+        return current_.load(std::memory_order_acquire);
+    }
+
+    std::uint64_t
+    store(ValueType const &value)
+    {
+        auto version = version_.load(std::memory_order_relaxed) + 1;
+        current_.store(
+            std::make_shared< watch_snapshot< ValueType > const >(value,
+                                                                  version),
+            std::memory_order_release);
+        version_.store(version, std::memory_order_release);
+        return version;
+    }
+
+  private:
+    std::atomic< watch_snapshot_ptr< ValueType > > current_;
+
+    /// The version of current_, which is cheaper to poll than current_.
+    std::atomic< std::uint64_t > version_ { 0 };
+};
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WATCH_STORAGE_HPP
@@ -0,0 +1,331 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WORK_TRACKER_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WORK_TRACKER_HPP
+
+#include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/config.hpp>
+
+#include <boost/asio/execution/context.hpp>
+#include <boost/asio/execution/context_as.hpp>
+#include <boost/asio/execution/outstanding_work.hpp>
+#include <boost/asio/execution_context.hpp>
+#include <boost/asio/prefer.hpp>
+#include <boost/asio/query.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace boost::channels::detail {
+
+template < concepts::Lockable Mutex >
+struct work_tracker;
+
+/// @brief One op's share of the outstanding work a work_tracker holds on an
+/// execution context. The share is given up on destruction.
+template < concepts::Lockable Mutex >
+struct counted_work
+{
+    using entry_type = typename work_tracker< Mutex >::entry;
+
+    counted_work() = default;
+
+    counted_work(work_tracker< Mutex > *tracker, entry_type *entry) noexcept
+    : tracker_(tracker)
+    , entry_(entry)
+    {
+    }
+
+    counted_work(counted_work &&other) noexcept
+    : tracker_(std::exchange(other.tracker_, nullptr))
+    , entry_(other.entry_)
+    {
+    }
+
+    counted_work &
+    operator=(counted_work &&other) noexcept
+    {
+        counted_work(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    ~counted_work()
+    {
+        if (tracker_)
+            tracker_->release(*entry_);
+    }
+
+    void
+    swap(counted_work &other) noexcept
+    {
+        std::swap(tracker_, other.tracker_);
+        std::swap(entry_, other.entry_);
+    }
+
+  private:
+    work_tracker< Mutex > *tracker_ = nullptr;
+    entry_type            *entry_   = nullptr;
+};
+
+/// @brief Holds outstanding work on each execution context on which the
+/// handlers of a channel's waiting ops will run.
+///
+/// Tracking work through each op's executor costs a copy of the executor and
+/// an atomic increment and decrement of the context's work count, which every
+/// channel and timer on the context shares. The tracker instead keeps an
+/// entry per context and executor type with a count of the channel's ops
+/// there. The work is taken, through a single tracked executor of that type,
+/// when the count rises from zero and is released when it falls back. While
+/// other ops are waiting, an op's share costs one compare-and-swap on the
+/// entry to take and one to give up, and never takes a lock.
+///
+/// Entries are never removed or moved until the tracker is destroyed, so a
+/// share points at its entry and lookups walk the list without a lock. Only
+/// adding an entry for a new context takes the mutex.
+///
+/// An op releases its share only after posting its handler, which is itself
+/// work, so the context's count never falls to zero in between. Ops may
+/// complete after their channel has gone, so the tracker is reference
+/// counted by the channel and by every entry whose count is not zero.
+///
+/// A lone op, one with no other op of its channel waiting on its context,
+/// is dearer to count here than through its own executor. It still takes
+/// and releases the work through a tracked executor, and updates the entry
+/// on either side: bench_work_tracker measures 80 ns for its share against
+/// 40 ns for a tracked any_io_executor, and 55 against 15 ns for the
+/// io_context's own executor. The tracker is kept because the op then holds
+/// an untracked executor, whose copies count no work as its handler is
+/// posted. Over the op's round trip, posting and running its handler
+/// included, a lone op comes out cheaper with the tracker: 270 against
+/// 295 ns through any_io_executor, and 175 against 220 ns through the
+/// io_context's executor. A fast path which tracked lone ops by their
+/// executors would give that back.
+template < concepts::Lockable Mutex >
+struct work_tracker
+{
+    /// @brief Make a tracker owned by a channel, which must call retire()
+    /// when it is done with it.
+    static work_tracker *
+    create()
+    {
+        return new work_tracker();
+    }
+
+    /// @brief Give up the channel's reference to the tracker.
+    void
+    retire() noexcept
+    {
+        drop_ref();
+    }
+
+    /// @brief Count an op whose handler will run on exec.
+    template < class Executor >
+    counted_work< Mutex >
+    acquire(Executor const &exec)
+    {
+        auto *context = &asio::query(
+            exec, asio::execution::context_as< asio::execution_context & >);
+        auto &e = find_or_add< Executor >(context);
+
+        auto n = e.count.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if (n == busy)
+            {
+                BOOST_CHANNELS_BUSY_WAIT();
+                n = e.count.load(std::memory_order_relaxed);
+            }
+            else if (n != 0)
+            {
+                if (e.count.compare_exchange_weak(
+                        n, n + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (e.count.compare_exchange_weak(
+                         n, busy, std::memory_order_acquire))
+            {
+                // the first op on the context takes the work, and a
+                // reference to the tracker on behalf of every share
+                refs_.fetch_add(1, std::memory_order_relaxed);
+                e.work.emplace(asio::prefer(
+                    exec, asio::execution::outstanding_work.tracked));
+                e.count.store(1, std::memory_order_release);
+                break;
+            }
+        }
+        return counted_work< Mutex >(this, &e);
+    }
+
+  private:
+    friend struct counted_work< Mutex >;
+
+    /// marks a count whose work is being taken or released
+    static constexpr std::size_t busy = ~std::size_t(0);
+
+    /// identifies the executor type of an entry
+    template < class Executor >
+    static constexpr char type_key = 0;
+
+    struct entry
+    {
+        entry(asio::execution_context *context, void const *type, entry *next)
+        : context(context)
+        , type(type)
+        , next(next)
+        {
+        }
+
+        virtual ~entry() = default;
+
+        /// @brief Release the work. Only called by the thread which has set
+        /// count to busy.
+        virtual void
+        reset() noexcept = 0;
+
+        asio::execution_context *const context;
+        void const *const              type;
+        entry *const                   next;
+        std::atomic< std::size_t >     count { 0 };
+    };
+
+    /// An entry which holds the work as a tracked Executor
+    template < class Executor >
+    struct typed_entry final : entry
+    {
+        using entry::entry;
+
+        void
+        reset() noexcept override
+        {
+            work.reset();
+        }
+
+        /// Only touched by the thread which has set count to busy
+        std::optional< std::decay_t< typename asio::prefer_result<
+            Executor const &,
+            asio::execution::outstanding_work_t::tracked_t >::type > >
+            work;
+    };
+
+    work_tracker() = default;
+
+    ~work_tracker()
+    {
+        auto e = entries_.load(std::memory_order_relaxed);
+        while (e)
+            delete std::exchange(e, e->next);
+    }
+
+    template < class Executor >
+    typed_entry< Executor > &
+    find_or_add(asio::execution_context *context)
+    {
+        auto type = static_cast< void const * >(&type_key< Executor >);
+        if (auto e = find(context, type))
+            return static_cast< typed_entry< Executor > & >(*e);
+
+        // entries are only added under the mutex
+        auto lck = std::lock_guard(mutex_);
+        if (auto e = find(context, type))
+            return static_cast< typed_entry< Executor > & >(*e);
+        auto e = new typed_entry< Executor >(
+            context, type, entries_.load(std::memory_order_relaxed));
+        entries_.store(e, std::memory_order_release);
+        return *e;
+    }
+
+    entry *
+    find(asio::execution_context *context, void const *type) const noexcept
+    {
+        for (auto e = entries_.load(std::memory_order_acquire); e; e = e->next)
+            if (e->context == context && e->type == type)
+                return e;
+        return nullptr;
+    }
+
+    void
+    release(entry &e) noexcept
+    {
+        auto n = e.count.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            BOOST_CHANNELS_ASSERT(n != 0);
+            if (n == busy)
+            {
+                BOOST_CHANNELS_BUSY_WAIT();
+                n = e.count.load(std::memory_order_relaxed);
+            }
+            else if (n != 1)
+            {
+                if (e.count.compare_exchange_weak(
+                        n, n - 1, std::memory_order_relaxed))
+                    return;
+            }
+            else if (e.count.compare_exchange_weak(
+                         n, busy, std::memory_order_acquire))
+            {
+                e.reset();
+                e.count.store(0, std::memory_order_release);
+                break;
+            }
+        }
+        drop_ref();
+    }
+
+    void
+    drop_ref() noexcept
+    {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    Mutex                      mutex_;
+    std::atomic< std::size_t > refs_ { 1 };
+    std::atomic< entry * >     entries_ { nullptr };
+};
+
+/// @brief True if work on Executor's context can be counted by a
+/// work_tracker rather than by the op itself.
+template < class Executor >
+concept trackable_executor =
+    asio::can_query_v<
+        Executor const &,
+        asio::execution::context_as_t< asio::execution_context & > > &&
+    asio::can_prefer_v< Executor const &,
+                        asio::execution::outstanding_work_t::tracked_t >;
+
+/// @brief The executor an op keeps for its handler, and the op's share of the
+/// work on the executor's context.
+///
+/// Executors which a work_tracker cannot hold are tracked by the op, as if by
+/// prefer(exec, outstanding_work.tracked), and take no share.
+template < concepts::Lockable Mutex, class Executor >
+auto
+track_work(work_tracker< Mutex > &tracker, Executor exec)
+{
+    if constexpr (trackable_executor< Executor >)
+    {
+        auto work = tracker.acquire(exec);
+        return std::make_pair(std::move(exec), std::move(work));
+    }
+    else
+        return std::make_pair(
+            asio::prefer(std::move(exec),
+                         asio::execution::outstanding_work.tracked),
+            counted_work< Mutex >());
+}
+
+}   // namespace boost::channels::detail
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_DETAIL_WORK_TRACKER_HPP
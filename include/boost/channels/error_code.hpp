@@ -24,8 +24,13 @@ struct errors
 {
     enum channel_errors
     {
-        channel_null   = 1,   //! The channel does not have an implementation
-        channel_closed = 2,   //! The channel has been closed
+        channel_null       = 1,   //! The channel does not have an implementation
+        channel_closed     = 2,   //! The channel has been closed
+        channel_unbuffered = 3,   //! The channel has no buffer
+        value_dropped      = 4,   //! The value was discarded by the channel
+        channel_full       = 5,   //! The channel is full
+        timed_out          = 6,   //! The deadline of the operation passed
+        no_such_lane       = 7,   //! The channel has no lane of that index
     };
 
     struct channel_category final : error_category
@@ -66,7 +71,12 @@ struct errors
         {
             static const std::string_view messages[] = { "Invalid code",
                                                          "Channel is null",
-                                                         "Channel is closed" };
+                                                         "Channel is closed",
+                                                         "Channel has no buffer",
+                                                         "Value was dropped",
+                                                         "Channel is full",
+                                                         "Operation timed out",
+                                                         "No such lane" };
 
             auto ubound =
                 static_cast< int >(std::extent_v< decltype(messages) >);
@@ -0,0 +1,54 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_OVERFLOW_POLICY_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_OVERFLOW_POLICY_HPP
+
+#include <cstddef>
+
+namespace boost::channels {
+
+/// @brief What a channel does with a value sent while its buffer is full and
+/// no consumer is waiting.
+enum class overflow_policy
+{
+    /// @brief The sender waits until there is room. This is the default.
+    block,
+
+    /// @brief The new value is discarded, and the send completes with
+    /// errors::value_dropped.
+    drop_newest,
+
+    /// @brief The oldest buffered value is discarded to make room, and the
+    /// send succeeds. If the channel has no buffer, the new value is
+    /// discarded as by drop_newest.
+    drop_oldest,
+
+    /// @brief The send completes with errors::channel_full.
+    reject,
+};
+
+/// @brief The number of values a channel has refused because of its
+/// overflow_policy.
+struct overflow_counters
+{
+    /// @brief Values discarded on arrival under overflow_policy::drop_newest
+    /// or drop_oldest.
+    std::size_t dropped_newest = 0;
+
+    /// @brief Buffered values discarded under overflow_policy::drop_oldest.
+    std::size_t dropped_oldest = 0;
+
+    /// @brief Values refused under overflow_policy::reject.
+    std::size_t rejected = 0;
+};
+
+}   // namespace boost::channels
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_OVERFLOW_POLICY_HPP
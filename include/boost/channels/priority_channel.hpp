@@ -0,0 +1,357 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_PRIORITY_CHANNEL_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_PRIORITY_CHANNEL_HPP
+
+#include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/detail/cancellation.hpp>
+#include <boost/channels/detail/consumer_op_function.hpp>
+#include <boost/channels/detail/free_deleter.hpp>
+#include <boost/channels/detail/postit.hpp>
+#include <boost/channels/detail/priority_channel_impl.hpp>
+#include <boost/channels/detail/producer_op_function.hpp>
+#include <boost/channels/error_code.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace boost::channels {
+
+/// @brief A channel whose values are sent on one of several lanes, and
+/// consumed in order of lane priority.
+///
+/// Lane 0 has the highest priority. A consumer always takes the oldest value
+/// of the highest priority lane which has one. Each lane has its own buffer
+/// and its own queue of waiting senders, so a flood of senders on a low
+/// priority lane never delays a sender on a higher one.
+/// @tparam ValueType is the type of value passed through the channel.
+/// @tparam Lanes is the number of lanes, from 1 to 64.
+/// @tparam Executor is the type of executor associated with the channel.
+template < class ValueType,
+           std::size_t Lanes,
+           class Executor           = asio::any_io_executor,
+           concepts::Lockable Mutex = std::mutex >
+struct priority_channel
+{
+    using executor_type = Executor;
+
+    /// @brief T type of value handled by this channel
+    using value_type = ValueType;
+
+    using impl_type = detail::priority_channel_impl< ValueType, Lanes, Mutex >;
+    using impl_ptr  = std::shared_ptr< impl_type >;
+
+    /// @brief The number of lanes.
+    static constexpr std::size_t lanes = Lanes;
+
+    /// @brief Construct a channel in which every lane can buffer capacity
+    /// values.
+    priority_channel(Executor exec, std::size_t capacity = 0);
+
+    /// @brief Construct a channel in which lane n can buffer capacities[n]
+    /// values.
+    priority_channel(Executor                                exec,
+                     std::array< std::size_t, Lanes > const &capacities);
+
+    ~priority_channel()
+    {
+        close();
+    }
+
+    /// @brief Consume one value, from the highest priority lane which has
+    /// one, if a value is available immediately.
+    /// @param ec is set to errors::channel_closed if the channel is closed
+    /// and no values remain, and otherwise cleared.
+    std::optional< value_type >
+    consume_if(error_code &ec);
+
+    /// @brief Send a value on a lane if that can be done without waiting.
+    /// @param lane is the lane on which the value is sent
+    /// @param value is moved from only if the channel accepts it
+    /// @param ec is set to errors::no_such_lane if lane is not less than
+    /// Lanes, to errors::channel_closed if the channel is closed, and
+    /// otherwise cleared.
+    /// @return true if the value was accepted.
+    bool
+    try_send(std::size_t lane, value_type &&value, error_code &ec);
+
+    /// @brief Initiate an asynchronous send of a value on a lane
+    ///
+    /// The send waits only behind earlier sends on the same lane. The
+    /// completion handler will always be invoked as if by a call to
+    /// post(handler). A send on a lane which is not less than Lanes completes
+    /// with errors::no_such_lane.
+    ///
+    /// As for channel::async_send, a cancellation emitted on the handler's
+    /// associated cancellation slot withdraws a waiting send and completes
+    /// it with asio::error::operation_aborted. The unsent value is
+    /// destroyed.
+    /// @param lane is the lane on which the value is sent
+    /// @param value is the value to send into the channel
+    /// @param token is the completion token
+    /// @return depends on CompletionToken
+    template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code)) SendHandler
+                   BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(executor_type) >
+    BOOST_ASIO_INITFN_RESULT_TYPE(SendHandler, void(error_code))
+    async_send(std::size_t   lane,
+               value_type    value,
+               SendHandler &&token
+                   BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
+    /// @brief Initiate an asynchronous consume of the next value from the
+    /// highest priority lane which has one
+    ///
+    /// The completion handler will always be invoked as if by a call to
+    /// post(handler). If the channel is closed and no values remain, the
+    /// handler is invoked with errors::channel_closed. A cancellation emitted
+    /// on the handler's associated cancellation slot withdraws a waiting
+    /// consume and completes it with asio::error::operation_aborted.
+    /// @param token is the completion token
+    /// @return depends on CompletionToken
+    template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, ValueType))
+                   ConsumeHandler BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(
+                       executor_type) >
+    BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeHandler, void(error_code, ValueType))
+    async_consume(ConsumeHandler &&token
+                      BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
+    /// @brief Cause the channel to be closed.
+    ///
+    /// Waiting sends on every lane fail with errors::channel_closed. Values
+    /// already buffered are still delivered, in order of priority.
+    void
+    close() noexcept;
+
+    executor_type const &
+    get_executor() const
+    {
+        return exec_;
+    }
+
+    impl_ptr const &
+    get_implementation() const
+    {
+        return impl_;
+    }
+
+  private:
+    static impl_ptr
+    create_impl(std::array< std::size_t, Lanes > const &capacities);
+
+    Executor exec_;
+    impl_ptr impl_;
+};
+
+template < class ValueType,
+           std::size_t Lanes,
+           class Executor,
+           concepts::Lockable Mutex >
+priority_channel< ValueType, Lanes, Executor, Mutex >::priority_channel(
+    Executor    exec,
+    std::size_t capacity)
+: exec_(std::move(exec))
+{
+    std::array< std::size_t, Lanes > capacities;
+    capacities.fill(capacity);
+    impl_ = create_impl(capacities);
+}
+
+template < class ValueType,
+           std::size_t Lanes,
+           class Executor,
+           concepts::Lockable Mutex >
+priority_channel< ValueType, Lanes, Executor, Mutex >::priority_channel(
+    Executor                                exec,
+    std::array< std::size_t, Lanes > const &capacities)
+: exec_(std::move(exec))
+, impl_(create_impl(capacities))
+{
+}
+
+template < class ValueType,
+           std::size_t Lanes,
+           class Executor,
+           concepts::Lockable Mutex >
+auto
+priority_channel< ValueType, Lanes, Executor, Mutex >::consume_if(
+    error_code &ec) -> std::optional< value_type >
+{
+    ec.clear();
+
+    if (!impl_) [[unlikely]]
+    {
+        ec = errors::channel_null;
+        return {};
+    }
+
+    return impl_->consume_if(ec);
+}
+
+template < class ValueType,
+           std::size_t Lanes,
+           class Executor,
+           concepts::Lockable Mutex >
+bool
+priority_channel< ValueType, Lanes, Executor, Mutex >::try_send(
+    std::size_t  lane,
+    value_type &&value,
+    error_code  &ec)
+{
+    ec.clear();
+
+    if (!impl_) [[unlikely]]
+    {
+        ec = errors::channel_null;
+        return false;
+    }
+
+    if (lane >= Lanes) [[unlikely]]
+    {
+        ec = errors::no_such_lane;
+        return false;
+    }
+
+    return impl_->try_produce(lane, value, ec);
+}
+
+template < class ValueType,
+           std::size_t Lanes,
+           class Executor,
+           concepts::Lockable Mutex >
+template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code)) SendHandler >
+BOOST_ASIO_INITFN_RESULT_TYPE(SendHandler, void(error_code))
+priority_channel< ValueType, Lanes, Executor, Mutex >::async_send(
+    std::size_t   lane,
+    value_type    value,
+    SendHandler &&token)
+{
+    return asio::async_initiate< SendHandler, void(error_code) >(
+        [lane,
+         value1 = std::move(value),
+         impl1  = impl_,
+         default_executor =
+             get_executor()]< class Handler1 >(Handler1 &&handler1) mutable {
+            if (impl1 && lane < Lanes) [[likely]]
+            {
+                auto slot           = detail::cancellation_slot_of(handler1);
+                auto [exec1, work1] = detail::track_work(
+                    impl1->work(),
+                    asio::get_associated_executor(handler1, default_executor));
+                auto op = detail::make_producer_op_function< Mutex >(
+                    std::move(value1),
+                    std::move(exec1),
+                    std::forward< Handler1 >(handler1),
+                    std::move(work1));
+                detail::connect_cancellation(slot, impl1, op);
+                impl1->submit_produce_op(lane, std::move(op));
+            }
+            else [[unlikely]]
+            {
+                auto ec = impl1 ? error_code(errors::no_such_lane)
+                                : error_code(errors::channel_null);
+                auto completion = detail::postit(
+                    asio::get_associated_executor(handler1, default_executor),
+                    std::forward< Handler1 >(handler1));
+                completion(ec);
+            }
+        },
+        token);
+}
+
+template < class ValueType,
+           std::size_t Lanes,
+           class Executor,
+           concepts::Lockable Mutex >
+template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, ValueType))
+               ConsumeHandler >
+BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeHandler, void(error_code, ValueType))
+priority_channel< ValueType, Lanes, Executor, Mutex >::async_consume(
+    ConsumeHandler &&token)
+{
+    if (!impl_) [[unlikely]]
+        BOOST_THROW_EXCEPTION(std::logic_error("channel is null"));
+
+    return asio::async_initiate< ConsumeHandler, void(error_code, ValueType) >(
+        [impl1 = impl_, default_executor = get_executor()]< class Handler1 >(
+            Handler1 &&handler1) {
+            auto slot           = detail::cancellation_slot_of(handler1);
+            auto [exec1, work1] = detail::track_work(
+                impl1->work(),
+                asio::get_associated_executor(handler1, default_executor));
+            auto op = detail::make_consumer_op_function< ValueType, Mutex >(
+                std::move(exec1),
+                std::forward< Handler1 >(handler1),
+                std::move(work1));
+            detail::connect_cancellation(slot, impl1, op);
+            impl1->submit_consume_op(std::move(op));
+        },
+        token);
+}
+
+template < class ValueType,
+           std::size_t Lanes,
+           class Executor,
+           concepts::Lockable Mutex >
+void
+priority_channel< ValueType, Lanes, Executor, Mutex >::close() noexcept
+{
+    if (impl_) [[likely]]
+    {
+        asio::dispatch(get_executor(), [impl = impl_] { impl->close(); });
+    }
+}
+
+template < class ValueType,
+           std::size_t Lanes,
+           class Executor,
+           concepts::Lockable Mutex >
+auto
+priority_channel< ValueType, Lanes, Executor, Mutex >::create_impl(
+    std::array< std::size_t, Lanes > const &capacities) -> impl_ptr
+{
+    auto slots  = impl_type::total_slots(capacities);
+    auto extra  = (sizeof(typename impl_type::slot_type) * slots) +
+                 (sizeof(impl_type) - 1);
+    auto blocks = 1 + (extra / sizeof(impl_type));
+
+    auto pmem = std::calloc(blocks, sizeof(impl_type));
+    if (!pmem)
+        BOOST_THROW_EXCEPTION(std::bad_alloc());
+
+    impl_type *impl;
+    try
+    {
+        impl = new (pmem) impl_type(capacities);
+    }
+    catch (...)
+    {
+        std::free(pmem);
+        throw;
+    }
+
+    // if the control block cannot be allocated, the deleter frees the impl
+    return impl_ptr(impl, detail::free_deleter());
+}
+
+}   // namespace boost::channels
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_PRIORITY_CHANNEL_HPP
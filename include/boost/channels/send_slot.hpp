@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_SEND_SLOT_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_SEND_SLOT_HPP
+
+#include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/concurrency.hpp>
+#include <boost/channels/detail/channel_impl.hpp>
+#include <boost/channels/error_code.hpp>
+
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace boost::channels {
+
+/// @brief A slot at the back of a channel's buffer, claimed for a value which
+/// is constructed in place.
+///
+/// A slot is obtained from channel::async_claim. The value is constructed in
+/// the slot with emplace(), may then be filled through value(), and becomes
+/// visible to consumers when it is published. Until then, values sent after
+/// the claim wait behind it.
+///
+/// A slot which is destroyed or reset without being published is given back
+/// to the channel, and any value constructed in it is destroyed.
+/// @tparam ValueType is the type of value passed through the channel.
+template < class ValueType, concepts::Lockable Mutex = std::mutex >
+struct send_slot
+{
+    using value_type = ValueType;
+    using impl_type =
+        detail::channel_impl< ValueType, Mutex, concurrency::locked >;
+
+    /// @brief Construct a slot which holds nothing.
+    send_slot() = default;
+
+    /// @brief Take ownership of a reserved slot.
+    /// @param impl is the channel in which the slot is reserved
+    /// @param storage is the uninitialised storage of the slot
+    send_slot(std::shared_ptr< impl_type > impl, void *storage) noexcept
+    : impl_(std::move(impl))
+    , storage_(storage)
+    {
+    }
+
+    send_slot(send_slot &&other) noexcept
+    : impl_(std::move(other.impl_))
+    , storage_(std::exchange(other.storage_, nullptr))
+    , constructed_(std::exchange(other.constructed_, false))
+    {
+    }
+
+    send_slot &
+    operator=(send_slot &&other) noexcept
+    {
+        auto tmp = std::move(other);
+        swap(tmp);
+        return *this;
+    }
+
+    ~send_slot()
+    {
+        reset();
+    }
+
+    /// @brief Test whether a slot is held.
+    explicit operator bool() const noexcept
+    {
+        return impl_ != nullptr;
+    }
+
+    /// @brief Test whether a value has been constructed in the slot.
+    bool
+    has_value() const noexcept
+    {
+        return constructed_;
+    }
+
+    /// @brief Construct the value in the slot, replacing any value already
+    /// there.
+    /// @pre *this
+    template < class... Args >
+    ValueType &
+    emplace(Args &&...args);
+
+    /// @brief The value in the slot.
+    /// @pre has_value()
+    ValueType &
+    value() noexcept
+    {
+        BOOST_CHANNELS_ASSERT(constructed_);
+        return *std::launder(static_cast< ValueType * >(storage_));
+    }
+
+    /// @brief Make the value visible to consumers and give up the slot.
+    ///
+    /// If the channel has been closed since the slot was claimed, the value
+    /// is destroyed instead and ec is set to errors::channel_closed.
+    /// @param ec is an out parameter which receives the outcome.
+    /// @pre has_value()
+    /// @post !*this
+    void
+    publish(error_code &ec);
+
+    /// @brief Give the slot back to the channel without publishing.
+    /// @post !*this
+    void
+    reset() noexcept;
+
+    void
+    swap(send_slot &other) noexcept
+    {
+        std::swap(impl_, other.impl_);
+        std::swap(storage_, other.storage_);
+        std::swap(constructed_, other.constructed_);
+    }
+
+  private:
+    std::shared_ptr< impl_type > impl_;
+    void                        *storage_     = nullptr;
+    bool                         constructed_ = false;
+};
+
+template < class ValueType, concepts::Lockable Mutex >
+template < class... Args >
+ValueType &
+send_slot< ValueType, Mutex >::emplace(Args &&...args)
+{
+    BOOST_CHANNELS_ASSERT(impl_);
+    if (constructed_)
+    {
+        value().~ValueType();
+        constructed_ = false;
+    }
+    auto p       = ::new (storage_) ValueType(std::forward< Args >(args)...);
+    constructed_ = true;
+    return *p;
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+send_slot< ValueType, Mutex >::publish(error_code &ec)
+{
+    BOOST_CHANNELS_ASSERT(constructed_);
+    auto impl    = std::move(impl_);
+    ec           = impl->publish_reserved(&value());
+    storage_     = nullptr;
+    constructed_ = false;
+}
+
+template < class ValueType, concepts::Lockable Mutex >
+void
+send_slot< ValueType, Mutex >::reset() noexcept
+{
+    if (!impl_)
+        return;
+    if (constructed_)
+        value().~ValueType();
+    auto impl = std::move(impl_);
+    impl->cancel_reserved();
+    storage_     = nullptr;
+    constructed_ = false;
+}
+
+}   // namespace boost::channels
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_SEND_SLOT_HPP
@@ -0,0 +1,36 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_SPILL_OPTIONS_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_SPILL_OPTIONS_HPP
+
+#include <cstddef>
+#include <filesystem>
+
+namespace boost::channels {
+
+/// @brief Configures the spill files of a channel using concurrency::spill.
+struct spill_options
+{
+    /// @brief The directory in which spill files are created. Empty selects
+    /// std::filesystem::temp_directory_path().
+    std::filesystem::path directory;
+
+    /// @brief The size in bytes of each spill file. Each file is mapped into
+    /// memory whole, and is released once every value in it is consumed.
+    std::size_t segment_size = std::size_t(1) << 20;
+
+    /// @brief The largest number of bytes held in spill files at once. When
+    /// it is reached, senders wait as they would for a full buffer.
+    std::size_t max_spill_size = std::size_t(64) << 20;
+};
+
+}   // namespace boost::channels
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_SPILL_OPTIONS_HPP
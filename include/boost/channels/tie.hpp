@@ -11,6 +11,7 @@
 #define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_TIE_HPP
 
 #include <boost/channels/concepts/selectable_op.hpp>
+#include <boost/channels/detail/cancellation.hpp>
 #include <boost/channels/detail/postit.hpp>
 #include <boost/channels/detail/select_state.hpp>
 
@@ -57,13 +58,16 @@ struct tied_channel_op< PoC1, PoCRest... >
                 }
                 else
                 {
-                    auto exec =
-                        asio::prefer(asio::get_associated_executor(
-                                         handler, get< 0 >(ops).get_executor()),
-                                     asio::execution::outstanding_work.tracked);
-                    auto ss =
-                        detail::make_select_state< mutex_type >(detail::postit(
-                            std::move(exec), std::forward< Handler >(handler)));
+                    auto slot = detail::cancellation_slot_of(handler);
+                    auto [exec, work] = detail::track_work(
+                        get< 0 >(ops).get_implementation()->work(),
+                        asio::get_associated_executor(
+                            handler, get< 0 >(ops).get_executor()));
+                    auto ss = detail::make_select_state< mutex_type >(
+                        std::move(exec),
+                        std::forward< Handler >(handler),
+                        std::move(work));
+                    detail::connect_cancellation(slot, ss);
 
                     static thread_local auto rng = [] {
                         std::random_device rd;
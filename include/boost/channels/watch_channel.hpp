@@ -0,0 +1,297 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#ifndef BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_WATCH_CHANNEL_HPP
+#define BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_WATCH_CHANNEL_HPP
+
+#include <boost/channels/concepts/std_lockable.hpp>
+#include <boost/channels/detail/cancellation.hpp>
+#include <boost/channels/detail/postit.hpp>
+#include <boost/channels/detail/watch_channel_impl.hpp>
+#include <boost/channels/detail/watch_consumer_op.hpp>
+#include <boost/channels/error_code.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/dispatch.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace boost::channels {
+
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+struct watch_receiver;
+
+/// @brief A channel which holds only its latest value.
+///
+/// Each send replaces the value and increments its version. Consumers
+/// subscribe through a watch_receiver, which remembers the last version it
+/// has seen and is woken at most once per change with the value current at
+/// that time. Intermediate values which no receiver asked for in time are
+/// never delivered.
+///
+/// The latest value is read without taking the channel's mutex. A trivially
+/// copyable ValueType is read through a sequence lock, so any number of
+/// receivers can poll it concurrently. Any other is read from an immutable
+/// snapshot held by a std::atomic< std::shared_ptr >, whose readers briefly
+/// serialise on the atomic's internal lock while each takes a reference,
+/// though they copy the value in parallel.
+/// @tparam ValueType is the type of value held by the channel. It must be
+/// copy constructible. It need only be default constructible if the channel
+/// is constructed without an initial value, or if async_consume is used,
+/// whose error completions carry a default-constructed value.
+/// @tparam Executor is the type of executor associated with the channel.
+template < class ValueType,
+           class Executor           = asio::any_io_executor,
+           concepts::Lockable Mutex = std::mutex >
+struct watch_channel
+{
+    using executor_type = Executor;
+
+    /// @brief T type of value handled by this channel
+    using value_type = ValueType;
+
+    using receiver_type = watch_receiver< ValueType, Executor, Mutex >;
+
+    using impl_type = detail::watch_channel_impl< ValueType, Mutex >;
+    using impl_ptr  = std::shared_ptr< impl_type >;
+
+    /// @brief Construct a channel holding initial, at version 0.
+    explicit watch_channel(Executor exec, ValueType initial = ValueType())
+    : exec_(std::move(exec))
+    , impl_(std::make_shared< impl_type >(initial))
+    {
+    }
+
+    ~watch_channel()
+    {
+        close();
+    }
+
+    /// @brief Replace the channel's value and wake every waiting receiver.
+    ///
+    /// Never waits.
+    /// @param value is the new value
+    /// @param ec is set to errors::channel_closed if the channel is closed,
+    /// and otherwise cleared.
+    void
+    send(value_type const &value, error_code &ec)
+    {
+        ec = impl_ ? impl_->store(value) : errors::channel_null;
+    }
+
+    /// @brief A copy of the latest value. Does not take the mutex.
+    value_type
+    get() const
+    {
+        return impl_->load().value;
+    }
+
+    /// @brief The version of the latest value. Does not take the mutex.
+    std::uint64_t
+    version() const
+    {
+        return impl_->version();
+    }
+
+    /// @brief Create a receiver which has seen the current version, and so
+    /// waits for the next change.
+    receiver_type
+    subscribe() const
+    {
+        return receiver_type(exec_, impl_, impl_->version());
+    }
+
+    /// @brief Cause the channel to be closed.
+    ///
+    /// Waiting receivers complete with errors::channel_closed, as do later
+    /// consumes which find no version newer than the receiver has seen.
+    void
+    close() noexcept
+    {
+        if (impl_) [[likely]]
+            asio::dispatch(exec_, [impl = impl_] { impl->close(); });
+    }
+
+    executor_type const &
+    get_executor() const
+    {
+        return exec_;
+    }
+
+    impl_ptr const &
+    get_implementation() const
+    {
+        return impl_;
+    }
+
+  private:
+    Executor exec_;
+    impl_ptr impl_;
+};
+
+/// @brief Consumes changes of a watch_channel.
+///
+/// The version a receiver has seen is held in a cursor shared with its
+/// outstanding async_consume, so a receiver may be moved or destroyed while
+/// the op waits. A copy of a receiver starts with its own cursor.
+/// @note A receiver may be used by one consumer at a time.
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+struct watch_receiver
+{
+    using executor_type = Executor;
+    using value_type    = ValueType;
+    using impl_type     = detail::watch_channel_impl< ValueType, Mutex >;
+    using impl_ptr      = std::shared_ptr< impl_type >;
+
+    watch_receiver(Executor exec, impl_ptr impl, std::uint64_t seen)
+    : exec_(std::move(exec))
+    , impl_(std::move(impl))
+    , seen_(std::make_shared< std::uint64_t >(seen))
+    {
+    }
+
+    watch_receiver(watch_receiver const &other)
+    : watch_receiver(other.exec_, other.impl_, other.seen())
+    {
+    }
+
+    watch_receiver(watch_receiver &&) = default;
+
+    watch_receiver &
+    operator=(watch_receiver const &other)
+    {
+        if (this != &other)
+            *this = watch_receiver(other);
+        return *this;
+    }
+
+    watch_receiver &
+    operator=(watch_receiver &&) = default;
+
+    /// @brief The version of the last value consumed through this receiver.
+    std::uint64_t
+    seen() const
+    {
+        return *seen_;
+    }
+
+    /// @brief Test whether the channel holds a version newer than seen().
+    bool
+    has_changed() const
+    {
+        return impl_->version() > seen();
+    }
+
+    /// @brief Consume the latest value if it is newer than seen(). Does not
+    /// take the mutex.
+    /// @param ec is set to errors::channel_closed if the channel is closed
+    /// and there is no newer value, and otherwise cleared.
+    std::optional< value_type >
+    consume_if(error_code &ec);
+
+    /// @brief Initiate an asynchronous consume of the first value newer than
+    /// seen()
+    ///
+    /// If the channel already holds a newer value, the operation completes
+    /// with it without taking the mutex or allocating. Otherwise it waits
+    /// for the next send, and completes with that value. The completion
+    /// handler will always be invoked as if by a call to post(handler).
+    ///
+    /// The op is allocated with the handler's associated allocator. An error
+    /// completes with a default-constructed value. A cancellation emitted on
+    /// the handler's associated cancellation slot withdraws a waiting
+    /// consume, leaving seen() as it was, and completes it with
+    /// asio::error::operation_aborted.
+    /// @param token is the completion token
+    /// @return depends on CompletionToken
+    template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, ValueType))
+                   ConsumeHandler BOOST_ASIO_DEFAULT_COMPLETION_TOKEN_TYPE(
+                       executor_type) >
+    BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeHandler, void(error_code, ValueType))
+    async_consume(ConsumeHandler &&token
+                      BOOST_ASIO_DEFAULT_COMPLETION_TOKEN(executor_type));
+
+    executor_type const &
+    get_executor() const
+    {
+        return exec_;
+    }
+
+  private:
+    Executor exec_;
+    impl_ptr impl_;
+
+    /// Shared with the outstanding async_consume, if any
+    std::shared_ptr< std::uint64_t > seen_;
+};
+
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+auto
+watch_receiver< ValueType, Executor, Mutex >::consume_if(error_code &ec)
+    -> std::optional< value_type >
+{
+    ec.clear();
+
+    std::optional< value_type > result;
+    if (impl_->version() > *seen_)
+    {
+        auto latest = impl_->load();
+        *seen_      = latest.version;
+        result.emplace(std::move(latest.value));
+    }
+    else if (impl_->closed())
+        ec = errors::channel_closed;
+    return result;
+}
+
+template < class ValueType, class Executor, concepts::Lockable Mutex >
+template < BOOST_ASIO_COMPLETION_TOKEN_FOR(void(error_code, ValueType))
+               ConsumeHandler >
+BOOST_ASIO_INITFN_RESULT_TYPE(ConsumeHandler, void(error_code, ValueType))
+watch_receiver< ValueType, Executor, Mutex >::async_consume(
+    ConsumeHandler &&token)
+{
+    return asio::async_initiate< ConsumeHandler, void(error_code, ValueType) >(
+        [this]< class Handler1 >(Handler1 &&handler1) {
+            auto exec0 = asio::get_associated_executor(handler1, exec_);
+
+            // a change which has already happened needs no op
+            error_code ec;
+            if (auto v = consume_if(ec); v || ec)
+            {
+                auto completion =
+                    detail::postit(exec0, std::forward< Handler1 >(handler1));
+                completion(ec, v ? std::move(*v) : value_type());
+                return;
+            }
+
+            // the op is completed with a snapshot shared with every other
+            // waiting receiver. Its version is recorded in the cursor, and
+            // its value copied, as the handler is invoked.
+            auto slot           = detail::cancellation_slot_of(handler1);
+            auto [exec1, work1] = detail::track_work(impl_->work(), exec0);
+            auto op = detail::make_watch_consumer_op< ValueType, Mutex >(
+                std::move(exec1),
+                std::forward< Handler1 >(handler1),
+                seen_,
+                std::move(work1));
+            detail::connect_cancellation(slot, impl_, op);
+            impl_->submit_consume_op(*seen_, std::move(op));
+        },
+        token);
+}
+
+}   // namespace boost::channels
+
+#endif   // BOOST_CHANNELS_INCLUDE_BOOST_CHANNELS_WATCH_CHANNEL_HPP
@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace boost;
+using namespace std::literals;
+
+namespace {
+
+template < class Channel >
+void
+send_and_consume(Channel &c)
+{
+    constexpr int count = 1000;
+
+    auto producer = std::thread([&] {
+        for (int i = 0; i < count; ++i)
+        {
+            channels::error_code ec;
+            c.send(std::to_string(i), ec);
+            CHECK(!ec);
+        }
+    });
+
+    std::vector< std::string > received;
+    for (int i = 0; i < count; ++i)
+    {
+        channels::error_code ec;
+        auto                 v = c.consume(ec);
+        CHECK(!ec);
+        received.push_back(std::move(v));
+    }
+    producer.join();
+
+    REQUIRE(received.size() == count);
+    for (int i = 0; i < count; ++i)
+        CHECK(received[i] == std::to_string(i));
+}
+
+}   // namespace
+
+TEST_CASE("blocking send and consume between threads")
+{
+    auto ioc = asio::io_context();
+
+    SUBCASE("unbuffered")
+    {
+        auto c = channels::channel< std::string >(ioc.get_executor());
+        send_and_consume(c);
+    }
+
+    SUBCASE("buffered")
+    {
+        auto c = channels::channel< std::string >(ioc.get_executor(), 8);
+        send_and_consume(c);
+    }
+
+    SUBCASE("spsc")
+    {
+        auto c = channels::channel< std::string,
+                                    asio::any_io_executor,
+                                    std::mutex,
+                                    channels::concurrency::spsc >(
+            ioc.get_executor(), 8);
+        send_and_consume(c);
+    }
+}
+
+TEST_CASE("blocking operations are released by close")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor());
+
+    SUBCASE("consume")
+    {
+        channels::error_code ec;
+        auto                 consumer = std::thread([&] { c.consume(ec); });
+        std::this_thread::sleep_for(10ms);
+        c.close();
+        ioc.run();
+        consumer.join();
+        CHECK(ec == channels::errors::channel_closed);
+    }
+
+    SUBCASE("send")
+    {
+        channels::error_code ec;
+        auto producer = std::thread([&] { c.send("lost", ec); });
+        std::this_thread::sleep_for(10ms);
+        c.close();
+        ioc.run();
+        producer.join();
+        CHECK(ec == channels::errors::channel_closed);
+    }
+
+    SUBCASE("already closed")
+    {
+        c.close();
+        ioc.run();
+
+        channels::error_code ec;
+        c.send("lost", ec);
+        CHECK(ec == channels::errors::channel_closed);
+        c.consume(ec);
+        CHECK(ec == channels::errors::channel_closed);
+    }
+}
+
+TEST_CASE("blocking consume takes a buffered value without parking")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor(), 1);
+
+    channels::error_code ec;
+    c.send("ready", ec);
+    CHECK(!ec);
+    CHECK(c.consume(ec) == "ready");
+    CHECK(!ec);
+}
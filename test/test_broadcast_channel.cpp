@@ -0,0 +1,205 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/broadcast_channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <doctest/doctest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+using string_channel = channels::broadcast_channel< std::string >;
+
+std::vector< std::string >
+drain(string_channel::receiver_type &rx)
+{
+    std::vector< std::string > values;
+    channels::error_code       ec;
+    while (auto v = rx.consume_if(ec))
+        values.push_back(*v);
+    return values;
+}
+
+// counts live instances, to show when values are destroyed
+struct tracked
+{
+    explicit tracked(std::shared_ptr< int > const &live = {})
+    : live(live)
+    {
+    }
+
+    std::shared_ptr< int > live;
+};
+
+}   // namespace
+
+TEST_CASE("broadcast channel delivers every value to every subscriber")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 4);
+
+    auto early = c.subscribe();
+
+    channels::error_code ec;
+    CHECK(c.try_send("a", ec));
+    auto late = c.subscribe();
+    CHECK(c.try_send("b", ec));
+
+    std::vector< std::string > waited;
+    auto waiter = c.subscribe();
+    waiter.async_consume([&](channels::error_code ec, std::string s) {
+        CHECK(!ec);
+        waited.push_back(std::move(s));
+    });
+    ioc.poll();
+    ioc.restart();
+    CHECK(waited.empty());
+
+    c.async_send("c", [](channels::error_code ec) { CHECK(!ec); });
+    ioc.poll();
+    ioc.restart();
+
+    CHECK(waited == std::vector< std::string > { "c" });
+    CHECK(early.lag() == 3);
+    CHECK(drain(early) == std::vector< std::string > { "a", "b", "c" });
+    CHECK(drain(late) == std::vector< std::string > { "b", "c" });
+    CHECK(early.lag() == 0);
+}
+
+TEST_CASE("broadcast channel destroys values once every cursor passes")
+{
+    auto ioc  = asio::io_context();
+    auto c    = channels::broadcast_channel< tracked >(ioc.get_executor(), 4);
+    auto impl = c.get_implementation();
+    auto live = std::make_shared< int >();
+
+    auto rx1 = c.subscribe();
+    auto rx2 = c.subscribe();
+
+    channels::error_code ec;
+    for (int i = 0; i < 3; ++i)
+        CHECK(c.try_send(tracked(live), ec));
+    CHECK(live.use_count() == 4);
+    CHECK(impl->size() == 3);
+
+    while (rx1.consume_if(ec))
+        ;
+    CHECK(live.use_count() == 4);
+
+    CHECK(rx2.consume_if(ec));
+    CHECK(live.use_count() == 3);
+
+    // dropping the slowest subscriber releases what only it needed
+    rx2 = c.subscribe();
+    CHECK(live.use_count() == 1);
+    CHECK(impl->size() == 0);
+
+    // without subscribers, values are not kept at all
+    auto none = channels::broadcast_channel< tracked >(ioc.get_executor(), 4);
+    CHECK(none.try_send(tracked(live), ec));
+    CHECK(live.use_count() == 1);
+}
+
+TEST_CASE("broadcast channel blocks on the slowest subscriber")
+{
+    auto ioc  = asio::io_context();
+    auto c    = string_channel(ioc.get_executor(), 2);
+    auto fast = c.subscribe();
+    auto slow = c.subscribe();
+
+    int sent = 0;
+    for (auto s : { "a", "b", "c", "d" })
+        c.async_send(s, [&](channels::error_code ec) {
+            CHECK(!ec);
+            ++sent;
+        });
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 2);
+
+    // the fast subscriber alone does not make room
+    CHECK(drain(fast) == std::vector< std::string > { "a", "b" });
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 2);
+
+    channels::error_code ec;
+    CHECK(slow.consume_if(ec) == "a");
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 3);
+
+    // each value taken admits the next waiting sender
+    CHECK(drain(slow) == std::vector< std::string > { "b", "c", "d" });
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 4);
+    CHECK(drain(fast) == std::vector< std::string > { "c", "d" });
+}
+
+TEST_CASE("broadcast channel lags slow subscribers under drop_oldest")
+{
+    auto ioc  = asio::io_context();
+    auto c    = string_channel(
+        ioc.get_executor(), 2, channels::overflow_policy::drop_oldest);
+    auto fast = c.subscribe();
+    auto slow = c.subscribe();
+
+    channels::error_code ec;
+    for (auto s : { "a", "b", "c", "d" })
+    {
+        CHECK(c.try_send(s, ec));
+        CHECK(fast.consume_if(ec) == s);
+    }
+
+    CHECK(slow.missed() == 2);
+    CHECK(fast.missed() == 0);
+    CHECK(c.counters().dropped_oldest == 2);
+    CHECK(drain(slow) == std::vector< std::string > { "c", "d" });
+}
+
+TEST_CASE("closed broadcast channel drains each subscriber")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 2);
+    auto rx1 = c.subscribe();
+    auto rx2 = c.subscribe();
+
+    channels::error_code ec;
+    CHECK(c.try_send("a", ec));
+
+    std::vector< channels::error_code > errors;
+    for (int i = 0; i < 2; ++i)
+        rx1.async_consume([&](channels::error_code ec, std::string) {
+            errors.push_back(ec);
+        });
+    ioc.poll();
+    ioc.restart();
+
+    c.close();
+    ioc.poll();
+    ioc.restart();
+    REQUIRE(errors.size() == 2);
+    CHECK(!errors[0]);
+    CHECK(errors[1] == channels::errors::channel_closed);
+
+    CHECK(!c.try_send("b", ec));
+    CHECK(ec == channels::errors::channel_closed);
+
+    CHECK(rx2.consume_if(ec) == "a");
+    CHECK(!rx2.consume_if(ec));
+    CHECK(ec == channels::errors::channel_closed);
+}
@@ -0,0 +1,242 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/broadcast_channel.hpp>
+#include <boost/channels/channel.hpp>
+#include <boost/channels/channel_consumer.hpp>
+#include <boost/channels/detail/cancellation.hpp>
+#include <boost/channels/priority_channel.hpp>
+#include <boost/channels/tie.hpp>
+#include <boost/channels/watch_channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#ifdef BOOST_CHANNELS_HAS_CANCELLATION_SLOT
+#include <boost/asio/bind_cancellation_slot.hpp>
+#include <boost/asio/cancellation_signal.hpp>
+#endif
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace boost;
+using namespace std::literals;
+
+TEST_CASE("withdrawn ops leave the queue and complete as aborted")
+{
+    using string_channel = channels::channel< std::string >;
+
+    auto ioc  = asio::io_context();
+    auto c    = string_channel(ioc.get_executor());
+    auto impl = c.get_implementation();
+
+    std::optional< channels::error_code > consumed;
+    auto consumer = channels::detail::
+        make_consumer_op_function< std::string, std::mutex >(
+            ioc.get_executor(),
+            [&](channels::error_code ec, std::string) { consumed = ec; });
+    impl->submit_consume_op(consumer);
+    CHECK(impl->consumers_waiting() == 1);
+
+    CHECK(channels::detail::cancel_parked_op(impl.get(), *consumer));
+    CHECK(impl->consumers_waiting() == 0);
+    CHECK(!channels::detail::cancel_parked_op(impl.get(), *consumer));
+
+    ioc.run();
+    CHECK(consumed == asio::error::operation_aborted);
+
+    // a cancelled send hands its value back if it can
+    std::optional< std::string > returned;
+    auto producer = channels::detail::make_timed_producer_op< std::mutex >(
+        "a"s,
+        std::weak_ptr< string_channel::impl_type >(impl),
+        channels::detail::timer_service::of(ioc.get_executor()),
+        ioc.get_executor(),
+        [&](channels::error_code ec, std::optional< std::string > v) {
+            CHECK(ec == asio::error::operation_aborted);
+            returned = v;
+        });
+    impl->submit_produce_op(producer);
+    CHECK(impl->producers_waiting() == 1);
+    CHECK(channels::detail::cancel_parked_op(impl.get(), *producer));
+    CHECK(impl->producers_waiting() == 0);
+
+    ioc.restart();
+    ioc.run();
+    CHECK(returned == "a");
+}
+
+TEST_CASE("withdrawn ops leave priority, broadcast and watch channels")
+{
+    auto ioc = asio::io_context();
+
+    std::vector< channels::error_code > results;
+    auto on_send    = [&](channels::error_code ec) { results.push_back(ec); };
+    auto on_consume = [&](channels::error_code ec, int) {
+        results.push_back(ec);
+    };
+
+    // a send parked on a lower lane is found and that lane left idle
+    auto pc    = channels::priority_channel< int, 3 >(ioc.get_executor());
+    auto pimpl = pc.get_implementation();
+    auto pprod = channels::detail::make_producer_op_function< std::mutex >(
+        1, ioc.get_executor(), on_send);
+    pimpl->submit_produce_op(2, pprod);
+    CHECK(pimpl->producers_waiting(2) == 1);
+    CHECK(channels::detail::cancel_parked_op(pimpl.get(), *pprod));
+    CHECK(pimpl->producers_waiting(2) == 0);
+    channels::error_code ec;
+    CHECK(!pc.consume_if(ec));
+
+    auto pcons = channels::detail::make_consumer_op_function< int, std::mutex >(
+        ioc.get_executor(), on_consume);
+    pimpl->submit_consume_op(pcons);
+    CHECK(channels::detail::cancel_parked_op(pimpl.get(), *pcons));
+    CHECK(pimpl->consumers_waiting() == 0);
+
+    // a receive is found in its own subscriber's queue
+    auto bc    = channels::broadcast_channel< int >(ioc.get_executor(), 1);
+    auto bimpl = bc.get_implementation();
+    auto rx    = bc.subscribe();
+    auto sub   = bimpl->subscribe();
+    auto bcons = channels::detail::make_consumer_op_function< int, std::mutex >(
+        ioc.get_executor(), on_consume);
+    bimpl->submit_consume_op(*sub, bcons);
+    CHECK(channels::detail::cancel_parked_op(bimpl.get(), *bcons));
+    bimpl->unsubscribe(sub);
+
+    CHECK(bc.try_send(1, ec));
+    auto bprod = channels::detail::make_producer_op_function< std::mutex >(
+        2, ioc.get_executor(), on_send);
+    bimpl->submit_produce_op(bprod);
+    CHECK(bimpl->producers_waiting() == 1);
+    CHECK(channels::detail::cancel_parked_op(bimpl.get(), *bprod));
+    CHECK(bimpl->producers_waiting() == 0);
+
+    // a watch consume leaves the receiver's version alone
+    auto wc     = channels::watch_channel< int >(ioc.get_executor());
+    auto wimpl  = wc.get_implementation();
+    auto cursor = std::make_shared< std::uint64_t >(0);
+    auto wcons  = channels::detail::make_watch_consumer_op< int, std::mutex >(
+        ioc.get_executor(), on_consume, cursor);
+    wimpl->submit_consume_op(0, wcons);
+    CHECK(wimpl->consumers_waiting() == 1);
+    CHECK(channels::detail::cancel_parked_op(wimpl.get(), *wcons));
+    CHECK(wimpl->consumers_waiting() == 0);
+
+    ioc.run();
+    CHECK(results == std::vector< channels::error_code >(
+                         5, asio::error::operation_aborted));
+    CHECK(*cursor == 0);
+}
+
+#ifdef BOOST_CHANNELS_HAS_CANCELLATION_SLOT
+
+TEST_CASE("cancellation slots withdraw parked sends and consumes")
+{
+    auto ioc  = asio::io_context();
+    auto c    = channels::channel< std::string >(ioc.get_executor());
+    auto impl = c.get_implementation();
+
+    asio::cancellation_signal sig_consume, sig_send, sig_send_for;
+
+    std::optional< channels::error_code > consumed, sent;
+    c.async_consume(asio::bind_cancellation_slot(
+        sig_consume.slot(),
+        [&](channels::error_code ec, std::string) { consumed = ec; }));
+    ioc.poll();
+    ioc.restart();
+    CHECK(impl->consumers_waiting() == 1);
+
+    sig_consume.emit(asio::cancellation_type::terminal);
+    CHECK(impl->consumers_waiting() == 0);
+
+    c.async_send("a",
+                 asio::bind_cancellation_slot(
+                     sig_send.slot(),
+                     [&](channels::error_code ec) { sent = ec; }));
+    std::optional< std::string > returned;
+    c.async_send_for(
+        "b",
+        1h,
+        asio::bind_cancellation_slot(
+            sig_send_for.slot(),
+            [&](channels::error_code ec, std::optional< std::string > v) {
+                CHECK(ec == asio::error::operation_aborted);
+                returned = v;
+            }));
+    CHECK(impl->producers_waiting() == 2);
+
+    sig_send.emit(asio::cancellation_type::partial);
+    sig_send_for.emit(asio::cancellation_type::total);
+    CHECK(impl->producers_waiting() == 0);
+
+    // nothing is left to keep the context running
+    ioc.run();
+    CHECK(consumed == asio::error::operation_aborted);
+    CHECK(sent == asio::error::operation_aborted);
+    CHECK(returned == "b");
+
+    // a signal after completion has no effect
+    sig_consume.emit(asio::cancellation_type::terminal);
+    ioc.restart();
+    CHECK(ioc.poll() == 0);
+}
+
+TEST_CASE("completed ops clear their cancellation slots")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor());
+
+    asio::cancellation_signal    sig;
+    std::optional< std::string > received;
+    c.async_consume(asio::bind_cancellation_slot(
+        sig.slot(),
+        [&](channels::error_code ec, std::string s) {
+            CHECK(!ec);
+            received = s;
+        }));
+    CHECK(sig.slot().has_handler());
+
+    c.async_send("a", [](channels::error_code) {});
+    ioc.run();
+    CHECK(received == "a");
+
+    // the canceller, and the op it referred to, are gone
+    CHECK(!sig.slot().has_handler());
+}
+
+TEST_CASE("cancellation slots withdraw every branch of a tie")
+{
+    auto ioc = asio::io_context();
+    auto c1  = channels::channel< std::string >(ioc.get_executor());
+    auto c2  = channels::channel< std::string >(ioc.get_executor());
+
+    asio::cancellation_signal            sig;
+    std::optional< channels::error_code > result;
+    std::string                           s1, s2;
+    channels::tie(s1 << c1, s2 << c2)
+        .async_wait(asio::bind_cancellation_slot(
+            sig.slot(),
+            [&](channels::error_code ec, int) { result = ec; }));
+    CHECK(c1.get_implementation()->consumers_waiting() == 1);
+
+    sig.emit(asio::cancellation_type::terminal);
+    ioc.run();
+    CHECK(result == asio::error::operation_aborted);
+    CHECK(c1.get_implementation()->consumers_waiting() == 0);
+    CHECK(c2.get_implementation()->consumers_waiting() == 0);
+}
+
+#endif
@@ -0,0 +1,170 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace boost;
+
+namespace {
+
+using string_channel = channels::channel< std::string >;
+using string_slot    = string_channel::send_slot_type;
+
+string_slot
+claim(asio::io_context &ioc, string_channel &c)
+{
+    string_slot          result;
+    channels::error_code ec;
+    c.async_claim([&](channels::error_code e, string_slot s) {
+        ec     = e;
+        result = std::move(s);
+    });
+    ioc.poll();
+    ioc.restart();
+    CHECK(!ec);
+    return result;
+}
+
+}   // namespace
+
+TEST_CASE("a claimed slot is invisible until published")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 4);
+
+    auto slot = claim(ioc, c);
+    REQUIRE(slot);
+    slot.emplace(3, 'x');
+    slot.value() += "yz";
+
+    std::vector< std::string > received;
+    c.async_consume([&](channels::error_code e, std::string s) {
+        CHECK(!e);
+        received.push_back(std::move(s));
+    });
+    ioc.poll();
+    ioc.restart();
+    CHECK(received.empty());
+    CHECK(c.get_implementation()->consumers_waiting() == 1);
+
+    channels::error_code ec;
+    slot.publish(ec);
+    CHECK(!ec);
+    CHECK(!slot);
+    ioc.poll();
+
+    CHECK(received == std::vector< std::string > { "xxxyz" });
+}
+
+TEST_CASE("sends wait behind a claimed slot")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 4);
+
+    auto slot = claim(ioc, c);
+    c.async_send("second", [](channels::error_code e) { CHECK(!e); });
+    ioc.poll();
+    ioc.restart();
+    CHECK(c.get_implementation()->producers_waiting() == 1);
+
+    slot.emplace("first");
+    channels::error_code ec;
+    slot.publish(ec);
+    CHECK(!ec);
+    CHECK(c.get_implementation()->producers_waiting() == 0);
+
+    CHECK(c.consume_if(ec) == "first");
+    CHECK(c.consume_if(ec) == "second");
+}
+
+TEST_CASE("a slot which is not published is given back")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 1);
+
+    auto slot = claim(ioc, c);
+    slot.emplace("discarded");
+    c.async_send("sent", [](channels::error_code e) { CHECK(!e); });
+    ioc.poll();
+    ioc.restart();
+    CHECK(c.get_implementation()->producers_waiting() == 1);
+
+    slot.reset();
+    CHECK(!slot);
+    CHECK(c.get_implementation()->producers_waiting() == 0);
+
+    channels::error_code ec;
+    CHECK(c.consume_if(ec) == "sent");
+    CHECK(!c.consume_if(ec));
+}
+
+TEST_CASE("claims which cannot be granted")
+{
+    auto ioc = asio::io_context();
+
+    SUBCASE("unbuffered channel")
+    {
+        auto c = string_channel(ioc.get_executor());
+
+        channels::error_code ec;
+        string_slot          slot;
+        c.async_claim([&](channels::error_code e, string_slot s) {
+            ec   = e;
+            slot = std::move(s);
+        });
+        ioc.poll();
+
+        CHECK(ec == channels::errors::channel_unbuffered);
+        CHECK(!slot);
+    }
+
+    SUBCASE("closed while waiting for space")
+    {
+        auto c = string_channel(ioc.get_executor(), 1);
+        c.async_send("full", [](channels::error_code) {});
+
+        channels::error_code ec;
+        string_slot          slot;
+        c.async_claim([&](channels::error_code e, string_slot s) {
+            ec   = e;
+            slot = std::move(s);
+        });
+        ioc.poll();
+        ioc.restart();
+        CHECK(c.get_implementation()->producers_waiting() == 1);
+
+        c.close();
+        ioc.poll();
+
+        CHECK(ec == channels::errors::channel_closed);
+        CHECK(!slot);
+    }
+
+    SUBCASE("closed while the slot is held")
+    {
+        auto c    = string_channel(ioc.get_executor(), 1);
+        auto slot = claim(ioc, c);
+        slot.emplace("late");
+
+        c.close();
+        ioc.poll();
+
+        channels::error_code ec;
+        slot.publish(ec);
+        CHECK(ec == channels::errors::channel_closed);
+        CHECK(!slot);
+    }
+}
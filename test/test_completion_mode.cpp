@@ -0,0 +1,437 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+#include <boost/channels/channel_consumer.hpp>
+#include <boost/channels/detail/completion_scope.hpp>
+#include <boost/channels/tie.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace boost;
+
+TEST_CASE("completion_mode decides whether a matched consume runs inline")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor());
+    CHECK(c.get_completion_mode() == channels::completion_mode::post);
+
+    std::string received;
+    bool        sent = false;
+    c.async_consume([&](channels::error_code ec, std::string s) {
+        CHECK(!ec);
+        // the channel's mutex has been released
+        CHECK(c.get_implementation()->consumers_waiting() == 0);
+        received = std::move(s);
+    });
+
+    SUBCASE("post")
+    {
+        asio::post(ioc, [&] {
+            c.async_send("a", [&](channels::error_code) { sent = true; });
+            CHECK(received.empty());
+            CHECK(!sent);
+        });
+        ioc.run();
+    }
+
+    SUBCASE("dispatch")
+    {
+        c.set_completion_mode(channels::completion_mode::dispatch);
+        asio::post(ioc, [&] {
+            c.async_send("a", [&](channels::error_code) { sent = true; });
+            CHECK(received == "a");
+            CHECK(sent);
+        });
+        ioc.run();
+    }
+
+    SUBCASE("dispatch from a thread not running the executor")
+    {
+        c.set_completion_mode(channels::completion_mode::dispatch);
+        c.async_send("a", [&](channels::error_code) { sent = true; });
+        CHECK(received.empty());
+        ioc.run();
+    }
+
+    CHECK(received == "a");
+    CHECK(sent);
+}
+
+TEST_CASE("every kind of op completes inline under dispatch")
+{
+    using namespace std::chrono_literals;
+
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), 1);
+    c.set_completion_mode(channels::completion_mode::dispatch);
+
+    bool completed = false;
+    auto done      = [&](auto &&...) { completed = true; };
+
+    // an op parked on the channel, and the call which completes it
+    std::function< void() > complete = [&] {
+        c.async_send(1, [](channels::error_code) {});
+    };
+
+    std::vector< int > values;
+    int                value = 0;
+    SUBCASE("consume_some")
+    {
+        c.async_consume_some(4, values, done);
+    }
+    SUBCASE("consume_inplace")
+    {
+        c.async_consume_inplace([](int &) {}, done);
+    }
+    SUBCASE("consume_for")
+    {
+        c.async_consume_for(1h, done);
+    }
+    SUBCASE("select")
+    {
+        channels::tie(value << c).async_wait(done);
+    }
+    SUBCASE("send_range")
+    {
+        values = { 1, 2 };
+        c.async_send_range(values.begin(), values.end(), done);
+        complete = [&] { c.async_consume([](channels::error_code, int) {}); };
+    }
+    SUBCASE("send_for")
+    {
+        c.async_send(0, [](channels::error_code) {});
+        c.async_send_for(1, 1h, done);
+        complete = [&] { c.async_consume([](channels::error_code, int) {}); };
+    }
+    SUBCASE("claim")
+    {
+        c.async_send(0, [](channels::error_code) {});
+        c.async_claim(done);
+        complete = [&] { c.async_consume([](channels::error_code, int) {}); };
+    }
+
+    ioc.poll();
+    ioc.restart();
+    REQUIRE(!completed);
+    asio::post(ioc, [&] {
+        complete();
+        CHECK(completed);
+    });
+    ioc.run();
+    CHECK(completed);
+}
+
+TEST_CASE("inline completions are bounded by the thread's budget")
+{
+    auto ioc = asio::io_context();
+    auto c1  = channels::channel< int >(ioc.get_executor());
+    auto c2  = channels::channel< int >(ioc.get_executor());
+    c1.set_completion_mode(channels::completion_mode::dispatch);
+    c2.set_completion_mode(channels::completion_mode::dispatch);
+
+    // two loops which feed each other would recurse without limit if every
+    // completion ran inline
+    constexpr int rounds    = 10000;
+    std::size_t   max_depth = 0;
+    int           last      = 0;
+
+    std::function< void(channels::channel< int > &,
+                        channels::channel< int > &) >
+        echo = [&](channels::channel< int > &in, channels::channel< int > &out) {
+            in.async_consume([&](channels::error_code ec, int v) {
+                if (ec)
+                    return;
+                max_depth = std::max(max_depth,
+                                     channels::detail::inline_depth());
+                last = v;
+                if (v < rounds)
+                {
+                    echo(in, out);
+                    out.async_send(v + 1, [](channels::error_code) {});
+                }
+                else
+                    out.close();
+            });
+        };
+    echo(c1, c2);
+    echo(c2, c1);
+    asio::post(ioc, [&] { c1.async_send(0, [](channels::error_code) {}); });
+    ioc.run();
+
+    CHECK(last == rounds);
+    CHECK(max_depth > 1);
+    CHECK(max_depth <= BOOST_CHANNELS_INLINE_DEPTH);
+    CHECK(channels::detail::inline_depth() == 0);
+}
+
+TEST_CASE("noexcept members post handlers which dispatch would run inline")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor(), 1);
+    c.set_completion_mode(channels::completion_mode::dispatch);
+
+    // the handlers are bound to the io_context, so that they throw from run()
+    bool returned = false;
+    auto check    = [&] {
+        CHECK(returned);
+        throw std::runtime_error("handler");
+    };
+
+    SUBCASE("close")
+    {
+        c.async_consume(asio::bind_executor(
+            ioc, [&](channels::error_code ec, std::string) {
+                CHECK(ec == channels::errors::channel_closed);
+                check();
+            }));
+        ioc.poll();
+        ioc.restart();
+        asio::post(ioc, [&] {
+            c.close();
+            returned = true;
+        });
+    }
+
+    SUBCASE("releasing an unpublished slot")
+    {
+        auto slot = channels::channel< std::string >::send_slot_type();
+        c.async_claim([&](channels::error_code ec, auto s) {
+            CHECK(!ec);
+            slot = std::move(s);
+        });
+        c.async_send("waiting",
+                     asio::bind_executor(ioc, [&](channels::error_code ec) {
+                         CHECK(!ec);
+                         check();
+                     }));
+        ioc.poll();
+        ioc.restart();
+        REQUIRE(slot);
+        asio::post(ioc, [&] {
+            slot.reset();
+            returned = true;
+        });
+    }
+
+    CHECK_THROWS_AS(ioc.run(), std::runtime_error);
+}
+
+TEST_CASE("completions made together are posted once per executor")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor());
+
+    constexpr int      waiters = 1000;
+    std::vector< int > order;
+    for (int i = 0; i < waiters; ++i)
+        c.async_consume([&, i](channels::error_code ec, int) {
+            CHECK(ec == channels::errors::channel_closed);
+            order.push_back(i);
+        });
+
+    SUBCASE("one executor")
+    {
+        // the scheduler runs as many functions as it would for one waiter
+        auto lone = [] {
+            auto ioc = asio::io_context();
+            auto c   = channels::channel< int >(ioc.get_executor());
+            c.async_consume([](channels::error_code, int) {});
+            c.close();
+            return ioc.run();
+        };
+        c.close();
+        CHECK(ioc.run() == lone());
+        REQUIRE(order.size() == waiters);
+        CHECK(std::is_sorted(order.begin(), order.end()));
+    }
+
+    SUBCASE("a strand is a separate executor")
+    {
+        auto strand = asio::make_strand(ioc);
+        bool ran    = false;
+        c.async_consume(asio::bind_executor(
+            strand, [&](channels::error_code, int) {
+                CHECK(strand.running_in_this_thread());
+                ran = true;
+            }));
+        c.close();
+        ioc.run();
+        CHECK(ran);
+        CHECK(order.size() == waiters);
+    }
+
+    SUBCASE("a throwing handler does not strand the rest")
+    {
+        c.async_consume([](channels::error_code, int) {
+            throw std::runtime_error("handler");
+        });
+        c.async_consume([&](channels::error_code, int) { order.push_back(-1); });
+        c.close();
+        CHECK_THROWS_AS(ioc.run(), std::runtime_error);
+        ioc.restart();
+        ioc.run();
+        REQUIRE(order.size() == waiters + 1);
+        CHECK(order.back() == -1);
+    }
+}
+
+TEST_CASE("unrun batched handlers are destroyed with their io_context")
+{
+    auto token = std::make_shared< int >();
+    {
+        auto ioc = asio::io_context();
+        auto c   = channels::channel< int >(ioc.get_executor());
+        for (int i = 0; i < 2; ++i)
+            c.async_consume([token](channels::error_code, int) {});
+        c.close();
+        CHECK(token.use_count() == 3);
+    }
+    CHECK(token.use_count() == 1);
+}
+
+namespace {
+
+template < class Executor, class Handler >
+void
+commit_consumer(Executor const &exec, Handler handler, std::string value)
+{
+    auto op = channels::detail::
+        make_consumer_op_function< std::string, std::mutex >(
+            exec, std::move(handler));
+    REQUIRE(op->state().claim());
+    op->commit({ channels::error_code(), std::move(value) });
+}
+
+}   // namespace
+
+TEST_CASE("ops on one executor are posted as one batch however they interleave")
+{
+    auto token = std::make_shared< int >();
+    auto value = [](int i) { return std::string(64, char('a' + i)); };
+
+    std::vector< std::string > received;
+    auto handler = [&received, token](channels::error_code, std::string s) {
+        received.push_back(std::move(s));
+    };
+
+    // six ops on the io_context and two on a strand, interleaved, whose
+    // values are held by their ops until the scope ends
+    auto complete = [&](asio::io_context &ioc) {
+        auto strand = asio::make_strand(ioc);
+        auto scope =
+            channels::detail::completion_scope(channels::completion_mode::post);
+        for (int i = 0; i < 8; ++i)
+            if (i % 4 == 3)
+                commit_consumer(strand, handler, value(i));
+            else
+                commit_consumer(ioc.get_executor(), handler, value(i));
+    };
+
+    SUBCASE("run")
+    {
+        auto ioc = asio::io_context();
+        complete(ioc);
+        CHECK(received.empty());
+        ioc.run();
+        REQUIRE(received.size() == 8);
+
+        // each executor sees its handlers in the order they completed
+        auto on_strand = [&](std::string const &s) {
+            return s == value(3) || s == value(7);
+        };
+        std::stable_partition(received.begin(), received.end(), on_strand);
+        CHECK(received ==
+              std::vector< std::string > { value(3), value(7), value(0),
+                                           value(1), value(2), value(4),
+                                           value(5), value(6) });
+    }
+
+    SUBCASE("one post per executor")
+    {
+        // the scheduler runs as many functions as it would for one op on
+        // each executor
+        auto one_each = [&] {
+            auto ioc    = asio::io_context();
+            auto strand = asio::make_strand(ioc);
+            {
+                auto scope = channels::detail::completion_scope(
+                    channels::completion_mode::post);
+                commit_consumer(ioc.get_executor(), handler, value(0));
+                commit_consumer(strand, handler, value(3));
+            }
+            return ioc.run();
+        };
+        auto expected = one_each();
+        received.clear();
+
+        auto ioc = asio::io_context();
+        complete(ioc);
+        CHECK(ioc.run() == expected);
+        CHECK(received.size() == 8);
+    }
+
+    SUBCASE("more executors than can be gathered")
+    {
+        // groups are posted early, and then only neighbours are gathered,
+        // but every executor's handlers stay in order
+        auto ioc = asio::io_context();
+        std::vector< asio::strand< asio::io_context::executor_type > > strands;
+        for (int i = 0; i < 100; ++i)
+            strands.push_back(asio::make_strand(ioc));
+        {
+            auto scope = channels::detail::completion_scope(
+                channels::completion_mode::post);
+            for (int i = 0; i < 400; ++i)
+                if (i % 2)
+                    commit_consumer(
+                        strands[(i / 2) % 100], handler, std::to_string(i));
+                else
+                    commit_consumer(
+                        ioc.get_executor(), handler, std::to_string(i));
+        }
+        ioc.run();
+        REQUIRE(received.size() == 400);
+
+        std::vector< int > order;
+        for (auto &s : received)
+            order.push_back(std::stoi(s));
+        auto strand_of = [](int i) { return i % 2 ? (i / 2) % 100 : -1; };
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return strand_of(a) < strand_of(b);
+        });
+        for (std::size_t k = 1; k < order.size(); ++k)
+            if (strand_of(order[k - 1]) == strand_of(order[k]))
+                CHECK(order[k - 1] < order[k]);
+    }
+
+    SUBCASE("discarded")
+    {
+        {
+            auto ioc = asio::io_context();
+            complete(ioc);
+            CHECK(token.use_count() == 10);
+        }
+        CHECK(token.use_count() == 2);
+        CHECK(received.empty());
+    }
+}
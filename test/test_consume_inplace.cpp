@@ -0,0 +1,131 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <doctest/doctest.h>
+
+using namespace boost;
+
+namespace {
+
+// a value which counts how often it is moved
+struct counted
+{
+    static inline int moves = 0;
+
+    counted(int v = 0)
+    : value(v)
+    {
+    }
+
+    counted(counted &&other) noexcept
+    : value(other.value)
+    {
+        ++moves;
+    }
+
+    counted &
+    operator=(counted &&other) noexcept
+    {
+        value = other.value;
+        ++moves;
+        return *this;
+    }
+
+    int value;
+};
+
+}   // namespace
+
+TEST_CASE("async_consume_inplace visits a buffered value in its slot")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< counted >(ioc.get_executor(), 1);
+
+    c.async_send(counted(7), [](channels::error_code e) { CHECK(!e); });
+    ioc.poll();
+    ioc.restart();
+
+    counted::moves = 0;
+    int                  seen = 0;
+    channels::error_code ec   = channels::errors::channel_null;
+    c.async_consume_inplace([&](counted &v) { seen = v.value; },
+                            [&](channels::error_code e) { ec = e; });
+    ioc.poll();
+
+    CHECK(!ec);
+    CHECK(seen == 7);
+    CHECK(counted::moves == 0);
+}
+
+TEST_CASE("async_consume_inplace visits a value in the sender")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< counted >(ioc.get_executor());
+
+    SUBCASE("sender waiting")
+    {
+        c.async_send(counted(1), [](channels::error_code e) { CHECK(!e); });
+        ioc.poll();
+        CHECK(c.get_implementation()->producers_waiting() == 1);
+
+        counted::moves = 0;
+        int seen       = 0;
+        c.async_consume_inplace([&](counted &x) { seen = x.value; },
+                                [](channels::error_code e) { CHECK(!e); });
+        ioc.run();
+
+        CHECK(seen == 1);
+        CHECK(counted::moves == 0);
+    }
+
+    SUBCASE("consumer waiting")
+    {
+        // the send moves the value into its op, so compare against a
+        // consumer which takes the value by move
+        counted::moves = 0;
+        c.async_consume([](channels::error_code e, counted) { CHECK(!e); });
+        c.async_send(counted(2), [](channels::error_code) {});
+        ioc.run();
+        ioc.restart();
+        auto const moved = counted::moves;
+
+        counted::moves = 0;
+        int seen       = 0;
+        c.async_consume_inplace([&](counted &x) { seen = x.value; },
+                                [](channels::error_code e) { CHECK(!e); });
+        c.async_send(counted(3), [](channels::error_code) {});
+        ioc.run();
+
+        CHECK(seen == 3);
+        CHECK(counted::moves < moved);
+    }
+}
+
+TEST_CASE("async_consume_inplace on a closed channel")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< counted >(ioc.get_executor(), 1);
+
+    c.close();
+    ioc.poll();
+    ioc.restart();
+
+    auto                 visited = false;
+    channels::error_code ec;
+    c.async_consume_inplace([&](counted &) { visited = true; },
+                            [&](channels::error_code e) { ec = e; });
+    ioc.poll();
+
+    CHECK(!visited);
+    CHECK(ec == channels::errors::channel_closed);
+}
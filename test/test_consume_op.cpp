@@ -7,9 +7,11 @@
 // Official repository: https://github.com/madmongo1/boost_channels
 //
 
+#include <boost/channels/channel.hpp>
 #include <boost/channels/detail/implement_channel_queue.hpp>
 #include <boost/channels/scope_exit.hpp>
 
+#include <boost/asio/io_context.hpp>
 #include <boost/assert.hpp>
 
 #include <atomic>
@@ -29,27 +31,19 @@ namespace {
 struct test_consumer final
 : channels::detail::consume_op_interface< std::string >
 {
-    void
-    commit(value_type &&source) override
-    {
-        REQUIRE(!mutex_.try_lock());
-        REQUIRE(!target.has_value());
-        target.emplace(std::move(source));
-    }
-
-    bool
-    completed() const override
+    test_consumer()
+    : basic_consume_op_interface(this)
     {
-        return target.has_value();
     }
 
-    mutex_type &
-    get_mutex() override
+    void
+    commit(value_type &&source)
     {
-        return mutex_;
+        REQUIRE(state().claimed());
+        REQUIRE(!target.has_value());
+        target.emplace(std::move(source));
     }
 
-    mutex_type                  mutex_;
     std::optional< value_type > target;
 };
 
@@ -57,16 +51,17 @@ struct test_producer final
 : channels::detail::produce_op_interface< std::string >
 {
     test_producer(std::string source)
-    : source(std::move(source))
+    : basic_produce_op_interface(this)
+    , source(std::move(source))
     {
     }
 
     std::string
-    consume() override
+    consume()
     {
         REQUIRE(source.has_value());
         REQUIRE(!completed_);
-        REQUIRE(!mutex_.try_lock());
+        REQUIRE(state().claimed());
         auto result = std::move(*source);
         source.reset();
         completed_ = true;
@@ -74,33 +69,27 @@ struct test_producer final
     }
 
     void
-    fail(channels::error_code ec) override
+    fail(channels::error_code ec)
     {
         REQUIRE(source.has_value());
         REQUIRE(!completed_);
-        REQUIRE(!mutex_.try_lock());
+        REQUIRE(state().claimed());
         this->ec   = ec;
         completed_ = true;
     }
 
-    bool
-    completed() const override
-    {
-        return completed_;
-    }
-
-    mutex_type &
-    get_mutex() override
-    {
-        return mutex_;
-    }
-
-    mutex_type                   mutex_;
     channels::error_code         ec;
     std::optional< std::string > source;
     bool                         completed_ = false;
 };
 
+template < class Op, class... Args >
+boost::intrusive_ptr< Op >
+make_op(Args &&...args)
+{
+    return boost::intrusive_ptr< Op >(new Op(std::forward< Args >(args)...));
+}
+
 }   // namespace
 TEST_CASE("flush values(0) consumers(0) producers(0)")
 {
@@ -144,7 +133,7 @@ TEST_CASE("flush values(0) consumers(0) producers(1)")
     channels::detail::producer_queue< std::string > producers;
 
     std::string const original0 = "0123456789012345678901234567890123456789";
-    auto              p0        = std::make_shared< test_producer >(original0);
+    auto              p0        = make_op< test_producer >(original0);
     producers.push(p0);
 
     SUBCASE("not closed")
@@ -185,7 +174,7 @@ TEST_CASE("flush values(0) consumers(1) producers(0)")
     channels::detail::consumer_queue< std::string > consumers;
     channels::detail::producer_queue< std::string > producers;
 
-    auto c0 = std::make_shared< test_consumer >();
+    auto c0 = make_op< test_consumer >();
     consumers.push(c0);
 
     SUBCASE("not closed")
@@ -226,9 +215,9 @@ TEST_CASE("flush values(0) consumers(1) producers(1)")
     channels::detail::producer_queue< std::string > producers;
 
     std::string const original0 = "0123456789012345678901234567890123456789";
-    auto              p0        = std::make_shared< test_producer >(original0);
+    auto              p0        = make_op< test_producer >(original0);
     producers.push(p0);
-    auto c0 = std::make_shared< test_consumer >();
+    auto c0 = make_op< test_consumer >();
     consumers.push(c0);
 
     SUBCASE("not closed")
@@ -266,6 +255,73 @@ TEST_CASE("flush values(0) consumers(1) producers(1)")
     }
 }
 
+TEST_CASE("op queue erase")
+{
+    channels::detail::producer_queue< std::string > producers;
+
+    auto p0 = make_op< test_producer >("a");
+    auto p1 = make_op< test_producer >("b");
+    auto p2 = make_op< test_producer >("c");
+    producers.push(p0);
+    producers.push(p1);
+    producers.push(p2);
+    CHECK(producers.size() == 3);
+
+    // removing from the middle preserves the order of the rest
+    auto removed = producers.erase(p1.get());
+    CHECK(removed == p1);
+    CHECK(!producers.linked(*p1));
+    CHECK(producers.size() == 2);
+    CHECK(producers.front() == p0.get());
+    CHECK(producers.pop() == p0);
+    CHECK(producers.front() == p2.get());
+
+    // an erased op may be queued again
+    producers.push(p1);
+    CHECK(producers.erase(p2.get()) == p2);
+    CHECK(producers.pop() == p1);
+    CHECK(producers.empty());
+}
+
+TEST_CASE("completion state claims")
+{
+    using channels::detail::claim_pair;
+    using channels::detail::claim_pair_result;
+    using channels::detail::completion_state;
+
+    completion_state a, b;
+
+    // a released claim may be taken again
+    REQUIRE(a.claim());
+    CHECK(a.claimed());
+    a.release();
+    CHECK(!a.claimed());
+    CHECK(!a.completed());
+
+    SUBCASE("pair")
+    {
+        REQUIRE(claim_pair(b, a) == claim_pair_result::claimed);
+        CHECK(a.claimed());
+        CHECK(b.claimed());
+        a.commit();
+        b.release();
+
+        // a completed state is reported, whichever address is lower, and no
+        // claim is left on the other
+        CHECK(claim_pair(a, b) == claim_pair_result::first_completed);
+        CHECK(claim_pair(b, a) == claim_pair_result::second_completed);
+        CHECK(!b.claimed());
+    }
+
+    SUBCASE("same state")
+    {
+        CHECK(claim_pair(a, a) == claim_pair_result::same_state);
+        a.commit();
+        CHECK(!a.claim());
+        CHECK(claim_pair(a, a) == claim_pair_result::first_completed);
+    }
+}
+
 TEST_CASE("flush 1 0 0")
 {
 }
@@ -281,3 +337,100 @@ TEST_CASE("flush 1 1 0")
 TEST_CASE("flush 1 1 1")
 {
 }
+
+namespace {
+
+template < class T >
+struct counting_allocator
+{
+    using value_type = T;
+
+    explicit counting_allocator(int &count)
+    : count(&count)
+    {
+    }
+
+    template < class U >
+    counting_allocator(counting_allocator< U > const &other)
+    : count(other.count)
+    {
+    }
+
+    T *
+    allocate(std::size_t n)
+    {
+        ++*count;
+        return std::allocator< T >().allocate(n);
+    }
+
+    void
+    deallocate(T *p, std::size_t n)
+    {
+        --*count;
+        std::allocator< T >().deallocate(p, n);
+    }
+
+    template < class U >
+    bool
+    operator==(counting_allocator< U > const &other) const
+    {
+        return count == other.count;
+    }
+
+    int *count;
+};
+
+template < class F >
+struct allocating_handler
+{
+    using allocator_type = counting_allocator< void >;
+
+    allocator_type
+    get_allocator() const
+    {
+        return alloc;
+    }
+
+    template < class... Args >
+    void
+    operator()(Args &&...args)
+    {
+        f(std::forward< Args >(args)...);
+    }
+
+    allocator_type alloc;
+    F              f;
+};
+
+}   // namespace
+
+TEST_CASE("ops are allocated with the handler's allocator")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor());
+
+    int  live     = 0;
+    int  received = 0;
+    auto consume  = allocating_handler {
+        counting_allocator< void >(live),
+        [&](channels::error_code ec, std::string s) {
+            CHECK(!ec);
+            CHECK(s == "hello");
+            ++received;
+        }
+    };
+    auto send = allocating_handler { counting_allocator< void >(live),
+                                     [&](channels::error_code ec) {
+                                         CHECK(!ec);
+                                         ++received;
+                                     } };
+
+    c.async_consume(std::move(consume));
+    CHECK(live == 1);
+    c.async_send("hello", std::move(send));
+    ioc.run();
+    CHECK(received == 2);
+
+    // every op has been returned to the handler's allocator
+    CHECK(live == 0);
+}
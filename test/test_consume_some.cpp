@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace boost;
+
+TEST_CASE("async_consume_some drains the buffer and waiting senders")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor(), 2);
+
+    int sends = 0;
+    for (int i = 0; i < 4; ++i)
+        c.async_send("value " + std::to_string(i),
+                     [&](channels::error_code e) {
+                         CHECK(!e);
+                         ++sends;
+                     });
+    ioc.poll();
+    CHECK(c.get_implementation()->producers_waiting() == 2);
+
+    std::vector< std::string > out;
+    int                        completions = 0;
+    std::size_t                taken       = 0;
+    channels::error_code       ec;
+    c.async_consume_some(3, out, [&](channels::error_code e, std::size_t n) {
+        ++completions;
+        ec    = e;
+        taken = n;
+    });
+    ioc.poll();
+
+    CHECK(completions == 1);
+    CHECK(!ec);
+    CHECK(taken == 3);
+    CHECK(out == std::vector< std::string > {
+                     "value 0", "value 1", "value 2" });
+
+    // the remaining sender has moved its value into the buffer
+    CHECK(sends == 4);
+    CHECK(c.get_implementation()->producers_waiting() == 0);
+
+    ioc.restart();
+    c.async_consume_some(10, out, [&](channels::error_code e, std::size_t n) {
+        ++completions;
+        ec    = e;
+        taken = n;
+    });
+    ioc.poll();
+
+    CHECK(completions == 2);
+    CHECK(!ec);
+    CHECK(taken == 1);
+    CHECK(out.back() == "value 3");
+}
+
+TEST_CASE("async_consume_some waits for the first value")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), 8);
+
+    std::vector< int >   out;
+    int                  completions = 0;
+    std::size_t          taken       = 0;
+    channels::error_code ec;
+    c.async_consume_some(5, out, [&](channels::error_code e, std::size_t n) {
+        ++completions;
+        ec    = e;
+        taken = n;
+    });
+    ioc.poll();
+    CHECK(completions == 0);
+    CHECK(c.get_implementation()->consumers_waiting() == 1);
+
+    c.async_send(42, [](channels::error_code) {});
+    ioc.poll();
+
+    CHECK(completions == 1);
+    CHECK(!ec);
+    CHECK(taken == 1);
+    CHECK(out == std::vector< int > { 42 });
+    CHECK(c.get_implementation()->consumers_waiting() == 0);
+}
+
+TEST_CASE("async_consume_some on a closed channel")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), 8);
+
+    for (int i = 0; i < 3; ++i)
+        c.async_send(i, [](channels::error_code) {});
+    c.close();
+    ioc.poll();
+    ioc.restart();
+
+    std::vector< int >   out;
+    std::size_t          taken = 0;
+    channels::error_code ec;
+    c.async_consume_some(5, out, [&](channels::error_code e, std::size_t n) {
+        ec    = e;
+        taken = n;
+    });
+    ioc.poll();
+
+    // values still buffered are delivered without error
+    CHECK(!ec);
+    CHECK(taken == 3);
+    CHECK(out == std::vector< int > { 0, 1, 2 });
+
+    ioc.restart();
+    c.async_consume_some(5, out, [&](channels::error_code e, std::size_t n) {
+        ec    = e;
+        taken = n;
+    });
+    ioc.poll();
+
+    CHECK(ec == channels::errors::channel_closed);
+    CHECK(taken == 0);
+    CHECK(out.size() == 3);
+}
+
+TEST_CASE("async_consume_some of nothing completes at once")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor());
+
+    std::vector< int >   out;
+    int                  completions = 0;
+    std::size_t          taken       = 1;
+    channels::error_code ec;
+    c.async_consume_some(0, out, [&](channels::error_code e, std::size_t n) {
+        ++completions;
+        ec    = e;
+        taken = n;
+    });
+    ioc.poll();
+
+    CHECK(completions == 1);
+    CHECK(!ec);
+    CHECK(taken == 0);
+    CHECK(c.get_implementation()->consumers_waiting() == 0);
+}
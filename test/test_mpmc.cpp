@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+#include <boost/channels/channel_consumer.hpp>
+#include <boost/channels/tie.hpp>
+
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/system_executor.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <future>
+#include <string>
+#include <vector>
+
+using namespace boost;
+using namespace std::literals;
+
+namespace {
+template < class ValueType >
+using mpmc_channel = channels::channel< ValueType,
+                                        asio::any_io_executor,
+                                        std::mutex,
+                                        channels::concurrency::mpmc >;
+}
+
+TEST_CASE("mpmc ring capacity 1")
+{
+    channels::detail::mpmc_ring_data data { 1 };
+    channels::detail::mpmc_ring_slot< std::string > slots[1];
+    auto ring = channels::detail::mpmc_ring_ref< std::string > { &data, slots };
+    ring.init();
+
+    auto a = "a"s, b = "b"s;
+    CHECK(ring.try_push(a));
+    CHECK(!ring.try_push(b));
+    CHECK(b == "b");
+    CHECK(ring.size() == 1);
+
+    auto v = ring.try_pop();
+    REQUIRE(v);
+    CHECK(*v == "a");
+    CHECK(!ring.try_pop());
+
+    CHECK(ring.try_push(b));
+    v = ring.try_pop();
+    REQUIRE(v);
+    CHECK(*v == "b");
+    ring.destroy();
+}
+
+TEST_CASE("mpmc buffered send and consume")
+{
+    auto ioc = asio::io_context();
+    auto c   = mpmc_channel< std::string >(ioc.get_executor(), 2);
+
+    int sent = 0;
+    for (auto s : { "a"s, "b"s, "c"s })
+        c.async_send(s, [&](channels::error_code ec) {
+            CHECK(!ec);
+            ++sent;
+        });
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 2);
+
+    std::vector< std::string > got;
+    for (int i = 0; i < 3; ++i)
+        c.async_consume([&](channels::error_code ec, std::string s) {
+            CHECK(!ec);
+            got.push_back(s);
+        });
+    ioc.poll();
+    CHECK(sent == 3);
+    CHECK(got == std::vector< std::string > { "a", "b", "c" });
+}
+
+TEST_CASE("mpmc unbuffered")
+{
+    auto ioc = asio::io_context();
+    auto c   = mpmc_channel< int >(ioc.get_executor());
+
+    int received = 0;
+    c.async_consume([&](channels::error_code ec, int v) {
+        CHECK(!ec);
+        received = v;
+    });
+    c.async_send(7, asio::detached);
+    ioc.run();
+    CHECK(received == 7);
+}
+
+TEST_CASE("mpmc select")
+{
+    auto ioc = asio::io_context();
+    auto e   = ioc.get_executor();
+    auto c1  = mpmc_channel< int >(e, 1);
+    auto c2  = mpmc_channel< int >(e, 1);
+
+    c2.async_send(2, asio::detached);
+
+    int v1 = 0, v2 = 0;
+    channels::tie(v1 << c1, v2 << c2)
+        .async_wait([&](channels::error_code ec, int which) {
+            CHECK(!ec);
+            CHECK(which == 1);
+            CHECK(v2 == 2);
+        });
+    ioc.poll();
+    c1.close();
+    c2.close();
+    ioc.run();
+}
+
+TEST_CASE("mpmc threads")
+{
+    auto c = mpmc_channel< int >(asio::system_executor(), 16);
+
+    constexpr int producers = 4;
+    constexpr int consumers = 4;
+    constexpr int count     = 20000;
+
+    std::atomic< long long > sum { 0 };
+    std::atomic< int >       received { 0 };
+
+    std::vector< std::future< void > > tasks;
+    for (int p = 0; p < producers; ++p)
+        tasks.push_back(std::async(std::launch::async, [&] {
+            for (int i = 0; i < count; ++i)
+                c.async_send(i, asio::use_future).get();
+        }));
+
+    std::vector< std::future< void > > sinks;
+    for (int q = 0; q < consumers; ++q)
+        sinks.push_back(std::async(std::launch::async, [&] {
+            for (;;)
+            {
+                channels::error_code ec;
+                auto                 v = c.consume_if(ec);
+                if (!v)
+                {
+                    auto f = c.async_consume(
+                        asio::redirect_error(asio::use_future, ec));
+                    auto x = f.get();
+                    if (ec)
+                        break;
+                    v = x;
+                }
+                sum += *v;
+                ++received;
+            }
+        }));
+
+    for (auto &t : tasks)
+        t.get();
+    while (received.load() != producers * count)
+        std::this_thread::yield();
+    c.close();
+    for (auto &s : sinks)
+        s.get();
+
+    CHECK(sum.load() == (long long)producers * count * (count - 1) / 2);
+}
@@ -0,0 +1,246 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+#include <boost/channels/channel_producer.hpp>
+#include <boost/channels/tie.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <doctest/doctest.h>
+
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+using int_channel = channels::channel< int >;
+
+/// Send 0..n-1 with async_send and collect the completions.
+std::vector< channels::error_code >
+send_all(asio::io_context &ioc, int_channel &c, int n)
+{
+    std::vector< channels::error_code > results(n);
+    for (int i = 0; i < n; ++i)
+        c.async_send(i, [&results, i](channels::error_code ec) {
+            results[i] = ec;
+        });
+    ioc.poll();
+    ioc.restart();
+    return results;
+}
+
+std::vector< int >
+drain(int_channel &c)
+{
+    std::vector< int >   values;
+    channels::error_code ec;
+    while (auto v = c.consume_if(ec))
+        values.push_back(*v);
+    return values;
+}
+
+}   // namespace
+
+TEST_CASE("drop_newest discards sends which do not fit")
+{
+    auto ioc = asio::io_context();
+    auto c   = int_channel(
+        ioc.get_executor(), 2, channels::overflow_policy::drop_newest);
+
+    auto results = send_all(ioc, c, 5);
+    CHECK(!results[0]);
+    CHECK(!results[1]);
+    for (int i = 2; i < 5; ++i)
+        CHECK(results[i] == channels::errors::value_dropped);
+    CHECK(c.get_implementation()->producers_waiting() == 0);
+
+    CHECK(drain(c) == std::vector< int > { 0, 1 });
+    CHECK(c.counters().dropped_newest == 3);
+    CHECK(c.counters().dropped_oldest == 0);
+}
+
+TEST_CASE("drop_oldest overwrites the oldest buffered value")
+{
+    auto ioc = asio::io_context();
+    auto c   = int_channel(
+        ioc.get_executor(), 3, channels::overflow_policy::drop_oldest);
+
+    auto results = send_all(ioc, c, 5);
+    for (auto ec : results)
+        CHECK(!ec);
+    CHECK(c.get_implementation()->producers_waiting() == 0);
+
+    CHECK(drain(c) == std::vector< int > { 2, 3, 4 });
+    CHECK(c.counters().dropped_oldest == 2);
+    CHECK(c.counters().dropped_newest == 0);
+}
+
+TEST_CASE("drop_oldest on an unbuffered channel drops the new value")
+{
+    auto ioc = asio::io_context();
+    auto c   = int_channel(
+        ioc.get_executor(), 0, channels::overflow_policy::drop_oldest);
+
+    channels::error_code ec;
+    CHECK(!c.try_send(1, ec));
+    CHECK(ec == channels::errors::value_dropped);
+    CHECK(c.counters().dropped_newest == 1);
+
+    // a waiting consumer still receives the value
+    int received = 0;
+    c.async_consume([&](channels::error_code ec, int v) {
+        CHECK(!ec);
+        received = v;
+    });
+    ioc.poll();
+    ioc.restart();
+    CHECK(c.try_send(7, ec));
+    ioc.poll();
+    CHECK(received == 7);
+}
+
+TEST_CASE("reject refuses sends which do not fit")
+{
+    auto ioc = asio::io_context();
+    auto c   = int_channel(
+        ioc.get_executor(), 1, channels::overflow_policy::reject);
+
+    channels::error_code ec;
+    c.send(1, ec);
+    CHECK(!ec);
+    c.send(2, ec);
+    CHECK(ec == channels::errors::channel_full);
+
+    auto results = send_all(ioc, c, 1);
+    CHECK(results[0] == channels::errors::channel_full);
+    CHECK(c.counters().rejected == 2);
+
+    CHECK(drain(c) == std::vector< int > { 1 });
+
+    c.close();
+    ioc.poll();
+    c.send(3, ec);
+    CHECK(ec == channels::errors::channel_closed);
+    CHECK(c.counters().rejected == 2);
+}
+
+TEST_CASE("async_send_range applies the policy to each value")
+{
+    auto ioc = asio::io_context();
+
+    SUBCASE("drop_newest")
+    {
+        auto c = int_channel(
+            ioc.get_executor(), 2, channels::overflow_policy::drop_newest);
+
+        auto values = std::vector< int > { 0, 1, 2, 3, 4 };
+        auto result = channels::error_code();
+        auto sent   = std::size_t(99);
+        c.async_send_range(values.begin(),
+                           values.end(),
+                           [&](channels::error_code ec, std::size_t n) {
+                               result = ec;
+                               sent   = n;
+                           });
+        ioc.poll();
+
+        CHECK(result == channels::errors::value_dropped);
+        CHECK(sent == 2);
+        CHECK(c.get_implementation()->producers_waiting() == 0);
+        CHECK(c.counters().dropped_newest == 3);
+        CHECK(drain(c) == std::vector< int > { 0, 1 });
+    }
+
+    SUBCASE("drop_oldest")
+    {
+        auto c = int_channel(
+            ioc.get_executor(), 2, channels::overflow_policy::drop_oldest);
+
+        auto values = std::vector< int > { 0, 1, 2, 3, 4 };
+        auto sent   = std::size_t(0);
+        c.async_send_range(values.begin(),
+                           values.end(),
+                           [&](channels::error_code ec, std::size_t n) {
+                               CHECK(!ec);
+                               sent = n;
+                           });
+        ioc.poll();
+
+        CHECK(sent == 5);
+        CHECK(c.counters().dropped_oldest == 3);
+        CHECK(drain(c) == std::vector< int > { 3, 4 });
+    }
+}
+
+TEST_CASE("select send branches and claims do not wait on a lossy channel")
+{
+    auto ioc = asio::io_context();
+
+    SUBCASE("drop_newest select")
+    {
+        auto c = int_channel(
+            ioc.get_executor(), 1, channels::overflow_policy::drop_newest);
+        channels::error_code ec;
+        c.send(1, ec);
+
+        auto source = 2;
+        auto result = channels::error_code();
+        channels::tie(source >> c)
+            .async_wait([&](channels::error_code ec, int which) {
+                CHECK(which == 0);
+                result = ec;
+            });
+        ioc.poll();
+
+        CHECK(result == channels::errors::value_dropped);
+        CHECK(c.get_implementation()->producers_waiting() == 0);
+        CHECK(c.counters().dropped_newest == 1);
+        CHECK(drain(c) == std::vector< int > { 1 });
+    }
+
+    SUBCASE("drop_oldest select")
+    {
+        auto c = int_channel(
+            ioc.get_executor(), 1, channels::overflow_policy::drop_oldest);
+        channels::error_code ec;
+        c.send(1, ec);
+
+        auto source = 2;
+        auto result = channels::error_code(channels::errors::channel_null);
+        channels::tie(source >> c)
+            .async_wait([&](channels::error_code ec, int) { result = ec; });
+        ioc.poll();
+
+        CHECK(!result);
+        CHECK(c.counters().dropped_oldest == 1);
+        CHECK(drain(c) == std::vector< int > { 2 });
+    }
+
+    SUBCASE("reject claim")
+    {
+        auto c = int_channel(
+            ioc.get_executor(), 1, channels::overflow_policy::reject);
+        channels::error_code ec;
+        c.send(1, ec);
+
+        auto result = channels::error_code();
+        c.async_claim(
+            [&](channels::error_code ec, int_channel::send_slot_type slot) {
+                CHECK(!slot);
+                result = ec;
+            });
+        ioc.poll();
+
+        CHECK(result == channels::errors::channel_full);
+        CHECK(c.get_implementation()->producers_waiting() == 0);
+        CHECK(c.counters().rejected == 1);
+    }
+}
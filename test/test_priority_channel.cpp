@@ -0,0 +1,193 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/priority_channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <doctest/doctest.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace boost;
+
+using string_channel = channels::priority_channel< std::string, 3 >;
+
+TEST_CASE("priority channel delivers the highest lane first")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 4);
+
+    channels::error_code ec;
+    CHECK(c.try_send(2, "low 1", ec));
+    CHECK(c.try_send(1, "mid 1", ec));
+    CHECK(c.try_send(2, "low 2", ec));
+    CHECK(c.try_send(0, "high 1", ec));
+    CHECK(c.try_send(1, "mid 2", ec));
+
+    std::vector< std::string > received;
+    for (int i = 0; i < 5; ++i)
+        c.async_consume([&](channels::error_code ec, std::string s) {
+            CHECK(!ec);
+            received.push_back(std::move(s));
+        });
+    ioc.run();
+
+    CHECK(received == std::vector< std::string > {
+                          "high 1", "mid 1", "mid 2", "low 1", "low 2" });
+}
+
+TEST_CASE("priority channel lanes have their own capacity and senders")
+{
+    auto ioc  = asio::io_context();
+    auto c    = string_channel(ioc.get_executor(), { 1, 0, 2 });
+    auto impl = c.get_implementation();
+    CHECK(impl->capacity(0) == 1);
+    CHECK(impl->capacity(1) == 0);
+    CHECK(impl->capacity(2) == 2);
+
+    int sent = 0;
+    for (int i = 0; i < 4; ++i)
+        c.async_send(2, "low", [&](channels::error_code ec) {
+            CHECK(!ec);
+            ++sent;
+        });
+    c.async_send(0, "high", [&](channels::error_code ec) {
+        CHECK(!ec);
+        ++sent;
+    });
+    ioc.poll();
+    ioc.restart();
+
+    // a full low lane does not hold up the high lane
+    CHECK(sent == 3);
+    CHECK(impl->producers_waiting(0) == 0);
+    CHECK(impl->producers_waiting(2) == 2);
+
+    // the unbuffered lane only hands over to a waiting consumer
+    channels::error_code ec;
+    CHECK(!c.try_send(1, "mid", ec));
+    CHECK(!ec);
+
+    std::vector< std::string > received;
+    while (auto s = c.consume_if(ec))
+        received.push_back(*s);
+    ioc.poll();
+    CHECK(sent == 5);
+    CHECK(received == std::vector< std::string > {
+                          "high", "low", "low", "low", "low" });
+}
+
+TEST_CASE("priority channel hands a send to a waiting consumer")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor());
+
+    std::vector< std::string > received;
+    for (int i = 0; i < 2; ++i)
+        c.async_consume([&](channels::error_code ec, std::string s) {
+            CHECK(!ec);
+            received.push_back(std::move(s));
+        });
+    ioc.poll();
+    ioc.restart();
+    CHECK(c.get_implementation()->consumers_waiting() == 2);
+
+    channels::error_code ec;
+    CHECK(c.try_send(1, "mid", ec));
+    bool sent = false;
+    c.async_send(2, "low", [&](channels::error_code ec) {
+        CHECK(!ec);
+        sent = true;
+    });
+    ioc.run();
+
+    CHECK(sent);
+    CHECK(received == std::vector< std::string > { "mid", "low" });
+}
+
+TEST_CASE("closed priority channel drains its lanes in order")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 1);
+
+    channels::error_code ec;
+    CHECK(c.try_send(2, "low", ec));
+    CHECK(c.try_send(0, "high", ec));
+
+    channels::error_code send_ec;
+    c.async_send(2, "parked", [&](channels::error_code ec) { send_ec = ec; });
+    ioc.poll();
+    ioc.restart();
+
+    c.close();
+    ioc.poll();
+    ioc.restart();
+    CHECK(send_ec == channels::errors::channel_closed);
+
+    CHECK(!c.try_send(1, "late", ec));
+    CHECK(ec == channels::errors::channel_closed);
+
+    std::vector< std::string >          received;
+    std::vector< channels::error_code > errors;
+    for (int i = 0; i < 3; ++i)
+        c.async_consume([&](channels::error_code ec, std::string s) {
+            errors.push_back(ec);
+            if (!ec)
+                received.push_back(std::move(s));
+        });
+    ioc.run();
+
+    CHECK(received == std::vector< std::string > { "high", "low" });
+    REQUIRE(errors.size() == 3);
+    CHECK(errors[2] == channels::errors::channel_closed);
+
+    CHECK(!c.consume_if(ec));
+    CHECK(ec == channels::errors::channel_closed);
+}
+
+TEST_CASE("priority channel refuses a lane it does not have")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 1);
+
+    channels::error_code ec;
+    CHECK(!c.try_send(3, "nowhere", ec));
+    CHECK(ec == channels::errors::no_such_lane);
+
+    std::optional< channels::error_code > sent;
+    c.async_send(64, "nowhere", [&](channels::error_code ec) { sent = ec; });
+    ioc.run();
+    CHECK(sent == channels::errors::no_such_lane);
+    CHECK(!c.consume_if(ec));
+}
+
+TEST_CASE("priority channel posts the consumers it closes as one batch")
+{
+    // the scheduler runs as many functions as it would for one consumer
+    auto close_with = [](int consumers) {
+        auto ioc    = asio::io_context();
+        auto c      = string_channel(ioc.get_executor());
+        int  failed = 0;
+        for (int i = 0; i < consumers; ++i)
+            c.async_consume([&](channels::error_code ec, std::string) {
+                CHECK(ec == channels::errors::channel_closed);
+                ++failed;
+            });
+        ioc.poll();
+        ioc.restart();
+        c.get_implementation()->close();
+        auto ran = ioc.run();
+        CHECK(failed == consumers);
+        return ran;
+    };
+    CHECK(close_with(100) == close_with(1));
+}
@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace boost;
+
+namespace {
+
+using string_channel = channels::channel< std::string >;
+
+std::vector< std::string >
+drain(string_channel &c)
+{
+    std::vector< std::string > result;
+    channels::error_code       ec;
+    while (auto v = c.consume_if(ec))
+        result.push_back(std::move(*v));
+    return result;
+}
+
+}   // namespace
+
+TEST_CASE("growing a channel admits waiting senders")
+{
+    auto  ioc  = asio::io_context();
+    auto  c    = string_channel(ioc.get_executor(), 2);
+    auto &impl = *c.get_implementation();
+
+    int sent = 0;
+    for (int i = 0; i < 5; ++i)
+        c.async_send(std::to_string(i), [&](channels::error_code ec) {
+            CHECK(!ec);
+            ++sent;
+        });
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 2);
+    CHECK(impl.producers_waiting() == 3);
+
+    c.resize(4);
+    CHECK(impl.capacity() == 4);
+    CHECK(impl.producers_waiting() == 1);
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 4);
+
+    CHECK(drain(c) == std::vector< std::string > { "0", "1", "2", "3", "4" });
+    ioc.poll();
+    CHECK(sent == 5);
+}
+
+TEST_CASE("shrinking a channel keeps its values until they drain")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 8);
+
+    channels::error_code ec;
+    for (int i = 0; i < 6; ++i)
+        CHECK(c.try_send(std::to_string(i), ec));
+
+    c.resize(2);
+    CHECK(c.get_implementation()->capacity() == 2);
+
+    std::string extra = "extra";
+    CHECK(!c.try_send(std::move(extra), ec));
+    for (int i = 0; i < 4; ++i)
+        CHECK(c.consume_if(ec) == std::to_string(i));
+    CHECK(!c.try_send(std::move(extra), ec));
+
+    CHECK(c.consume_if(ec) == "4");
+    CHECK(c.try_send(std::move(extra), ec));
+    CHECK(drain(c) == std::vector< std::string > { "5", "extra" });
+}
+
+TEST_CASE("resize preserves order across the ring's wrap")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 3);
+
+    // leave the ring's head part way through its slots
+    channels::error_code ec;
+    for (int i = 0; i < 3; ++i)
+        CHECK(c.try_send(std::to_string(i), ec));
+    CHECK(c.consume_if(ec) == "0");
+    CHECK(c.consume_if(ec) == "1");
+    for (int i = 3; i < 5; ++i)
+        CHECK(c.try_send(std::to_string(i), ec));
+
+    SUBCASE("grow")
+    {
+        c.resize(5);
+    }
+    SUBCASE("same size")
+    {
+        c.resize(3);
+    }
+    SUBCASE("shrink")
+    {
+        c.resize(1);
+    }
+
+    CHECK(drain(c) == std::vector< std::string > { "2", "3", "4" });
+}
+
+TEST_CASE("an unbuffered channel can be given a buffer")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor());
+
+    channels::error_code send_ec = channels::errors::channel_null;
+    c.async_send("waiting", [&](channels::error_code ec) { send_ec = ec; });
+    ioc.poll();
+    ioc.restart();
+    CHECK(c.get_implementation()->producers_waiting() == 1);
+
+    c.resize(1);
+    ioc.poll();
+    ioc.restart();
+    CHECK(!send_ec);
+
+    std::string received;
+    c.async_consume([&](channels::error_code ec, std::string s) {
+        CHECK(!ec);
+        received = std::move(s);
+    });
+    ioc.poll();
+    CHECK(received == "waiting");
+}
+
+TEST_CASE("resize waits for a claimed slot to be settled")
+{
+    auto ioc = asio::io_context();
+    auto c   = string_channel(ioc.get_executor(), 2);
+
+    string_channel::send_slot_type slot;
+    c.async_claim(
+        [&](channels::error_code ec, string_channel::send_slot_type s) {
+            CHECK(!ec);
+            slot = std::move(s);
+        });
+    ioc.poll();
+    ioc.restart();
+    REQUIRE(slot);
+
+    c.resize(4);
+    CHECK(c.get_implementation()->capacity() == 2);
+
+    channels::error_code ec;
+    slot.emplace("claimed");
+    slot.publish(ec);
+    CHECK(!ec);
+    CHECK(c.get_implementation()->capacity() == 4);
+    CHECK(c.consume_if(ec) == "claimed");
+}
@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/detail/concurrency_traits.hpp>
+
+#include <cstdlib>
+#include <string>
+
+#include <doctest/doctest.h>
+
+using namespace boost;
+
+namespace {
+
+// owns the storage of a ring the way channel_impl does
+template < class Concurrency, class ValueType >
+struct ring_fixture
+{
+    using traits_type = channels::detail::concurrency_traits< Concurrency >;
+    using ring_type   = typename traits_type::template ring_ref< ValueType >;
+    using slot_type   = typename ring_type::slot_type;
+
+    explicit ring_fixture(std::size_t capacity)
+    : data(capacity)
+    , storage(static_cast< slot_type * >(
+          std::calloc(capacity ? capacity : 1, sizeof(slot_type))))
+    {
+        ring().init();
+    }
+
+    ~ring_fixture()
+    {
+        ring().destroy();
+        std::free(storage);
+    }
+
+    ring_type
+    ring()
+    {
+        return ring_type { &data, storage };
+    }
+
+    typename traits_type::ring_data data;
+    slot_type                      *storage;
+};
+
+template < class Concurrency >
+void
+check_fifo_across_wrap(std::size_t capacity)
+{
+    auto f    = ring_fixture< Concurrency, std::string >(capacity);
+    auto ring = f.ring();
+    INFO("capacity=", capacity);
+
+    int next_in  = 0;
+    int next_out = 0;
+    for (int round = 0; round < 10; ++round)
+    {
+        // fill to capacity, then drain a little less than half
+        while (ring.try_push_with([&] { return std::to_string(next_in); }))
+            ++next_in;
+        CHECK(ring.size() == capacity);
+
+        for (std::size_t i = 0; i < capacity / 2 + 1; ++i)
+        {
+            REQUIRE(ring.try_pop_with([&](std::string &&s) {
+                CHECK(s == std::to_string(next_out));
+            }));
+            ++next_out;
+        }
+    }
+
+    while (ring.try_pop_with([&](std::string &&s) {
+        CHECK(s == std::to_string(next_out));
+    }))
+        ++next_out;
+    CHECK(next_out == next_in);
+    CHECK(ring.empty());
+}
+
+}   // namespace
+
+TEST_CASE("locked ring preserves order across wrap")
+{
+    for (std::size_t capacity : { 1, 2, 3, 4, 5, 8, 13, 16 })
+        check_fifo_across_wrap< channels::concurrency::locked >(capacity);
+}
+
+TEST_CASE("spsc ring preserves order across wrap")
+{
+    for (std::size_t capacity : { 1, 2, 3, 4, 5, 8, 13, 16 })
+        check_fifo_across_wrap< channels::concurrency::spsc >(capacity);
+}
+
+TEST_CASE("mpmc ring preserves order across wrap")
+{
+    for (std::size_t capacity : { 1, 2, 3, 4, 5, 8, 13, 16 })
+        check_fifo_across_wrap< channels::concurrency::mpmc >(capacity);
+}
+
+TEST_CASE("ring index")
+{
+    using channels::detail::ring_index;
+
+    CHECK(ring_index(1).power_of_two);
+    CHECK(ring_index(1024).power_of_two);
+    CHECK(!ring_index(3).power_of_two);
+    CHECK(!ring_index(1000).power_of_two);
+
+    // powers of two count up and mask
+    CHECK(ring_index(8).slot_of(13) == 5);
+    CHECK(ring_index(8).advance(15) == 16);
+    CHECK(ring_index(8).distance(14, 19) == 5);
+    CHECK(ring_index(1).slot_of(13) == 0);
+
+    // other capacities wrap at twice the capacity
+    CHECK(ring_index(6).slot_of(8) == 2);
+    CHECK(ring_index(6).advance(11) == 0);
+    CHECK(ring_index(6).distance(10, 2) == 4);
+    CHECK(ring_index(6).distance(3, 9) == 6);
+}
@@ -159,3 +159,106 @@ TEST_CASE("2 producers, 2 consumer, threads")
     f1.get();
     f2.get();
 }
+
+TEST_CASE("losing branches are removed from idle channels")
+{
+    auto ioc = asio::io_context();
+    auto e   = ioc.get_executor();
+
+    auto active = channels::channel< std::string >(e);
+    auto idle1  = channels::channel< std::string >(e);
+    auto idle2  = channels::channel< std::string >(e);
+
+    std::string s0, s1, s2;
+    auto        src2 = "unsent"s;
+
+    int completions = 0;
+    for (int i = 0; i < 100; ++i)
+    {
+        channels::tie(s0 << active, s1 << idle1, src2 >> idle2)
+            .async_wait([&](channels::error_code ec, int which) {
+                CHECK(!ec);
+                CHECK(which == 0);
+                ++completions;
+            });
+        active.async_send(std::to_string(i), [](channels::error_code) {});
+        ioc.run();
+        ioc.restart();
+
+        CHECK(s0 == std::to_string(i));
+        CHECK(idle1.get_implementation()->consumers_waiting() == 0);
+        CHECK(idle2.get_implementation()->producers_waiting() == 0);
+    }
+    CHECK(completions == 100);
+    CHECK(src2 == "unsent");
+}
+
+TEST_CASE("a select on both ends of a channel is matched past itself")
+{
+    auto ioc = asio::io_context();
+    auto e   = ioc.get_executor();
+
+    auto chan = channels::channel< std::string >(e);
+
+    std::string sink;
+    auto        source = "from select"s;
+
+    int which_done = -1;
+    channels::tie(sink << chan, source >> chan)
+        .async_wait([&](channels::error_code ec, int which) {
+            CHECK(!ec);
+            which_done = which;
+        });
+
+    std::string consumed;
+    auto        consumer = [&](channels::error_code ec, std::string s) {
+        CHECK(!ec);
+        consumed = s;
+    };
+    auto sent     = 0;
+    auto producer = [&](channels::error_code ec) {
+        CHECK(!ec);
+        ++sent;
+    };
+
+    SUBCASE("consumer first")
+    {
+        chan.async_consume(consumer);
+        chan.async_send("plain"s, producer);
+        ioc.poll();
+
+        CHECK(which_done == 1);
+        CHECK(consumed == "from select");
+        CHECK(sent == 0);
+    }
+
+    SUBCASE("producer first")
+    {
+        chan.async_send("plain"s, producer);
+        chan.async_consume(consumer);
+        ioc.poll();
+
+        CHECK(which_done == 0);
+        CHECK(sink == "plain");
+        CHECK(sent == 1);
+        CHECK(consumed.empty());
+    }
+
+    // the select has completed, so the plain op left over is the only one
+    // waiting, and another party completes it
+    auto impl    = chan.get_implementation();
+    auto waiting = impl->consumers_waiting() + impl->producers_waiting();
+    CHECK(waiting == 1);
+
+    auto const sent_before = sent;
+    if (sent_before == 0)
+        chan.async_consume(consumer);
+    else
+        chan.async_send("plain"s, producer);
+    ioc.run();
+
+    CHECK(consumed == "plain");
+    CHECK(sent == sent_before + 1);
+    CHECK(impl->consumers_waiting() == 0);
+    CHECK(impl->producers_waiting() == 0);
+}
@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+using namespace boost;
+
+namespace {
+
+std::vector< std::string >
+make_values(int n)
+{
+    std::vector< std::string > result;
+    for (int i = 0; i < n; ++i)
+        result.push_back("value " + std::to_string(i));
+    return result;
+}
+
+}   // namespace
+
+TEST_CASE("async_send_range fills the buffer and then waits")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor(), 4);
+
+    auto const original = make_values(10);
+    auto       values   = original;
+
+    int                  completions = 0;
+    std::size_t          accepted    = 0;
+    channels::error_code ec;
+    c.async_send_range(values.begin(),
+                       values.end(),
+                       [&](channels::error_code e, std::size_t n) {
+                           ++completions;
+                           ec       = e;
+                           accepted = n;
+                       });
+
+    // only the buffer's worth has been taken so far
+    ioc.poll();
+    CHECK(completions == 0);
+    CHECK(c.get_implementation()->producers_waiting() == 1);
+
+    std::vector< std::string > received;
+    for (int i = 0; i < 10; ++i)
+        c.async_consume([&](channels::error_code e, std::string s) {
+            CHECK(!e);
+            received.push_back(std::move(s));
+        });
+    ioc.run();
+
+    CHECK(completions == 1);
+    CHECK(!ec);
+    CHECK(accepted == 10);
+    CHECK(received == original);
+    CHECK(c.get_implementation()->producers_waiting() == 0);
+}
+
+TEST_CASE("async_send_range hands values to waiting consumers")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor());
+
+    std::vector< std::string > received;
+    for (int i = 0; i < 3; ++i)
+        c.async_consume([&](channels::error_code e, std::string s) {
+            CHECK(!e);
+            received.push_back(std::move(s));
+        });
+
+    auto const original = make_values(3);
+    auto       values   = original;
+
+    std::size_t accepted = 0;
+    c.async_send_range(
+        values.begin(), values.end(), [&](channels::error_code e, std::size_t n) {
+            CHECK(!e);
+            accepted = n;
+        });
+    CHECK(c.get_implementation()->consumers_waiting() == 0);
+    CHECK(c.get_implementation()->producers_waiting() == 0);
+
+    ioc.run();
+    CHECK(accepted == 3);
+    CHECK(received == original);
+}
+
+TEST_CASE("async_send_range reports a partial batch when closed")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor(), 2);
+
+    auto values = make_values(5);
+
+    std::size_t          accepted = 0;
+    channels::error_code ec;
+    c.async_send_range(values.begin(),
+                       values.end(),
+                       [&](channels::error_code e, std::size_t n) {
+                           ec       = e;
+                           accepted = n;
+                       });
+    c.async_consume([](channels::error_code, std::string) {});
+    c.close();
+    ioc.run();
+
+    CHECK(ec == channels::errors::channel_closed);
+    CHECK(accepted == 3);
+
+    // the values which were not accepted are untouched
+    CHECK(values[3] == "value 3");
+    CHECK(values[4] == "value 4");
+}
+
+TEST_CASE("async_send_range of nothing completes at once")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor());
+
+    std::vector< std::string > values;
+    int                        completions = 0;
+    c.async_send_range(
+        values.begin(), values.end(), [&](channels::error_code e, std::size_t n) {
+            CHECK(!e);
+            CHECK(n == 0);
+            ++completions;
+        });
+    ioc.run();
+    CHECK(completions == 1);
+}
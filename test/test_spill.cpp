@@ -0,0 +1,193 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+
+#ifdef BOOST_CHANNELS_HAS_SPILL
+
+#include <boost/channels/detail/spill_buffer.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+struct record
+{
+    int    seq;
+    double value;
+};
+
+using record_channel = channels::channel< record,
+                                          asio::any_io_executor,
+                                          std::mutex,
+                                          channels::concurrency::spill >;
+
+// four records per segment and four segments
+channels::spill_options
+small_spill()
+{
+    auto options           = channels::spill_options();
+    options.segment_size   = 4 * sizeof(record);
+    options.max_spill_size = 16 * sizeof(record);
+    return options;
+}
+
+}   // namespace
+
+TEST_CASE("spill buffer overflows to segments in order")
+{
+    using ring_type = channels::detail::spill_buffer_ref< record >;
+    using slot_type = ring_type::slot_type;
+
+    auto data = channels::detail::spill_buffer_data(4, small_spill());
+    auto storage =
+        static_cast< slot_type * >(std::calloc(4, sizeof(slot_type)));
+    auto ring = ring_type { &data, storage };
+    ring.init();
+    CHECK(ring.capacity() == 20);
+
+    // as the channel does after unlocking, map the segment asked for
+    auto grow = [&] {
+        while (data.start_mapping())
+        {
+            channels::error_code ec;
+            auto                 s = data.map_segment(ec);
+            REQUIRE(data.finish_mapping(s, ec));
+        }
+    };
+
+    int  next_in  = 0;
+    int  next_out = 0;
+    auto push     = [&] {
+        if (ring.try_push_with([&] { return record { next_in++, 0.5 }; }))
+            return true;
+        grow();
+        return ring.try_push_with([&] { return record { next_in++, 0.5 }; });
+    };
+    auto pop = [&] {
+        return ring.try_pop_with(
+            [&](record &&r) { CHECK(r.seq == next_out++); });
+    };
+
+    for (int i = 0; i < 20; ++i)
+        CHECK(push());
+    CHECK(data.spilled == 16);
+    CHECK(data.segments == 4);
+    CHECK(!push());
+
+    // while values are spilled, new values follow them even though the ring
+    // has space. Draining the first segment makes it the spare.
+    for (int i = 0; i < 8; ++i)
+        CHECK(pop());
+    for (int i = 0; i < 2; ++i)
+        CHECK(push());
+    CHECK(data.spilled == 14);
+    CHECK(data.segments == 4);
+
+    while (pop())
+        ;
+    CHECK(next_out == next_in);
+    CHECK(data.spilled == 0);
+
+    // once the spill is drained, the ring is used again
+    CHECK(push());
+    CHECK(data.spilled == 0);
+    CHECK(pop());
+
+    ring.destroy();
+    CHECK(data.segments == 0);
+    std::free(storage);
+}
+
+TEST_CASE("spilling channel accepts sends until the spill limit")
+{
+    auto  ioc  = asio::io_context();
+    auto  c    = record_channel(ioc.get_executor(), 4, small_spill());
+    auto &impl = *c.get_implementation();
+
+    int sent = 0;
+    for (int i = 0; i < 21; ++i)
+        c.async_send(record { i, 0.0 }, [&](channels::error_code ec) {
+            CHECK(!ec);
+            ++sent;
+        });
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 20);
+    CHECK(impl.producers_waiting() == 1);
+
+    std::vector< int >   received;
+    channels::error_code ec;
+    while (auto r = c.consume_if(ec))
+        received.push_back(r->seq);
+    ioc.poll();
+    CHECK(sent == 21);
+
+    REQUIRE(received.size() == 21);
+    for (int i = 0; i < 21; ++i)
+        CHECK(received[i] == i);
+}
+
+TEST_CASE("spilling channel maps segments for a waiting range send")
+{
+    auto ioc = asio::io_context();
+    auto c   = record_channel(ioc.get_executor(), 4, small_spill());
+
+    auto values = std::vector< record >();
+    for (int i = 0; i < 20; ++i)
+        values.push_back(record { i, 0.0 });
+
+    std::size_t sent = 0;
+    c.async_send_range(values.begin(),
+                       values.end(),
+                       [&](channels::error_code ec, std::size_t n) {
+                           CHECK(!ec);
+                           sent = n;
+                       });
+    ioc.poll();
+    CHECK(sent == 20);
+    CHECK(!c.spill_error());
+
+    channels::error_code ec;
+    for (int i = 0; i < 20; ++i)
+        CHECK(c.consume_if(ec)->seq == i);
+}
+
+TEST_CASE("spilling channel without a usable directory waits like a full one")
+{
+    auto ioc          = asio::io_context();
+    auto options      = small_spill();
+    options.directory = "/nonexistent/boost_channels";
+    auto c            = record_channel(ioc.get_executor(), 2, options);
+
+    int sent = 0;
+    for (int i = 0; i < 3; ++i)
+        c.async_send(record { i, 0.0 }, [&](channels::error_code ec) {
+            CHECK(!ec);
+            ++sent;
+        });
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 2);
+    CHECK(c.get_implementation()->producers_waiting() == 1);
+    CHECK(c.spill_error() == std::errc::no_such_file_or_directory);
+
+    channels::error_code ec;
+    for (int i = 0; i < 3; ++i)
+        CHECK(c.consume_if(ec)->seq == i);
+}
+
+#endif
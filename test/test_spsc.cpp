@@ -0,0 +1,158 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/system_executor.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include <doctest/doctest.h>
+
+#include <future>
+#include <string>
+#include <thread>
+
+using namespace boost;
+using namespace std::literals;
+
+namespace {
+template < class ValueType >
+using spsc_channel = channels::channel< ValueType,
+                                        asio::any_io_executor,
+                                        std::mutex,
+                                        channels::concurrency::spsc >;
+}
+
+TEST_CASE("spsc consume_if uses the ring")
+{
+    auto ioc = asio::io_context();
+    auto c   = spsc_channel< std::string >(ioc.get_executor(), 2);
+
+    channels::error_code ec;
+    CHECK(!c.consume_if(ec));
+    CHECK(!ec);
+
+    int sent = 0;
+    c.async_send("a", [&](channels::error_code ec) {
+        CHECK(!ec);
+        ++sent;
+    });
+    c.async_send("b", [&](channels::error_code ec) {
+        CHECK(!ec);
+        ++sent;
+    });
+    c.async_send("c", [&](channels::error_code ec) {
+        CHECK(!ec);
+        ++sent;
+    });
+
+    // the first two sends completed without parking
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 2);
+
+    auto v = c.consume_if(ec);
+    CHECK(!ec);
+    REQUIRE(v);
+    CHECK(*v == "a");
+
+    // the parked producer was admitted into the freed slot
+    ioc.poll();
+    ioc.restart();
+    CHECK(sent == 3);
+
+    v = c.consume_if(ec);
+    REQUIRE(v);
+    CHECK(*v == "b");
+    v = c.consume_if(ec);
+    REQUIRE(v);
+    CHECK(*v == "c");
+    v = c.consume_if(ec);
+    CHECK(!v);
+    CHECK(!ec);
+
+    c.close();
+    ioc.poll();
+    v = c.consume_if(ec);
+    CHECK(!v);
+    CHECK(ec == channels::errors::channel_closed);
+}
+
+TEST_CASE("spsc parked consumer is woken by a lock-free send")
+{
+    auto ioc = asio::io_context();
+    auto c   = spsc_channel< int >(ioc.get_executor(), 4);
+
+    int received = 0;
+    c.async_consume([&](channels::error_code ec, int v) {
+        CHECK(!ec);
+        received = v;
+    });
+    c.async_send(42, asio::detached);
+
+    ioc.run();
+    CHECK(received == 42);
+}
+
+TEST_CASE("spsc close delivers buffered values")
+{
+    auto ioc = asio::io_context();
+    auto c   = spsc_channel< int >(ioc.get_executor(), 4);
+
+    c.async_send(1, asio::detached);
+    c.async_send(2, asio::detached);
+    c.close();
+
+    std::vector< int > got;
+    channels::error_code last;
+    for (int i = 0; i < 3; ++i)
+        c.async_consume([&](channels::error_code ec, int v) {
+            if (ec)
+                last = ec;
+            else
+                got.push_back(v);
+        });
+
+    ioc.run();
+    CHECK(got == std::vector< int > { 1, 2 });
+    CHECK(last == channels::errors::channel_closed);
+}
+
+TEST_CASE("spsc threads")
+{
+    auto c = spsc_channel< int >(asio::system_executor(), 64);
+
+    constexpr int count = 100000;
+
+    auto producer = std::async(std::launch::async, [&] {
+        for (int i = 0; i < count; ++i)
+            c.async_send(i, asio::use_future).get();
+    });
+
+    auto consumer = std::async(std::launch::async, [&] {
+        long long sum  = 0;
+        int       next = 0;
+        while (next < count)
+        {
+            channels::error_code ec;
+            auto                 v = c.consume_if(ec);
+            if (!v)
+                v = c.async_consume(asio::use_future).get();
+            CHECK(*v == next);
+            sum += *v;
+            ++next;
+        }
+        return sum;
+    });
+
+    producer.get();
+    CHECK(consumer.get() == (long long)count * (count - 1) / 2);
+}
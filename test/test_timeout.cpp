@@ -0,0 +1,223 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+#include <boost/channels/detail/timer_wheel.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace boost;
+using namespace std::literals;
+
+namespace {
+
+// the ticks at which nodes leave the wheel, in order
+std::vector< std::uint64_t >
+expiries(channels::detail::timer_wheel &wheel, std::uint64_t to)
+{
+    std::vector< std::uint64_t > ticks;
+    while (wheel.now() < to)
+    {
+        auto next = wheel.next_tick();
+        auto step = next && *next < to ? *next : to;
+        for (auto node = wheel.advance(step); node; node = node->next)
+        {
+            CHECK(node->when == wheel.now());
+            ticks.push_back(node->when);
+        }
+    }
+    return ticks;
+}
+
+}   // namespace
+
+TEST_CASE("timer wheel expires each node at its tick")
+{
+    using channels::detail::timer_node;
+    auto wheel = channels::detail::timer_wheel(1000);
+
+    // one node per level, one beyond the wheel, and one to be removed
+    std::uint64_t const deltas[] = { 1, 63, 64, 100, 4095, 4096, 300000,
+                                     1u << 25 };
+    std::vector< timer_node > nodes(std::size(deltas) + 1);
+    for (std::size_t i = 0; i < std::size(deltas); ++i)
+        wheel.insert(nodes[i], 1000 + deltas[i]);
+    wheel.insert(nodes.back(), 1050);
+    CHECK(wheel.size() == nodes.size());
+
+    CHECK(wheel.remove(nodes.back()));
+    CHECK(!wheel.remove(nodes.back()));
+
+    auto ticks = expiries(wheel, 1000 + (1u << 25) + 1);
+    REQUIRE(ticks.size() == std::size(deltas));
+    for (std::size_t i = 0; i < std::size(deltas); ++i)
+        CHECK(ticks[i] == 1000 + deltas[i]);
+    CHECK(wheel.empty());
+    CHECK(!wheel.next_tick());
+}
+
+TEST_CASE("async_consume_for times out and leaves the queue")
+{
+    auto ioc  = asio::io_context();
+    auto c    = channels::channel< std::string >(ioc.get_executor());
+    auto impl = c.get_implementation();
+
+    std::optional< channels::error_code > result;
+    c.async_consume_for(5ms, [&](channels::error_code ec, std::string s) {
+        CHECK(s.empty());
+        result = ec;
+    });
+    ioc.poll();
+    ioc.restart();
+    CHECK(impl->consumers_waiting() == 1);
+
+    ioc.run();
+    REQUIRE(result);
+    CHECK(*result == channels::errors::timed_out);
+    CHECK(impl->consumers_waiting() == 0);
+
+    // the value is not lost to the expired consumer
+    channels::error_code ec;
+    CHECK(!c.try_send("a", ec));
+    CHECK(impl->consumers_waiting() == 0);
+}
+
+TEST_CASE("completed timed ops do not wait for their deadlines")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor());
+
+    std::optional< std::string > received;
+    c.async_consume_for(1h, [&](channels::error_code ec, std::string s) {
+        CHECK(!ec);
+        received = s;
+    });
+
+    std::optional< channels::error_code > sent;
+    c.async_send_for("a", 1h, [&](channels::error_code ec, auto back) {
+        CHECK(!back);
+        sent = ec;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    ioc.run();
+    CHECK(std::chrono::steady_clock::now() - start < 1s);
+    CHECK(received == "a");
+    REQUIRE(sent);
+    CHECK(!*sent);
+}
+
+TEST_CASE("async_send_for hands the value back")
+{
+    auto ioc  = asio::io_context();
+    auto c    = channels::channel< std::string >(ioc.get_executor());
+    auto impl = c.get_implementation();
+
+    std::vector< channels::error_code > errors;
+    std::vector< std::string >          returned;
+    auto handler = [&](channels::error_code          ec,
+                       std::optional< std::string > v) {
+        errors.push_back(ec);
+        REQUIRE(v);
+        returned.push_back(*v);
+    };
+
+    c.async_send_for("late", 2ms, handler);
+    c.async_send_for("closed", 1h, handler);
+    CHECK(impl->producers_waiting() == 2);
+
+    while (errors.empty())
+        ioc.run_one();
+    CHECK(errors[0] == channels::errors::timed_out);
+    CHECK(returned[0] == "late");
+    CHECK(impl->producers_waiting() == 1);
+
+    c.close();
+    ioc.run();
+    REQUIRE(errors.size() == 2);
+    CHECK(errors[1] == channels::errors::channel_closed);
+    CHECK(returned[1] == "closed");
+}
+
+TEST_CASE("timed ops expire in deadline order")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor());
+
+    std::vector< int > order;
+    for (int ms : { 30, 10, 20, 1 })
+        c.async_consume_for(std::chrono::milliseconds(ms),
+                            [&, ms](channels::error_code ec, int) {
+                                CHECK(ec == channels::errors::timed_out);
+                                order.push_back(ms);
+                            });
+    ioc.run();
+    CHECK(order == std::vector< int > { 1, 10, 20, 30 });
+}
+
+TEST_CASE("deadlines race values across threads")
+{
+    // consumers expire constantly while other threads hand them values, so
+    // expiries and flushes contend for the same ops
+    auto pool = asio::thread_pool(8);
+    auto c    = channels::channel< int >(pool.get_executor());
+
+    std::atomic< long > sent { 0 }, received { 0 }, expired { 0 };
+    std::atomic< bool > stop { false };
+
+    std::function< void() > consume = [&] {
+        c.async_consume_for(1us, [&](channels::error_code ec, int) {
+            if (ec == channels::errors::timed_out)
+                ++expired;
+            else if (!ec)
+                ++received;
+            else
+                return;
+            if (!stop)
+                consume();
+        });
+    };
+    for (int i = 0; i < 1000; ++i)
+        asio::post(pool, consume);
+
+    auto const until   = std::chrono::steady_clock::now() + 2s;
+    auto       senders = std::vector< std::thread >();
+    for (int t = 0; t < 4; ++t)
+        senders.emplace_back([&] {
+            while (std::chrono::steady_clock::now() < until)
+            {
+                channels::error_code ec;
+                if (c.try_send(1, ec))
+                    ++sent;
+                std::this_thread::sleep_for(50us);
+            }
+        });
+    for (auto &t : senders)
+        t.join();
+
+    stop = true;
+    c.close();
+    pool.join();
+
+    CHECK(sent > 0);
+    CHECK(received == sent);
+    CHECK(expired > 0);
+}
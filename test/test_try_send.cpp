@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+using namespace boost;
+
+TEST_CASE("try_send fills the buffer and then refuses")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor(), 2);
+
+    channels::error_code ec;
+    std::string          a = "a", b = "b", x = "x";
+    CHECK(c.try_send(std::move(a), ec));
+    CHECK(!ec);
+    CHECK(c.try_send(std::move(b), ec));
+    CHECK(!ec);
+
+    // a refused value is left with the caller
+    CHECK(!c.try_send(std::move(x), ec));
+    CHECK(!ec);
+    CHECK(x == "x");
+
+    CHECK(c.consume_if(ec) == "a");
+    CHECK(c.consume_if(ec) == "b");
+    CHECK(!c.consume_if(ec));
+}
+
+TEST_CASE("try_send hands a value to a waiting consumer")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor());
+
+    channels::error_code ec;
+    CHECK(!c.try_send("nobody waiting", ec));
+    CHECK(!ec);
+
+    SUBCASE("async_consume")
+    {
+        std::string received;
+        c.async_consume([&](channels::error_code e, std::string s) {
+            CHECK(!e);
+            received = std::move(s);
+        });
+        ioc.poll();
+        ioc.restart();
+
+        CHECK(c.try_send("handed over", ec));
+        CHECK(c.get_implementation()->consumers_waiting() == 0);
+        ioc.poll();
+        CHECK(received == "handed over");
+    }
+
+    SUBCASE("async_consume_inplace")
+    {
+        std::string seen;
+        c.async_consume_inplace([&](std::string &s) { seen = s; },
+                                [](channels::error_code e) { CHECK(!e); });
+        ioc.poll();
+        ioc.restart();
+
+        CHECK(c.try_send("visited", ec));
+        ioc.poll();
+        CHECK(seen == "visited");
+    }
+
+    SUBCASE("async_consume_some")
+    {
+        std::vector< std::string > out;
+        std::size_t                taken = 0;
+        c.async_consume_some(
+            4, out, [&](channels::error_code e, std::size_t n) {
+                CHECK(!e);
+                taken = n;
+            });
+        ioc.poll();
+        ioc.restart();
+
+        // the batch is completed with what was available
+        CHECK(c.try_send("only one", ec));
+        CHECK(c.get_implementation()->consumers_waiting() == 0);
+        ioc.poll();
+        CHECK(taken == 1);
+        CHECK(out == std::vector< std::string > { "only one" });
+    }
+}
+
+TEST_CASE("try_send on a closed channel")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< std::string >(ioc.get_executor(), 1);
+    c.close();
+    ioc.poll();
+
+    channels::error_code ec;
+    std::string          v = "kept";
+    CHECK(!c.try_send(std::move(v), ec));
+    CHECK(ec == channels::errors::channel_closed);
+    CHECK(v == "kept");
+}
+
+TEST_CASE("spsc try_send")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int,
+                                asio::any_io_executor,
+                                std::mutex,
+                                channels::concurrency::spsc >(
+        ioc.get_executor(), 1);
+
+    channels::error_code ec;
+    CHECK(c.try_send(1, ec));
+    CHECK(!c.try_send(2, ec));
+    CHECK(c.consume_if(ec) == 1);
+
+    int received = 0;
+    c.async_consume([&](channels::error_code e, int v) {
+        CHECK(!e);
+        received = v;
+    });
+    ioc.poll();
+    CHECK(c.try_send(3, ec));
+    ioc.restart();
+    ioc.poll();
+    CHECK(received == 3);
+}
@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+#include <boost/channels/detail/chunk_buffer.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+using unbounded_channel = channels::channel< std::string,
+                                             asio::any_io_executor,
+                                             std::mutex,
+                                             channels::concurrency::unbounded >;
+
+std::size_t
+chunks_in_use(channels::detail::chunk_buffer_data const &d)
+{
+    std::size_t n = 0;
+    for (auto c = d.head_chunk; c; c = c->next)
+        ++n;
+    return n;
+}
+
+}   // namespace
+
+TEST_CASE("chunk buffer preserves order and recycles its chunks")
+{
+    using ring_type = channels::detail::chunk_buffer_ref< std::string >;
+    constexpr auto per_chunk = ring_type::chunk_values;
+
+    auto data = channels::detail::chunk_buffer_data(0);
+    auto ring = ring_type { &data, nullptr };
+    ring.init();
+
+    int next_in  = 0;
+    int next_out = 0;
+    for (int round = 0; round < 3; ++round)
+    {
+        // grow well past several chunks, then drain a little over half
+        for (std::size_t i = 0; i < 5 * per_chunk + 3; ++i)
+            CHECK(ring.try_push_with(
+                [&] { return std::to_string(next_in++); }));
+        CHECK(chunks_in_use(data) > 5);
+
+        while (ring.size() > per_chunk + 1)
+            REQUIRE(ring.try_pop_with([&](std::string &&s) {
+                CHECK(s == std::to_string(next_out++));
+            }));
+        CHECK(data.spare_count <= BOOST_CHANNELS_CHUNK_FREELIST);
+    }
+
+    while (ring.try_pop_with(
+        [&](std::string &&s) { CHECK(s == std::to_string(next_out++)); }))
+        ;
+    CHECK(next_out == next_in);
+
+    // the last chunk is kept for reuse, and the rest beyond the free list
+    // have been released
+    CHECK(ring.empty());
+    CHECK(chunks_in_use(data) == 1);
+    CHECK(data.spare_count == BOOST_CHANNELS_CHUNK_FREELIST);
+
+    // a partly filled buffer is released on destruction
+    CHECK(ring.try_push_with([] { return std::string("left behind"); }));
+    ring.destroy();
+    CHECK(data.head_chunk == nullptr);
+    CHECK(data.spare == nullptr);
+}
+
+TEST_CASE("unbounded channel sends complete without waiting")
+{
+    auto ioc = asio::io_context();
+    auto c   = unbounded_channel(ioc.get_executor());
+
+    constexpr int n    = 10000;
+    int           sent = 0;
+    for (int i = 0; i < n; ++i)
+        c.async_send(std::to_string(i), [&](channels::error_code ec) {
+            CHECK(!ec);
+            ++sent;
+        });
+    CHECK(c.get_implementation()->producers_waiting() == 0);
+    ioc.poll();
+    CHECK(sent == n);
+
+    channels::error_code ec;
+    CHECK(c.try_send("last", ec));
+    c.send("blocking", ec);
+    CHECK(!ec);
+
+    std::vector< std::string > received;
+    c.async_consume_some(
+        n + 2, received, [](channels::error_code ec, std::size_t) {
+            CHECK(!ec);
+        });
+    ioc.restart();
+    ioc.poll();
+    REQUIRE(received.size() == n + 2);
+    for (int i = 0; i < n; ++i)
+        CHECK(received[i] == std::to_string(i));
+    CHECK(received[n] == "last");
+    CHECK(received[n + 1] == "blocking");
+}
+
+TEST_CASE("unbounded channel hands values to waiting consumers")
+{
+    auto ioc = asio::io_context();
+    auto c   = unbounded_channel(ioc.get_executor());
+
+    std::vector< std::string > received;
+    for (int i = 0; i < 2; ++i)
+        c.async_consume([&](channels::error_code ec, std::string s) {
+            CHECK(!ec);
+            received.push_back(std::move(s));
+        });
+    ioc.poll();
+    ioc.restart();
+
+    c.async_send("a", [](channels::error_code ec) { CHECK(!ec); });
+    c.async_send("b", [](channels::error_code ec) { CHECK(!ec); });
+    c.async_send("c", [](channels::error_code ec) { CHECK(!ec); });
+    ioc.poll();
+    CHECK(received == std::vector< std::string > { "a", "b" });
+
+    channels::error_code ec;
+    CHECK(c.consume_if(ec) == "c");
+}
+
+TEST_CASE("closed unbounded channel drains and refuses sends")
+{
+    auto ioc = asio::io_context();
+    auto c   = unbounded_channel(ioc.get_executor());
+
+    channels::error_code ec;
+    for (int i = 0; i < 3; ++i)
+        CHECK(c.try_send(std::to_string(i), ec));
+    c.close();
+    ioc.poll();
+    ioc.restart();
+
+    channels::error_code send_ec;
+    c.async_send("late", [&](channels::error_code e) { send_ec = e; });
+    ioc.poll();
+    CHECK(send_ec == channels::errors::channel_closed);
+
+    CHECK(!c.try_send("late", ec));
+    CHECK(ec == channels::errors::channel_closed);
+
+    for (int i = 0; i < 3; ++i)
+        CHECK(c.consume_if(ec) == std::to_string(i));
+    CHECK(!c.consume_if(ec));
+    CHECK(ec == channels::errors::channel_closed);
+}
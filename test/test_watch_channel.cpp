@@ -0,0 +1,279 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/watch_channel.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace boost;
+
+namespace {
+
+struct position
+{
+    long x = 0;
+    long y = 0;
+    long z = 0;
+};
+
+struct counted
+{
+    static inline int copies = 0;
+
+    counted() = default;
+
+    counted(counted const &other)
+    : n(other.n)
+    {
+        ++copies;
+    }
+
+    counted &
+    operator=(counted const &other)
+    {
+        n = other.n;
+        ++copies;
+        return *this;
+    }
+
+    int n = 0;
+};
+
+/// trivially copyable but not default constructible
+struct point
+{
+    explicit point(int x)
+    : x(x)
+    {
+    }
+
+    int x;
+};
+
+/// neither trivially copyable nor default constructible
+struct label
+{
+    explicit label(std::string s)
+    : s(std::move(s))
+    {
+    }
+
+    std::string s;
+};
+
+}   // namespace
+
+TEST_CASE("watch channel conflates sends")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::watch_channel< int >(ioc.get_executor(), 1);
+    auto rx  = c.subscribe();
+    CHECK(c.get() == 1);
+    CHECK(!rx.has_changed());
+
+    channels::error_code ec;
+    CHECK(!rx.consume_if(ec));
+    CHECK(!ec);
+
+    for (int i = 2; i <= 4; ++i)
+        c.send(i, ec);
+    CHECK(c.version() == 3);
+    CHECK(rx.has_changed());
+
+    // only the latest value is seen, once
+    CHECK(rx.consume_if(ec) == 4);
+    CHECK(rx.seen() == 3);
+    CHECK(!rx.consume_if(ec));
+}
+
+TEST_CASE("watch channel wakes every waiting receiver once")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::watch_channel< std::string >(ioc.get_executor());
+
+    std::vector< channels::watch_channel< std::string >::receiver_type > rxs;
+    for (int i = 0; i < 3; ++i)
+        rxs.push_back(c.subscribe());
+
+    std::vector< std::string > received;
+    for (auto &rx : rxs)
+        rx.async_consume([&](channels::error_code ec, std::string s) {
+            CHECK(!ec);
+            received.push_back(std::move(s));
+        });
+    ioc.poll();
+    ioc.restart();
+    CHECK(c.get_implementation()->consumers_waiting() == 3);
+
+    channels::error_code ec;
+    c.send("first", ec);
+    c.send("second", ec);
+    ioc.poll();
+    ioc.restart();
+
+    CHECK(received == std::vector< std::string > { "first", "first", "first" });
+    for (auto &rx : rxs)
+        CHECK(rx.seen() == 1);
+
+    // a receiver which is behind completes at once with the latest value
+    received.clear();
+    rxs[0].async_consume([&](channels::error_code ec, std::string s) {
+        CHECK(!ec);
+        received.push_back(std::move(s));
+    });
+    ioc.poll();
+    CHECK(received == std::vector< std::string > { "second" });
+    CHECK(rxs[0].seen() == 2);
+}
+
+TEST_CASE("watch channel shares one snapshot among waiting receivers")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::watch_channel< counted >(ioc.get_executor());
+
+    std::vector< channels::watch_channel< counted >::receiver_type > rxs;
+    for (int i = 0; i < 8; ++i)
+        rxs.push_back(c.subscribe());
+
+    int received = 0;
+    for (auto &rx : rxs)
+        rx.async_consume([&](channels::error_code ec, counted v) {
+            CHECK(!ec);
+            CHECK(v.n == 7);
+            ++received;
+        });
+    ioc.poll();
+    ioc.restart();
+
+    // the store copies the value once, however many receivers wait
+    auto v      = counted();
+    v.n         = 7;
+    auto before = counted::copies;
+    channels::error_code ec;
+    c.send(v, ec);
+    CHECK(counted::copies - before == 1);
+
+    // and each receiver copies it out as its handler runs
+    ioc.poll();
+    CHECK(received == 8);
+    CHECK(counted::copies - before == 9);
+}
+
+TEST_CASE("watch channel values need not be default constructible")
+{
+    auto ioc = asio::io_context();
+    auto ch1 = channels::watch_channel< point >(ioc.get_executor(), point(1));
+    auto ch2 =
+        channels::watch_channel< label >(ioc.get_executor(), label("one"));
+    auto rx1 = ch1.subscribe();
+    auto rx2 = ch2.subscribe();
+
+    channels::error_code ec;
+    ch1.send(point(2), ec);
+    ch2.send(label("two"), ec);
+    CHECK(ch1.get().x == 2);
+    CHECK(ch2.get().s == "two");
+
+    auto p = rx1.consume_if(ec);
+    REQUIRE(p);
+    CHECK(p->x == 2);
+    auto l = rx2.consume_if(ec);
+    REQUIRE(l);
+    CHECK(l->s == "two");
+}
+
+TEST_CASE("watch receiver may be moved while a consume waits")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::watch_channel< int >(ioc.get_executor());
+    auto rx  = std::optional(c.subscribe());
+
+    int received = 0;
+    rx->async_consume([&](channels::error_code ec, int v) {
+        CHECK(!ec);
+        received = v;
+    });
+    ioc.poll();
+    ioc.restart();
+
+    // the moved-to receiver sees the version the op consumes, and a copy
+    // keeps its own
+    auto moved = std::move(*rx);
+    rx.reset();
+    auto copy = moved;
+
+    channels::error_code ec;
+    c.send(3, ec);
+    ioc.poll();
+    CHECK(received == 3);
+    CHECK(moved.seen() == 1);
+    CHECK(copy.seen() == 0);
+}
+
+TEST_CASE("closed watch channel fails receivers with nothing new")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::watch_channel< int >(ioc.get_executor());
+    auto rx1 = c.subscribe();
+    auto rx2 = c.subscribe();
+
+    channels::error_code ec1;
+    rx1.async_consume([&](channels::error_code ec, int) { ec1 = ec; });
+    ioc.poll();
+    ioc.restart();
+
+    c.close();
+    ioc.poll();
+    ioc.restart();
+    CHECK(ec1 == channels::errors::channel_closed);
+
+    channels::error_code ec;
+    c.send(5, ec);
+    CHECK(ec == channels::errors::channel_closed);
+    CHECK(!rx2.consume_if(ec));
+    CHECK(ec == channels::errors::channel_closed);
+}
+
+TEST_CASE("watch channel readers never see a torn value")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::watch_channel< position >(ioc.get_executor());
+
+    std::atomic< bool > done { false };
+    std::atomic< long > torn { 0 };
+
+    std::vector< std::thread > readers;
+    for (int i = 0; i < 4; ++i)
+        readers.emplace_back([&] {
+            auto                 rx = c.subscribe();
+            channels::error_code ec;
+            while (!done.load())
+                if (auto p = rx.consume_if(ec))
+                    if (p->x != p->y || p->y != p->z)
+                        ++torn;
+        });
+
+    channels::error_code ec;
+    for (long i = 1; i <= 100000; ++i)
+        c.send(position { i, i, i }, ec);
+    done = true;
+    for (auto &t : readers)
+        t.join();
+
+    CHECK(torn == 0);
+    CHECK(c.get().x == 100000);
+}
@@ -0,0 +1,216 @@
+//
+// Copyright (c) 2021 Richard Hodges (hodges.r@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/madmongo1/boost_channels
+//
+
+#include <boost/channels/channel.hpp>
+#include <boost/channels/channel_consumer.hpp>
+#include <boost/channels/detail/work_tracker.hpp>
+#include <boost/channels/tie.hpp>
+#include <boost/channels/watch_channel.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace boost;
+using namespace std::literals;
+
+TEST_CASE("counted work keeps each context running until the last share")
+{
+    auto ioc1    = asio::io_context();
+    auto ioc2    = asio::io_context();
+    auto tracker = channels::detail::work_tracker< std::mutex >::create();
+
+    std::optional< channels::detail::counted_work< std::mutex > > a, b, c;
+    a.emplace(tracker->acquire(ioc1.get_executor()));
+    b.emplace(tracker->acquire(asio::any_io_executor(ioc1.get_executor())));
+    c.emplace(tracker->acquire(asio::make_strand(ioc2)));
+
+    // shares outlive the channel which handed them out
+    tracker->retire();
+
+    ioc1.run_for(1ms);
+    CHECK(!ioc1.stopped());
+    a.reset();
+    ioc1.run_for(1ms);
+    CHECK(!ioc1.stopped());
+    b.reset();
+    ioc1.run();
+    CHECK(ioc1.stopped());
+
+    ioc2.run_for(1ms);
+    CHECK(!ioc2.stopped());
+    c.reset();
+    ioc2.run();
+    CHECK(ioc2.stopped());
+}
+
+TEST_CASE("waiting ops keep the context running")
+{
+    auto ioc = asio::io_context();
+
+    SUBCASE("any_io_executor")
+    {
+        auto c = channels::channel< std::string >(ioc.get_executor());
+
+        int consumed = 0;
+        for (int i = 0; i < 3; ++i)
+            c.async_consume([&](channels::error_code ec, std::string) {
+                CHECK(!ec);
+                ++consumed;
+            });
+        ioc.run_for(1ms);
+        CHECK(!ioc.stopped());
+
+        for (int i = 0; i < 3; ++i)
+            c.async_send("a", [](channels::error_code ec) { CHECK(!ec); });
+        ioc.run();
+        CHECK(consumed == 3);
+    }
+
+    SUBCASE("concrete executor")
+    {
+        auto c = channels::channel< std::string,
+                                    asio::io_context::executor_type >(
+            ioc.get_executor());
+
+        std::optional< channels::error_code > sent;
+        c.async_send("a", [&](channels::error_code ec) { sent = ec; });
+        ioc.run_for(1ms);
+        CHECK(!ioc.stopped());
+        CHECK(!sent);
+
+        c.close();
+        ioc.run();
+        CHECK(sent == channels::errors::channel_closed);
+    }
+
+    SUBCASE("handler bound to a strand")
+    {
+        auto c      = channels::channel< std::string >(ioc.get_executor());
+        auto strand = asio::make_strand(ioc);
+
+        std::string received;
+        c.async_consume(asio::bind_executor(
+            strand, [&](channels::error_code, std::string s) {
+                CHECK(strand.running_in_this_thread());
+                received = std::move(s);
+            }));
+        ioc.run_for(1ms);
+        CHECK(!ioc.stopped());
+
+        c.async_send("a", [](channels::error_code) {});
+        ioc.run();
+        CHECK(received == "a");
+    }
+}
+
+TEST_CASE("every kind of waiting op keeps the context running")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::channel< int >(ioc.get_executor(), 1);
+
+    bool completed = false;
+    auto done      = [&](auto &&...) { completed = true; };
+
+    // an op parked on the channel, and the call which completes it
+    std::function< void() > complete = [&] {
+        c.async_send(1, [](channels::error_code) {});
+    };
+
+    std::vector< int > values;
+    int                value = 0;
+    SUBCASE("consume_some")
+    {
+        c.async_consume_some(4, values, done);
+    }
+    SUBCASE("consume_inplace")
+    {
+        c.async_consume_inplace([](int &) {}, done);
+    }
+    SUBCASE("consume_for")
+    {
+        c.async_consume_for(1h, done);
+    }
+    SUBCASE("select")
+    {
+        channels::tie(value << c).async_wait(done);
+    }
+    SUBCASE("send_range")
+    {
+        values = { 1, 2 };
+        c.async_send_range(values.begin(), values.end(), done);
+        complete = [&] { c.async_consume([](channels::error_code, int) {}); };
+    }
+    SUBCASE("send_for")
+    {
+        c.async_send(0, [](channels::error_code) {});
+        c.async_send_for(1, 1h, done);
+        complete = [&] { c.async_consume([](channels::error_code, int) {}); };
+    }
+    SUBCASE("claim")
+    {
+        c.async_send(0, [](channels::error_code) {});
+        c.async_claim(done);
+        complete = [&] { c.async_consume([](channels::error_code, int) {}); };
+    }
+
+    ioc.run_for(1ms);
+    CHECK(!ioc.stopped());
+    REQUIRE(!completed);
+
+    // the context stops once the op has completed
+    complete();
+    ioc.run();
+    CHECK(completed);
+}
+
+TEST_CASE("waiting watch receivers keep the context running")
+{
+    auto ioc = asio::io_context();
+    auto c   = channels::watch_channel< int >(ioc.get_executor());
+    auto rx  = c.subscribe();
+
+    std::optional< int > received;
+    rx.async_consume([&](channels::error_code ec, int v) {
+        CHECK(!ec);
+        received = v;
+    });
+    ioc.run_for(1ms);
+    CHECK(!ioc.stopped());
+    REQUIRE(!received);
+
+    channels::error_code ec;
+    c.send(1, ec);
+    ioc.run();
+    CHECK(received == 1);
+}
+
+TEST_CASE("ops complete after their channel is destroyed")
+{
+    auto ioc = asio::io_context();
+
+    std::optional< channels::error_code > consumed;
+    {
+        auto c = channels::channel< std::string >(ioc.get_executor());
+        c.async_consume([&](channels::error_code ec, std::string) {
+            consumed = ec;
+        });
+    }
+    ioc.run();
+    CHECK(consumed == channels::errors::channel_closed);
+}